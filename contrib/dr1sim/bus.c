@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * System bus: boot ROM, on-chip memory, the NAND window of the static
+ * memory controller and the peripheral block.  Peripherals that are not
+ * modelled behave as plain read/write registers so that clock, MIO and
+ * reset setup done by the flash drivers reads back what was written.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr1sim.h"
+
+static uint8_t rom[ROM_SIZE];
+static uint8_t ocm[OCM_SIZE];
+
+#define SCRATCH_SLOTS 4096
+
+static struct {
+	uint32_t addr;
+	uint32_t value;
+	bool used;
+} scratch[SCRATCH_SLOTS];
+
+static uint32_t *scratch_word(uint64_t addr, bool create)
+{
+	uint32_t a = (uint32_t)addr & ~3u;
+	unsigned int i = (a >> 2) * 2654435761u % SCRATCH_SLOTS;
+
+	for (unsigned int n = 0; n < SCRATCH_SLOTS; n++, i = (i + 1) % SCRATCH_SLOTS) {
+		if (scratch[i].used && scratch[i].addr == a)
+			return &scratch[i].value;
+		if (!scratch[i].used) {
+			if (!create)
+				return NULL;
+			scratch[i].used = true;
+			scratch[i].addr = a;
+			scratch[i].value = 0;
+			return &scratch[i].value;
+		}
+	}
+	return NULL;
+}
+
+static uint64_t scratch_read(uint64_t addr, unsigned int size)
+{
+	uint64_t value = 0;
+
+	for (unsigned int i = 0; i < size; i += 4) {
+		uint32_t *w = scratch_word(addr + i, false);
+		value |= (uint64_t)(w ? *w : 0) << (8 * i);
+	}
+	if (size < 4)
+		value = (value >> (8 * (addr & 3))) & ((1ULL << (8 * size)) - 1);
+	return value;
+}
+
+static void scratch_write(uint64_t addr, unsigned int size, uint64_t value)
+{
+	if (size < 4) {
+		uint32_t *w = scratch_word(addr, true);
+		unsigned int shift = 8 * (addr & 3);
+		uint32_t mask = ((1u << (8 * size)) - 1) << shift;
+
+		if (w)
+			*w = (*w & ~mask) | (((uint32_t)value << shift) & mask);
+		return;
+	}
+	for (unsigned int i = 0; i < size; i += 4) {
+		uint32_t *w = scratch_word(addr + i, true);
+		if (w)
+			*w = (uint32_t)(value >> (8 * i));
+	}
+}
+
+void bus_init(void)
+{
+	/* The boot ROM parks the hart in wfi until a debugger takes over. */
+	static const uint32_t boot[] = {
+		0x10500073,	/* wfi */
+		0xffdff06f,	/* j . - 4 */
+	};
+
+	memcpy(rom, boot, sizeof(boot));
+	memset(ocm, 0, sizeof(ocm));
+	memset(scratch, 0, sizeof(scratch));
+}
+
+void bus_reset(void)
+{
+	ssi_reset();
+	smc_reset();
+	mshc_reset();
+}
+
+uint8_t *bus_ram(uint64_t addr, size_t len)
+{
+	if (addr >= OCM_BASE && addr + len <= OCM_BASE + OCM_SIZE)
+		return ocm + (addr - OCM_BASE);
+	if (addr + len <= ROM_BASE + ROM_SIZE)
+		return rom + addr;
+	return NULL;
+}
+
+static uint64_t ram_read(const uint8_t *p, unsigned int size)
+{
+	uint64_t value = 0;
+
+	for (unsigned int i = 0; i < size; i++)
+		value |= (uint64_t)p[i] << (8 * i);
+	return value;
+}
+
+static void ram_write(uint8_t *p, unsigned int size, uint64_t value)
+{
+	for (unsigned int i = 0; i < size; i++)
+		p[i] = value >> (8 * i);
+}
+
+static bool in(uint64_t addr, unsigned int size, uint64_t base, uint64_t len)
+{
+	return addr >= base && addr + size <= base + len;
+}
+
+/** @returns 0 on success, -1 for an access fault. */
+int bus_read(uint64_t addr, unsigned int size, uint64_t *value)
+{
+	uint8_t *p = bus_ram(addr, size);
+
+	if (p) {
+		*value = ram_read(p, size);
+		return 0;
+	}
+
+	if (addr & (size - 1))
+		return -1;
+
+	if (in(addr, size, NAND_BASE, NAND_SIZE)) {
+		sim_now += cfg.bus_ps;
+		*value = nand_read(addr - NAND_BASE, size);
+		return 0;
+	}
+	if (!in(addr, size, PERIPH_BASE, PERIPH_SIZE))
+		return -1;
+
+	sim_now += cfg.bus_ps;
+	if (in(addr, size, SSI_BASE, 0x1000))
+		*value = ssi_read(addr - SSI_BASE, size);
+	else if (in(addr, size, SMC_BASE, 0x1000))
+		*value = smc_read(addr - SMC_BASE, size);
+	else if (in(addr, size, MSHC0_BASE, 0x1000))
+		*value = mshc_read(0, addr - MSHC0_BASE, size);
+	else if (in(addr, size, MSHC1_BASE, 0x1000))
+		*value = mshc_read(1, addr - MSHC1_BASE, size);
+	else
+		*value = scratch_read(addr, size);
+	return 0;
+}
+
+int bus_write(uint64_t addr, unsigned int size, uint64_t value)
+{
+	uint8_t *p = bus_ram(addr, size);
+
+	if (p) {
+		if (p < ocm || p >= ocm + OCM_SIZE)
+			return -1;	/* ROM */
+		ram_write(p, size, value);
+		return 0;
+	}
+
+	if (addr & (size - 1))
+		return -1;
+
+	if (in(addr, size, NAND_BASE, NAND_SIZE)) {
+		sim_now += cfg.bus_ps;
+		nand_write(addr - NAND_BASE, size, value);
+		return 0;
+	}
+	if (!in(addr, size, PERIPH_BASE, PERIPH_SIZE))
+		return -1;
+
+	sim_now += cfg.bus_ps;
+	if (in(addr, size, SSI_BASE, 0x1000))
+		ssi_write(addr - SSI_BASE, size, value);
+	else if (in(addr, size, SMC_BASE, 0x1000))
+		smc_write(addr - SMC_BASE, size, value);
+	else if (in(addr, size, MSHC0_BASE, 0x1000))
+		mshc_write(0, addr - MSHC0_BASE, size, value);
+	else if (in(addr, size, MSHC1_BASE, 0x1000))
+		mshc_write(1, addr - MSHC1_BASE, size, value);
+	else
+		scratch_write(addr, size, value);
+	return 0;
+}
@@ -0,0 +1,416 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Debug module, RISC-V external debug support 0.13: run control, abstract
+ * register access with program buffer execution, abstractauto and system
+ * bus access.  There is a single hart.
+ */
+
+#include "dr1sim.h"
+
+#define DM_DATA0	0x04
+#define DM_DATA1	0x05
+#define DM_DMCONTROL	0x10
+#define DM_DMSTATUS	0x11
+#define DM_HARTINFO	0x12
+#define DM_HALTSUM1	0x13
+#define DM_ABSTRACTCS	0x16
+#define DM_COMMAND	0x17
+#define DM_ABSTRACTAUTO	0x18
+#define DM_PROGBUF0	0x20
+#define DM_DMCS2	0x32
+#define DM_SBCS		0x38
+#define DM_SBADDRESS0	0x39
+#define DM_SBADDRESS1	0x3a
+#define DM_SBDATA0	0x3c
+#define DM_SBDATA1	0x3d
+#define DM_HALTSUM0	0x40
+
+#define DMCONTROL_HALTREQ		(1u << 31)
+#define DMCONTROL_RESUMEREQ		(1u << 30)
+#define DMCONTROL_ACKHAVERESET		(1u << 28)
+#define DMCONTROL_HARTSELLO_SHIFT	16
+#define DMCONTROL_SETRESETHALTREQ	(1u << 3)
+#define DMCONTROL_CLRRESETHALTREQ	(1u << 2)
+#define DMCONTROL_NDMRESET		(1u << 1)
+#define DMCONTROL_DMACTIVE		(1u << 0)
+
+#define CMDERR_NONE		0
+#define CMDERR_NOTSUP		2
+#define CMDERR_EXCEPTION	3
+#define CMDERR_HALTRESUME	4
+
+#define PROGBUF_SIZE	8
+#define DATA_COUNT	2
+
+#define SBCS_SBVERSION		(1u << 29)
+#define SBCS_SBBUSYERROR	(1u << 22)
+#define SBCS_SBREADONADDR	(1u << 20)
+#define SBCS_SBACCESS_SHIFT	17
+#define SBCS_SBAUTOINCREMENT	(1u << 16)
+#define SBCS_SBREADONDATA	(1u << 15)
+#define SBCS_SBERROR_SHIFT	12
+#define SBCS_SBASIZE		(32u << 5)
+#define SBCS_SBACCESS_ALL	0x0f	/* 8, 16, 32 and 64 bit */
+#define SBCS_RW_MASK		(SBCS_SBREADONADDR | (7u << SBCS_SBACCESS_SHIFT) | \
+				 SBCS_SBAUTOINCREMENT | SBCS_SBREADONDATA)
+
+static struct {
+	bool active;
+	unsigned int hartsel;
+	bool ndmreset;
+	bool resethaltreq;
+	bool havereset;
+	bool resumeack;
+	uint32_t data[DATA_COUNT];
+	uint32_t progbuf[PROGBUF_SIZE];
+	unsigned int cmderr;
+	uint32_t command;
+	uint32_t abstractauto;
+	uint32_t sbcs;
+	uint32_t sbaddress;
+	uint32_t sbdata[2];
+} dm;
+
+void dm_reset(void)
+{
+	dm.active = false;
+	dm.hartsel = 0;
+	dm.ndmreset = false;
+	dm.resethaltreq = false;
+	dm.resumeack = false;
+	for (int i = 0; i < DATA_COUNT; i++)
+		dm.data[i] = 0;
+	for (int i = 0; i < PROGBUF_SIZE; i++)
+		dm.progbuf[i] = 0;
+	dm.cmderr = CMDERR_NONE;
+	dm.command = 0;
+	dm.abstractauto = 0;
+	dm.sbcs = 2u << SBCS_SBACCESS_SHIFT;
+	dm.sbaddress = 0;
+	dm.sbdata[0] = 0;
+	dm.sbdata[1] = 0;
+}
+
+/** Reset the hart and the peripherals, from ndmreset or nSRST. */
+void dm_system_reset(bool assert)
+{
+	if (assert) {
+		hart.in_reset = true;
+		return;
+	}
+	if (!hart.in_reset)
+		return;
+
+	sim_debug("system reset");
+	hart_reset();
+	bus_reset();
+	hart.in_reset = false;
+	dm.havereset = true;
+	if (dm.resethaltreq)
+		hart_halt(HALT_RESETHALTREQ);
+}
+
+static bool hart_selected(void)
+{
+	return dm.hartsel == 0;
+}
+
+static uint32_t dmstatus(void)
+{
+	uint32_t v = 2;			/* version 0.13 */
+
+	v |= 1u << 7;			/* authenticated */
+	v |= 1u << 5;			/* hasresethaltreq */
+	v |= 1u << 22;			/* impebreak */
+	if (!hart_selected())
+		return v | (3u << 14);	/* all/anynonexistent */
+
+	if (dm.havereset)
+		v |= 3u << 18;
+	if (dm.resumeack)
+		v |= 3u << 16;
+	if (hart.in_reset)
+		v |= 3u << 12;		/* all/anyunavail */
+	else if (hart.halted)
+		v |= 3u << 8;		/* all/anyhalted */
+	else
+		v |= 3u << 10;		/* all/anyrunning */
+	return v;
+}
+
+static int access_register(uint32_t command)
+{
+	unsigned int aarsize = (command >> 20) & 7;
+	bool postexec = command & (1u << 18);
+	bool transfer = command & (1u << 17);
+	bool write = command & (1u << 16);
+	unsigned int regno = command & 0xffff;
+
+	if (aarsize != 2 && aarsize != 3)
+		return CMDERR_NOTSUP;
+	if (!hart.halted)
+		return CMDERR_HALTRESUME;
+
+	if (transfer) {
+		uint64_t value = dm.data[0];
+
+		if (aarsize == 3)
+			value |= (uint64_t)dm.data[1] << 32;
+
+		if (regno >= 0x1000 && regno <= 0x101f) {
+			unsigned int r = regno - 0x1000;
+
+			if (write) {
+				if (r)
+					hart.x[r] = value;
+			} else {
+				value = hart.x[r];
+			}
+		} else if (regno < 0x1000) {
+			if (write ? hart_write_csr(regno, value) : hart_read_csr(regno, &value))
+				return CMDERR_EXCEPTION;
+		} else {
+			return CMDERR_EXCEPTION;
+		}
+
+		if (!write) {
+			dm.data[0] = value;
+			if (aarsize == 3)
+				dm.data[1] = value >> 32;
+		}
+	}
+
+	if (command & (1u << 19))
+		dm.command = (command & ~0xffffu) | ((regno + 1) & 0xffff);
+
+	if (postexec && hart_exec_progbuf(dm.progbuf, PROGBUF_SIZE) < 0)
+		return CMDERR_EXCEPTION;
+	return CMDERR_NONE;
+}
+
+static void execute_command(void)
+{
+	unsigned int cmdtype = dm.command >> 24;
+
+	if (dm.cmderr)
+		return;
+	if (cmdtype != 0)
+		dm.cmderr = CMDERR_NOTSUP;
+	else
+		dm.cmderr = access_register(dm.command);
+	if (dm.cmderr)
+		sim_debug("abstract command 0x%08x failed, cmderr %u", dm.command, dm.cmderr);
+}
+
+static void autoexec_data(unsigned int index)
+{
+	if (dm.abstractauto & (1u << index))
+		execute_command();
+}
+
+static void autoexec_progbuf(unsigned int index)
+{
+	if (dm.abstractauto & (1u << (16 + index)))
+		execute_command();
+}
+
+static unsigned int sb_size(void)
+{
+	return 1u << ((dm.sbcs >> SBCS_SBACCESS_SHIFT) & 7);
+}
+
+static bool sb_error(void)
+{
+	return dm.sbcs & (SBCS_SBBUSYERROR | (7u << SBCS_SBERROR_SHIFT));
+}
+
+static void sb_set_error(unsigned int error)
+{
+	dm.sbcs |= error << SBCS_SBERROR_SHIFT;
+}
+
+static void sb_read(void)
+{
+	unsigned int size = sb_size();
+	uint64_t value;
+
+	if (size > 8) {
+		sb_set_error(4);
+		return;
+	}
+	if (dm.sbaddress & (size - 1)) {
+		sb_set_error(3);
+		return;
+	}
+	if (bus_read(dm.sbaddress, size, &value) < 0) {
+		sb_set_error(2);
+		return;
+	}
+	dm.sbdata[0] = value;
+	dm.sbdata[1] = value >> 32;
+	if (dm.sbcs & SBCS_SBAUTOINCREMENT)
+		dm.sbaddress += size;
+}
+
+static void sb_write(void)
+{
+	unsigned int size = sb_size();
+	uint64_t value = dm.sbdata[0] | (uint64_t)dm.sbdata[1] << 32;
+
+	if (size > 8) {
+		sb_set_error(4);
+		return;
+	}
+	if (dm.sbaddress & (size - 1)) {
+		sb_set_error(3);
+		return;
+	}
+	if (bus_write(dm.sbaddress, size, value) < 0) {
+		sb_set_error(2);
+		return;
+	}
+	if (dm.sbcs & SBCS_SBAUTOINCREMENT)
+		dm.sbaddress += size;
+}
+
+uint32_t dm_read(unsigned int addr)
+{
+	uint32_t v;
+
+	if (addr == DM_DMCONTROL)
+		return (dm.hartsel << DMCONTROL_HARTSELLO_SHIFT) |
+			(dm.ndmreset ? DMCONTROL_NDMRESET : 0) | (dm.active ? DMCONTROL_DMACTIVE : 0);
+	if (!dm.active)
+		return 0;
+
+	switch (addr) {
+		case DM_DATA0:
+		case DM_DATA1:
+			v = dm.data[addr - DM_DATA0];
+			autoexec_data(addr - DM_DATA0);
+			return v;
+		case DM_DMSTATUS:
+			return dmstatus();
+		case DM_HARTINFO:
+			return 0;
+		case DM_HALTSUM0:
+		case DM_HALTSUM1:
+			return hart.halted ? 1 : 0;
+		case DM_ABSTRACTCS:
+			return (PROGBUF_SIZE << 24) | (dm.cmderr << 8) | DATA_COUNT;
+		case DM_COMMAND:
+			return 0;
+		case DM_ABSTRACTAUTO:
+			return dm.abstractauto;
+		case DM_SBCS:
+			return dm.sbcs | SBCS_SBVERSION | SBCS_SBASIZE | SBCS_SBACCESS_ALL;
+		case DM_SBADDRESS0:
+			return dm.sbaddress;
+		case DM_SBDATA0:
+			v = dm.sbdata[0];
+			if (!sb_error() && (dm.sbcs & SBCS_SBREADONDATA))
+				sb_read();
+			return v;
+		case DM_SBDATA1:
+			return dm.sbdata[1];
+	}
+
+	if (addr >= DM_PROGBUF0 && addr < DM_PROGBUF0 + PROGBUF_SIZE) {
+		v = dm.progbuf[addr - DM_PROGBUF0];
+		autoexec_progbuf(addr - DM_PROGBUF0);
+		return v;
+	}
+	return 0;
+}
+
+static void write_dmcontrol(uint32_t value)
+{
+	if (!(value & DMCONTROL_DMACTIVE)) {
+		dm_reset();
+		return;
+	}
+	dm.active = true;
+
+	/* One hart, one implemented hartsel bit to let it be discovered. */
+	dm.hartsel = (value >> DMCONTROL_HARTSELLO_SHIFT) & 1;
+
+	if (value & DMCONTROL_ACKHAVERESET)
+		dm.havereset = false;
+	if (value & DMCONTROL_SETRESETHALTREQ)
+		dm.resethaltreq = true;
+	if (value & DMCONTROL_CLRRESETHALTREQ)
+		dm.resethaltreq = false;
+
+	if (dm.ndmreset != !!(value & DMCONTROL_NDMRESET)) {
+		dm.ndmreset = value & DMCONTROL_NDMRESET;
+		dm_system_reset(dm.ndmreset);
+	}
+
+	if (!hart_selected() || hart.in_reset)
+		return;
+
+	if (value & DMCONTROL_HALTREQ) {
+		hart_halt(HALT_HALTREQ);
+	} else if (value & DMCONTROL_RESUMEREQ) {
+		dm.resumeack = false;
+		hart_resume();
+		dm.resumeack = true;
+	}
+}
+
+void dm_write(unsigned int addr, uint32_t value)
+{
+	if (addr == DM_DMCONTROL) {
+		write_dmcontrol(value);
+		return;
+	}
+	if (!dm.active)
+		return;
+
+	switch (addr) {
+		case DM_DATA0:
+		case DM_DATA1:
+			dm.data[addr - DM_DATA0] = value;
+			autoexec_data(addr - DM_DATA0);
+			return;
+		case DM_ABSTRACTCS:
+			dm.cmderr &= ~((value >> 8) & 7);
+			return;
+		case DM_COMMAND:
+			dm.command = value;
+			execute_command();
+			return;
+		case DM_ABSTRACTAUTO:
+			dm.abstractauto = value & (0xffff0000 | ((1u << DATA_COUNT) - 1));
+			dm.abstractauto &= ((1u << (16 + PROGBUF_SIZE)) - 1) | 0xffff;
+			return;
+		case DM_SBCS:
+			dm.sbcs = (dm.sbcs & ~SBCS_RW_MASK) | (value & SBCS_RW_MASK);
+			dm.sbcs &= ~(value & SBCS_SBBUSYERROR);
+			dm.sbcs &= ~(value & (7u << SBCS_SBERROR_SHIFT));
+			return;
+		case DM_SBADDRESS0:
+			dm.sbaddress = value;
+			if (!sb_error() && (dm.sbcs & SBCS_SBREADONADDR))
+				sb_read();
+			return;
+		case DM_SBADDRESS1:
+			return;
+		case DM_SBDATA0:
+			dm.sbdata[0] = value;
+			if (!sb_error())
+				sb_write();
+			return;
+		case DM_SBDATA1:
+			dm.sbdata[1] = value;
+			return;
+		case DM_DMCS2:
+			return;
+	}
+
+	if (addr >= DM_PROGBUF0 && addr < DM_PROGBUF0 + PROGBUF_SIZE) {
+		dm.progbuf[addr - DM_PROGBUF0] = value;
+		autoexec_progbuf(addr - DM_PROGBUF0);
+	}
+}
@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * dr1sim - software model of the Anlogic DR1 RISC-V processing unit,
+ * reachable through the OpenOCD remote_bitbang driver.
+ */
+
+#ifndef DR1SIM_H
+#define DR1SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* All simulated time is kept in picoseconds. */
+#define PS_PER_NS	UINT64_C(1000)
+#define PS_PER_US	UINT64_C(1000000)
+#define PS_PER_MS	UINT64_C(1000000000)
+
+/* Memory map */
+#define ROM_BASE	0x00000000ULL
+#define ROM_SIZE	0x1000
+#define OCM_BASE	0x61000000ULL
+#define OCM_SIZE	0x40000
+#define NAND_BASE	0x64000000ULL
+#define NAND_SIZE	0x01000000
+#define PERIPH_BASE	0xF8000000ULL
+#define PERIPH_SIZE	0x01000000
+#define SSI_BASE	0xF804E000ULL
+#define MSHC0_BASE	0xF8049000ULL
+#define MSHC1_BASE	0xF804A000ULL
+#define SMC_BASE	0xF841A000ULL
+
+enum stuck_target {
+	STUCK_NONE,
+	STUCK_NOR,
+	STUCK_NAND,
+	STUCK_EMMC,
+};
+
+struct sim_config {
+	int port;
+	bool pjtag;		/* rpu alone on the chain */
+	bool lockstep;		/* hart only advances with TCK */
+	bool verbose;
+	uint64_t tck_ps;
+	uint64_t cpu_ps;	/* one instruction */
+	uint64_t bus_ps;	/* extra cost of a peripheral access */
+	uint64_t ssi_clk_ps;	/* SSI controller input clock */
+	unsigned int ssi_speedup;
+	double flash_time_scale;
+	unsigned int dmi_busy_tcks;
+	uint32_t nor_id;
+	uint32_t nor_size;
+	enum stuck_target stuck;
+	uint64_t stuck_offset;
+	unsigned int stuck_bit;
+};
+
+struct sim_stats {
+	uint64_t tcks;
+	uint64_t dmi_ops;
+	uint64_t instret;
+	uint64_t nor_programmed;
+	uint64_t nand_programmed;
+	uint64_t emmc_written;
+	uint64_t ssi_underruns;
+	uint64_t ssi_overruns;
+};
+
+extern struct sim_config cfg;
+extern struct sim_stats stats;
+extern uint64_t sim_now;
+
+void sim_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void sim_debug(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+uint64_t flash_time(uint64_t us);
+
+/* bus.c */
+void bus_init(void);
+void bus_reset(void);
+int bus_read(uint64_t addr, unsigned int size, uint64_t *value);
+int bus_write(uint64_t addr, unsigned int size, uint64_t value);
+uint8_t *bus_ram(uint64_t addr, size_t len);
+
+/* jtag.c */
+void jtag_reset(void);
+void jtag_clock(int tms, int tdi);
+int jtag_tdo(void);
+
+/* dm.c */
+void dm_reset(void);
+uint32_t dm_read(unsigned int addr);
+void dm_write(unsigned int addr, uint32_t value);
+void dm_system_reset(bool assert);
+
+/* hart.c */
+enum halt_cause {
+	HALT_EBREAK = 1,
+	HALT_TRIGGER = 2,
+	HALT_HALTREQ = 3,
+	HALT_STEP = 4,
+	HALT_RESETHALTREQ = 5,
+};
+
+struct hart {
+	uint64_t x[32];
+	uint64_t pc;
+	uint64_t mstatus, mtvec, mepc, mcause, mtval, mscratch, mie;
+	uint64_t dcsr, dpc, dscratch[2];
+	uint64_t pmp[80];
+	bool halted;
+	bool wfi;
+	bool lockup;
+	bool in_reset;
+};
+
+extern struct hart hart;
+
+void hart_reset(void);
+void hart_halt(enum halt_cause cause);
+void hart_resume(void);
+bool hart_runnable(void);
+void hart_run_until(uint64_t t);
+int hart_read_csr(unsigned int csr, uint64_t *value);
+int hart_write_csr(unsigned int csr, uint64_t value);
+int hart_exec_progbuf(const uint32_t *progbuf, unsigned int count);
+
+/* ssi.c */
+void ssi_reset(void);
+uint64_t ssi_read(uint64_t off, unsigned int size);
+void ssi_write(uint64_t off, unsigned int size, uint64_t value);
+uint8_t *nor_data(void);
+
+/* smc.c */
+void smc_reset(void);
+uint64_t smc_read(uint64_t off, unsigned int size);
+void smc_write(uint64_t off, unsigned int size, uint64_t value);
+uint64_t nand_read(uint64_t off, unsigned int size);
+void nand_write(uint64_t off, unsigned int size, uint64_t value);
+const uint8_t *nand_page(uint32_t page);
+unsigned int nand_page_size(void);
+unsigned int nand_oob_size(void);
+
+/* mshc.c */
+void mshc_reset(void);
+uint64_t mshc_read(int id, uint64_t off, unsigned int size);
+void mshc_write(int id, uint64_t off, unsigned int size, uint64_t value);
+void emmc_read_block(uint32_t block, uint8_t *buf);
+
+/* selftest.c */
+int selftest(void);
+
+#endif /* DR1SIM_H */
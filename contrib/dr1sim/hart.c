@@ -0,0 +1,691 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * RV64IM machine-mode hart with the debug mode state of the RISC-V
+ * debug specification 0.13: dcsr, dpc, dscratch, halting on ebreak,
+ * single step and execution of the debug module program buffer.
+ */
+
+#include "dr1sim.h"
+
+struct hart hart;
+
+#define MISA_RV64IM	((2ULL << 62) | (1ULL << ('I' - 'A')) | (1ULL << ('M' - 'A')))
+
+#define MSTATUS_MIE	(1ULL << 3)
+#define MSTATUS_MPIE	(1ULL << 7)
+#define MSTATUS_MPP	(3ULL << 11)
+
+#define DCSR_XDEBUGVER	(4ULL << 28)
+#define DCSR_EBREAKM	(1ULL << 15)
+#define DCSR_STEPIE	(1ULL << 11)
+#define DCSR_STOPCOUNT	(1ULL << 10)
+#define DCSR_STOPTIME	(1ULL << 9)
+#define DCSR_CAUSE	(7ULL << 6)
+#define DCSR_STEP	(1ULL << 2)
+#define DCSR_PRV	3ULL
+#define DCSR_WRITABLE	(DCSR_EBREAKM | DCSR_STEPIE | DCSR_STOPCOUNT | DCSR_STOPTIME | DCSR_STEP)
+
+#define EXC_INSN_MISALIGNED	0
+#define EXC_INSN_FAULT		1
+#define EXC_ILLEGAL		2
+#define EXC_BREAKPOINT		3
+#define EXC_LOAD_FAULT		5
+#define EXC_STORE_FAULT		7
+#define EXC_ECALL_M		11
+
+/* execute() results besides an exception number */
+#define EXEC_OK		(-1)
+#define EXEC_EBREAK	(-2)
+
+/* Program buffer instructions are fetched from a private address. */
+#define PROGBUF_ADDR	0x800ULL
+#define PROGBUF_LIMIT	1024
+
+static uint64_t minstret;
+static uint64_t trap_tval;
+static bool stepping;
+
+void hart_reset(void)
+{
+	for (int i = 0; i < 32; i++)
+		hart.x[i] = 0;
+	hart.pc = ROM_BASE;
+	hart.mstatus = MSTATUS_MPP;
+	hart.mtvec = 0;
+	hart.mepc = 0;
+	hart.mcause = 0;
+	hart.mtval = 0;
+	hart.mscratch = 0;
+	hart.mie = 0;
+	hart.dcsr = DCSR_XDEBUGVER | DCSR_PRV;
+	hart.dpc = 0;
+	hart.dscratch[0] = 0;
+	hart.dscratch[1] = 0;
+	for (int i = 0; i < 80; i++)
+		hart.pmp[i] = 0;
+	hart.halted = false;
+	hart.wfi = false;
+	hart.lockup = false;
+	minstret = 0;
+	stepping = false;
+}
+
+bool hart_runnable(void)
+{
+	return !hart.halted && !hart.wfi && !hart.lockup && !hart.in_reset;
+}
+
+void hart_halt(enum halt_cause cause)
+{
+	if (hart.halted)
+		return;
+	hart.dpc = hart.pc;
+	hart.dcsr = (hart.dcsr & ~DCSR_CAUSE) | ((uint64_t)cause << 6) | DCSR_PRV;
+	hart.halted = true;
+	hart.wfi = false;
+	hart.lockup = false;
+	stepping = false;
+	sim_debug("hart halted, cause %d, dpc 0x%llx", cause, (unsigned long long)hart.dpc);
+}
+
+void hart_resume(void)
+{
+	if (!hart.halted)
+		return;
+	hart.pc = hart.dpc;
+	hart.halted = false;
+	stepping = hart.dcsr & DCSR_STEP;
+	sim_debug("hart resumed at 0x%llx%s", (unsigned long long)hart.pc, stepping ? " (step)" : "");
+}
+
+int hart_read_csr(unsigned int csr, uint64_t *value)
+{
+	switch (csr) {
+		case 0x300:
+			*value = hart.mstatus;
+			return 0;
+		case 0x301:
+			*value = MISA_RV64IM;
+			return 0;
+		case 0x304:
+			*value = hart.mie;
+			return 0;
+		case 0x305:
+			*value = hart.mtvec;
+			return 0;
+		case 0x340:
+			*value = hart.mscratch;
+			return 0;
+		case 0x341:
+			*value = hart.mepc;
+			return 0;
+		case 0x342:
+			*value = hart.mcause;
+			return 0;
+		case 0x343:
+			*value = hart.mtval;
+			return 0;
+		case 0x344:	/* mip: no interrupt sources */
+		case 0x320:	/* mcountinhibit */
+		case 0xf11:	/* mvendorid */
+		case 0xf12:	/* marchid */
+		case 0xf13:	/* mimpid */
+		case 0xf14:	/* mhartid */
+		case 0x7a0:	/* tselect: no triggers, reads back 0 */
+		case 0x7a1:
+		case 0x7a2:
+		case 0x7a3:
+			*value = 0;
+			return 0;
+		case 0x7b0:
+		case 0x7b1:
+		case 0x7b2:
+		case 0x7b3:
+			if (!hart.halted)
+				return -1;
+			*value = csr == 0x7b0 ? hart.dcsr : csr == 0x7b1 ? hart.dpc : hart.dscratch[csr - 0x7b2];
+			return 0;
+		case 0xb00:
+		case 0xb02:
+		case 0xc00:
+		case 0xc02:
+			*value = minstret;
+			return 0;
+	}
+
+	if ((csr >= 0xb03 && csr <= 0xb1f) || (csr >= 0xc03 && csr <= 0xc1f) ||
+			(csr >= 0x323 && csr <= 0x33f)) {
+		*value = 0;
+		return 0;
+	}
+	if (csr >= 0x3a0 && csr <= 0x3ef) {
+		if (csr <= 0x3af && (csr & 1))
+			return -1;	/* odd pmpcfg do not exist on RV64 */
+		*value = hart.pmp[csr - 0x3a0];
+		return 0;
+	}
+	return -1;
+}
+
+int hart_write_csr(unsigned int csr, uint64_t value)
+{
+	if ((csr >> 10) == 3)
+		return -1;	/* read-only */
+
+	switch (csr) {
+		case 0x300:
+			hart.mstatus = (value & (MSTATUS_MIE | MSTATUS_MPIE)) | MSTATUS_MPP;
+			return 0;
+		case 0x301:
+		case 0x344:
+		case 0x320:
+		case 0x7a0:
+		case 0x7a1:
+		case 0x7a2:
+		case 0x7a3:
+			return 0;
+		case 0x304:
+			hart.mie = value & 0x888;
+			return 0;
+		case 0x305:
+			hart.mtvec = value & ~2ULL;
+			return 0;
+		case 0x340:
+			hart.mscratch = value;
+			return 0;
+		case 0x341:
+			hart.mepc = value & ~3ULL;
+			return 0;
+		case 0x342:
+			hart.mcause = value;
+			return 0;
+		case 0x343:
+			hart.mtval = value;
+			return 0;
+		case 0x7b0:
+			if (!hart.halted)
+				return -1;
+			hart.dcsr = (hart.dcsr & ~DCSR_WRITABLE) | (value & DCSR_WRITABLE);
+			return 0;
+		case 0x7b1:
+			if (!hart.halted)
+				return -1;
+			hart.dpc = value & ~3ULL;
+			return 0;
+		case 0x7b2:
+		case 0x7b3:
+			if (!hart.halted)
+				return -1;
+			hart.dscratch[csr - 0x7b2] = value;
+			return 0;
+		case 0xb00:
+		case 0xb02:
+			minstret = value;
+			return 0;
+	}
+
+	if ((csr >= 0xb03 && csr <= 0xb1f) || (csr >= 0x323 && csr <= 0x33f))
+		return 0;
+	if (csr >= 0x3a0 && csr <= 0x3ef) {
+		if (csr <= 0x3af && (csr & 1))
+			return -1;
+		hart.pmp[csr - 0x3a0] = value;
+		return 0;
+	}
+	return -1;
+}
+
+static inline int64_t sext(uint64_t value, int bits)
+{
+	return (int64_t)(value << (64 - bits)) >> (64 - bits);
+}
+
+static void set_reg(unsigned int rd, uint64_t value)
+{
+	if (rd)
+		hart.x[rd] = value;
+}
+
+static int load(uint64_t addr, unsigned int funct3, uint64_t *value)
+{
+	static const unsigned int sizes[8] = { 1, 2, 4, 8, 1, 2, 4, 0 };
+	unsigned int size = sizes[funct3];
+	uint64_t v;
+
+	if (!size)
+		return EXC_ILLEGAL;
+	if (bus_read(addr, size, &v) < 0) {
+		trap_tval = addr;
+		return EXC_LOAD_FAULT;
+	}
+	*value = funct3 < 3 ? (uint64_t)sext(v, 8 * size) : v;
+	return EXEC_OK;
+}
+
+static int64_t div_s(int64_t a, int64_t b)
+{
+	if (b == 0)
+		return -1;
+	if (a == INT64_MIN && b == -1)
+		return a;
+	return a / b;
+}
+
+static int64_t rem_s(int64_t a, int64_t b)
+{
+	if (b == 0)
+		return a;
+	if (a == INT64_MIN && b == -1)
+		return 0;
+	return a % b;
+}
+
+static uint64_t alu(unsigned int funct3, unsigned int funct7, uint64_t a, uint64_t b, bool *illegal)
+{
+	if (funct7 == 1) {
+		switch (funct3) {
+			case 0:
+				return a * b;
+			case 1:
+				return (uint64_t)(((__int128)(int64_t)a * (__int128)(int64_t)b) >> 64);
+			case 2:
+				return (uint64_t)(((__int128)(int64_t)a * (unsigned __int128)b) >> 64);
+			case 3:
+				return (uint64_t)(((unsigned __int128)a * b) >> 64);
+			case 4:
+				return div_s(a, b);
+			case 5:
+				return b ? a / b : ~0ULL;
+			case 6:
+				return rem_s(a, b);
+			default:
+				return b ? a % b : a;
+		}
+	}
+
+	if (funct7 != 0 && !(funct7 == 0x20 && (funct3 == 0 || funct3 == 5))) {
+		*illegal = true;
+		return 0;
+	}
+
+	switch (funct3) {
+		case 0:
+			return funct7 ? a - b : a + b;
+		case 1:
+			return a << (b & 63);
+		case 2:
+			return (int64_t)a < (int64_t)b;
+		case 3:
+			return a < b;
+		case 4:
+			return a ^ b;
+		case 5:
+			return funct7 ? (uint64_t)((int64_t)a >> (b & 63)) : a >> (b & 63);
+		case 6:
+			return a | b;
+		default:
+			return a & b;
+	}
+}
+
+static uint64_t alu32(unsigned int funct3, unsigned int funct7, uint64_t a, uint64_t b, bool *illegal)
+{
+	int32_t sa = (int32_t)a, sb = (int32_t)b;
+	uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+
+	if (funct7 == 1) {
+		switch (funct3) {
+			case 0:
+				return (uint64_t)(int64_t)(int32_t)(ua * ub);
+			case 4:
+				if (sb == 0)
+					return ~0ULL;
+				if (sa == INT32_MIN && sb == -1)
+					return (uint64_t)(int64_t)sa;
+				return (uint64_t)(int64_t)(sa / sb);
+			case 5:
+				return (uint64_t)(int64_t)(int32_t)(ub ? ua / ub : ~0u);
+			case 6:
+				if (sb == 0)
+					return (uint64_t)(int64_t)sa;
+				if (sa == INT32_MIN && sb == -1)
+					return 0;
+				return (uint64_t)(int64_t)(sa % sb);
+			case 7:
+				return (uint64_t)(int64_t)(int32_t)(ub ? ua % ub : ua);
+			default:
+				*illegal = true;
+				return 0;
+		}
+	}
+
+	switch (funct3) {
+		case 0:
+			if (funct7 & ~0x20)
+				break;
+			return (uint64_t)(int64_t)(int32_t)(funct7 ? ua - ub : ua + ub);
+		case 1:
+			if (funct7)
+				break;
+			return (uint64_t)(int64_t)(int32_t)(ua << (ub & 31));
+		case 5:
+			if (funct7 == 0)
+				return (uint64_t)(int64_t)(int32_t)(ua >> (ub & 31));
+			if (funct7 == 0x20)
+				return (uint64_t)(int64_t)(sa >> (ub & 31));
+			break;
+	}
+	*illegal = true;
+	return 0;
+}
+
+static int csr_op(uint32_t insn)
+{
+	unsigned int rd = (insn >> 7) & 31;
+	unsigned int funct3 = (insn >> 12) & 7;
+	unsigned int rs1 = (insn >> 15) & 31;
+	unsigned int csr = insn >> 20;
+	uint64_t src = funct3 & 4 ? rs1 : hart.x[rs1];
+	uint64_t old = 0;
+	bool do_write = (funct3 & 3) == 1 || rs1 != 0;
+
+	if (hart_read_csr(csr, &old) < 0)
+		return EXC_ILLEGAL;
+
+	if (do_write) {
+		uint64_t value;
+
+		switch (funct3 & 3) {
+			case 1:
+				value = src;
+				break;
+			case 2:
+				value = old | src;
+				break;
+			default:
+				value = old & ~src;
+				break;
+		}
+		if (hart_write_csr(csr, value) < 0)
+			return EXC_ILLEGAL;
+	}
+	set_reg(rd, old);
+	return EXEC_OK;
+}
+
+static int system_op(uint32_t insn, uint64_t *npc)
+{
+	if ((insn >> 12) & 7)
+		return csr_op(insn);
+
+	switch (insn) {
+		case 0x00000073:
+			return EXC_ECALL_M;
+		case 0x00100073:
+			return EXEC_EBREAK;
+		case 0x30200073:	/* mret */
+			*npc = hart.mepc;
+			hart.mstatus = (hart.mstatus & ~MSTATUS_MIE) |
+				(hart.mstatus & MSTATUS_MPIE ? MSTATUS_MIE : 0) | MSTATUS_MPIE;
+			return EXEC_OK;
+		case 0x10500073:	/* wfi */
+			if (!hart.halted && !stepping)
+				hart.wfi = true;
+			return EXEC_OK;
+	}
+	return EXC_ILLEGAL;
+}
+
+/**
+ * Execute one instruction.
+ * @returns EXEC_OK with the next pc in @a npc, EXEC_EBREAK, or an
+ * exception number.
+ */
+static int execute(uint32_t insn, uint64_t pc, uint64_t *npc)
+{
+	unsigned int opcode = insn & 0x7f;
+	unsigned int rd = (insn >> 7) & 31;
+	unsigned int funct3 = (insn >> 12) & 7;
+	unsigned int rs1 = (insn >> 15) & 31;
+	unsigned int rs2 = (insn >> 20) & 31;
+	unsigned int funct7 = insn >> 25;
+	uint64_t a = hart.x[rs1], b = hart.x[rs2];
+	int64_t imm_i = (int32_t)insn >> 20;
+	int64_t sign = (int32_t)insn >> 31;
+	int64_t imm_s = (int64_t)((int32_t)insn >> 25) * 32 | ((insn >> 7) & 31);
+	int64_t imm_b = (int64_t)((uint64_t)sign << 12) | ((insn & 0x80) << 4) |
+		((insn >> 20) & 0x7e0) | ((insn >> 7) & 0x1e);
+	int64_t imm_u = (int32_t)(insn & 0xfffff000);
+	int64_t imm_j = (int64_t)((uint64_t)sign << 20) | (insn & 0xff000) |
+		((insn >> 9) & 0x800) | ((insn >> 20) & 0x7fe);
+	bool illegal = false;
+	uint64_t value;
+	int r;
+
+	*npc = pc + 4;
+
+	switch (opcode) {
+		case 0x37:	/* lui */
+			set_reg(rd, imm_u);
+			return EXEC_OK;
+		case 0x17:	/* auipc */
+			set_reg(rd, pc + imm_u);
+			return EXEC_OK;
+		case 0x6f:	/* jal */
+			set_reg(rd, pc + 4);
+			*npc = pc + imm_j;
+			break;
+		case 0x67:	/* jalr */
+			if (funct3)
+				return EXC_ILLEGAL;
+			*npc = (a + imm_i) & ~1ULL;
+			set_reg(rd, pc + 4);
+			break;
+		case 0x63: {	/* branches */
+			bool taken;
+
+			switch (funct3) {
+				case 0:
+					taken = a == b;
+					break;
+				case 1:
+					taken = a != b;
+					break;
+				case 4:
+					taken = (int64_t)a < (int64_t)b;
+					break;
+				case 5:
+					taken = (int64_t)a >= (int64_t)b;
+					break;
+				case 6:
+					taken = a < b;
+					break;
+				case 7:
+					taken = a >= b;
+					break;
+				default:
+					return EXC_ILLEGAL;
+			}
+			if (taken)
+				*npc = pc + imm_b;
+			break;
+		}
+		case 0x03:	/* loads */
+			r = load(a + imm_i, funct3, &value);
+			if (r != EXEC_OK)
+				return r;
+			set_reg(rd, value);
+			return EXEC_OK;
+		case 0x23:	/* stores */
+			if (funct3 > 3)
+				return EXC_ILLEGAL;
+			if (bus_write(a + imm_s, 1u << funct3, b) < 0) {
+				trap_tval = a + imm_s;
+				return EXC_STORE_FAULT;
+			}
+			return EXEC_OK;
+		case 0x13:	/* op-imm */
+			if (funct3 == 1 || funct3 == 5) {
+				unsigned int kind = insn >> 26;
+
+				if (kind != 0 && !(funct3 == 5 && kind == 0x10))
+					return EXC_ILLEGAL;
+				value = alu(funct3, kind ? 0x20 : 0, a, (insn >> 20) & 63, &illegal);
+			} else {
+				value = alu(funct3, 0, a, imm_i, &illegal);
+			}
+			set_reg(rd, value);
+			return EXEC_OK;
+		case 0x1b:	/* op-imm-32 */
+			if (funct3 == 0)
+				value = (uint64_t)(int64_t)(int32_t)(a + imm_i);
+			else
+				value = alu32(funct3, funct7, a, rs2, &illegal);
+			if (illegal)
+				return EXC_ILLEGAL;
+			set_reg(rd, value);
+			return EXEC_OK;
+		case 0x33:
+			value = alu(funct3, funct7, a, b, &illegal);
+			if (illegal)
+				return EXC_ILLEGAL;
+			set_reg(rd, value);
+			return EXEC_OK;
+		case 0x3b:
+			value = alu32(funct3, funct7, a, b, &illegal);
+			if (illegal)
+				return EXC_ILLEGAL;
+			set_reg(rd, value);
+			return EXEC_OK;
+		case 0x0f:	/* fence, fence.i */
+			if (funct3 > 1)
+				return EXC_ILLEGAL;
+			return EXEC_OK;
+		case 0x73:
+			return system_op(insn, npc);
+		default:
+			return EXC_ILLEGAL;
+	}
+
+	if (*npc & 3) {
+		trap_tval = *npc;
+		return EXC_INSN_MISALIGNED;
+	}
+	return EXEC_OK;
+}
+
+static int fetch(uint64_t pc, uint32_t *insn)
+{
+	const uint8_t *p;
+
+	if (pc & 3) {
+		trap_tval = pc;
+		return EXC_INSN_MISALIGNED;
+	}
+	p = bus_ram(pc, 4);
+	if (!p) {
+		trap_tval = pc;
+		return EXC_INSN_FAULT;
+	}
+	*insn = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+	return EXEC_OK;
+}
+
+static void take_trap(int cause, uint64_t pc)
+{
+	uint64_t base = hart.mtvec & ~3ULL;
+
+	if (cause == EXC_ILLEGAL) {
+		uint32_t insn = 0;
+
+		fetch(pc, &insn);
+		trap_tval = insn;
+	} else if (cause == EXC_BREAKPOINT || cause == EXC_ECALL_M) {
+		trap_tval = cause == EXC_BREAKPOINT ? pc : 0;
+	}
+
+	if (!bus_ram(base, 4)) {
+		/* There is nothing to run: the core would spin on the fault. */
+		sim_log("hart locked up: exception %d at pc 0x%llx (tval 0x%llx), mtvec 0x%llx",
+			cause, (unsigned long long)pc, (unsigned long long)trap_tval,
+			(unsigned long long)hart.mtvec);
+		hart.pc = pc;
+		hart.lockup = true;
+		return;
+	}
+
+	hart.mepc = pc;
+	hart.mcause = cause;
+	hart.mtval = trap_tval;
+	hart.mstatus = (hart.mstatus & ~(MSTATUS_MIE | MSTATUS_MPIE)) |
+		(hart.mstatus & MSTATUS_MIE ? MSTATUS_MPIE : 0) | MSTATUS_MPP;
+	hart.pc = base;
+}
+
+static void step(void)
+{
+	uint64_t pc = hart.pc, npc;
+	uint32_t insn;
+	int r = fetch(pc, &insn);
+
+	if (r == EXEC_OK)
+		r = execute(insn, pc, &npc);
+
+	sim_now += cfg.cpu_ps;
+	stats.instret++;
+	minstret++;
+
+	if (r == EXEC_OK) {
+		hart.pc = npc;
+	} else if (r == EXEC_EBREAK) {
+		if (hart.dcsr & DCSR_EBREAKM) {
+			hart.pc = pc;
+			hart_halt(HALT_EBREAK);
+			return;
+		}
+		take_trap(EXC_BREAKPOINT, pc);
+	} else {
+		take_trap(r, pc);
+	}
+
+	if (stepping && !hart.halted)
+		hart_halt(HALT_STEP);
+}
+
+void hart_run_until(uint64_t t)
+{
+	while (hart_runnable() && sim_now < t)
+		step();
+}
+
+/**
+ * Run the program buffer in debug mode.
+ * @returns 0 when it reached ebreak or the implicit ebreak after the
+ * last word, -1 if it raised an exception.
+ */
+int hart_exec_progbuf(const uint32_t *progbuf, unsigned int count)
+{
+	uint64_t pc = PROGBUF_ADDR, npc;
+
+	for (int n = 0; n < PROGBUF_LIMIT; n++) {
+		uint64_t index = (pc - PROGBUF_ADDR) / 4;
+		int r;
+
+		if (pc & 3 || pc < PROGBUF_ADDR || index > count)
+			return -1;
+		if (index == count)
+			return 0;
+
+		r = execute(progbuf[index], pc, &npc);
+		sim_now += cfg.cpu_ps;
+		if (r == EXEC_EBREAK)
+			return 0;
+		if (r != EXEC_OK) {
+			sim_debug("progbuf exception %d at word %llu", r, (unsigned long long)index);
+			return -1;
+		}
+		pc = npc;
+	}
+	return -1;
+}
@@ -0,0 +1,251 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * JTAG chain of the DR1: TDI -> fpga -> rsv -> dummy -> rpu -> TDO, or the
+ * rpu TAP alone when the processor JTAG pins are used.  Only the rpu TAP
+ * has anything behind it, a RISC-V debug transport module; the others
+ * just provide BYPASS.
+ */
+
+#include "dr1sim.h"
+
+enum tap_state {
+	TLR, RTI,
+	SELECT_DR, CAPTURE_DR, SHIFT_DR, EXIT1_DR, PAUSE_DR, EXIT2_DR, UPDATE_DR,
+	SELECT_IR, CAPTURE_IR, SHIFT_IR, EXIT1_IR, PAUSE_IR, EXIT2_IR, UPDATE_IR,
+};
+
+/* next state for TMS = 0 and TMS = 1 */
+static const enum tap_state next_state[16][2] = {
+	[TLR]        = { RTI, TLR },
+	[RTI]        = { RTI, SELECT_DR },
+	[SELECT_DR]  = { CAPTURE_DR, SELECT_IR },
+	[CAPTURE_DR] = { SHIFT_DR, EXIT1_DR },
+	[SHIFT_DR]   = { SHIFT_DR, EXIT1_DR },
+	[EXIT1_DR]   = { PAUSE_DR, UPDATE_DR },
+	[PAUSE_DR]   = { PAUSE_DR, EXIT2_DR },
+	[EXIT2_DR]   = { SHIFT_DR, UPDATE_DR },
+	[UPDATE_DR]  = { RTI, SELECT_DR },
+	[SELECT_IR]  = { CAPTURE_IR, TLR },
+	[CAPTURE_IR] = { SHIFT_IR, EXIT1_IR },
+	[SHIFT_IR]   = { SHIFT_IR, EXIT1_IR },
+	[EXIT1_IR]   = { PAUSE_IR, UPDATE_IR },
+	[PAUSE_IR]   = { PAUSE_IR, EXIT2_IR },
+	[EXIT2_IR]   = { SHIFT_IR, UPDATE_IR },
+	[UPDATE_IR]  = { RTI, SELECT_DR },
+};
+
+#define RPU_IR_IDCODE	0x01
+#define RPU_IR_DTMCS	0x10
+#define RPU_IR_DMI	0x11
+#define RPU_IDCODE	0x1c900a6d
+
+#define DMI_ABITS	7
+#define DMI_OP_NOP	0
+#define DMI_OP_READ	1
+#define DMI_OP_WRITE	2
+#define DMI_OP_BUSY	3
+
+struct tap {
+	const char *name;
+	unsigned int irlen;
+	uint32_t ircapture;
+	uint32_t ir;
+	uint64_t shift;
+	unsigned int len;
+};
+
+/* Ordered from TDO to TDI, like the "jtag newtap" declarations. */
+static struct tap taps[] = {
+	{ "rpu", 5, 0x01, 0, 0, 0 },
+	{ "dummy", 4, 0x01, 0, 0, 0 },
+	{ "rsv", 4, 0x01, 0, 0, 0 },
+	{ "fpga", 8, 0xc5, 0, 0, 0 },
+};
+
+static enum tap_state state;
+
+static struct {
+	uint32_t data;
+	unsigned int addr;
+	unsigned int status;	/* sticky DMI status */
+	uint64_t ready_tck;	/* TCK count when the last operation completes */
+} dtm;
+
+static unsigned int num_taps(void)
+{
+	return cfg.pjtag ? 1 : sizeof(taps) / sizeof(taps[0]);
+}
+
+static void tap_reset(struct tap *tap)
+{
+	/* rpu selects IDCODE after reset, the others BYPASS */
+	tap->ir = tap == &taps[0] ? RPU_IR_IDCODE : (1u << tap->irlen) - 1;
+}
+
+void jtag_reset(void)
+{
+	state = TLR;
+	for (unsigned int i = 0; i < num_taps(); i++)
+		tap_reset(&taps[i]);
+	dtm.data = 0;
+	dtm.addr = 0;
+	dtm.status = DMI_OP_NOP;
+	dtm.ready_tck = 0;
+}
+
+static bool dmi_busy(void)
+{
+	return stats.tcks < dtm.ready_tck;
+}
+
+static uint64_t rpu_capture_dr(unsigned int *len)
+{
+	switch (taps[0].ir) {
+		case RPU_IR_IDCODE:
+			*len = 32;
+			return RPU_IDCODE;
+		case RPU_IR_DTMCS:
+			*len = 32;
+			/* idle hint, dmistat, abits, version 0.13 */
+			return ((uint64_t)(cfg.dmi_busy_tcks ? 1 : 0) << 12) |
+				(dtm.status << 10) | (DMI_ABITS << 4) | 1;
+		case RPU_IR_DMI:
+			*len = DMI_ABITS + 34;
+			if (dmi_busy() && dtm.status == DMI_OP_NOP) {
+				sim_debug("DMI scanned while busy");
+				dtm.status = DMI_OP_BUSY;
+			}
+			return ((uint64_t)dtm.addr << 34) | ((uint64_t)dtm.data << 2) | dtm.status;
+		default:
+			*len = 1;
+			return 0;
+	}
+}
+
+static void dmi_update(uint64_t value)
+{
+	unsigned int op = value & 3;
+	uint32_t data = value >> 2;
+	unsigned int addr = (value >> 34) & ((1u << DMI_ABITS) - 1);
+
+	/* A sticky error or busy status makes the DTM ignore operations. */
+	if (dtm.status != DMI_OP_NOP || op == DMI_OP_NOP)
+		return;
+	if (dmi_busy()) {
+		dtm.status = DMI_OP_BUSY;
+		return;
+	}
+
+	stats.dmi_ops++;
+	dtm.addr = addr;
+	if (op == DMI_OP_READ) {
+		dtm.data = dm_read(addr);
+	} else if (op == DMI_OP_WRITE) {
+		dm_write(addr, data);
+	} else {
+		dtm.status = 2;
+		return;
+	}
+	dtm.ready_tck = stats.tcks + cfg.dmi_busy_tcks;
+}
+
+static void rpu_update_dr(uint64_t value)
+{
+	if (taps[0].ir == RPU_IR_DTMCS) {
+		if (value & (1u << 16))		/* dmireset */
+			dtm.status = DMI_OP_NOP;
+		if (value & (1u << 17)) {	/* dmihardreset */
+			dtm.status = DMI_OP_NOP;
+			dtm.ready_tck = 0;
+		}
+	} else if (taps[0].ir == RPU_IR_DMI) {
+		dmi_update(value);
+	}
+}
+
+static void capture(bool ir)
+{
+	for (unsigned int i = 0; i < num_taps(); i++) {
+		struct tap *tap = &taps[i];
+
+		if (ir) {
+			tap->shift = tap->ircapture;
+			tap->len = tap->irlen;
+		} else if (i == 0) {
+			tap->shift = rpu_capture_dr(&tap->len);
+		} else {
+			tap->shift = 0;
+			tap->len = 1;
+		}
+	}
+}
+
+static void shift(int tdi)
+{
+	int in = tdi;
+
+	/* Data enters at the TDI end, i.e. at the last TAP of the array. */
+	for (int i = num_taps() - 1; i >= 0; i--) {
+		struct tap *tap = &taps[i];
+		int out = tap->shift & 1;
+
+		tap->shift = (tap->shift >> 1) | ((uint64_t)in << (tap->len - 1));
+		in = out;
+	}
+}
+
+static void update(bool ir)
+{
+	for (unsigned int i = 0; i < num_taps(); i++) {
+		struct tap *tap = &taps[i];
+
+		if (ir) {
+			tap->ir = tap->shift & ((1u << tap->irlen) - 1);
+			if (i != 0 && tap->ir != (1u << tap->irlen) - 1)
+				sim_debug("%s TAP: instruction 0x%x treated as BYPASS", tap->name, tap->ir);
+		} else if (i == 0) {
+			rpu_update_dr(tap->shift);
+		}
+	}
+}
+
+/** Rising edge of TCK. */
+void jtag_clock(int tms, int tdi)
+{
+	stats.tcks++;
+
+	switch (state) {
+		case TLR:
+			for (unsigned int i = 0; i < num_taps(); i++)
+				tap_reset(&taps[i]);
+			break;
+		case CAPTURE_DR:
+			capture(false);
+			break;
+		case CAPTURE_IR:
+			capture(true);
+			break;
+		case SHIFT_DR:
+		case SHIFT_IR:
+			shift(tdi);
+			break;
+		case UPDATE_DR:
+			update(false);
+			break;
+		case UPDATE_IR:
+			update(true);
+			break;
+		default:
+			break;
+	}
+
+	state = next_state[state][tms ? 1 : 0];
+}
+
+int jtag_tdo(void)
+{
+	if (state != SHIFT_DR && state != SHIFT_IR)
+		return 0;
+	return taps[0].shift & 1;
+}
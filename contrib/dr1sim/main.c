@@ -0,0 +1,393 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * dr1sim - serve the simulated DR1 over the remote_bitbang protocol.
+ *
+ * OpenOCD connects with "adapter driver remote_bitbang".  Every rising TCK
+ * edge advances simulated time by one TCK period.  In the default
+ * free-running mode the hart also executes whenever the socket is idle, so
+ * loaders run at full host speed while OpenOCD is waiting; --lockstep
+ * instead lets the hart run only as far as the TCK clock has advanced,
+ * which makes the number of instructions a loader gets between two host
+ * accesses deterministic.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "dr1sim.h"
+
+struct sim_config cfg = {
+	.port = 5555,
+	.tck_ps = 100 * PS_PER_NS,		/* 10 MHz */
+	.cpu_ps = 2 * PS_PER_NS,		/* 500 MIPS */
+	.bus_ps = 20 * PS_PER_NS,
+	.ssi_clk_ps = 5 * PS_PER_NS,		/* 200 MHz */
+	.ssi_speedup = 1,
+	.flash_time_scale = 1.0,
+	.nor_id = 0xef4018,			/* Winbond W25Q128 */
+	.nor_size = 16 << 20,
+};
+
+struct sim_stats stats;
+uint64_t sim_now;
+
+/* instructions run per slice while the socket is idle */
+#define RUN_SLICE	4096
+
+void sim_log(const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "dr1sim: [%" PRIu64 " ns] ", sim_now / PS_PER_NS);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+void sim_debug(const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!cfg.verbose)
+		return;
+	fprintf(stderr, "dr1sim: [%" PRIu64 " ns] ", sim_now / PS_PER_NS);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+/** Flash array operation time, scaled by --flash-time-scale. */
+uint64_t flash_time(uint64_t us)
+{
+	return (uint64_t)((double)us * PS_PER_US * cfg.flash_time_scale);
+}
+
+static void print_stats(void)
+{
+	fprintf(stderr,
+		"dr1sim: %" PRIu64 " TCKs, %" PRIu64 " DMI ops, %" PRIu64 " instructions, "
+		"%.3f ms simulated\n"
+		"dr1sim: programmed NOR %" PRIu64 " B, NAND %" PRIu64 " B, eMMC %" PRIu64 " B; "
+		"SSI underruns %" PRIu64 ", overruns %" PRIu64 "\n",
+		stats.tcks, stats.dmi_ops, stats.instret, (double)sim_now / PS_PER_MS,
+		stats.nor_programmed, stats.nand_programmed, stats.emmc_written,
+		stats.ssi_underruns, stats.ssi_overruns);
+}
+
+static void power_on(void)
+{
+	bus_init();
+	dm_reset();
+	jtag_reset();
+	/* comes out of reset like after power-on: havereset set, hart in ROM */
+	dm_system_reset(true);
+	dm_system_reset(false);
+}
+
+struct conn {
+	int fd;
+	char out[4096];
+	size_t out_len;
+};
+
+static int flush_out(struct conn *c)
+{
+	size_t done = 0;
+
+	while (done < c->out_len) {
+		ssize_t n = write(c->fd, c->out + done, c->out_len - done);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		done += n;
+	}
+	c->out_len = 0;
+	return 0;
+}
+
+static int put_char(struct conn *c, char ch)
+{
+	if (c->out_len == sizeof(c->out) && flush_out(c) < 0)
+		return -1;
+	c->out[c->out_len++] = ch;
+	return 0;
+}
+
+static void tck_edge(int tms, int tdi)
+{
+	jtag_clock(tms, tdi);
+	sim_now += cfg.tck_ps;
+	if (cfg.lockstep)
+		hart_run_until(sim_now);
+}
+
+/** @returns 1 to keep going, 0 on 'Q', -1 on a socket error. */
+static int handle(struct conn *c, char ch, int *tck)
+{
+	switch (ch) {
+		case 'R':
+			return put_char(c, jtag_tdo() ? '1' : '0') < 0 ? -1 : 1;
+		case 'Q':
+			return 0;
+		case 'B':
+		case 'b':
+			return 1;
+		default:
+			break;
+	}
+
+	if (ch >= '0' && ch <= '7') {
+		int bits = ch - '0';
+		int new_tck = (bits >> 2) & 1;
+
+		if (new_tck && !*tck)
+			tck_edge((bits >> 1) & 1, bits & 1);
+		*tck = new_tck;
+		return 1;
+	}
+
+	if (ch >= 'r' && ch <= 'u') {
+		int bits = ch - 'r';
+
+		if (bits & 2)
+			jtag_reset();
+		dm_system_reset(bits & 1);
+		return 1;
+	}
+
+	sim_debug("unknown remote_bitbang command 0x%02x", (unsigned char)ch);
+	return 1;
+}
+
+static void serve(int fd)
+{
+	struct conn c = { .fd = fd };
+	char in[4096];
+	int tck = 0;
+
+	for (;;) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+		int timeout = -1;
+
+		if (!cfg.lockstep && hart_runnable())
+			timeout = 0;
+		if (timeout < 0 && flush_out(&c) < 0)
+			return;
+
+		int r = poll(&pfd, 1, timeout);
+
+		if (r < 0 && errno != EINTR)
+			return;
+		if (r <= 0) {
+			/* socket idle: let the hart run for a while */
+			hart_run_until(sim_now + RUN_SLICE * cfg.cpu_ps);
+			continue;
+		}
+
+		ssize_t n = read(fd, in, sizeof(in));
+
+		if (n <= 0)
+			return;
+		for (ssize_t i = 0; i < n; i++) {
+			r = handle(&c, in[i], &tck);
+			if (r <= 0) {
+				if (r == 0)
+					flush_out(&c);
+				return;
+			}
+		}
+	}
+}
+
+static int listen_on(int port)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+		perror("bind");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int parse_stuck(const char *arg)
+{
+	char target[8];
+	unsigned long long offset;
+	unsigned int bit = 0;
+
+	if (sscanf(arg, "%7[a-z]:%lli:%u", target, &offset, &bit) < 2 || bit > 7)
+		return -1;
+	if (!strcmp(target, "nor"))
+		cfg.stuck = STUCK_NOR;
+	else if (!strcmp(target, "nand"))
+		cfg.stuck = STUCK_NAND;
+	else if (!strcmp(target, "emmc"))
+		cfg.stuck = STUCK_EMMC;
+	else
+		return -1;
+	cfg.stuck_offset = offset;
+	cfg.stuck_bit = bit;
+	return 0;
+}
+
+static void usage(void)
+{
+	fputs("usage: dr1sim [options]\n"
+		"  --port N               remote_bitbang TCP port (default 5555)\n"
+		"  --pjtag                only the RISC-V TAP on the chain\n"
+		"  --lockstep             hart only runs as far as TCK time has advanced\n"
+		"  --tck-khz N            TCK frequency used for simulated time (default 10000)\n"
+		"  --cpu-mhz N            instructions per microsecond (default 500)\n"
+		"  --bus-ns N             extra cost of a peripheral access (default 20)\n"
+		"  --ssi-speedup N        run the SPI serial clock N times faster\n"
+		"  --flash-time-scale X   scale flash program/erase/read times\n"
+		"  --dmi-busy N           TCKs a DMI operation keeps the DTM busy\n"
+		"  --nor-id ID            JEDEC ID of the SPI NOR, e.g. ef4019\n"
+		"  --stuck-bit DEV:OFF[:BIT]  bit of nor, nand or emmc that cannot be programmed\n"
+		"  --selftest             run the flash loaders against the models and exit\n"
+		"  --verbose              log model events\n", stderr);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] = {
+		{ "port", required_argument, NULL, 'p' },
+		{ "pjtag", no_argument, NULL, 'j' },
+		{ "lockstep", no_argument, NULL, 'l' },
+		{ "tck-khz", required_argument, NULL, 't' },
+		{ "cpu-mhz", required_argument, NULL, 'c' },
+		{ "bus-ns", required_argument, NULL, 'b' },
+		{ "ssi-speedup", required_argument, NULL, 's' },
+		{ "flash-time-scale", required_argument, NULL, 'f' },
+		{ "dmi-busy", required_argument, NULL, 'd' },
+		{ "nor-id", required_argument, NULL, 'n' },
+		{ "stuck-bit", required_argument, NULL, 'x' },
+		{ "selftest", no_argument, NULL, 'T' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	bool run_selftest = false;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "p:v", options, NULL)) != -1) {
+		switch (opt) {
+			case 'p':
+				cfg.port = atoi(optarg);
+				break;
+			case 'j':
+				cfg.pjtag = true;
+				break;
+			case 'l':
+				cfg.lockstep = true;
+				break;
+			case 't':
+				cfg.tck_ps = PS_PER_MS / strtoull(optarg, NULL, 0);
+				break;
+			case 'c':
+				cfg.cpu_ps = PS_PER_US / strtoull(optarg, NULL, 0);
+				break;
+			case 'b':
+				cfg.bus_ps = strtoull(optarg, NULL, 0) * PS_PER_NS;
+				break;
+			case 's':
+				cfg.ssi_speedup = strtoul(optarg, NULL, 0);
+				break;
+			case 'f':
+				cfg.flash_time_scale = strtod(optarg, NULL);
+				break;
+			case 'd':
+				cfg.dmi_busy_tcks = strtoul(optarg, NULL, 0);
+				break;
+			case 'n':
+				cfg.nor_id = strtoul(optarg, NULL, 16);
+				break;
+			case 'x':
+				if (parse_stuck(optarg) < 0) {
+					fprintf(stderr, "dr1sim: bad --stuck-bit '%s'\n", optarg);
+					return 2;
+				}
+				break;
+			case 'T':
+				run_selftest = true;
+				break;
+			case 'v':
+				cfg.verbose = true;
+				break;
+			default:
+				usage();
+				return opt == 'h' ? 0 : 2;
+		}
+	}
+
+	unsigned int capacity = cfg.nor_id & 0xff;
+
+	if (capacity < 0x10 || capacity > 0x1a) {
+		fprintf(stderr, "dr1sim: unsupported NOR capacity code 0x%02x\n", capacity);
+		return 2;
+	}
+	cfg.nor_size = 1u << capacity;
+	if (!cfg.ssi_speedup || !cfg.tck_ps || !cfg.cpu_ps) {
+		usage();
+		return 2;
+	}
+
+	power_on();
+
+	if (run_selftest)
+		return selftest() ? 1 : 0;
+
+	int lfd = listen_on(cfg.port);
+
+	if (lfd < 0)
+		return 1;
+	fprintf(stderr, "dr1sim: listening for remote_bitbang on 127.0.0.1:%d\n", cfg.port);
+
+	for (;;) {
+		int fd = accept(lfd, NULL, NULL);
+		int one = 1;
+
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("accept");
+			return 1;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		fprintf(stderr, "dr1sim: client connected\n");
+		serve(fd);
+		close(fd);
+		print_stats();
+		/* the next session starts with a fresh chain */
+		jtag_reset();
+	}
+}
@@ -0,0 +1,498 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * DesignWare mobile storage host controller (SDHCI register layout) with
+ * an eMMC device on the first instance.  The second instance has no card
+ * and reports a command timeout for everything.
+ *
+ * Only PIO single block transfers are modelled.  Interrupt status bits are
+ * raised lazily when simulated time passes the completion time of the
+ * command, the card access and the data transfer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr1sim.h"
+
+#define MSHC_BLOCKSIZE		0x04
+#define MSHC_BLOCKCOUNT		0x06
+#define MSHC_ARGUMENT		0x08
+#define MSHC_XFER_MODE		0x0c
+#define MSHC_CMD		0x0e
+#define MSHC_RESP01		0x10
+#define MSHC_BUF_DATA		0x20
+#define MSHC_PSTATE		0x24
+#define MSHC_CLK_CTRL		0x2c
+#define MSHC_SW_RST		0x2f
+#define MSHC_NORMAL_INT		0x30
+#define MSHC_ERROR_INT		0x32
+#define MSHC_CAPABILITIES1	0x40
+#define MSHC_HOST_VERSION	0xfe
+
+#define INT_CMD_COMPLETE	(1u << 0)
+#define INT_XFER_COMPLETE	(1u << 1)
+#define INT_BUF_WR_READY	(1u << 4)
+#define INT_BUF_RD_READY	(1u << 5)
+#define INT_ERROR		(1u << 15)
+#define ERR_CMD_TOUT		(1u << 0)
+
+#define PSTATE_CMD_INHIBIT	(1u << 0)
+#define PSTATE_DAT_INHIBIT	(1u << 1)
+#define PSTATE_BUF_WR_EN	(1u << 10)
+#define PSTATE_BUF_RD_EN	(1u << 11)
+#define PSTATE_CARD_INSERTED	(1u << 16)
+
+#define CMD_RESP_NONE		0
+#define CMD_RESP_136		1
+#define CMD_DATA_PRESENT	(1u << 5)
+#define XFER_DIR_READ		(1u << 4)
+
+/* eMMC device */
+#define EMMC_BLOCK_SIZE		512
+#define EMMC_SECTORS		30535680u	/* 16 GB */
+
+enum card_state {
+	CARD_IDLE,
+	CARD_READY,
+	CARD_IDENT,
+	CARD_STBY,
+	CARD_TRAN,
+	CARD_DATA,
+	CARD_RCV,
+	CARD_PRG,
+};
+
+#define R1_ILLEGAL_COMMAND	(1u << 22)
+#define R1_READY_FOR_DATA	(1u << 8)
+
+/* timings in microseconds, the array ones go through flash_time() */
+#define MSHC_T_CMD		2
+#define MSHC_T_XFER		10
+#define EMMC_T_READ		50
+#define EMMC_T_PROG		250
+
+#define NEVER			UINT64_MAX
+
+/* Samsung KLMAG1JETD in the SDHCI R2 layout, CID[127:8] -> RESP[119:0] */
+static const uint32_t emmc_cid[4] = {
+	0x3456789a, 0x34520112, 0x414a5444, 0x00150100,
+};
+
+static const uint32_t emmc_csd[4] = {
+	0x0a4040c0, 0xffffffff, 0x7fff5983, 0x00d04f01,
+};
+
+struct block {
+	uint32_t index;
+	struct block *next;
+	uint8_t data[EMMC_BLOCK_SIZE];
+};
+
+#define BLOCK_BUCKETS	4096
+
+static struct {
+	enum card_state state;
+	uint16_t rca;
+	uint8_t ext_csd[512];
+	struct block *buckets[BLOCK_BUCKETS];
+} card;
+
+struct mshc {
+	uint8_t regs[0x100];
+	uint16_t normal, error;
+	uint32_t resp[4];
+
+	uint64_t cmd_done_at;
+	uint64_t rd_ready_at;
+	uint64_t xfer_done_at;
+	uint32_t pending_resp[4];
+
+	bool data_active;
+	bool reading;
+	uint32_t block;
+	uint8_t buf[EMMC_BLOCK_SIZE];
+	unsigned int words, nwords;
+	bool buf_ready;
+};
+
+static struct mshc mshc[2];
+
+static struct block *find_block(uint32_t index, bool create)
+{
+	struct block **b = &card.buckets[index % BLOCK_BUCKETS];
+
+	for (; *b; b = &(*b)->next)
+		if ((*b)->index == index)
+			return *b;
+	if (!create)
+		return NULL;
+
+	*b = calloc(1, sizeof(**b));
+	if (!*b) {
+		sim_log("out of memory");
+		exit(1);
+	}
+	(*b)->index = index;
+	return *b;
+}
+
+void emmc_read_block(uint32_t index, uint8_t *buf)
+{
+	struct block *b = find_block(index, false);
+
+	if (b)
+		memcpy(buf, b->data, EMMC_BLOCK_SIZE);
+	else
+		memset(buf, 0, EMMC_BLOCK_SIZE);
+}
+
+static void emmc_write_block(uint32_t index, const uint8_t *buf)
+{
+	struct block *b = find_block(index, true);
+
+	memcpy(b->data, buf, EMMC_BLOCK_SIZE);
+	if (cfg.stuck == STUCK_EMMC && cfg.stuck_offset / EMMC_BLOCK_SIZE == index)
+		b->data[cfg.stuck_offset % EMMC_BLOCK_SIZE] |= 1u << cfg.stuck_bit;
+	stats.emmc_written += EMMC_BLOCK_SIZE;
+}
+
+static void card_init(void)
+{
+	static bool done;
+
+	if (done)
+		return;
+	done = true;
+
+	memset(card.ext_csd, 0, sizeof(card.ext_csd));
+	card.ext_csd[192] = 8;			/* EXT_CSD revision 1.8 */
+	card.ext_csd[196] = 0x57;		/* device types */
+	for (int i = 0; i < 4; i++)
+		card.ext_csd[212 + i] = EMMC_SECTORS >> (8 * i);
+}
+
+static uint32_t r1(void)
+{
+	return (card.state << 9) | R1_READY_FOR_DATA;
+}
+
+/* ----------------------------------------------------------------------
+ * Controller
+ */
+
+static uint16_t reg16(struct mshc *m, unsigned int off)
+{
+	return m->regs[off] | (m->regs[off + 1] << 8);
+}
+
+static uint32_t reg32(struct mshc *m, unsigned int off)
+{
+	return reg16(m, off) | ((uint32_t)reg16(m, off + 2) << 16);
+}
+
+/** Raise the interrupt status bits of the events that are due. */
+static void update(struct mshc *m)
+{
+	if (sim_now >= m->cmd_done_at) {
+		m->cmd_done_at = NEVER;
+		memcpy(m->resp, m->pending_resp, sizeof(m->resp));
+		m->normal |= INT_CMD_COMPLETE;
+		if (m->data_active && !m->reading) {
+			m->buf_ready = true;
+			m->normal |= INT_BUF_WR_READY;
+		}
+	}
+	if (sim_now >= m->rd_ready_at) {
+		m->rd_ready_at = NEVER;
+		m->buf_ready = true;
+		m->normal |= INT_BUF_RD_READY;
+	}
+	if (sim_now >= m->xfer_done_at) {
+		m->xfer_done_at = NEVER;
+		m->data_active = false;
+		m->normal |= INT_XFER_COMPLETE;
+		if (card.state == CARD_DATA || card.state == CARD_RCV || card.state == CARD_PRG)
+			card.state = CARD_TRAN;
+	}
+}
+
+static void cmd_timeout(struct mshc *m)
+{
+	m->error |= ERR_CMD_TOUT;
+	m->cmd_done_at = NEVER;
+}
+
+static void start_data(struct mshc *m, bool read, uint32_t block, const uint8_t *src)
+{
+	unsigned int size = reg16(m, MSHC_BLOCKSIZE) & 0xfff;
+
+	m->data_active = true;
+	m->reading = read;
+	m->block = block;
+	m->words = 0;
+	m->nwords = (size ? size : EMMC_BLOCK_SIZE) / 4;
+	if (m->nwords > EMMC_BLOCK_SIZE / 4)
+		m->nwords = EMMC_BLOCK_SIZE / 4;
+	m->buf_ready = false;
+	if (read) {
+		memcpy(m->buf, src, EMMC_BLOCK_SIZE);
+		m->rd_ready_at = m->cmd_done_at + flash_time(EMMC_T_READ) + MSHC_T_XFER * PS_PER_US;
+	}
+}
+
+static void issue_command(struct mshc *m, int id)
+{
+	uint16_t cmd = reg16(m, MSHC_CMD);
+	uint16_t xfer = reg16(m, MSHC_XFER_MODE);
+	uint32_t arg = reg32(m, MSHC_ARGUMENT);
+	unsigned int index = (cmd >> 8) & 0x3f;
+	bool data = cmd & CMD_DATA_PRESENT;
+	uint32_t *resp = m->pending_resp;
+
+	update(m);
+	if (m->cmd_done_at != NEVER || m->data_active) {
+		sim_log("MSHC%d: CMD%u issued while the controller is busy", id, index);
+		return;
+	}
+
+	memset(resp, 0, sizeof(m->pending_resp));
+	m->cmd_done_at = sim_now + MSHC_T_CMD * PS_PER_US;
+
+	if (id != 0) {
+		cmd_timeout(m);
+		return;
+	}
+
+	card_init();
+
+	switch (index) {
+		case 0:
+			card.state = CARD_IDLE;
+			card.rca = 0;
+			break;
+		case 1:
+			/* powered up, sector addressing, 2.7-3.6 V and 1.8 V */
+			resp[0] = 0xc0ff8080;
+			card.state = CARD_READY;
+			break;
+		case 2:
+			memcpy(resp, emmc_cid, sizeof(emmc_cid));
+			card.state = CARD_IDENT;
+			break;
+		case 3:
+			card.rca = arg >> 16;
+			resp[0] = r1();
+			card.state = CARD_STBY;
+			break;
+		case 9:
+			memcpy(resp, emmc_csd, sizeof(emmc_csd));
+			break;
+		case 7:
+			resp[0] = r1();
+			card.state = (arg >> 16) == card.rca && card.rca ? CARD_TRAN : CARD_STBY;
+			break;
+		case 13:
+			resp[0] = r1();
+			break;
+		case 6:
+			resp[0] = r1();
+			if (((arg >> 24) & 3) == 3)
+				card.ext_csd[(arg >> 16) & 0xff] = arg >> 8;
+			break;
+		case 16:
+		case 23:
+			resp[0] = r1();
+			break;
+		case 8:
+		case 17:
+		case 24: {
+			uint8_t block[EMMC_BLOCK_SIZE];
+			bool read = index != 24;
+
+			resp[0] = r1();
+			if (card.state != CARD_TRAN || !data || !(xfer & XFER_DIR_READ) != !read) {
+				sim_log("MSHC%d: CMD%u rejected (card state %d, cmd 0x%04x, xfer 0x%04x)",
+					id, index, card.state, cmd, xfer);
+				resp[0] |= R1_ILLEGAL_COMMAND;
+				break;
+			}
+			if (index != 8 && arg >= EMMC_SECTORS) {
+				resp[0] |= 1u << 31;	/* ADDRESS_OUT_OF_RANGE */
+				break;
+			}
+			if (index == 8)
+				memcpy(block, card.ext_csd, sizeof(block));
+			else if (read)
+				emmc_read_block(arg, block);
+			card.state = read ? CARD_DATA : CARD_RCV;
+			start_data(m, read, arg, block);
+			break;
+		}
+		default:
+			sim_log("MSHC%d: unsupported CMD%u", id, index);
+			resp[0] = r1() | R1_ILLEGAL_COMMAND;
+			break;
+	}
+
+	if ((cmd & 3) == CMD_RESP_NONE)
+		memset(resp, 0, sizeof(m->pending_resp));
+}
+
+static uint32_t buf_read(struct mshc *m)
+{
+	uint32_t v = 0;
+
+	if (!m->data_active || !m->reading || !m->buf_ready || m->words >= m->nwords)
+		return 0;
+	memcpy(&v, m->buf + 4 * m->words, 4);
+	if (++m->words == m->nwords) {
+		m->buf_ready = false;
+		m->xfer_done_at = sim_now;
+	}
+	return v;
+}
+
+static void buf_write(struct mshc *m, uint32_t v)
+{
+	if (!m->data_active || m->reading || !m->buf_ready || m->words >= m->nwords)
+		return;
+	memcpy(m->buf + 4 * m->words, &v, 4);
+	if (++m->words == m->nwords) {
+		m->buf_ready = false;
+		emmc_write_block(m->block, m->buf);
+		card.state = CARD_PRG;
+		m->xfer_done_at = sim_now + MSHC_T_XFER * PS_PER_US + flash_time(EMMC_T_PROG);
+	}
+}
+
+static void controller_reset(struct mshc *m)
+{
+	memset(m, 0, sizeof(*m));
+	m->cmd_done_at = NEVER;
+	m->rd_ready_at = NEVER;
+	m->xfer_done_at = NEVER;
+}
+
+void mshc_reset(void)
+{
+	for (int i = 0; i < 2; i++)
+		controller_reset(&mshc[i]);
+	card.state = CARD_IDLE;
+	card.rca = 0;
+}
+
+static uint8_t reg_byte(struct mshc *m, int id, unsigned int off)
+{
+	uint32_t v;
+
+	switch (off & ~3u) {
+		case MSHC_RESP01:
+		case MSHC_RESP01 + 4:
+		case MSHC_RESP01 + 8:
+		case MSHC_RESP01 + 12:
+			return m->resp[(off - MSHC_RESP01) / 4] >> (8 * (off & 3));
+		case MSHC_PSTATE:
+			v = (id == 0 ? PSTATE_CARD_INSERTED : 0) |
+				(m->cmd_done_at != NEVER ? PSTATE_CMD_INHIBIT : 0) |
+				(m->data_active ? PSTATE_DAT_INHIBIT : 0) |
+				(m->data_active && m->buf_ready && !m->reading ? PSTATE_BUF_WR_EN : 0) |
+				(m->data_active && m->buf_ready && m->reading ? PSTATE_BUF_RD_EN : 0);
+			return v >> (8 * (off & 3));
+		case MSHC_NORMAL_INT:
+			v = m->normal | (m->error ? INT_ERROR : 0) | ((uint32_t)m->error << 16);
+			return v >> (8 * (off & 3));
+		case MSHC_CAPABILITIES1:
+			v = 0x276ec898;		/* 3.3 V, high speed, 8-bit bus, 200 MHz base */
+			return v >> (8 * (off & 3));
+		default:
+			break;
+	}
+
+	switch (off) {
+		case MSHC_CLK_CTRL:
+			/* internal_clk_stable follows internal_clk_en */
+			return (m->regs[off] & ~2u) | ((m->regs[off] & 1) << 1);
+		case MSHC_SW_RST:
+			return 0;
+		case MSHC_HOST_VERSION:
+			return 0x05;		/* SD host specification 4.20 */
+		default:
+			return m->regs[off];
+	}
+}
+
+uint64_t mshc_read(int id, uint64_t off, unsigned int size)
+{
+	struct mshc *m = &mshc[id];
+	uint64_t v = 0;
+
+	update(m);
+	if (off >= 0x100)
+		return 0;
+
+	if ((off & ~3ULL) == MSHC_BUF_DATA) {
+		if (size != 4)
+			sim_debug("MSHC%d: %u byte BUF_DATA read", id, size);
+		return buf_read(m);
+	}
+
+	for (unsigned int i = 0; i < size; i++)
+		v |= (uint64_t)reg_byte(m, id, off + i) << (8 * i);
+	return v;
+}
+
+void mshc_write(int id, uint64_t off, unsigned int size, uint64_t value)
+{
+	struct mshc *m = &mshc[id];
+	bool command = false;
+
+	update(m);
+	if (off >= 0x100)
+		return;
+
+	if ((off & ~3ULL) == MSHC_BUF_DATA) {
+		buf_write(m, value);
+		return;
+	}
+
+	for (unsigned int i = 0; i < size; i++) {
+		unsigned int o = off + i;
+		uint8_t b = value >> (8 * i);
+
+		switch (o) {
+			case MSHC_NORMAL_INT:
+			case MSHC_NORMAL_INT + 1:
+				m->normal &= ~(b << (8 * (o - MSHC_NORMAL_INT)));
+				break;
+			case MSHC_ERROR_INT:
+			case MSHC_ERROR_INT + 1:
+				m->error &= ~(b << (8 * (o - MSHC_ERROR_INT)));
+				break;
+			case MSHC_SW_RST:
+				if (b & 1) {
+					uint8_t clk[2] = { m->regs[MSHC_CLK_CTRL], m->regs[MSHC_CLK_CTRL + 1] };
+
+					controller_reset(m);
+					m->regs[MSHC_CLK_CTRL] = clk[0];
+					m->regs[MSHC_CLK_CTRL + 1] = clk[1];
+				}
+				if (b & 6) {
+					m->cmd_done_at = NEVER;
+					m->rd_ready_at = NEVER;
+					m->xfer_done_at = NEVER;
+					m->data_active = false;
+				}
+				break;
+			case MSHC_CMD + 1:
+				command = true;
+				/* fall through */
+			default:
+				m->regs[o] = b;
+				break;
+		}
+	}
+
+	if (command)
+		issue_command(m, id);
+}
@@ -0,0 +1,631 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * --selftest: run the RISC-V flash loaders that OpenOCD ships against the
+ * device models, driving them the way the dwcssi, smc35x and dwcmshc
+ * drivers do: the loader is copied to OCM, started with its arguments in
+ * a0-a7 and ends on ebreak; async loaders are fed through the wp/rp ring
+ * of target_run_async_algorithm(), with the host charged a fixed number of
+ * TCKs per word written.  Every case checks both the loader's CRC and the
+ * model contents, and prints the simulated time it took.
+ *
+ * The fault cases check that the models produce the failures they exist
+ * for: a page program starved by a slow feeder, and bits that cannot be
+ * programmed (detected on NOR and eMMC, corrected by the ECC on NAND).
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dr1sim.h"
+
+static const uint8_t dwcssi_async_x4[] = {
+#include "../loaders/flash/qspi/dwcssi/build/flash_async_x4_riscv_64.inc"
+};
+
+static const uint8_t dwcssi_async_x1[] = {
+#include "../loaders/flash/qspi/dwcssi/build/flash_async_x1_riscv_64.inc"
+};
+
+static const uint8_t dwcssi_crc_x4[] = {
+#include "../loaders/flash/qspi/dwcssi/build/flash_crc_x4_riscv_64.inc"
+};
+
+static const uint8_t dwcssi_crc_x1[] = {
+#include "../loaders/flash/qspi/dwcssi/build/flash_crc_x1_riscv_64.inc"
+};
+
+static const uint8_t smc35x_async[] = {
+#include "../loaders/flash/smc35x/riscv64_smc35x_async.inc"
+};
+
+static const uint8_t smc35x_crc[] = {
+#include "../loaders/flash/smc35x/riscv64_smc35x_crc.inc"
+};
+
+static const uint8_t emmc_async[] = {
+#include "../loaders/flash/emmc/dwcmshc/build/emmc_async_riscv_64.inc"
+};
+
+static const uint8_t emmc_crc[] = {
+#include "../loaders/flash/emmc/dwcmshc/build/emmc_crc_riscv_64.inc"
+};
+
+#define LOADER_ADDR	OCM_BASE
+#define LOADER_AREA	0x8000
+#define RING_ADDR	(OCM_BASE + LOADER_AREA)
+#define RING_BLOCKS	8
+#define CRC_BUF_ADDR	(OCM_BASE + 0x20000)
+
+#define CSR_DCSR	0x7b0
+#define CSR_DPC		0x7b1
+#define DCSR_EBREAKM	(1u << 15)
+
+/* a 32-bit system bus write costs about two DMI scans */
+#define HOST_TCKS_PER_WORD	100
+#define LOADER_SLICE		(100 * PS_PER_US)
+#define LOADER_TIMEOUT		(10000 * PS_PER_MS)
+
+/* SSI registers and fields, as the dwcssi driver programs them */
+#define SSI_CTRLR0	0x00
+#define SSI_CTRLR1	0x04
+#define SSI_SSIENR	0x08
+#define SSI_SER		0x10
+#define SSI_BAUDR	0x14
+#define SSI_TXFTLR	0x18
+#define SSI_SR		0x28
+#define SSI_DR		0x60
+#define SSI_SPI_CTRLR0	0xf4
+
+#define SSI_TMOD_TX_ONLY	1
+#define SSI_TMOD_RX_ONLY	2
+#define SSI_TMOD_EEPROM		3
+#define SSI_FRF_X4		2
+#define SSI_SR_BUSY		(1u << 0)
+#define SSI_SR_TFE		(1u << 2)
+#define SSI_SR_RFNE		(1u << 3)
+#define SSI_BAUD_DIV		4
+
+#define SPI_CTRLR0_ADDR_24	(6u << 2)
+#define SPI_CTRLR0_INST_8	(2u << 8)
+#define SPI_CTRLR0_WAIT(n)	((n) << 11)
+#define SPI_CTRLR0_STRETCH	(1u << 30)
+
+#define NOR_PAGE	256
+
+/* SMC35x and MSHC registers used for the host side set-up */
+#define SMC_ECC1_CFG		0x404
+#define SMC_ECC1_CFG_APB_4BLK	0x17	/* APB mode, ECC at page end, 4 blocks */
+#define NAND_PAGE		2048
+#define NAND_OOB		64
+
+#define MSHC_BLOCKSIZE		0x04
+#define MSHC_ARGUMENT		0x08
+#define MSHC_XFER_MODE		0x0c
+#define MSHC_RESP01		0x10
+#define MSHC_NORMAL_INT		0x30
+#define EMMC_BLOCK		512
+
+struct ring {
+	const uint8_t *data;
+	uint32_t size;
+	uint32_t done;
+	uint32_t block;
+	uint32_t start, end;	/* fifo area, after the wp and rp words */
+	uint32_t wp;
+	uint32_t pending;	/* bytes being written by the host */
+};
+
+struct result {
+	unsigned int passed, failed;
+};
+
+static uint32_t ram_u32(uint64_t addr)
+{
+	uint32_t v;
+
+	memcpy(&v, bus_ram(addr, 4), 4);
+	return v;
+}
+
+static void set_ram_u32(uint64_t addr, uint32_t v)
+{
+	memcpy(bus_ram(addr, 4), &v, 4);
+}
+
+static uint32_t crc32_msb(const uint8_t *p, size_t len)
+{
+	uint32_t crc = 0xffffffff;
+
+	while (len--) {
+		crc ^= (uint32_t)*p++ << 24;
+		for (int i = 0; i < 8; i++)
+			crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+	}
+	return crc;
+}
+
+static void pattern(uint8_t *buf, size_t len, uint32_t seed)
+{
+	uint32_t x = seed * 2654435761u + 1;
+
+	for (size_t i = 0; i < len; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		buf[i] = x >> 24;
+	}
+}
+
+static void report(struct result *r, const char *name, bool ok, uint64_t t0, uint32_t bytes,
+		const char *detail)
+{
+	double ms = (double)(sim_now - t0) / PS_PER_MS;
+
+	printf("%-4s %-34s %8.3f ms", ok ? "PASS" : "FAIL", name, ms);
+	if (bytes && ms > 0)
+		printf("  %7.1f KiB/s", bytes / 1024.0 / (ms / 1000.0));
+	if (detail)
+		printf("  (%s)", detail);
+	putchar('\n');
+	if (ok)
+		r->passed++;
+	else
+		r->failed++;
+}
+
+/* ----------------------------------------------------------------------
+ * Running loaders
+ */
+
+static void ring_init(struct ring *ring, const uint8_t *data, uint32_t size, uint32_t block)
+{
+	ring->data = data;
+	ring->size = size;
+	ring->done = 0;
+	ring->block = block;
+	ring->start = RING_ADDR + 8;
+	ring->end = ring->start + RING_BLOCKS * block;
+	ring->wp = ring->start;
+	ring->pending = 0;
+	set_ram_u32(RING_ADDR, ring->wp);
+	set_ram_u32(RING_ADDR + 4, ring->start);
+}
+
+/**
+ * Decide how much the host writes next, like
+ * target_async_algorithm_trans_data() does after reading rp.
+ * @returns how long the host is busy, in ps.
+ */
+static uint64_t ring_poll(struct ring *ring)
+{
+	uint32_t rp = ram_u32(RING_ADDR + 4);
+	uint32_t bytes;
+
+	ring->pending = 0;
+	if (rp == 0 || ring->done == ring->size)
+		return HOST_TCKS_PER_WORD * cfg.tck_ps;
+
+	if (rp > ring->wp)
+		bytes = rp - ring->wp - ring->block;
+	else if (rp > ring->start)
+		bytes = ring->end - ring->wp;
+	else
+		bytes = ring->end - ring->wp - ring->block;
+	if (bytes > ring->size - ring->done)
+		bytes = ring->size - ring->done;
+	bytes -= bytes % ring->block;
+
+	ring->pending = bytes;
+	return (bytes / 4 + 2) * HOST_TCKS_PER_WORD * cfg.tck_ps;
+}
+
+/** The host write has finished: the data and then wp become visible. */
+static void ring_commit(struct ring *ring)
+{
+	if (!ring->pending)
+		return;
+	memcpy(bus_ram(ring->wp, ring->pending), ring->data + ring->done, ring->pending);
+	ring->done += ring->pending;
+	ring->wp += ring->pending;
+	if (ring->wp == ring->end)
+		ring->wp = ring->start;
+	set_ram_u32(RING_ADDR, ring->wp);
+	ring->pending = 0;
+}
+
+/**
+ * Run a loader to its ebreak.
+ * @returns 0 with a0 in @a *ret, -1 if it did not finish.
+ */
+static int run_loader(const uint8_t *bin, size_t size, const uint64_t *args, unsigned int nargs,
+		struct ring *ring, uint64_t *ret)
+{
+	uint64_t deadline = sim_now + LOADER_TIMEOUT;
+	uint64_t dcsr;
+
+	memcpy(bus_ram(LOADER_ADDR, size), bin, size);
+	hart_halt(HALT_HALTREQ);
+	for (unsigned int i = 0; i < nargs; i++)
+		hart.x[10 + i] = args[i];
+	hart_read_csr(CSR_DCSR, &dcsr);
+	hart_write_csr(CSR_DCSR, dcsr | DCSR_EBREAKM);
+	hart_write_csr(CSR_DPC, LOADER_ADDR);
+	hart_resume();
+
+	while (!hart.halted) {
+		uint64_t busy = ring ? ring_poll(ring) : LOADER_SLICE;
+
+		if (!hart_runnable() || sim_now >= deadline) {
+			sim_log("loader did not finish, pc 0x%" PRIx64 " mcause %" PRIu64 " mepc 0x%" PRIx64 " mtval 0x%" PRIx64, hart.pc, hart.mcause, hart.mepc, hart.mtval);
+			hart_halt(HALT_HALTREQ);
+			return -1;
+		}
+		hart_run_until(sim_now + busy);
+		if (ring)
+			ring_commit(ring);
+	}
+
+	if (((hart.dcsr >> 6) & 7) != HALT_EBREAK) {
+		sim_log("loader stopped with cause %u", (unsigned int)((hart.dcsr >> 6) & 7));
+		return -1;
+	}
+	*ret = hart.x[10];
+	return 0;
+}
+
+/* ----------------------------------------------------------------------
+ * Host side SPI NOR access, one controller set-up per command
+ */
+
+static uint32_t ssi_r(unsigned int off)
+{
+	uint64_t v = 0;
+
+	bus_read(SSI_BASE + off, 4, &v);
+	return v;
+}
+
+static void ssi_w(unsigned int off, uint32_t v)
+{
+	bus_write(SSI_BASE + off, 4, v);
+}
+
+static void spi_command(const uint8_t *tx, unsigned int ntx, uint8_t *rx, unsigned int nrx)
+{
+	ssi_w(SSI_SSIENR, 0);
+	ssi_w(SSI_CTRLR0, ((nrx ? SSI_TMOD_EEPROM : SSI_TMOD_TX_ONLY) << 10) | 7);
+	ssi_w(SSI_CTRLR1, nrx ? nrx - 1 : 0);
+	ssi_w(SSI_TXFTLR, (ntx - 1) << 16);
+	ssi_w(SSI_BAUDR, SSI_BAUD_DIV);
+	ssi_w(SSI_SER, 1);
+	ssi_w(SSI_SSIENR, 1);
+	for (unsigned int i = 0; i < ntx; i++)
+		ssi_w(SSI_DR, tx[i]);
+	while ((ssi_r(SSI_SR) & (SSI_SR_BUSY | SSI_SR_TFE)) != SSI_SR_TFE)
+		;
+	for (unsigned int i = 0; i < nrx; i++)
+		rx[i] = ssi_r(SSI_SR) & SSI_SR_RFNE ? ssi_r(SSI_DR) : 0xff;
+	ssi_w(SSI_SSIENR, 0);
+}
+
+static void nor_wait_idle(void)
+{
+	static const uint8_t rdsr = 0x05;
+	uint8_t sr;
+
+	for (;;) {
+		spi_command(&rdsr, 1, &sr, 1);
+		if (!(sr & 1))
+			return;
+		sim_now += 10 * PS_PER_US;
+	}
+}
+
+static void nor_write_enable(void)
+{
+	static const uint8_t wren = 0x06;
+
+	spi_command(&wren, 1, NULL, 0);
+}
+
+static void nor_set_qe(bool on)
+{
+	uint8_t wrsr2[2] = { 0x31, on ? 0x02 : 0x00 };
+
+	nor_write_enable();
+	spi_command(wrsr2, 2, NULL, 0);
+	nor_wait_idle();
+}
+
+static void nor_erase(uint32_t offset, uint32_t size)
+{
+	for (uint32_t a = offset; a < offset + size; a += 0x10000) {
+		uint8_t cmd[4] = { 0xd8, a >> 16, a >> 8, a };
+
+		nor_write_enable();
+		spi_command(cmd, 4, NULL, 0);
+		nor_wait_idle();
+	}
+}
+
+/** Leave the controller set up for quad output reads, as dwcssi_config_quad_rd() does. */
+static void ssi_config_quad_read(void)
+{
+	ssi_w(SSI_SSIENR, 0);
+	ssi_w(SSI_CTRLR0, (SSI_FRF_X4 << 22) | (SSI_TMOD_RX_ONLY << 10) | 7);
+	ssi_w(SSI_CTRLR1, 0);
+	ssi_w(SSI_SPI_CTRLR0, SPI_CTRLR0_STRETCH | SPI_CTRLR0_WAIT(8) |
+		SPI_CTRLR0_INST_8 | SPI_CTRLR0_ADDR_24);
+	ssi_w(SSI_SSIENR, 1);
+}
+
+/* ----------------------------------------------------------------------
+ * Test cases
+ */
+
+static bool nor_program(bool quad, bool stretch, uint32_t offset, const uint8_t *data, uint32_t size)
+{
+	struct ring ring;
+	uint64_t ret;
+	int r;
+
+	nor_erase(offset, size);
+	ssi_w(SSI_SSIENR, 0);
+	ssi_w(SSI_BAUDR, SSI_BAUD_DIV);
+	ssi_w(SSI_SER, 1);
+	ring_init(&ring, data, size, NOR_PAGE);
+
+	if (quad) {
+		uint64_t spictrl = SPI_CTRLR0_INST_8 | SPI_CTRLR0_ADDR_24 | (stretch ? SPI_CTRLR0_STRETCH : 0);
+		uint64_t args[8] = {
+			SSI_BASE, NOR_PAGE, size, ring.start - 8, ring.end, offset, 0x32, spictrl,
+		};
+
+		nor_set_qe(true);
+		r = run_loader(dwcssi_async_x4, sizeof(dwcssi_async_x4), args, 8, &ring, &ret);
+		nor_set_qe(false);
+	} else {
+		uint64_t args[8] = {
+			SSI_BASE, NOR_PAGE, size, ring.start - 8, ring.end, offset, 0x02, 3,
+		};
+
+		r = run_loader(dwcssi_async_x1, sizeof(dwcssi_async_x1), args, 8, &ring, &ret);
+	}
+	nor_wait_idle();
+	return r == 0 && ram_u32(RING_ADDR + 4) != 0;
+}
+
+static bool nor_checksum(bool quad, uint32_t offset, uint32_t size, uint32_t *crc)
+{
+	uint64_t ret;
+	int r;
+
+	if (quad) {
+		uint64_t args[5] = { SSI_BASE, NOR_PAGE, size, offset, 0x6b };
+
+		nor_set_qe(true);
+		ssi_w(SSI_BAUDR, SSI_BAUD_DIV);
+		ssi_config_quad_read();
+		r = run_loader(dwcssi_crc_x4, sizeof(dwcssi_crc_x4), args, 5, NULL, &ret);
+		nor_set_qe(false);
+	} else {
+		uint64_t args[6] = { SSI_BASE, NOR_PAGE, size, offset, 0x03, 3 };
+
+		r = run_loader(dwcssi_crc_x1, sizeof(dwcssi_crc_x1), args, 6, NULL, &ret);
+	}
+	*crc = ret;
+	return r == 0;
+}
+
+static void test_nor(struct result *res, const char *name, bool quad, uint32_t offset,
+		bool expect_ok)
+{
+	uint8_t data[16 * NOR_PAGE];
+	uint64_t t0 = sim_now;
+	uint32_t crc = 0;
+	char detail[96];
+	bool ok;
+
+	pattern(data, sizeof(data), offset);
+	if (cfg.stuck == STUCK_NOR)
+		data[cfg.stuck_offset - offset] &= ~(1u << cfg.stuck_bit);
+
+	ok = nor_program(quad, true, offset, data, sizeof(data));
+	bool loader_ok = ok && nor_checksum(quad, offset, sizeof(data), &crc);
+	bool crc_ok = crc == crc32_msb(data, sizeof(data));
+	bool same = !memcmp(nor_data() + offset, data, sizeof(data));
+
+	snprintf(detail, sizeof(detail), "crc %08" PRIx32 "%s, contents %s", crc,
+		crc_ok ? " matches" : " differs", same ? "match" : "differ");
+	ok = loader_ok && (expect_ok ? crc_ok && same : !crc_ok && !same);
+	report(res, name, ok, t0, sizeof(data), detail);
+}
+
+static void test_nor_starved(struct result *res)
+{
+	uint8_t data[4 * NOR_PAGE];
+	uint64_t t0 = sim_now;
+	uint64_t underruns = stats.ssi_underruns;
+	unsigned int speedup = cfg.ssi_speedup;
+	uint32_t offset = 0x40000;
+	char detail[96];
+
+	pattern(data, sizeof(data), 7);
+	/* a serial clock much faster than the loader can fill the FIFO */
+	cfg.ssi_speedup = 64;
+	bool ran = nor_program(true, false, offset, data, sizeof(data));
+	cfg.ssi_speedup = speedup;
+
+	bool same = !memcmp(nor_data() + offset, data, sizeof(data));
+
+	snprintf(detail, sizeof(detail), "%" PRIu64 " underruns, contents %s",
+		stats.ssi_underruns - underruns, same ? "match" : "differ");
+	report(res, "nor x4 without clock stretch", ran && !same &&
+		stats.ssi_underruns > underruns, t0, 0, detail);
+}
+
+static bool nand_program(uint32_t page, const uint8_t *data, uint32_t size)
+{
+	struct ring ring;
+	uint64_t ret;
+
+	bus_write(SMC_BASE + SMC_ECC1_CFG, 4, SMC_ECC1_CFG_APB_4BLK);
+	ring_init(&ring, data, size, NAND_PAGE);
+
+	uint64_t args[8] = { 0, NAND_PAGE, size, ring.start - 8, ring.end, page, NAND_OOB, 1 };
+
+	return run_loader(smc35x_async, sizeof(smc35x_async), args, 8, &ring, &ret) == 0 &&
+		ram_u32(RING_ADDR + 4) != 0;
+}
+
+static bool nand_checksum(uint32_t page, uint32_t size, uint32_t *crc)
+{
+	uint32_t c = 0xffffffff;
+
+	/* smc35x_checksum() runs the loader once per page, chaining nothing */
+	for (uint32_t done = 0; done < size; done += NAND_PAGE, page++) {
+		uint64_t args[8] = { 0, NAND_PAGE, NAND_PAGE, CRC_BUF_ADDR, page, NAND_OOB, 0x2c, 1 };
+		uint64_t ret;
+
+		if (run_loader(smc35x_crc, sizeof(smc35x_crc), args, 8, NULL, &ret) < 0)
+			return false;
+		c ^= ret;
+	}
+	*crc = c;
+	return true;
+}
+
+static void test_nand(struct result *res, const char *name, uint32_t page)
+{
+	static uint8_t data[8 * NAND_PAGE];
+	uint64_t t0 = sim_now;
+	uint32_t crc = 0, expect = 0xffffffff;
+	bool raw_same = true;
+	char detail[96];
+
+	pattern(data, sizeof(data), 3);
+	if (cfg.stuck == STUCK_NAND)
+		data[cfg.stuck_offset - page * NAND_PAGE] &= ~(1u << cfg.stuck_bit);
+
+	bool ok = nand_program(page, data, sizeof(data)) &&
+		nand_checksum(page, sizeof(data), &crc);
+
+	for (uint32_t i = 0; i < sizeof(data) / NAND_PAGE; i++) {
+		expect ^= crc32_msb(data + i * NAND_PAGE, NAND_PAGE);
+		if (memcmp(nand_page(page + i), data + i * NAND_PAGE, NAND_PAGE))
+			raw_same = false;
+	}
+
+	snprintf(detail, sizeof(detail), "crc %s, raw pages %s", crc == expect ? "matches" : "differs",
+		raw_same ? "match" : "differ");
+	/* a stuck bit is in the array, but the ECC corrects it on the way out */
+	ok = ok && crc == expect && raw_same == (cfg.stuck != STUCK_NAND);
+	report(res, name, ok, t0, sizeof(data), detail);
+}
+
+static int emmc_command(unsigned int index, uint32_t arg, unsigned int resp, uint32_t *r0)
+{
+	uint64_t status = 0;
+
+	bus_write(MSHC0_BASE + MSHC_ARGUMENT, 4, arg);
+	bus_write(MSHC0_BASE + MSHC_XFER_MODE, 4, (uint64_t)(index << 8 | resp) << 16);
+	do {
+		bus_read(MSHC0_BASE + MSHC_NORMAL_INT, 4, &status);
+	} while (!(status & 0x8001));
+	bus_write(MSHC0_BASE + MSHC_NORMAL_INT, 4, 0xffffffff);
+	if (r0) {
+		uint64_t v = 0;
+
+		bus_read(MSHC0_BASE + MSHC_RESP01, 4, &v);
+		*r0 = v;
+	}
+	return status & 0x8000 ? -1 : 0;
+}
+
+/** Identification and selection, as dwcmshc_emmc_card_init() does it. */
+static bool emmc_init(void)
+{
+	uint32_t ocr = 0;
+
+	emmc_command(0, 0, 0, NULL);
+	do {
+		if (emmc_command(1, 0x40ff8080, 2, &ocr) < 0)
+			return false;
+	} while (!(ocr & (1u << 31)));
+	return emmc_command(2, 0, 1, NULL) == 0 &&
+		emmc_command(3, 1u << 16, 2, NULL) == 0 &&
+		emmc_command(7, 1u << 16, 3, NULL) == 0 &&
+		emmc_command(16, EMMC_BLOCK, 2, NULL) == 0 &&
+		(bus_write(MSHC0_BASE + MSHC_BLOCKSIZE, 4, (1u << 16) | EMMC_BLOCK), true);
+}
+
+static void test_emmc(struct result *res, const char *name)
+{
+	static uint8_t data[32 * EMMC_BLOCK];
+	uint32_t block = 2048;
+	uint64_t t0 = sim_now;
+	struct ring ring;
+	uint64_t ret = 0;
+	char detail[96];
+
+	pattern(data, sizeof(data), 5);
+	if (cfg.stuck == STUCK_EMMC)
+		data[cfg.stuck_offset - block * EMMC_BLOCK] &= ~(1u << cfg.stuck_bit);
+
+	bool ok = emmc_init();
+
+	ring_init(&ring, data, sizeof(data), EMMC_BLOCK);
+	uint64_t wargs[6] = { MSHC0_BASE, EMMC_BLOCK, sizeof(data), ring.start - 8, ring.end, block };
+	uint64_t cargs[4] = { MSHC0_BASE, EMMC_BLOCK, sizeof(data), block };
+
+	ok = ok && run_loader(emmc_async, sizeof(emmc_async), wargs, 6, &ring, &ret) == 0;
+	ok = ok && run_loader(emmc_crc, sizeof(emmc_crc), cargs, 4, NULL, &ret) == 0;
+
+	bool crc_ok = (uint32_t)ret == crc32_msb(data, sizeof(data));
+
+	snprintf(detail, sizeof(detail), "crc %08" PRIx32 "%s", (uint32_t)ret,
+		crc_ok ? " matches" : " differs");
+	report(res, name, ok && crc_ok == (cfg.stuck != STUCK_EMMC), t0, sizeof(data), detail);
+}
+
+int selftest(void)
+{
+	struct result res = { 0, 0 };
+	enum stuck_target stuck = cfg.stuck;
+	uint64_t offset = cfg.stuck_offset;
+	unsigned int bit = cfg.stuck_bit;
+
+	/* the fault cases below place their own stuck bits */
+	cfg.stuck = STUCK_NONE;
+
+	test_nor(&res, "nor x4 program, x4 crc", true, 0x00000, true);
+	test_nor(&res, "nor x1 program, x1 crc", false, 0x10000, true);
+	test_nand(&res, "nand program, crc with ecc", 64);
+	test_emmc(&res, "emmc program, crc");
+	test_nor_starved(&res);
+
+	cfg.stuck = STUCK_NOR;
+	cfg.stuck_offset = 0x20123;
+	cfg.stuck_bit = 3;
+	test_nor(&res, "nor stuck bit detected", true, 0x20000, false);
+
+	cfg.stuck = STUCK_NAND;
+	cfg.stuck_offset = 129 * NAND_PAGE + 700;
+	cfg.stuck_bit = 5;
+	test_nand(&res, "nand stuck bit corrected", 128);
+
+	cfg.stuck = STUCK_EMMC;
+	cfg.stuck_offset = 2050 * EMMC_BLOCK + 17;
+	cfg.stuck_bit = 0;
+	test_emmc(&res, "emmc stuck bit detected");
+
+	cfg.stuck = stuck;
+	cfg.stuck_offset = offset;
+	cfg.stuck_bit = bit;
+
+	printf("%u passed, %u failed; %" PRIu64 " instructions, %.3f ms simulated\n",
+		res.passed, res.failed, stats.instret, (double)sim_now / PS_PER_MS);
+	return res.failed;
+}
@@ -0,0 +1,602 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Static memory controller (PL35x style) with an 8-bit ONFI NAND on
+ * interface 1.
+ *
+ * AXI accesses to the NAND window carry the NAND bus operation in their
+ * address, as the smc35x driver and loaders encode it:
+ *
+ *   command phase (bit 19 clear)
+ *     [23:21] address cycles, [20] end command valid,
+ *     [18:11] end command, [10:3] start command,
+ *     write data = address cycles, least significant byte first
+ *
+ *   data phase (bit 19 set)
+ *     [21] clear chip select (issues the end command if [20] is set),
+ *     [20] end command valid, [18:11] end command, [10] ECC last
+ *
+ * Commands taking more than four address cycles are completed by a second
+ * write to the same command address.  The ECC block computes the classic
+ * 24-bit Hamming code for each 512 byte block streamed through the page
+ * register after a program or read command.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr1sim.h"
+
+#define SMC_MEMC_STATUS		0x000
+#define SMC_MEM_CFG_SET		0x008
+#define SMC_MEM_CFG_CLR		0x00c
+#define SMC_ECC1_STATUS		0x400
+#define SMC_ECC1_CFG		0x404
+#define SMC_ECC1_BLOCK0		0x418
+#define SMC_ECC1_EXTRA_BLOCK	0x428
+
+#define MEMC_STATUS_INT1_RAW	(1u << 6)
+#define MEM_CFG_CLR_INT1	(1u << 4)
+
+#define NAND_DATA_PHASE		(1u << 19)
+#define NAND_CLEAR_CS		(1u << 21)
+#define NAND_END_CMD_VALID	(1u << 20)
+
+#define PAGE_SIZE		2048
+#define OOB_SIZE		64
+#define RAW_PAGE_SIZE		(PAGE_SIZE + OOB_SIZE)
+#define PAGES_PER_BLOCK		64
+#define BLOCKS			1024
+#define PAGES			(PAGES_PER_BLOCK * BLOCKS)
+
+#define STATUS_FAIL		0x01
+#define STATUS_ARDY		0x20
+#define STATUS_RDY		0x40
+#define STATUS_WP		0x80
+
+/* typical array timings in microseconds */
+#define NAND_T_R		25
+#define NAND_T_PROG		300
+#define NAND_T_BERS		2000
+#define NAND_T_RST		5
+
+static const uint8_t nand_id[5] = { 0x2c, 0xf1, 0x80, 0x95, 0x02 };
+
+enum nand_output {
+	OUT_NONE,
+	OUT_STATUS,
+	OUT_PAGE,
+	OUT_ID,
+	OUT_ONFI_ID,
+	OUT_PARAM,
+	OUT_FEATURE,
+};
+
+static uint8_t *pages[PAGES];		/* NULL = erased */
+static uint8_t erased[RAW_PAGE_SIZE];
+
+static struct {
+	/* command being assembled from command phase writes */
+	uint32_t cmd_addr;
+	uint8_t cmd;
+	unsigned int cycles, naddr;
+	uint8_t addr[8];
+
+	enum nand_output out, saved_out;
+	uint32_t col;
+	uint32_t row;
+	uint8_t reg[RAW_PAGE_SIZE];	/* page register */
+	bool program_loaded;
+	uint8_t status;
+	uint64_t busy_until;
+	bool int_armed;
+	uint8_t feature_addr;
+	unsigned int feature_count;
+	uint8_t features[256][4];
+	uint8_t param[256];
+} nand;
+
+static struct {
+	uint32_t regs[0x1000 / 4];
+	bool int1_enabled;
+	/* ECC block state */
+	uint32_t ecc_pos;		/* bytes seen since the command */
+	uint32_t ecc_odd, ecc_even;
+	uint32_t ecc_block[4];
+} smc;
+
+const uint8_t *nand_page(uint32_t page)
+{
+	if (page >= PAGES || !pages[page])
+		return erased;
+	return pages[page];
+}
+
+unsigned int nand_page_size(void)
+{
+	return PAGE_SIZE;
+}
+
+unsigned int nand_oob_size(void)
+{
+	return OOB_SIZE;
+}
+
+static bool nand_busy(void)
+{
+	return sim_now < nand.busy_until;
+}
+
+static void set_busy(uint64_t us)
+{
+	nand.busy_until = sim_now + flash_time(us);
+	nand.int_armed = true;
+}
+
+static uint16_t onfi_crc16(const uint8_t *p, size_t len)
+{
+	uint16_t crc = 0x4f4e;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= p[i] << 8;
+		for (int b = 0; b < 8; b++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1;
+	}
+	return crc;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = v >> (8 * i);
+}
+
+static void build_param_page(void)
+{
+	uint8_t *p = nand.param;
+
+	memset(p, 0, sizeof(nand.param));
+	memcpy(p, "ONFI", 4);
+	p[4] = 0x02;				/* ONFI 1.0 */
+	memcpy(p + 32, "DR1SIM      ", 12);
+	memcpy(p + 44, "SIMNAND01GX8        ", 20);
+	p[64] = nand_id[0];
+	put32(p + 80, PAGE_SIZE);
+	p[84] = OOB_SIZE;
+	put32(p + 92, PAGES_PER_BLOCK);
+	put32(p + 96, BLOCKS);
+	p[100] = 1;				/* logical units */
+	p[101] = 0x23;				/* 3 row, 2 column cycles */
+	p[102] = 1;				/* bits per cell */
+	p[112] = 1;				/* ECC bits required per 512 bytes */
+
+	uint16_t crc = onfi_crc16(p, 254);
+
+	p[254] = crc;
+	p[255] = crc >> 8;
+}
+
+/* ----------------------------------------------------------------------
+ * ECC block
+ */
+
+static unsigned int ecc_blocks(void)
+{
+	static const unsigned int blocks[4] = { 0, 1, 2, 4 };
+
+	return blocks[smc.regs[SMC_ECC1_CFG / 4] & 3];
+}
+
+static bool ecc_enabled(void)
+{
+	return (smc.regs[SMC_ECC1_CFG / 4] >> 2) & 3;
+}
+
+static void ecc_start(void)
+{
+	smc.ecc_pos = 0;
+	smc.ecc_odd = 0;
+	smc.ecc_even = 0;
+	memset(smc.ecc_block, 0, sizeof(smc.ecc_block));
+}
+
+/*
+ * The Hamming code of a block is the XOR of the bit addresses of all set
+ * bits (odd parities) and of their complements (even parities), so that
+ * a single flipped bit shows up as odd == ~even with odd = its address.
+ */
+static void ecc_byte(uint8_t b)
+{
+	if (!ecc_enabled() || smc.ecc_pos >= ecc_blocks() * 512)
+		return;
+
+	unsigned int offset = smc.ecc_pos % 512;
+
+	for (unsigned int j = 0; j < 8; j++) {
+		if (b & (1u << j)) {
+			uint32_t a = (offset << 3) | j;
+
+			smc.ecc_odd ^= a;
+			smc.ecc_even ^= ~a & 0xfff;
+		}
+	}
+
+	smc.ecc_pos++;
+	if (smc.ecc_pos % 512 == 0) {
+		smc.ecc_block[smc.ecc_pos / 512 - 1] = (1u << 30) | smc.ecc_odd | (smc.ecc_even << 12);
+		smc.ecc_odd = 0;
+		smc.ecc_even = 0;
+	}
+}
+
+/* ----------------------------------------------------------------------
+ * NAND device
+ */
+
+static uint8_t status_byte(void)
+{
+	return STATUS_WP | (nand_busy() ? 0 : STATUS_RDY | STATUS_ARDY) | nand.status;
+}
+
+static void load_page(void)
+{
+	if (nand.row >= PAGES) {
+		memset(nand.reg, 0xff, sizeof(nand.reg));
+		return;
+	}
+	memcpy(nand.reg, nand_page(nand.row), RAW_PAGE_SIZE);
+}
+
+static void program_page(void)
+{
+	nand.status = 0;
+	if (!nand.program_loaded || nand.row >= PAGES) {
+		nand.status = STATUS_FAIL;
+		return;
+	}
+	nand.program_loaded = false;
+
+	if (!pages[nand.row]) {
+		pages[nand.row] = malloc(RAW_PAGE_SIZE);
+		if (!pages[nand.row]) {
+			sim_log("out of memory");
+			exit(1);
+		}
+		memset(pages[nand.row], 0xff, RAW_PAGE_SIZE);
+	}
+
+	uint8_t *p = pages[nand.row];
+
+	for (unsigned int i = 0; i < RAW_PAGE_SIZE; i++) {
+		uint8_t v = nand.reg[i];
+
+		if (cfg.stuck == STUCK_NAND && i < PAGE_SIZE &&
+				(uint64_t)nand.row * PAGE_SIZE + i == cfg.stuck_offset)
+			v |= 1u << cfg.stuck_bit;
+		p[i] &= v;
+	}
+	stats.nand_programmed += PAGE_SIZE;
+	set_busy(NAND_T_PROG);
+}
+
+static void erase_block(void)
+{
+	uint32_t first = nand.row & ~(PAGES_PER_BLOCK - 1);
+
+	nand.status = 0;
+	if (first >= PAGES) {
+		nand.status = STATUS_FAIL;
+		return;
+	}
+	for (uint32_t i = first; i < first + PAGES_PER_BLOCK; i++) {
+		free(pages[i]);
+		pages[i] = NULL;
+	}
+	set_busy(NAND_T_BERS);
+}
+
+static void take_address(void)
+{
+	nand.col = nand.addr[0] | (nand.addr[1] << 8);
+	nand.row = nand.addr[2] | (nand.addr[3] << 8) | (nand.addr[4] << 16);
+}
+
+/** Called once all address cycles of the current command have been seen. */
+static void command_addressed(void)
+{
+	switch (nand.cmd) {
+		case 0x90:
+			nand.out = nand.addr[0] == 0x20 ? OUT_ONFI_ID : OUT_ID;
+			nand.col = 0;
+			break;
+		case 0xec:
+			nand.out = OUT_PARAM;
+			nand.col = 0;
+			set_busy(NAND_T_R);
+			break;
+		case 0xee:
+		case 0xef:
+			nand.feature_addr = nand.addr[0];
+			nand.feature_count = 0;
+			nand.out = OUT_FEATURE;
+			if (nand.cmd == 0xee)
+				set_busy(1);
+			break;
+		case 0x80:
+			take_address();
+			memset(nand.reg, 0xff, sizeof(nand.reg));
+			nand.program_loaded = true;
+			ecc_start();
+			break;
+		case 0x85:
+			nand.col = nand.addr[0] | (nand.addr[1] << 8);
+			break;
+		case 0x00:
+			if (nand.cycles) {
+				take_address();
+			} else if (nand.out == OUT_STATUS) {
+				/* 00h after a status read returns to data output */
+				nand.out = nand.saved_out;
+			}
+			break;
+		case 0x05:
+			nand.col = nand.addr[0] | (nand.addr[1] << 8);
+			break;
+		case 0x60:
+			nand.row = nand.addr[0] | (nand.addr[1] << 8) | (nand.addr[2] << 16);
+			break;
+		default:
+			break;
+	}
+}
+
+static void end_command(uint8_t cmd)
+{
+	if (nand_busy()) {
+		sim_debug("NAND: end command 0x%02x ignored while busy", cmd);
+		return;
+	}
+
+	switch (cmd) {
+		case 0x30:
+			load_page();
+			nand.out = OUT_PAGE;
+			ecc_start();
+			set_busy(NAND_T_R);
+			break;
+		case 0xe0:
+			nand.out = OUT_PAGE;
+			break;
+		case 0x10:
+			program_page();
+			break;
+		case 0xd0:
+			erase_block();
+			break;
+		default:
+			sim_debug("NAND: unsupported end command 0x%02x", cmd);
+			break;
+	}
+}
+
+static void start_command(uint32_t addr)
+{
+	nand.cmd_addr = addr;
+	nand.cmd = (addr >> 3) & 0xff;
+	nand.cycles = (addr >> 21) & 7;
+	nand.naddr = 0;
+	memset(nand.addr, 0, sizeof(nand.addr));
+
+	if (nand_busy() && nand.cmd != 0x70 && nand.cmd != 0xff) {
+		sim_debug("NAND: command 0x%02x while busy", nand.cmd);
+		return;
+	}
+
+	switch (nand.cmd) {
+		case 0xff:
+			nand.busy_until = 0;
+			nand.status = 0;
+			nand.out = OUT_NONE;
+			nand.program_loaded = false;
+			set_busy(NAND_T_RST);
+			break;
+		case 0x70:
+			if (nand.out != OUT_STATUS)
+				nand.saved_out = nand.out;
+			nand.out = OUT_STATUS;
+			break;
+		default:
+			break;
+	}
+}
+
+static void command_write(uint32_t addr, unsigned int size, uint64_t value)
+{
+	bool more = nand.naddr < nand.cycles && addr == nand.cmd_addr;
+
+	if (!more)
+		start_command(addr);
+
+	for (unsigned int i = 0; i < size && nand.naddr < nand.cycles; i++)
+		nand.addr[nand.naddr++] = value >> (8 * i);
+
+	if (nand.naddr < nand.cycles)
+		return;
+
+	command_addressed();
+	if (addr & NAND_END_CMD_VALID)
+		end_command((addr >> 11) & 0xff);
+}
+
+static uint8_t data_out(void)
+{
+	uint8_t v = 0xff;
+
+	switch (nand.out) {
+		case OUT_STATUS:
+			return status_byte();
+		case OUT_PAGE:
+			if (nand.col < RAW_PAGE_SIZE)
+				v = nand.reg[nand.col];
+			nand.col++;
+			ecc_byte(v);
+			return v;
+		case OUT_ID:
+			v = nand.col < sizeof(nand_id) ? nand_id[nand.col] : 0;
+			nand.col++;
+			return v;
+		case OUT_ONFI_ID:
+			v = nand.col < 4 ? "ONFI"[nand.col] : 0;
+			nand.col++;
+			return v;
+		case OUT_PARAM:
+			v = nand.param[nand.col % sizeof(nand.param)];
+			nand.col++;
+			return v;
+		case OUT_FEATURE:
+			v = nand.feature_count < 4 ?
+				nand.features[nand.feature_addr][nand.feature_count] : 0;
+			nand.feature_count++;
+			return v;
+		default:
+			return v;
+	}
+}
+
+static void data_in(uint8_t v)
+{
+	switch (nand.cmd) {
+		case 0x80:
+		case 0x85:
+			if (nand.col < RAW_PAGE_SIZE)
+				nand.reg[nand.col] = v;
+			nand.col++;
+			ecc_byte(v);
+			break;
+		case 0xef:
+			if (nand.feature_count < 4)
+				nand.features[nand.feature_addr][nand.feature_count] = v;
+			if (++nand.feature_count == 4)
+				set_busy(1);
+			break;
+		default:
+			break;
+	}
+}
+
+uint64_t nand_read(uint64_t off, unsigned int size)
+{
+	uint64_t v = 0;
+
+	if (!(off & NAND_DATA_PHASE)) {
+		sim_debug("NAND: read in command phase at 0x%" PRIx64, off);
+		return 0;
+	}
+	for (unsigned int i = 0; i < size; i++)
+		v |= (uint64_t)data_out() << (8 * i);
+	return v;
+}
+
+void nand_write(uint64_t off, unsigned int size, uint64_t value)
+{
+	uint32_t addr = off;
+
+	if (!(addr & NAND_DATA_PHASE)) {
+		command_write(addr, size, value);
+		return;
+	}
+
+	for (unsigned int i = 0; i < size; i++)
+		data_in(value >> (8 * i));
+
+	if ((addr & NAND_CLEAR_CS) && (addr & NAND_END_CMD_VALID))
+		end_command((addr >> 11) & 0xff);
+}
+
+/* ----------------------------------------------------------------------
+ * Controller registers
+ */
+
+void smc_reset(void)
+{
+	memset(&smc, 0, sizeof(smc));
+	nand.busy_until = 0;
+	nand.int_armed = false;
+	nand.out = OUT_NONE;
+	nand.status = 0;
+	nand.program_loaded = false;
+	memset(erased, 0xff, sizeof(erased));
+	build_param_page();
+}
+
+static uint32_t memc_status(void)
+{
+	uint32_t v = smc.int1_enabled ? 1u << 2 : 0;
+
+	if (nand.int_armed && !nand_busy())
+		v |= MEMC_STATUS_INT1_RAW | (smc.int1_enabled ? 1u << 4 : 0);
+	return v;
+}
+
+uint64_t smc_read(uint64_t off, unsigned int size)
+{
+	uint32_t v;
+
+	switch (off & ~3ULL) {
+		case SMC_MEMC_STATUS:
+			v = memc_status();
+			break;
+		case SMC_ECC1_STATUS:
+			v = 0;		/* never busy, the ECC is computed on the fly */
+			for (unsigned int i = 0; i < 4; i++)
+				if (smc.ecc_block[i] & (1u << 30))
+					v |= 1u << (10 + i);
+			break;
+		case SMC_ECC1_BLOCK0:
+		case SMC_ECC1_BLOCK0 + 4:
+		case SMC_ECC1_BLOCK0 + 8:
+		case SMC_ECC1_BLOCK0 + 12:
+			v = smc.ecc_block[(off - SMC_ECC1_BLOCK0) / 4];
+			break;
+		default:
+			v = smc.regs[(off & 0xfff) / 4];
+			break;
+	}
+
+	return size < 4 ? (v >> (8 * (off & 3))) & ((1u << (8 * size)) - 1) : v;
+}
+
+void smc_write(uint64_t off, unsigned int size, uint64_t value)
+{
+	uint32_t v = value;
+
+	if (size < 4) {
+		sim_debug("SMC: %u byte register write at 0x%03x", size, (unsigned int)off);
+		v <<= 8 * (off & 3);
+	}
+
+	switch (off & ~3ULL) {
+		case SMC_MEM_CFG_SET:
+			if (v & (1u << 1))
+				smc.int1_enabled = true;
+			break;
+		case SMC_MEM_CFG_CLR:
+			if (v & MEM_CFG_CLR_INT1)
+				nand.int_armed = false;
+			if (v & (1u << 1))
+				smc.int1_enabled = false;
+			break;
+		case SMC_ECC1_STATUS:
+			break;
+		case SMC_ECC1_BLOCK0:
+		case SMC_ECC1_BLOCK0 + 4:
+		case SMC_ECC1_BLOCK0 + 8:
+		case SMC_ECC1_BLOCK0 + 12:
+		case SMC_ECC1_EXTRA_BLOCK:
+			break;
+		default:
+			smc.regs[(off & 0xfff) / 4] = v;
+			break;
+	}
+}
@@ -0,0 +1,852 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * DesignWare SSI controller in master mode with a serial NOR flash on
+ * slave select 0.
+ *
+ * The controller is modelled frame by frame against simulated time: a
+ * transfer starts when the TX FIFO passes the TXFTHR start level, every
+ * frame takes (bits / lanes) serial clocks, and the FIFOs fill and drain
+ * at that rate.  In standard SPI mode the controller ends the transfer
+ * (releases chip select) as soon as the TX FIFO runs dry, exactly like
+ * the hardware, which is what makes a slow feeder corrupt page programs.
+ * In enhanced mode with CLK_STRETCH_EN the serial clock is paused
+ * instead.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr1sim.h"
+
+#define SSI_CTRLR0	0x00
+#define SSI_CTRLR1	0x04
+#define SSI_SSIENR	0x08
+#define SSI_SER		0x10
+#define SSI_BAUDR	0x14
+#define SSI_TXFTLR	0x18
+#define SSI_RXFTLR	0x1c
+#define SSI_TXFLR	0x20
+#define SSI_RXFLR	0x24
+#define SSI_SR		0x28
+#define SSI_IMR		0x2c
+#define SSI_ISR		0x30
+#define SSI_RISR	0x34
+#define SSI_TXOICR	0x38
+#define SSI_RXOICR	0x3c
+#define SSI_RXUICR	0x40
+#define SSI_ICR		0x48
+#define SSI_IDR		0x58
+#define SSI_VERSION	0x5c
+#define SSI_DR		0x60
+#define SSI_DR_END	0xec
+#define SSI_SPI_CTRLR0	0xf4
+
+#define TMOD_TX_AND_RX	0
+#define TMOD_TX_ONLY	1
+#define TMOD_RX_ONLY	2
+#define TMOD_EEPROM	3
+
+#define SPI_CTRLR0_STRETCH	(1u << 30)
+
+#define FIFO_DEPTH	256
+
+enum ssi_phase {
+	PH_INST,
+	PH_ADDR,
+	PH_WAIT,
+	PH_TX,
+	PH_RX,
+};
+
+static struct {
+	uint32_t ctrlr0, ctrlr1, ssienr, ser, baudr, txftlr, rxftlr;
+	uint32_t imr, risr, spi_ctrlr0;
+
+	uint32_t txf[FIFO_DEPTH];
+	unsigned int tx_head, tx_count;
+	uint8_t rxf[FIFO_DEPTH];
+	unsigned int rx_head, rx_count;
+
+	bool active;		/* transfer in progress, SR.BUSY */
+	bool stalled;		/* serial clock stretched */
+	bool rx_pending;	/* standard RX_ONLY waiting for a DR write */
+	enum ssi_phase phase;
+	uint32_t frames_left;
+	bool counted;		/* frames_left limits the data phase */
+	uint64_t unit_end;	/* completion time of the frame in flight */
+	bool unit_rx;
+	uint8_t unit_byte;
+	bool warned;
+} ssi;
+
+/* ----------------------------------------------------------------------
+ * SPI NOR flash
+ */
+
+enum nor_kind {
+	NOR_NONE,
+	NOR_READ,
+	NOR_PROGRAM,
+	NOR_ERASE,
+	NOR_CHIP_ERASE,
+	NOR_RDSR,
+	NOR_WRSR,
+	NOR_WREN,
+	NOR_WRDI,
+	NOR_RDID,
+	NOR_RSTEN,
+	NOR_RST,
+	NOR_EN4B,
+	NOR_EX4B,
+};
+
+struct nor_op {
+	uint8_t opcode;
+	enum nor_kind kind;
+	uint8_t addr;		/* address bytes, 3 = depends on 4-byte mode */
+	uint8_t addr_lanes;
+	uint8_t dummy;		/* dummy clocks */
+	uint8_t data_lanes;
+	uint32_t arg;		/* erase size, status register index */
+};
+
+static const struct nor_op nor_ops[] = {
+	{ 0x03, NOR_READ, 3, 1, 0, 1, 0 },
+	{ 0x13, NOR_READ, 4, 1, 0, 1, 0 },
+	{ 0x0b, NOR_READ, 3, 1, 8, 1, 0 },
+	{ 0x0c, NOR_READ, 4, 1, 8, 1, 0 },
+	{ 0x3b, NOR_READ, 3, 1, 8, 2, 0 },
+	{ 0x3c, NOR_READ, 4, 1, 8, 2, 0 },
+	{ 0x6b, NOR_READ, 3, 1, 8, 4, 0 },
+	{ 0x6c, NOR_READ, 4, 1, 8, 4, 0 },
+	{ 0xeb, NOR_READ, 3, 4, 6, 4, 0 },
+	{ 0xec, NOR_READ, 4, 4, 6, 4, 0 },
+	{ 0x02, NOR_PROGRAM, 3, 1, 0, 1, 0 },
+	{ 0x12, NOR_PROGRAM, 4, 1, 0, 1, 0 },
+	{ 0x32, NOR_PROGRAM, 3, 1, 0, 4, 0 },
+	{ 0x34, NOR_PROGRAM, 4, 1, 0, 4, 0 },
+	{ 0x20, NOR_ERASE, 3, 1, 0, 0, 0x1000 },
+	{ 0x21, NOR_ERASE, 4, 1, 0, 0, 0x1000 },
+	{ 0x52, NOR_ERASE, 3, 1, 0, 0, 0x8000 },
+	{ 0xd8, NOR_ERASE, 3, 1, 0, 0, 0x10000 },
+	{ 0xdc, NOR_ERASE, 4, 1, 0, 0, 0x10000 },
+	{ 0xc7, NOR_CHIP_ERASE, 0, 0, 0, 0, 0 },
+	{ 0x60, NOR_CHIP_ERASE, 0, 0, 0, 0, 0 },
+	{ 0x05, NOR_RDSR, 0, 0, 0, 1, 0 },
+	{ 0x35, NOR_RDSR, 0, 0, 0, 1, 1 },
+	{ 0x15, NOR_RDSR, 0, 0, 0, 1, 2 },
+	{ 0x01, NOR_WRSR, 0, 0, 0, 1, 0 },
+	{ 0x31, NOR_WRSR, 0, 0, 0, 1, 1 },
+	{ 0x11, NOR_WRSR, 0, 0, 0, 1, 2 },
+	{ 0x06, NOR_WREN, 0, 0, 0, 0, 0 },
+	{ 0x04, NOR_WRDI, 0, 0, 0, 0, 0 },
+	{ 0x9f, NOR_RDID, 0, 0, 0, 1, 0 },
+	{ 0x66, NOR_RSTEN, 0, 0, 0, 0, 0 },
+	{ 0x99, NOR_RST, 0, 0, 0, 0, 0 },
+	{ 0xf0, NOR_RST, 0, 0, 0, 0, 0 },
+	{ 0xb7, NOR_EN4B, 0, 0, 0, 0, 0 },
+	{ 0xe9, NOR_EX4B, 0, 0, 0, 0, 0 },
+};
+
+#define NOR_SR1_WIP	0x01
+#define NOR_SR1_WEL	0x02
+#define NOR_SR2_QE	0x02
+
+/* typical program, erase and status write times in microseconds */
+#define NOR_T_PP	300
+#define NOR_T_SE	30000
+#define NOR_T_BE	120000
+#define NOR_T_CE_PER_64K	5000
+#define NOR_T_W		2000
+
+static struct {
+	uint8_t *data;
+	uint32_t size;
+	uint8_t sr[3];
+	bool four_byte;
+	bool reset_enabled;
+	uint64_t busy_until;
+
+	/* current chip select cycle */
+	bool selected;
+	const struct nor_op *op;
+	bool opcode_seen;
+	bool invalid;		/* quad disabled, wrong lane count, ... */
+	bool garbled;		/* wrong number of dummy clocks */
+	unsigned int addr_bytes, addr_got;
+	uint32_t addr;
+	int dummy_left;
+	uint32_t count;
+	uint8_t page[256];
+	uint16_t page_bytes;
+	uint8_t status_bytes[2];
+	unsigned int status_count;
+	bool was_rsten;
+} nor;
+
+uint8_t *nor_data(void)
+{
+	return nor.data;
+}
+
+static bool nor_busy(void)
+{
+	return sim_now < nor.busy_until;
+}
+
+static void nor_init(void)
+{
+	if (nor.data)
+		return;
+	nor.size = cfg.nor_size;
+	nor.data = malloc(nor.size);
+	if (!nor.data) {
+		sim_log("out of memory");
+		exit(1);
+	}
+	memset(nor.data, 0xff, nor.size);
+}
+
+static void nor_select(bool on)
+{
+	if (on) {
+		nor.selected = true;
+		nor.op = NULL;
+		nor.opcode_seen = false;
+		nor.invalid = false;
+		nor.garbled = false;
+		nor.addr_got = 0;
+		nor.addr = 0;
+		nor.count = 0;
+		nor.page_bytes = 0;
+		nor.status_count = 0;
+		return;
+	}
+	if (!nor.selected)
+		return;
+	nor.selected = false;
+
+	bool was_rsten = nor.was_rsten;
+
+	nor.was_rsten = false;
+	if (!nor.op || nor.invalid || nor.addr_got < nor.addr_bytes)
+		return;
+
+	switch (nor.op->kind) {
+		case NOR_WREN:
+			nor.sr[0] |= NOR_SR1_WEL;
+			break;
+		case NOR_WRDI:
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			break;
+		case NOR_RSTEN:
+			nor.was_rsten = true;
+			break;
+		case NOR_RST:
+			if (nor.op->opcode == 0x99 && !was_rsten)
+				break;
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			nor.four_byte = false;
+			nor.busy_until = 0;
+			break;
+		case NOR_EN4B:
+			nor.four_byte = true;
+			break;
+		case NOR_EX4B:
+			nor.four_byte = false;
+			break;
+		case NOR_WRSR:
+			if (!(nor.sr[0] & NOR_SR1_WEL) || !nor.status_count)
+				break;
+			if (nor.op->arg == 0) {
+				nor.sr[0] = (nor.sr[0] & 3) | (nor.status_bytes[0] & 0xfc);
+				if (nor.status_count > 1)
+					nor.sr[1] = nor.status_bytes[1];
+			} else {
+				nor.sr[nor.op->arg] = nor.status_bytes[0];
+			}
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			nor.busy_until = sim_now + flash_time(NOR_T_W);
+			break;
+		case NOR_PROGRAM: {
+			uint32_t page = nor.addr & ~0xffu & (nor.size - 1);
+			unsigned int n = nor.count > 256 ? 256 : nor.count;
+			unsigned int start = nor.count > 256 ? nor.addr + nor.count : nor.addr;
+
+			if (!(nor.sr[0] & NOR_SR1_WEL) || !nor.count)
+				break;
+			for (unsigned int i = 0; i < n; i++) {
+				uint32_t a = page + ((start + i) & 0xff);
+				uint8_t v = nor.page[(start + i) & 0xff];
+
+				if (cfg.stuck == STUCK_NOR && a == cfg.stuck_offset)
+					v |= 1u << cfg.stuck_bit;
+				nor.data[a] &= v;
+			}
+			stats.nor_programmed += n;
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			nor.busy_until = sim_now + flash_time(NOR_T_PP);
+			break;
+		}
+		case NOR_ERASE: {
+			uint32_t size = nor.op->arg;
+			uint32_t a = nor.addr & ~(size - 1) & (nor.size - 1);
+
+			if (!(nor.sr[0] & NOR_SR1_WEL))
+				break;
+			memset(nor.data + a, 0xff, size);
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			nor.busy_until = sim_now + flash_time(size == 0x1000 ? NOR_T_SE : NOR_T_BE);
+			break;
+		}
+		case NOR_CHIP_ERASE:
+			if (!(nor.sr[0] & NOR_SR1_WEL))
+				break;
+			memset(nor.data, 0xff, nor.size);
+			nor.sr[0] &= ~NOR_SR1_WEL;
+			nor.busy_until = sim_now + flash_time((uint64_t)NOR_T_CE_PER_64K * (nor.size >> 16));
+			break;
+		default:
+			break;
+	}
+}
+
+static void nor_opcode(uint8_t opcode, int lanes)
+{
+	nor.opcode_seen = true;
+	for (size_t i = 0; i < sizeof(nor_ops) / sizeof(nor_ops[0]); i++) {
+		if (nor_ops[i].opcode == opcode) {
+			nor.op = &nor_ops[i];
+			break;
+		}
+	}
+
+	if (!nor.op) {
+		static unsigned int reported;
+
+		if (reported++ < 4)
+			sim_log("NOR: unknown opcode 0x%02x, data stream out of sync?%s", opcode,
+				reported == 4 ? " (not reported again)" : "");
+		return;
+	}
+	if (lanes != 1) {
+		nor.invalid = true;
+		return;
+	}
+	/* While busy the flash only answers status reads. */
+	if (nor_busy() && nor.op->kind != NOR_RDSR) {
+		sim_debug("NOR: opcode 0x%02x ignored while busy", opcode);
+		nor.invalid = true;
+		return;
+	}
+	if (nor.op->data_lanes == 4 && !(nor.sr[1] & NOR_SR2_QE)) {
+		sim_debug("NOR: quad opcode 0x%02x ignored, QE is clear", opcode);
+		nor.invalid = true;
+		return;
+	}
+
+	nor.addr_bytes = nor.op->addr == 3 && nor.four_byte ? 4 : nor.op->addr;
+	nor.dummy_left = nor.op->dummy;
+}
+
+static uint8_t nor_xfer(uint8_t out, int lanes)
+{
+	if (!nor.selected)
+		return 0xff;
+
+	if (!nor.opcode_seen) {
+		nor_opcode(out, lanes);
+		return 0xff;
+	}
+	if (!nor.op || nor.invalid)
+		return 0xff;
+
+	if (nor.addr_got < nor.addr_bytes) {
+		if (lanes != nor.op->addr_lanes)
+			nor.invalid = true;
+		nor.addr = (nor.addr << 8) | out;
+		nor.addr_got++;
+		return 0xff;
+	}
+
+	if (nor.dummy_left > 0) {
+		nor.dummy_left -= 8 / lanes;
+		if (nor.dummy_left < 0)
+			nor.garbled = true;
+		return 0xff;
+	}
+
+	switch (nor.op->kind) {
+		case NOR_READ: {
+			uint8_t v = nor.data[(nor.addr + nor.count++) & (nor.size - 1)];
+
+			if (lanes != nor.op->data_lanes)
+				return 0xff;
+			return nor.garbled ? v ^ 0x5a : v;
+		}
+		case NOR_PROGRAM:
+			if (lanes != nor.op->data_lanes) {
+				nor.invalid = true;
+				return 0xff;
+			}
+			nor.page[(nor.addr + nor.count) & 0xff] = out;
+			nor.count++;
+			return 0xff;
+		case NOR_RDSR:
+			if (nor.op->arg == 0)
+				return (nor.sr[0] & ~NOR_SR1_WIP) | (nor_busy() ? NOR_SR1_WIP : 0);
+			return nor.sr[nor.op->arg];
+		case NOR_WRSR:
+			if (nor.status_count < 2)
+				nor.status_bytes[nor.status_count++] = out;
+			return 0xff;
+		case NOR_RDID:
+			if (nor.count >= 3)
+				return 0;
+			return cfg.nor_id >> (8 * (2 - nor.count++));
+		default:
+			return 0xff;
+	}
+}
+
+static void nor_dummy(unsigned int clocks)
+{
+	if (!nor.selected || !nor.op || nor.invalid)
+		return;
+	nor.dummy_left -= clocks;
+	if (nor.dummy_left != 0)
+		nor.garbled = true;
+	nor.dummy_left = 0;
+}
+
+/* ----------------------------------------------------------------------
+ * SSI controller
+ */
+
+static unsigned int tmod(void)
+{
+	return (ssi.ctrlr0 >> 10) & 3;
+}
+
+static unsigned int frf_lanes(void)
+{
+	static const unsigned int lanes[4] = { 1, 2, 4, 8 };
+
+	return lanes[(ssi.ctrlr0 >> 22) & 3];
+}
+
+static bool enhanced(void)
+{
+	return frf_lanes() > 1;
+}
+
+static unsigned int inst_bits(void)
+{
+	static const unsigned int bits[4] = { 0, 4, 8, 16 };
+
+	return bits[(ssi.spi_ctrlr0 >> 8) & 3];
+}
+
+static unsigned int addr_bits(void)
+{
+	return ((ssi.spi_ctrlr0 >> 2) & 0xf) * 4;
+}
+
+static unsigned int wait_cycles(void)
+{
+	return (ssi.spi_ctrlr0 >> 11) & 0x1f;
+}
+
+static bool stretch(void)
+{
+	return enhanced() && (ssi.spi_ctrlr0 & SPI_CTRLR0_STRETCH);
+}
+
+static unsigned int inst_lanes(void)
+{
+	return (ssi.spi_ctrlr0 & 3) == 2 ? frf_lanes() : 1;
+}
+
+static unsigned int addr_lanes(void)
+{
+	return (ssi.spi_ctrlr0 & 3) == 0 ? 1 : frf_lanes();
+}
+
+static uint64_t sclk_ps(void)
+{
+	uint64_t p = cfg.ssi_clk_ps * (ssi.baudr & 0xfffe);
+
+	p /= cfg.ssi_speedup ? cfg.ssi_speedup : 1;
+	return p ? p : 1;
+}
+
+static uint32_t tx_pop(void)
+{
+	uint32_t v = ssi.txf[ssi.tx_head];
+
+	ssi.tx_head = (ssi.tx_head + 1) % FIFO_DEPTH;
+	ssi.tx_count--;
+	return v;
+}
+
+static void rx_push(uint8_t v)
+{
+	if (ssi.rx_count == FIFO_DEPTH) {
+		ssi.risr |= 1u << 3;	/* RXOIR */
+		stats.ssi_overruns++;
+		sim_debug("SSI: RX FIFO overflow");
+		return;
+	}
+	ssi.rxf[(ssi.rx_head + ssi.rx_count) % FIFO_DEPTH] = v;
+	ssi.rx_count++;
+}
+
+static void end_transfer(void)
+{
+	ssi.active = false;
+	ssi.stalled = false;
+	nor_select(false);
+}
+
+static void schedule(uint64_t t, uint64_t clocks)
+{
+	ssi.unit_end = t + clocks * sclk_ps();
+}
+
+static uint8_t send(uint32_t value, unsigned int bits, unsigned int lanes)
+{
+	uint8_t in = 0xff;
+
+	for (int shift = bits - 8; shift >= 0; shift -= 8)
+		in = nor_xfer(value >> shift, lanes);
+	return in;
+}
+
+/**
+ * Start the next frame of the transfer at time @a t.
+ * @returns false if the transfer ended or the clock is stretched.
+ */
+static bool begin_unit(uint64_t t)
+{
+	ssi.unit_rx = false;
+
+	for (;;) {
+		switch (ssi.phase) {
+			case PH_INST:
+				ssi.phase = PH_ADDR;
+				if (!enhanced() || !inst_bits())
+					continue;
+				send(tx_pop(), 8, inst_lanes());
+				schedule(t, 8 / inst_lanes());
+				return true;
+			case PH_ADDR:
+				ssi.phase = PH_WAIT;
+				if (!enhanced() || !addr_bits())
+					continue;
+				send(tx_pop(), addr_bits(), addr_lanes());
+				schedule(t, addr_bits() / addr_lanes());
+				return true;
+			case PH_WAIT:
+				ssi.phase = tmod() == TMOD_RX_ONLY ? PH_RX : PH_TX;
+				if (!enhanced() || !wait_cycles())
+					continue;
+				nor_dummy(wait_cycles());
+				schedule(t, wait_cycles());
+				return true;
+			case PH_TX:
+				if (ssi.counted && !ssi.frames_left) {
+					end_transfer();
+					return false;
+				}
+				if (!ssi.tx_count) {
+					if (tmod() == TMOD_EEPROM) {
+						ssi.phase = PH_RX;
+						ssi.frames_left = (ssi.ctrlr1 & 0xffff) + 1;
+						ssi.counted = true;
+						continue;
+					}
+					if (stretch()) {
+						ssi.stalled = true;
+						return false;
+					}
+					if (enhanced() && ssi.frames_left) {
+						stats.ssi_underruns++;
+						ssi.risr |= 1u << 0;
+						if (stats.ssi_underruns <= 4)
+							sim_log("SSI: TX FIFO underrun, transfer cut short with %u frames left%s",
+								ssi.frames_left,
+								stats.ssi_underruns == 4 ? " (not reported again)" : "");
+					}
+					end_transfer();
+					return false;
+				}
+				ssi.unit_byte = nor_xfer(tx_pop(), frf_lanes());
+				ssi.unit_rx = tmod() == TMOD_TX_AND_RX;
+				if (ssi.frames_left)
+					ssi.frames_left--;
+				schedule(t, 8 / frf_lanes());
+				return true;
+			case PH_RX:
+				if (!ssi.frames_left) {
+					end_transfer();
+					return false;
+				}
+				if (ssi.rx_count == FIFO_DEPTH && stretch()) {
+					ssi.stalled = true;
+					return false;
+				}
+				ssi.unit_byte = nor_xfer(0xff, frf_lanes());
+				ssi.unit_rx = true;
+				ssi.frames_left--;
+				schedule(t, 8 / frf_lanes());
+				return true;
+		}
+	}
+}
+
+static void sync(void)
+{
+	while (ssi.active && !ssi.stalled && ssi.unit_end <= sim_now) {
+		uint64_t t = ssi.unit_end;
+
+		if (ssi.unit_rx)
+			rx_push(ssi.unit_byte);
+		begin_unit(t);
+	}
+}
+
+static void start_transfer(void)
+{
+	ssi.active = true;
+	ssi.stalled = false;
+	ssi.phase = PH_INST;
+	ssi.counted = false;
+	ssi.frames_left = 0;
+	/*
+	 * NDF only ends enhanced mode TX transfers when the clock may be
+	 * stretched, but it is still what the software meant to send, so
+	 * keep counting to diagnose underruns.
+	 */
+	if (tmod() == TMOD_RX_ONLY || enhanced()) {
+		ssi.counted = tmod() == TMOD_RX_ONLY || stretch();
+		ssi.frames_left = (ssi.ctrlr1 & 0xffff) + 1;
+	}
+	if (ssi.ser & 1)
+		nor_select(true);
+	begin_unit(sim_now);
+}
+
+/** Start a transfer or restart a stretched clock if the FIFOs allow it. */
+static void kick(void)
+{
+	if (!(ssi.ssienr & 1))
+		return;
+
+	if (ssi.active) {
+		if (ssi.stalled) {
+			ssi.stalled = false;
+			if (!begin_unit(sim_now) && !ssi.active)
+				return;
+		}
+		return;
+	}
+
+	if (enhanced() && tmod() == TMOD_RX_ONLY) {
+		unsigned int need = (inst_bits() ? 1 : 0) + (addr_bits() ? 1 : 0);
+
+		if (ssi.tx_count >= (need ? need : 1))
+			start_transfer();
+	} else if (tmod() == TMOD_RX_ONLY) {
+		if (ssi.rx_pending) {
+			ssi.rx_pending = false;
+			ssi.tx_count = 0;
+			start_transfer();
+		}
+	} else if (ssi.tx_count > ((ssi.txftlr >> 16) & 0xff)) {
+		start_transfer();
+	}
+}
+
+static void flush(void)
+{
+	ssi.tx_head = ssi.tx_count = 0;
+	ssi.rx_head = ssi.rx_count = 0;
+	ssi.rx_pending = false;
+	if (ssi.active)
+		end_transfer();
+}
+
+void ssi_reset(void)
+{
+	nor_init();
+	nor_select(false);
+	memset(&ssi, 0, sizeof(ssi));
+	ssi.ctrlr0 = 7;
+	ssi.baudr = 0;
+	ssi.spi_ctrlr0 = 0x200;
+	nor.busy_until = 0;
+	nor.four_byte = false;
+	nor.sr[0] &= ~NOR_SR1_WEL;
+}
+
+static uint32_t isr_raw(void)
+{
+	uint32_t v = ssi.risr;
+
+	if (ssi.tx_count <= (ssi.txftlr & 0xff))
+		v |= 1u << 0;
+	if (ssi.rx_count > (ssi.rxftlr & 0xff))
+		v |= 1u << 4;
+	return v;
+}
+
+uint64_t ssi_read(uint64_t off, unsigned int size)
+{
+	uint32_t v = 0;
+
+	sync();
+
+	switch (off & ~3ULL) {
+		case SSI_CTRLR0:
+			v = ssi.ctrlr0;
+			break;
+		case SSI_CTRLR1:
+			v = ssi.ctrlr1;
+			break;
+		case SSI_SSIENR:
+			v = ssi.ssienr;
+			break;
+		case SSI_SER:
+			v = ssi.ser;
+			break;
+		case SSI_BAUDR:
+			v = ssi.baudr;
+			break;
+		case SSI_TXFTLR:
+			v = ssi.txftlr;
+			break;
+		case SSI_RXFTLR:
+			v = ssi.rxftlr;
+			break;
+		case SSI_TXFLR:
+			v = ssi.tx_count;
+			break;
+		case SSI_RXFLR:
+			v = ssi.rx_count;
+			break;
+		case SSI_SR:
+			v = (ssi.active ? 1 : 0) | (ssi.tx_count < FIFO_DEPTH ? 2 : 0) |
+				(ssi.tx_count == 0 ? 4 : 0) | (ssi.rx_count ? 8 : 0) |
+				(ssi.rx_count == FIFO_DEPTH ? 16 : 0);
+			break;
+		case SSI_IMR:
+			v = ssi.imr;
+			break;
+		case SSI_ISR:
+			v = isr_raw() & ssi.imr;
+			break;
+		case SSI_RISR:
+			v = isr_raw();
+			break;
+		case SSI_TXOICR:
+			ssi.risr &= ~(1u << 1);
+			break;
+		case SSI_RXOICR:
+			ssi.risr &= ~(1u << 3);
+			break;
+		case SSI_RXUICR:
+			ssi.risr &= ~(1u << 2);
+			break;
+		case SSI_ICR:
+			ssi.risr = 0;
+			break;
+		case SSI_VERSION:
+			v = 0x3130332a;
+			break;
+		case SSI_SPI_CTRLR0:
+			v = ssi.spi_ctrlr0;
+			break;
+		default:
+			if (off >= SSI_DR && off <= SSI_DR_END) {
+				if (!ssi.rx_count) {
+					ssi.risr |= 1u << 2;	/* RXUIR */
+					break;
+				}
+				v = ssi.rxf[ssi.rx_head];
+				ssi.rx_head = (ssi.rx_head + 1) % FIFO_DEPTH;
+				ssi.rx_count--;
+				kick();
+			}
+			break;
+	}
+
+	return size < 4 ? (v >> (8 * (off & 3))) & ((1u << (8 * size)) - 1) : v;
+}
+
+static void write_locked(uint32_t *reg, uint32_t value, const char *name)
+{
+	if (ssi.ssienr & 1) {
+		if (!ssi.warned)
+			sim_log("SSI: %s written while the controller is enabled, ignored", name);
+		ssi.warned = true;
+		return;
+	}
+	*reg = value;
+}
+
+void ssi_write(uint64_t off, unsigned int size, uint64_t value)
+{
+	uint32_t v = value;
+
+	sync();
+
+	if (size < 4)
+		v <<= 8 * (off & 3);
+
+	switch (off & ~3ULL) {
+		case SSI_CTRLR0:
+			write_locked(&ssi.ctrlr0, v, "CTRLR0");
+			break;
+		case SSI_CTRLR1:
+			write_locked(&ssi.ctrlr1, v & 0xffff, "CTRLR1");
+			break;
+		case SSI_SSIENR:
+			ssi.ssienr = v & 1;
+			if (!ssi.ssienr)
+				flush();
+			break;
+		case SSI_SER:
+			ssi.ser = v & 3;
+			break;
+		case SSI_BAUDR:
+			write_locked(&ssi.baudr, v & 0xfffe, "BAUDR");
+			break;
+		case SSI_TXFTLR:
+			ssi.txftlr = v & 0x00ff00ff;
+			break;
+		case SSI_RXFTLR:
+			ssi.rxftlr = v & 0xff;
+			break;
+		case SSI_IMR:
+			ssi.imr = v & 0x3f;
+			break;
+		case SSI_SPI_CTRLR0:
+			write_locked(&ssi.spi_ctrlr0, v, "SPI_CTRLR0");
+			break;
+		default:
+			if (off >= SSI_DR && off <= SSI_DR_END && (ssi.ssienr & 1)) {
+				if (ssi.tx_count == FIFO_DEPTH) {
+					ssi.risr |= 1u << 1;	/* TXOIR */
+					break;
+				}
+				ssi.txf[(ssi.tx_head + ssi.tx_count) % FIFO_DEPTH] = v;
+				ssi.tx_count++;
+				if (tmod() == TMOD_RX_ONLY && !enhanced())
+					ssi.rx_pending = true;
+			}
+			break;
+	}
+
+	kick();
+}
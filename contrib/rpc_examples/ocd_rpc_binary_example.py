@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""
+OpenOCD binary framed RPC example, covered by GNU GPLv3 or later
+
+Switches a Tcl RPC connection to the binary framed protocol, then sends many
+memory requests before reading any reply.  Adjacent requests are served by
+OpenOCD with a single target access.
+"""
+
+import socket
+import struct
+
+MAGIC = 0xb7
+OP_EVAL, OP_READ, OP_WRITE, OP_NOTIFY = 1, 2, 3, 0x80
+
+REQUEST = struct.Struct("<BBHII")      # magic, op, reserved, id, length
+REPLY = struct.Struct("<BBHIiI")       # magic, op, reserved, id, status, length
+ACCESS = struct.Struct("<QII")         # address, size, count
+
+
+class OpenOcdBinary:
+    def __init__(self, host="127.0.0.1", port=6666):
+        self.sock = socket.create_connection((host, port))
+        self.sock.sendall(b"tcl_binary\x1a")
+        self._recv_until(b"\x1a")
+        self.next_id = 1
+        self.pending = b""
+
+    def _recv_until(self, token):
+        data = b""
+        while not data.endswith(token):
+            data += self.sock.recv(1)
+        return data
+
+    def _recv_exact(self, n):
+        data = b""
+        while len(data) < n:
+            chunk = self.sock.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("OpenOCD closed the connection")
+            data += chunk
+        return data
+
+    def queue(self, op, payload):
+        """Queue a request; returns its id."""
+        rid = self.next_id
+        self.next_id += 1
+        self.pending += REQUEST.pack(MAGIC, op, 0, rid, len(payload)) + payload
+        return rid
+
+    def queue_read(self, address, size, count):
+        return self.queue(OP_READ, ACCESS.pack(address, size, count))
+
+    def queue_write(self, address, size, data):
+        return self.queue(OP_WRITE, ACCESS.pack(address, size, len(data) // size) + data)
+
+    def queue_eval(self, command):
+        return self.queue(OP_EVAL, command.encode())
+
+    def flush(self, count):
+        """Send the queued requests and collect count replies by id."""
+        self.sock.sendall(self.pending)
+        self.pending = b""
+        replies = {}
+        while len(replies) < count:
+            _, op, _, rid, status, length = REPLY.unpack(self._recv_exact(REPLY.size))
+            payload = self._recv_exact(length)
+            if op == OP_NOTIFY:
+                print("notification:", payload.decode().strip())
+                continue
+            replies[rid] = (status, payload)
+        return replies
+
+
+if __name__ == "__main__":
+    ocd = OpenOcdBinary()
+    ocd.queue_eval("halt")
+    ocd.queue_write(0x20000000, 4, bytes(range(64)))
+    ids = [ocd.queue_read(0x20000000 + 4 * i, 4, 1) for i in range(16)]
+    replies = ocd.flush(2 + len(ids))
+    for rid in ids:
+        status, data = replies[rid]
+        print("%d: status %d, data %s" % (rid, status, data.hex()))
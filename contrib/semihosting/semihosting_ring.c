@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Target side of the OpenOCD semihosting write ring.
+ *
+ * Once "arm semihosting_ring <size>" (or the equivalent command of another
+ * architecture) has set up a ring, semihosting_ring_write() queues data for
+ * an open semihosting handle in target memory and returns without trapping.
+ * OpenOCD writes the queued data out on the next semihosting trap of any
+ * kind, so a trap is only taken when the ring is full, plus once at the end
+ * (SYS_EXIT, SYS_CLOSE, ...).  Without a ring it falls back to SYS_WRITE.
+ * The ring is checked on every write; once OpenOCD has released it
+ * ("semihosting_ring off"), it is probed for once more and, if there is no
+ * new one, SYS_WRITE is used.
+ *
+ * Add this file to your project and provide semihosting_call(), the function
+ * your runtime already uses to issue a semihosting trap with the operation
+ * number and the parameter block address.  Call semihosting_ring_write()
+ * from your _write() or equivalent.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SYS_OPEN		0x01
+#define SYS_WRITE		0x05
+
+#define RING_MAGIC		0x53485247	/* "SHRG" */
+
+struct semihosting_ring {
+	uint32_t magic;
+	uint32_t size;		/* bytes in data[] */
+	uint32_t head;		/* written by the target */
+	uint32_t tail;		/* written by OpenOCD */
+	uint8_t data[];
+};
+
+long semihosting_call(int op, void *param);
+
+static volatile struct semihosting_ring *ring;
+static int ring_probed;
+
+static volatile struct semihosting_ring *ring_get(void)
+{
+	/* OpenOCD clears the magic when it stops using the ring, after which
+	 * the memory may be reused: look for a new ring instead */
+	if (ring && ring->magic != RING_MAGIC) {
+		ring = NULL;
+		ring_probed = 0;
+	}
+
+	if (!ring_probed) {
+		static const char name[] = ":semihosting-ring";
+		uintptr_t param[3] = { (uintptr_t)name, 0, sizeof(name) - 1 };
+		long address = semihosting_call(SYS_OPEN, param);
+
+		if (address != -1 &&
+				((volatile struct semihosting_ring *)address)->magic == RING_MAGIC)
+			ring = (volatile struct semihosting_ring *)address;
+		ring_probed = 1;
+	}
+	return ring;
+}
+
+static uint32_t ring_put_word(volatile struct semihosting_ring *r, uint32_t pos,
+	uint32_t value)
+{
+	/* pos and size are multiples of 4, so a word never wraps */
+	*(volatile uint32_t *)&r->data[pos] = value;
+	pos += 4;
+	return pos == r->size ? 0 : pos;
+}
+
+/**
+ * Write len bytes to a handle returned by SYS_OPEN.
+ * @returns 0 on success, otherwise the number of bytes not written.
+ */
+long semihosting_ring_write(int fd, const void *buf, size_t len)
+{
+	volatile struct semihosting_ring *r = ring_get();
+
+	if (r) {
+		uint32_t size = r->size;
+		uint32_t head = r->head;
+		uint32_t tail = r->tail;
+		/* one word always stays free so that head == tail means empty */
+		uint32_t room = (tail > head ? tail - head : size - head + tail) - 4;
+		uint32_t padded = (len + 3) & ~3u;
+
+		if (len <= size && 8 + padded <= room) {
+			const uint8_t *src = buf;
+			uint32_t pos = ring_put_word(r, head, fd);
+
+			pos = ring_put_word(r, pos, len);
+			for (size_t i = 0; i < padded; i++) {
+				r->data[pos] = i < len ? src[i] : 0;
+				if (++pos == size)
+					pos = 0;
+			}
+
+			/* publish the record only once it is complete */
+			__sync_synchronize();
+			r->head = pos;
+			return 0;
+		}
+	}
+
+	uintptr_t param[3] = { (uintptr_t)fd, (uintptr_t)buf, len };
+	return semihosting_call(SYS_WRITE, param);
+}
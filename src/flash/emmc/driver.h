@@ -42,7 +42,7 @@ struct emmc_flash_controller {
 	int (*write_block_data)(struct emmc_device *emmc, uint32_t *data, uint32_t addr);
 
 	/** Write image to the EMMC device. */
-	int (*write_image)(struct emmc_device *emmc, uint8_t *data, uint32_t addr, int size);	
+	int (*write_image)(struct emmc_device *emmc, const uint8_t *data, uint32_t addr, int size);	
 
 	/** Read a block of data from the EMMC device. */
 	int (*read_block_data)(struct emmc_device *emmc, uint32_t *data, uint32_t addr);
@@ -90,7 +90,7 @@ static int dwcmshc_emmc_write_block(struct emmc_device *emmc, uint32_t *buffer,
 }
 
 
-static int dwcmshc_emmc_write_image(struct emmc_device* emmc, uint8_t *buffer, uint32_t addr, int size)
+static int dwcmshc_emmc_write_image(struct emmc_device* emmc, const uint8_t *buffer, uint32_t addr, int size)
 {
 	int retval = ERROR_OK;
 
@@ -755,7 +755,7 @@ static struct code_src sync_srcs[3] =
 };
 
 
-int dwcmshc_emmc_async_write_image(struct emmc_device* emmc, uint8_t *buffer, target_addr_t addr, int image_size)
+int dwcmshc_emmc_async_write_image(struct emmc_device* emmc, const uint8_t *buffer, target_addr_t addr, int image_size)
 {
 	struct dwcmshc_emmc_controller *driver_priv = emmc->controller_priv;
 	struct flash_loader *loader = &driver_priv->flash_loader;
@@ -772,7 +772,7 @@ int dwcmshc_emmc_async_write_image(struct emmc_device* emmc, uint8_t *buffer, ta
 	return retval;
 }
 
-int dwcmshc_emmc_sync_write_image(struct emmc_device* emmc, uint8_t *buffer, target_addr_t addr, int image_size)
+int dwcmshc_emmc_sync_write_image(struct emmc_device* emmc, const uint8_t *buffer, target_addr_t addr, int image_size)
 {
 	struct dwcmshc_emmc_controller *driver_priv = emmc->controller_priv;
 	struct flash_loader *loader = &driver_priv->flash_loader;
@@ -112,9 +112,9 @@ int dwcmshc_emmc_set_bus_width(struct emmc_device *emmc);
 int dwcmshc_emmc_rd_ext_csd(struct emmc_device *emmc, uint32_t* buf);
 int dwcmshc_emmc_set_clk_ctrl(struct emmc_device *emmc, bool mode, uint32_t div);
 
-int dwcmshc_emmc_async_write_image(struct emmc_device* emmc, uint8_t *buffer, target_addr_t addr, int image_size);
+int dwcmshc_emmc_async_write_image(struct emmc_device* emmc, const uint8_t *buffer, target_addr_t addr, int image_size);
 
-int dwcmshc_emmc_sync_write_image(struct emmc_device* emmc, uint8_t *buffer, target_addr_t addr, int image_size);
+int dwcmshc_emmc_sync_write_image(struct emmc_device* emmc, const uint8_t *buffer, target_addr_t addr, int image_size);
 
 int slow_dwcmshc_emmc_write_block(struct emmc_device *emmc, uint32_t *buffer, uint32_t addr);
 int slow_dwcmshc_emmc_read_block(struct emmc_device *emmc, uint32_t *buffer, uint32_t addr);
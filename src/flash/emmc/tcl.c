@@ -91,6 +91,35 @@ COMMAND_HANDLER(handle_emmc_write_block_command)
 	return retval;
 }
 
+/* Write or verify @a size bytes of a fill section from one expanded piece
+ * of the fill pattern, instead of expanding the whole section. */
+static int emmc_fill_section(struct emmc_device *emmc, struct image *image,
+		unsigned int section, uint32_t size, bool verify)
+{
+	uint32_t piece = MIN(image->sections[section].size, IMAGE_FILL_PIECE_SIZE);
+	size_t buf_cnt;
+
+	uint8_t *buffer = malloc(piece);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = image_read_section(image, section, 0x0, piece, buffer, &buf_cnt);
+	for (uint32_t offset = 0; retval == ERROR_OK && offset < size; offset += piece) {
+		uint32_t addr = image->sections[section].base_address + offset;
+		uint32_t count = MIN(piece, size - offset);
+
+		if (verify)
+			retval = emmc_verify_image(emmc, buffer, addr, count);
+		else
+			retval = emmc_write_image(emmc, buffer, addr, count);
+	}
+
+	free(buffer);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_emmc_write_image_command)
 {
 	struct emmc_device *emmc = NULL;
@@ -117,18 +146,35 @@ COMMAND_HANDLER(handle_emmc_write_image_command)
 		} else
 			write_size = s.image.sections[i].size;
 
-		s.block = malloc(write_size);
+		if (image_section_is_fill(&s.image, i)) {
+			retval = emmc_fill_section(emmc, &s.image, i, write_size, false);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("write image fail");
+				emmc_fileio_cleanup(&s);
+				return retval;
+			}
+			continue;
+		}
+
+		/* block aligned sections go out straight from the image */
+		const uint8_t *data;
+		s.block = NULL;
+		if (write_size != s.image.sections[i].size
+				|| image_section_data(&s.image, i, 0x0, write_size, &data) != ERROR_OK) {
+			s.block = malloc(write_size);
 
-		retval = image_read_section(&s.image, i, 0x0, s.image.sections[i].size, s.block, &buf_cnt);
+			retval = image_read_section(&s.image, i, 0x0, s.image.sections[i].size, s.block, &buf_cnt);
 
-		if (retval != ERROR_OK) {
-			LOG_ERROR("read section fail");
-			free(s.block);
-			emmc_fileio_cleanup(&s);
-			return retval;
+			if (retval != ERROR_OK) {
+				LOG_ERROR("read section fail");
+				free(s.block);
+				emmc_fileio_cleanup(&s);
+				return retval;
+			}
+			data = s.block;
 		}
 
-		retval = emmc_write_image(emmc, s.block, s.image.sections[i].base_address, write_size);
+		retval = emmc_write_image(emmc, data, s.image.sections[i].base_address, write_size);
 
 		if (retval != ERROR_OK) {
 			LOG_ERROR("write image fail");
@@ -215,17 +261,32 @@ COMMAND_HANDLER(handle_emmc_verify_command)
 		return retval;
 
 	for (unsigned int i = 0; i < s.image.num_sections; i++) {
-		s.block = malloc(s.image.sections[i].size);
-		retval = image_read_section(&s.image, i, 0x0, s.image.sections[i].size, s.block, &buf_cnt);
+		if (image_section_is_fill(&s.image, i)) {
+			retval = emmc_fill_section(emmc, &s.image, i, s.image.sections[i].size, true);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("verify image fail");
+				emmc_fileio_cleanup(&s);
+				return retval;
+			}
+			continue;
+		}
 
-		if (retval != ERROR_OK) {
-			LOG_ERROR("read section fail");
-			free(s.block);
-			emmc_fileio_cleanup(&s);
-			return retval;
+		const uint8_t *data;
+		s.block = NULL;
+		if (image_section_data(&s.image, i, 0x0, s.image.sections[i].size, &data) != ERROR_OK) {
+			s.block = malloc(s.image.sections[i].size);
+			retval = image_read_section(&s.image, i, 0x0, s.image.sections[i].size, s.block, &buf_cnt);
+
+			if (retval != ERROR_OK) {
+				LOG_ERROR("read section fail");
+				free(s.block);
+				emmc_fileio_cleanup(&s);
+				return retval;
+			}
+			data = s.block;
 		}
 
-		retval = emmc_verify_image(emmc, s.block, s.image.sections[i].base_address, s.image.sections[i].size);
+		retval = emmc_verify_image(emmc, data, s.image.sections[i].base_address, s.image.sections[i].size);
 
 		if (retval != ERROR_OK) {
 			LOG_ERROR("verify image fail");
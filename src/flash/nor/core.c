@@ -43,6 +43,8 @@ int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 	int retval;
 
 	retval = bank->driver->erase(bank, first, last);
+	/* the flash controller changed memory behind the target's back */
+	target_mem_cache_invalidate(bank->target);
 	if (retval != ERROR_OK)
 		LOG_ERROR("retval %x failed erasing sectors %u to %u", retval, first, last);
 
@@ -99,6 +101,7 @@ int flash_driver_write(struct flash_bank *bank,
 	int retval;
 
 	retval = bank->driver->write(bank, buffer, offset, count);
+	target_mem_cache_invalidate(bank->target);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error writing to flash at address " TARGET_ADDR_FMT
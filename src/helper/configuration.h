@@ -28,6 +28,10 @@ int parse_cmdline_args(struct command_context *cmd_ctx,
 		int argc, char *argv[]);
 
 int parse_config_file(struct command_context *cmd_ctx);
+
+/** Argument of --supervise, or NULL when running a single instance. */
+const char *get_supervise_spec(void);
+void free_supervise_spec(void);
 void add_config_command(const char *cfg);
 
 void add_script_search_dir(const char *dir);
@@ -31,16 +31,74 @@
 #include "fileio.h"
 #include "replacements.h"
 
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/* binary files opened for reading at least this large are memory-mapped */
+#define FILEIO_MMAP_THRESHOLD	(1024 * 1024)
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	uint8_t *map;		/* read-only mapping of the whole file, or NULL */
+	size_t position;	/* read position when mapped */
+	bool eof;		/* a read hit the end when mapped, like feof() */
 };
 
+static void fileio_map_local(struct fileio *fileio)
+{
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+	void *map;
+
+	if (fileio->access != FILEIO_READ || fileio->type != FILEIO_BINARY
+			|| fileio->size < FILEIO_MMAP_THRESHOLD)
+		return;
+
+	if (fstat(fileno(fileio->file), &st) != 0 || !S_ISREG(st.st_mode)
+			|| (uint64_t)st.st_size != fileio->size)
+		return;
+
+	map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE, fileno(fileio->file), 0);
+	if (map == MAP_FAILED) {
+		LOG_DEBUG("couldn't map %s: %s, using buffered reads", fileio->url, strerror(errno));
+		return;
+	}
+
+	fileio->map = map;
+	fileio->position = 0;
+	fileio->eof = false;
+#endif
+}
+
+/* Touching a mapped page past the end of a file that was truncated while
+ * mapped raises SIGBUS, so check the file still covers the range first. */
+static bool fileio_map_covers(struct fileio *fileio, size_t end)
+{
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+
+	if (fstat(fileno(fileio->file), &st) != 0 || (uint64_t)st.st_size < end) {
+		LOG_ERROR("%s changed size while in use", fileio->url);
+		return false;
+	}
+#endif
+	return true;
+}
+
 static inline int fileio_close_local(struct fileio *fileio)
 {
+#ifdef HAVE_SYS_MMAN_H
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+#endif
+
 	int retval = fclose(fileio->file);
 	if (retval != 0) {
 		if (retval == EBADF)
@@ -113,6 +171,9 @@ static inline int fileio_open_local(struct fileio *fileio)
 	}
 
 	fileio->size = file_size;
+	fileio->map = NULL;
+
+	fileio_map_local(fileio);
 
 	return ERROR_OK;
 }
@@ -156,6 +217,9 @@ int fileio_close(struct fileio *fileio)
 
 int fileio_feof(struct fileio *fileio)
 {
+	if (fileio->map)
+		return fileio->eof;
+
 	return feof(fileio->file);
 }
 
@@ -163,6 +227,12 @@ int fileio_seek(struct fileio *fileio, size_t position)
 {
 	int retval;
 
+	if (fileio->map) {
+		fileio->position = position;
+		fileio->eof = false;
+		return ERROR_OK;
+	}
+
 	retval = fseek(fileio->file, position, SEEK_SET);
 
 	if (retval != 0) {
@@ -178,6 +248,23 @@ static int fileio_local_read(struct fileio *fileio, size_t size, void *buffer,
 {
 	ssize_t retval;
 
+	if (fileio->map) {
+		*size_read = 0;
+		if (fileio->position < fileio->size) {
+			*size_read = MIN(size, fileio->size - fileio->position);
+			if (!fileio_map_covers(fileio, fileio->position + *size_read)) {
+				*size_read = 0;
+				return ERROR_FILEIO_OPERATION_FAILED;
+			}
+			memcpy(buffer, fileio->map + fileio->position, *size_read);
+			fileio->position += *size_read;
+		}
+		/* as with fread(), only a short read sets end of file */
+		if (*size_read < size)
+			fileio->eof = true;
+		return ERROR_OK;
+	}
+
 	retval = fread(buffer, 1, size, fileio->file);
 	*size_read = (retval >= 0) ? retval : 0;
 
@@ -208,7 +295,18 @@ int fileio_read_u32(struct fileio *fileio, uint32_t *data)
 
 static int fileio_local_fgets(struct fileio *fileio, size_t size, void *buffer)
 {
-	if (!fgets(buffer, size, fileio->file))
+	/* keep the stream in step with the mapped read position */
+	if (fileio->map && fseek(fileio->file, fileio->position, SEEK_SET) != 0)
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	char *line = fgets(buffer, size, fileio->file);
+
+	if (fileio->map) {
+		fileio->position = ftell(fileio->file);
+		fileio->eof = feof(fileio->file);
+	}
+
+	if (!line)
 		return ERROR_FILEIO_OPERATION_FAILED;
 
 	return ERROR_OK;
@@ -273,3 +371,30 @@ int fileio_size(struct fileio *fileio, size_t *size)
 
 	return ERROR_OK;
 }
+
+/**
+ * Get a pointer to @a size bytes of the file at @a offset without copying.
+ * Only available when the file is memory-mapped, callers fall back to
+ * fileio_seek() and fileio_read() on ERROR_FILEIO_OPERATION_NOT_SUPPORTED.
+ * The data stays valid until the file is closed.
+ *
+ * The file must not be truncated while it is mapped: touching a mapped
+ * page past the new end raises SIGBUS. Reads and this call refuse a range
+ * the file no longer covers, but a file truncated while the returned data
+ * is in use is not caught.
+ */
+int fileio_map(struct fileio *fileio, size_t offset, size_t size, const uint8_t **data)
+{
+	if (!fileio->map)
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+	if (offset > fileio->size || size > fileio->size - offset)
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	if (!fileio_map_covers(fileio, offset + size))
+		return ERROR_FILEIO_OPERATION_FAILED;
+
+	*data = fileio->map + offset;
+
+	return ERROR_OK;
+}
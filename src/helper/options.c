@@ -46,6 +46,7 @@
 #endif
 
 static int help_flag, version_flag;
+static char *supervise_spec;
 
 static const struct option long_options[] = {
 	{"help",		no_argument,			&help_flag,		1},
@@ -55,6 +56,7 @@ static const struct option long_options[] = {
 	{"search",		required_argument,		0,				's'},
 	{"log_output",	required_argument,		0,				'l'},
 	{"command",		required_argument,		0,				'c'},
+	{"supervise",	required_argument,		0,				'p'},
 	{0, 0, 0, 0}
 };
 
@@ -281,7 +283,7 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 		/* getopt_long stores the option index here. */
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "hvd::l:f:s:c:", long_options, &option_index);
+		c = getopt_long(argc, argv, "hvd::l:f:s:c:p:", long_options, &option_index);
 
 		/* Detect the end of the options. */
 		if (c == -1)
@@ -321,6 +323,10 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 				if (optarg)
 				    add_config_command(optarg);
 				break;
+			case 'p':		/* --supervise | -p */
+				free(supervise_spec);
+				supervise_spec = strdup(optarg);
+				break;
 			default:  /* '?' */
 				/* getopt will emit an error message, all we have to do is bail. */
 				return ERROR_FAIL;
@@ -343,6 +349,7 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 		LOG_OUTPUT("             | -d<n>\tset debug level to <level>\n");
 		LOG_OUTPUT("--log_output | -l\tredirect log output to file <name>\n");
 		LOG_OUTPUT("--command    | -c\trun <command>\n");
+		LOG_OUTPUT("--supervise  | -p\trun one instance per adapter, <vid:pid> or <location>[,<location>...]\n");
 		exit(-1);
 	}
 
@@ -359,3 +366,14 @@ int parse_cmdline_args(struct command_context *cmd_ctx, int argc, char *argv[])
 
 	return ERROR_OK;
 }
+
+const char *get_supervise_spec(void)
+{
+	return supervise_spec;
+}
+
+void free_supervise_spec(void)
+{
+	free(supervise_spec);
+	supervise_spec = NULL;
+}
@@ -16,6 +16,7 @@
 #include "minidriver.h"
 #include "interface.h"
 #include "interfaces.h"
+#include "trace.h"
 #include <transport/transport.h>
 
 /**
@@ -117,6 +118,8 @@ int adapter_quit(void)
 			LOG_ERROR("failed: %d", result);
 	}
 
+	jtag_trace_stop();
+
 	free(adapter_config.serial);
 	free(adapter_config.usb_location);
 
@@ -158,6 +158,18 @@ void jtag_command_queue_reset(void)
 	next_command_pointer = &jtag_command_queue;
 }
 
+/**
+ * Return the most recently queued command, or NULL if the queue is empty.
+ * Used to fold a new request into the previous command where possible.
+ */
+struct jtag_command *jtag_command_queue_last(void)
+{
+	if (next_command_pointer == &jtag_command_queue)
+		return NULL;
+
+	return container_of(next_command_pointer, struct jtag_command, next);
+}
+
 /**
  * Copy a struct scan_field for insertion into the queue.
  *
@@ -238,7 +250,7 @@ int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer)
 	return bit_count;
 }
 
-int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
+int jtag_read_buffer(const uint8_t *buffer, const struct scan_command *cmd)
 {
 	int i;
 	int bit_count = 0;
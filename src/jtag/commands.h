@@ -116,6 +116,22 @@ struct tms_command {
 	const uint8_t *bits;
 };
 
+/**
+ * A vector of back to back plain scans, see jtag_add_bulk_scan().
+ */
+struct bulk_scan_command {
+	/** number of entries in *scans */
+	unsigned num_scans;
+	/** length, register, capture flag and end state of each scan */
+	struct jtag_bulk_scan *scans;
+	/** total number of bits of all the scans */
+	unsigned num_bits;
+	/** packed TDI bits */
+	uint8_t *out;
+	/** packed TDO bits of the captured scans, or NULL */
+	uint8_t *in;
+};
+
 /**
  * Defines a container type that hold a pointer to a JTAG command
  * structure of any defined type.
@@ -130,6 +146,7 @@ union jtag_command_container {
 	struct end_state_command *end_state;
 	struct sleep_command *sleep;
 	struct tms_command *tms;
+	struct bulk_scan_command *bulk;
 };
 
 /**
@@ -153,6 +170,7 @@ enum jtag_command_type {
 	JTAG_STABLECLOCKS = 8,
 	JTAG_TMS          = 9,
 	JTAG_TDI          = 10,
+	JTAG_BULK_SCAN    = 11,
 };
 
 struct jtag_command {
@@ -168,11 +186,12 @@ void *cmd_queue_alloc(size_t size);
 
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
+struct jtag_command *jtag_command_queue_last(void);
 
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
 int jtag_scan_size(const struct scan_command *cmd);
-int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd);
+int jtag_read_buffer(const uint8_t *buffer, const struct scan_command *cmd);
 int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer);
 
 #endif /* OPENOCD_JTAG_COMMANDS_H */
@@ -34,6 +34,7 @@
 #include "jtag.h"
 #include "swd.h"
 #include "interface.h"
+#include "trace.h"
 #include <transport/transport.h>
 #include <helper/jep106.h>
 #include "helper/system.h"
@@ -353,9 +354,77 @@ static void jtag_prelude(tap_state_t state)
 	cmd_queue_cur_state = state;
 }
 
+/** Number of queued commands dropped or merged by the chain optimizer. */
+static unsigned int jtag_optimize_cmds_saved;
+
+/** The queue optimizer may only touch chain-wide commands if every
+ * enabled TAP has opted in. */
+static bool jtag_chain_optimize(void)
+{
+	struct jtag_tap *tap = jtag_tap_next_enabled(NULL);
+
+	if (!tap)
+		return false;
+
+	for (; tap; tap = jtag_tap_next_enabled(tap)) {
+		if (!tap->optimize)
+			return false;
+	}
+	return true;
+}
+
+/** Forget what is known about the instruction registers, e.g. after raw
+ * TMS/IR traffic the IR tracking in interface_jtag_add_ir_scan() can't see. */
+static void jtag_invalidate_cur_instr(void)
+{
+	for (struct jtag_tap *tap = jtag_all_taps(); tap; tap = tap->next_tap)
+		tap->cur_instr_valid = false;
+}
+
+/**
+ * An IR scan is redundant if it would load every enabled TAP with the
+ * instruction it already holds and it starts and ends in Run-Test/Idle,
+ * so skipping it doesn't skip any Capture/Update of the data registers.
+ * Scans that capture the IR are never dropped.
+ */
+static bool jtag_ir_scan_is_redundant(struct jtag_tap *active,
+	const struct scan_field *in_fields, tap_state_t state)
+{
+	if (!active->optimize || in_fields->in_value || !in_fields->out_value)
+		return false;
+	if (state != TAP_IDLE || cmd_queue_cur_state != TAP_IDLE)
+		return false;
+	if (in_fields->num_bits != active->ir_length)
+		return false;
+
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		if (!tap->cur_instr_valid)
+			return false;
+
+		if (tap != active) {
+			/* interface_jtag_add_ir_scan() loads BYPASS into the others */
+			if (!tap->bypass)
+				return false;
+			continue;
+		}
+
+		/* the bypass flag also shapes later DR scans, so it must match */
+		if (tap->bypass || buf_cmp(tap->cur_instr, in_fields->out_value, tap->ir_length))
+			return false;
+	}
+	return true;
+}
+
 void jtag_add_ir_scan_noverify(struct jtag_tap *active, const struct scan_field *in_fields,
 	tap_state_t state)
 {
+	if (jtag_ir_scan_is_redundant(active, in_fields, state)) {
+		active->ir_scans_saved++;
+		for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap))
+			active->ir_bits_saved += tap->ir_length;
+		return;
+	}
+
 	jtag_prelude(state);
 
 	int retval = interface_jtag_add_ir_scan(active, in_fields, state);
@@ -396,6 +465,7 @@ void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 	assert(state != TAP_RESET);
 
 	jtag_prelude(state);
+	jtag_invalidate_cur_instr();
 
 	int retval = interface_jtag_add_plain_ir_scan(
 			num_bits, out_bits, in_bits, state);
@@ -477,8 +547,15 @@ void jtag_add_plain_dr_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 
 void jtag_add_tlr(void)
 {
+	struct jtag_command *last = jtag_command_queue_last();
+
 	jtag_prelude(TAP_RESET);
-	jtag_set_error(interface_jtag_add_tlr());
+
+	/* a second TLR in a row can't move the TAPs anywhere */
+	if (jtag_chain_optimize() && last && last->type == JTAG_TLR_RESET)
+		jtag_optimize_cmds_saved++;
+	else
+		jtag_set_error(interface_jtag_add_tlr());
 
 	/* NOTE: order here matches TRST path in jtag_add_reset() */
 	jtag_call_event_callbacks(JTAG_TRST_ASSERTED);
@@ -508,6 +585,7 @@ int jtag_add_tms_seq(unsigned nbits, const uint8_t *seq, enum tap_state state)
 
 	jtag_checks();
 	cmd_queue_cur_state = state;
+	jtag_invalidate_cur_instr();
 
 	retval = interface_add_tms_seq(nbits, seq, state);
 	jtag_set_error(retval);
@@ -523,12 +601,110 @@ int jtag_add_tdi_seq(unsigned nbits, const uint8_t *out_bits, uint8_t *in_bits,
 
 	jtag_checks();
 	cmd_queue_cur_state = state;
+	jtag_invalidate_cur_instr();
 
 	retval = interface_add_tdi_seq(nbits, out_bits, in_bits, state);
 	jtag_set_error(retval);
 	return retval;
 }
 
+/* Copy the TDO of one split bulk scan to its place in the capture vector. */
+static int jtag_bulk_scan_capture_callback(jtag_callback_data_t data0,
+	jtag_callback_data_t data1,
+	jtag_callback_data_t data2,
+	jtag_callback_data_t data3)
+{
+	buf_set_buf((uint8_t *)data0, 0, (uint8_t *)data1, (unsigned)data2, (unsigned)data3);
+	return ERROR_OK;
+}
+
+/* Queue a bulk vector as plain scans for adapters that can't take it whole. */
+static int jtag_split_bulk_scan(unsigned num_scans, const struct jtag_bulk_scan *scans,
+	const uint8_t *out_bits, uint8_t *in_bits)
+{
+	unsigned offset = 0;
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < num_scans && retval == ERROR_OK; offset += scans[i++].num_bits) {
+		const struct jtag_bulk_scan *scan = &scans[i];
+		bool aligned = !(offset % 8) && !(scan->num_bits % 8);
+		const uint8_t *out = out_bits + offset / 8;
+		uint8_t *in = NULL;
+
+		if (!aligned) {
+			uint8_t *tmp = cmd_queue_alloc(DIV_ROUND_UP(scan->num_bits, 8));
+
+			if (!tmp)
+				return ERROR_FAIL;
+			buf_set_buf(out_bits, offset, tmp, 0, scan->num_bits);
+			out = tmp;
+		}
+
+		if (scan->capture) {
+			if (aligned) {
+				in = in_bits + offset / 8;
+			} else {
+				in = cmd_queue_alloc(DIV_ROUND_UP(scan->num_bits, 8));
+				if (!in)
+					return ERROR_FAIL;
+			}
+		}
+
+		if (scan->ir_scan)
+			retval = interface_jtag_add_plain_ir_scan(scan->num_bits, out, in, scan->end_state);
+		else
+			retval = interface_jtag_add_plain_dr_scan(scan->num_bits, out, in, scan->end_state);
+
+		if (retval == ERROR_OK && in && !aligned)
+			jtag_add_callback4(jtag_bulk_scan_capture_callback, (jtag_callback_data_t)in,
+				(jtag_callback_data_t)in_bits, (jtag_callback_data_t)offset,
+				(jtag_callback_data_t)scan->num_bits);
+	}
+
+	return retval;
+}
+
+int jtag_add_bulk_scan(unsigned num_scans, const struct jtag_bulk_scan *scans,
+	const uint8_t *out_bits, uint8_t *in_bits)
+{
+	unsigned num_bits = 0;
+	bool ir_scan = false;
+	int retval;
+
+	if (!num_scans)
+		return ERROR_OK;
+
+	for (unsigned i = 0; i < num_scans; i++) {
+		const struct jtag_bulk_scan *scan = &scans[i];
+
+		if (!scan->num_bits || !tap_is_state_stable(scan->end_state)
+				|| scan->end_state == TAP_RESET) {
+			LOG_ERROR("BUG: bulk scan %u has %u bits, end state %s", i,
+				scan->num_bits, tap_state_name(scan->end_state));
+			jtag_set_error(ERROR_JTAG_NOT_STABLE_STATE);
+			return ERROR_JTAG_NOT_STABLE_STATE;
+		}
+		if (scan->capture && !in_bits) {
+			LOG_ERROR("BUG: bulk scan %u captures TDO without a capture vector", i);
+			jtag_set_error(ERROR_FAIL);
+			return ERROR_FAIL;
+		}
+		num_bits += scan->num_bits;
+		ir_scan |= scan->ir_scan;
+	}
+
+	jtag_prelude(scans[num_scans - 1].end_state);
+	if (ir_scan)
+		jtag_invalidate_cur_instr();
+
+	if (adapter_driver->jtag_ops->supported & DEBUG_CAP_BULK_SCAN)
+		retval = interface_add_bulk_scan(num_scans, scans, num_bits, out_bits, in_bits);
+	else
+		retval = jtag_split_bulk_scan(num_scans, scans, out_bits, in_bits);
+	jtag_set_error(retval);
+	return retval;
+}
+
 void jtag_add_pathmove(int num_states, const tap_state_t *path)
 {
 	tap_state_t cur_state = cmd_queue_cur_state;
@@ -559,6 +735,14 @@ void jtag_add_pathmove(int num_states, const tap_state_t *path)
 
 	jtag_checks();
 
+	/* a path through Update-IR may have loaded anything */
+	for (int i = 0; i < num_states; i++) {
+		if (path[i] == TAP_IRUPDATE) {
+			jtag_invalidate_cur_instr();
+			break;
+		}
+	}
+
 	jtag_set_error(interface_jtag_add_pathmove(num_states, path));
 	cmd_queue_cur_state = path[num_states - 1];
 }
@@ -606,6 +790,31 @@ int jtag_add_statemove(tap_state_t goal_state)
 
 void jtag_add_runtest(int num_cycles, tap_state_t state)
 {
+	/* passing through Test-Logic-Reset resets every IR */
+	if (state == TAP_RESET)
+		jtag_invalidate_cur_instr();
+
+	if (jtag_chain_optimize() && cmd_queue_cur_state == TAP_IDLE) {
+		struct jtag_command *last = jtag_command_queue_last();
+
+		/* nothing to clock and nowhere to go */
+		if (num_cycles == 0 && state == TAP_IDLE) {
+			jtag_optimize_cmds_saved++;
+			return;
+		}
+
+		/* extend the previous idle run instead of queueing another */
+		if (last && last->type == JTAG_RUNTEST
+				&& last->cmd.runtest->end_state == TAP_IDLE
+				&& num_cycles <= INT_MAX - last->cmd.runtest->num_cycles) {
+			jtag_prelude(state);
+			last->cmd.runtest->num_cycles += num_cycles;
+			last->cmd.runtest->end_state = state;
+			jtag_optimize_cmds_saved++;
+			return;
+		}
+	}
+
 	jtag_prelude(state);
 	jtag_set_error(interface_jtag_add_runtest(num_cycles, state));
 }
@@ -968,6 +1177,8 @@ int default_interface_jtag_execute_queue(void)
 
 	int result = adapter_driver->jtag_ops->execute_queue();
 
+	jtag_trace_record_queue(jtag_command_queue, result);
+
 	struct jtag_command *cmd = jtag_command_queue;
 	while (debug_level >= LOG_LVL_DEBUG_IO && cmd) {
 		switch (cmd->type) {
@@ -1023,6 +1234,10 @@ int default_interface_jtag_execute_queue(void)
 			case JTAG_TDI:
 				LOG_DEBUG_IO("JTAG TDI (TODO)");
 				break;
+			case JTAG_BULK_SCAN:
+				LOG_DEBUG_IO("JTAG BULK SCAN %u scans, %u bits",
+						cmd->cmd.bulk->num_scans, cmd->cmd.bulk->num_bits);
+				break;
 			default:
 				LOG_ERROR("Unknown JTAG command: %d", cmd->type);
 				break;
@@ -1036,7 +1251,12 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
-	jtag_set_error(interface_jtag_execute_queue());
+
+	int retval = interface_jtag_execute_queue();
+	/* the scans may not all have reached the TAPs */
+	if (retval != ERROR_OK)
+		jtag_invalidate_cur_instr();
+	jtag_set_error(retval);
 
 	if (jtag_flush_queue_sleep > 0) {
 		/* For debug purposes it can be useful to test performance
@@ -1052,6 +1272,11 @@ int jtag_get_flush_queue_count(void)
 	return jtag_flush_queue_count;
 }
 
+unsigned int jtag_get_optimize_cmds_saved(void)
+{
+	return jtag_optimize_cmds_saved;
+}
+
 int jtag_execute_queue(void)
 {
 	jtag_execute_queue_noclear();
@@ -1068,6 +1293,7 @@ static int jtag_reset_callback(enum jtag_event event, void *priv)
 		/* current instruction is either BYPASS or IDCODE */
 		buf_set_ones(tap->cur_instr, tap->ir_length);
 		tap->bypass = 1;
+		tap->cur_instr_valid = false;
 	}
 
 	return ERROR_OK;
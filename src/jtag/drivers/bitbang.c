@@ -200,8 +200,10 @@ static int bitbang_stableclocks(int num_cycles)
 	return ERROR_OK;
 }
 
-static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
-		unsigned scan_size)
+/* Shift 'scan_size' bits starting at bit 'offset' of 'out' (NULL for
+ * zeros) and store TDO at the same position of 'in' (NULL to discard). */
+static int bitbang_scan_bits(bool ir_scan, const uint8_t *out, uint8_t *in,
+		unsigned offset, unsigned scan_size)
 {
 	tap_state_t saved_end_state = tap_get_end_state();
 	unsigned bit_cnt;
@@ -220,8 +222,8 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 	}
 
 	size_t buffered = 0;
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
-		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
+	for (bit_cnt = offset; bit_cnt < offset + scan_size; bit_cnt++) {
+		int tms = (bit_cnt == offset + scan_size - 1) ? 1 : 0;
 		int tdi;
 		int bytec = bit_cnt/8;
 		int bcval = 1 << (bit_cnt % 8);
@@ -231,13 +233,13 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		 * as it removes the dependency on an uninitialised value
 		 */
 		tdi = 0;
-		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
+		if (out && (out[bytec] & bcval))
 			tdi = 1;
 
 		if (bitbang_interface->write(0, tms, tdi) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (type != SCAN_OUT) {
+		if (in) {
 			if (bitbang_interface->buf_size) {
 				if (bitbang_interface->sample() != ERROR_OK)
 					return ERROR_FAIL;
@@ -245,10 +247,10 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 			} else {
 				switch (bitbang_interface->read()) {
 					case BB_LOW:
-						buffer[bytec] &= ~bcval;
+						in[bytec] &= ~bcval;
 						break;
 					case BB_HIGH:
-						buffer[bytec] |= bcval;
+						in[bytec] |= bcval;
 						break;
 					default:
 						return ERROR_FAIL;
@@ -259,16 +261,16 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		if (bitbang_interface->write(1, tms, tdi) != ERROR_OK)
 			return ERROR_FAIL;
 
-		if (type != SCAN_OUT && bitbang_interface->buf_size &&
+		if (in && bitbang_interface->buf_size &&
 				(buffered == bitbang_interface->buf_size ||
-				 bit_cnt == scan_size - 1)) {
+				 bit_cnt == offset + scan_size - 1)) {
 			for (unsigned i = bit_cnt + 1 - buffered; i <= bit_cnt; i++) {
 				switch (bitbang_interface->read_sample()) {
 					case BB_LOW:
-						buffer[i/8] &= ~(1 << (i % 8));
+						in[i/8] &= ~(1 << (i % 8));
 						break;
 					case BB_HIGH:
-						buffer[i/8] |= 1 << (i % 8);
+						in[i/8] |= 1 << (i % 8);
 						break;
 					default:
 						return ERROR_FAIL;
@@ -289,6 +291,31 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 	return ERROR_OK;
 }
 
+static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+		unsigned scan_size)
+{
+	return bitbang_scan_bits(ir_scan, type != SCAN_IN ? buffer : NULL,
+			type != SCAN_OUT ? buffer : NULL, 0, scan_size);
+}
+
+static int bitbang_bulk_scan(struct bulk_scan_command *bulk)
+{
+	unsigned offset = 0;
+
+	LOG_DEBUG_IO("bulk scan: %u scans, %u bits", bulk->num_scans, bulk->num_bits);
+
+	for (unsigned i = 0; i < bulk->num_scans; offset += bulk->scans[i++].num_bits) {
+		const struct jtag_bulk_scan *scan = &bulk->scans[i];
+
+		bitbang_end_state(scan->end_state);
+		if (bitbang_scan_bits(scan->ir_scan, bulk->out, scan->capture ? bulk->in : NULL,
+					offset, scan->num_bits) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 int bitbang_execute_queue(void)
 {
 	struct jtag_command *cmd = jtag_command_queue;	/* currently processed command */
@@ -367,6 +394,10 @@ int bitbang_execute_queue(void)
 			case JTAG_TMS:
 				retval = bitbang_execute_tms(cmd);
 				break;
+			case JTAG_BULK_SCAN:
+				if (bitbang_bulk_scan(cmd->cmd.bulk) != ERROR_OK)
+					return ERROR_FAIL;
+				break;
 			default:
 				LOG_ERROR("BUG: unknown JTAG command type encountered");
 				exit(-1);
@@ -102,6 +102,7 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 
 		/* update device information */
 		buf_cpy(field->out_value, tap->cur_instr, tap->ir_length);
+		tap->cur_instr_valid = true;
 
 		field++;
 	}
@@ -279,6 +280,35 @@ int interface_add_tdi_seq(unsigned num_bits,
 	return ERROR_OK;
 }
 
+int interface_add_bulk_scan(unsigned num_scans, const struct jtag_bulk_scan *scans,
+		unsigned num_bits, const uint8_t *out_bits, uint8_t *in_bits)
+{
+	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
+	struct bulk_scan_command *bulk = cmd_queue_alloc(sizeof(struct bulk_scan_command));
+
+	if (!cmd || !bulk)
+		return ERROR_FAIL;
+
+	cmd->type = JTAG_BULK_SCAN;
+	cmd->cmd.bulk = bulk;
+
+	/* one copy of the whole vector; our caller doesn't guarantee it'll persist */
+	bulk->num_scans = num_scans;
+	bulk->scans = cmd_queue_alloc(num_scans * sizeof(*scans));
+	bulk->num_bits = num_bits;
+	bulk->out = cmd_queue_alloc(DIV_ROUND_UP(num_bits, 8));
+	bulk->in = in_bits;
+	if (!bulk->scans || !bulk->out)
+		return ERROR_FAIL;
+
+	memcpy(bulk->scans, scans, num_scans * sizeof(*scans));
+	memcpy(bulk->out, out_bits, DIV_ROUND_UP(num_bits, 8));
+
+	jtag_queue_command(cmd);
+
+	return ERROR_OK;
+}
+
 int interface_jtag_add_pathmove(int num_states, const tap_state_t *path)
 {
 	/* allocate memory for a new list member */
@@ -146,6 +146,7 @@ static uint16_t ftdi_vid[MAX_USB_IDS + 1] = { 0 };
 static uint16_t ftdi_pid[MAX_USB_IDS + 1] = { 0 };
 
 static struct mpsse_ctx *mpsse_ctx;
+static bool ftdi_pipeline;
 
 struct signal {
 	const char *name;
@@ -653,6 +654,71 @@ static void ftdi_execute_scan(struct jtag_command *cmd)
 		tap_state_name(tap_get_end_state()));
 }
 
+static void ftdi_execute_bulk_scan(struct jtag_command *cmd)
+{
+	struct bulk_scan_command *bulk = cmd->cmd.bulk;
+	unsigned offset = 0;
+
+	LOG_DEBUG_IO("bulk scan: %u scans, %u bits", bulk->num_scans, bulk->num_bits);
+
+	/* the MPSSE takes bit offsets, so every scan goes straight from and
+	 * to the packed vectors */
+	for (unsigned i = 0; i < bulk->num_scans; offset += bulk->scans[i++].num_bits) {
+		const struct jtag_bulk_scan *scan = &bulk->scans[i];
+		tap_state_t shift_state = scan->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT;
+		uint8_t *in = scan->capture ? bulk->in : NULL;
+		unsigned last = offset + scan->num_bits - 1;
+
+		if (tap_get_state() != shift_state)
+			move_to_state(shift_state);
+
+		ftdi_end_state(scan->end_state);
+
+		DO_CLOCK_DATA(mpsse_ctx,
+			bulk->out,
+			offset,
+			in,
+			offset,
+			scan->num_bits - 1,
+			ftdi_jtag_mode);
+
+		/* clock the last bit while leaving the shift state */
+		uint8_t last_bit = 0;
+		bit_copy(&last_bit, 0, bulk->out, last, 1);
+		uint8_t tms_bits = 0x03;
+		DO_CLOCK_TMS_CS(mpsse_ctx,
+				&tms_bits,
+				0,
+				in,
+				last,
+				1,
+				last_bit,
+				ftdi_jtag_mode);
+		tap_set_state(tap_state_transition(tap_get_state(), 1));
+		if (tap_get_end_state() == TAP_IDLE) {
+			DO_CLOCK_TMS_CS_OUT(mpsse_ctx,
+					&tms_bits,
+					1,
+					2,
+					last_bit,
+					ftdi_jtag_mode);
+			tap_set_state(tap_state_transition(tap_get_state(), 1));
+			tap_set_state(tap_state_transition(tap_get_state(), 0));
+		} else {
+			DO_CLOCK_TMS_CS_OUT(mpsse_ctx,
+					&tms_bits,
+					2,
+					1,
+					last_bit,
+					ftdi_jtag_mode);
+			tap_set_state(tap_state_transition(tap_get_state(), 0));
+		}
+
+		if (tap_get_state() != tap_get_end_state())
+			move_to_state(tap_get_end_state());
+	}
+}
+
 static int ftdi_reset(int trst, int srst)
 {
 	struct signal *sig_ntrst = find_signal_by_name("nTRST");
@@ -766,6 +832,9 @@ static void ftdi_execute_command(struct jtag_command *cmd)
 		case JTAG_TDI:
 			ftdi_execute_tdi(cmd);
 			break;
+		case JTAG_BULK_SCAN:
+			ftdi_execute_bulk_scan(cmd);
+			break;
 		default:
 			LOG_ERROR("BUG: unknown JTAG command type encountered: %d", cmd->type);
 			break;
@@ -816,6 +885,8 @@ static int ftdi_initialize(void)
 	if (!mpsse_ctx)
 		return ERROR_JTAG_INIT_FAILED;
 
+	mpsse_set_pipelined(mpsse_ctx, ftdi_pipeline);
+
 	output = jtag_output_init;
 	direction = jtag_direction_init;
 
@@ -1480,6 +1551,23 @@ COMMAND_HANDLER(ftdi_handle_tdo_sample_edge_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(ftdi_handle_pipeline_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], ftdi_pipeline);
+		if (mpsse_ctx) {
+			mpsse_flush(mpsse_ctx);
+			mpsse_set_pipelined(mpsse_ctx, ftdi_pipeline);
+		}
+	}
+
+	command_print(CMD, "pipelined flush: %s.", ftdi_pipeline ? "on" : "off");
+	return ERROR_OK;
+}
+
 #if BUILD_FTDI_CJTAG == 1
 COMMAND_HANDLER(ftdi_handle_oscan1_mode_command)
 {
@@ -1574,6 +1662,14 @@ static const struct command_registration ftdi_subcommand_handlers[] = {
 			"allow signalling speed increase)",
 		.usage = "(rising|falling)",
 	},
+	{
+		.name = "pipeline",
+		.handler = &ftdi_handle_pipeline_command,
+		.mode = COMMAND_ANY,
+		.help = "set to 'on' to overlap building the next command buffer "
+			"with the USB transfer of the previous one (default is 'off')",
+		.usage = "(on|off)",
+	},
 #if BUILD_FTDI_CJTAG == 1
 	{
 		.name = "oscan1_mode",
@@ -1861,7 +1957,7 @@ static const struct swd_driver ftdi_swd = {
 static const char * const ftdi_transports[] = { "jtag", "swd", NULL };
 
 static struct jtag_interface ftdi_interface = {
-	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_TDI_SEQ,
+	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_TDI_SEQ | DEBUG_CAP_BULK_SCAN,
 	.execute_queue = ftdi_execute_queue,
 };
 
@@ -462,6 +462,57 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 	return ERROR_OK;
 }
 
+/**
+ * jtag_vpi_bulk_scan - launches the scans of a bulk vector
+ * @param cmd the command to launch
+ *
+ * Every scan goes through one reusable buffer instead of a buffer built
+ * per scan command.
+ *
+ * Returns ERROR_OK if OK, ERROR_xxx if a read/write error occurred.
+ */
+static int jtag_vpi_bulk_scan(struct bulk_scan_command *cmd)
+{
+	unsigned max_bits = 0;
+	unsigned offset = 0;
+	int retval = ERROR_OK;
+
+	for (unsigned i = 0; i < cmd->num_scans; i++)
+		max_bits = MAX(max_bits, cmd->scans[i].num_bits);
+
+	uint8_t *buf = malloc(DIV_ROUND_UP(max_bits, 8));
+	if (!buf)
+		return ERROR_FAIL;
+
+	for (unsigned i = 0; retval == ERROR_OK && i < cmd->num_scans;
+	     offset += cmd->scans[i++].num_bits) {
+		const struct jtag_bulk_scan *scan = &cmd->scans[i];
+
+		retval = jtag_vpi_state_move(scan->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_buf(cmd->out, offset, buf, 0, scan->num_bits);
+		retval = jtag_vpi_queue_tdi(buf, scan->num_bits, TAP_SHIFT);
+		if (retval != ERROR_OK)
+			break;
+
+		/* move forward from IREXIT1 or DREXIT1 to a stable pause state */
+		retval = jtag_vpi_clock_tms(0);
+		if (retval != ERROR_OK)
+			break;
+		tap_set_state(scan->ir_scan ? TAP_IRPAUSE : TAP_DRPAUSE);
+
+		if (scan->capture)
+			buf_set_buf(buf, 0, cmd->in, offset, scan->num_bits);
+
+		retval = jtag_vpi_state_move(scan->end_state);
+	}
+
+	free(buf);
+	return retval;
+}
+
 static int jtag_vpi_runtest(int cycles, tap_state_t state)
 {
 	int retval;
@@ -535,6 +586,9 @@ static int jtag_vpi_execute_queue(void)
 		case JTAG_SCAN:
 			retval = jtag_vpi_scan(cmd->cmd.scan);
 			break;
+		case JTAG_BULK_SCAN:
+			retval = jtag_vpi_bulk_scan(cmd->cmd.bulk);
+			break;
 		default:
 			LOG_ERROR("BUG: unknown JTAG command type 0x%X",
 				  cmd->type);
@@ -690,7 +744,7 @@ static const struct command_registration jtag_vpi_command_handlers[] = {
 };
 
 static struct jtag_interface jtag_vpi_interface = {
-	.supported = DEBUG_CAP_TMS_SEQ,
+	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_BULK_SCAN,
 	.execute_queue = jtag_vpi_execute_queue,
 };
 
@@ -217,6 +217,63 @@ int jtag_libusb_open(const uint16_t vids[], const uint16_t pids[],
 	return retval;
 }
 
+int jtag_libusb_get_locations(uint16_t vid, uint16_t pid,
+		char ***locations, unsigned int *count)
+{
+#ifdef HAVE_LIBUSB_GET_PORT_NUMBERS
+	struct libusb_context *ctx;
+	struct libusb_device **list;
+	uint8_t port_path[MAX_USB_PORTS];
+	char **out = NULL;
+	unsigned int n = 0;
+
+	*locations = NULL;
+	*count = 0;
+
+	if (libusb_init(&ctx) < 0)
+		return ERROR_FAIL;
+
+	ssize_t cnt = libusb_get_device_list(ctx, &list);
+	for (ssize_t idx = 0; idx < cnt; idx++) {
+		struct libusb_device_descriptor dev_desc;
+
+		if (libusb_get_device_descriptor(list[idx], &dev_desc) != 0)
+			continue;
+
+		if (dev_desc.idVendor != vid || dev_desc.idProduct != pid)
+			continue;
+
+		int path_len = libusb_get_port_numbers(list[idx], port_path, MAX_USB_PORTS);
+		if (path_len <= 0)
+			continue;
+
+		char loc[4 + 4 * MAX_USB_PORTS];
+		int len = snprintf(loc, sizeof(loc), "%u-%u",
+				libusb_get_bus_number(list[idx]), port_path[0]);
+		for (int i = 1; i < path_len && len < (int)sizeof(loc); i++)
+			len += snprintf(loc + len, sizeof(loc) - len, ".%u", port_path[i]);
+
+		char **tmp = realloc(out, (n + 1) * sizeof(*out));
+		if (!tmp)
+			break;
+		out = tmp;
+		out[n] = strdup(loc);
+		if (out[n])
+			n++;
+	}
+	if (cnt >= 0)
+		libusb_free_device_list(list, 1);
+	libusb_exit(ctx);
+
+	*locations = out;
+	*count = n;
+	return ERROR_OK;
+#else
+	LOG_ERROR("libusb does not report USB port numbers, cannot enumerate adapters");
+	return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
 void jtag_libusb_close(struct libusb_device_handle *dev)
 {
 	/* Close device */
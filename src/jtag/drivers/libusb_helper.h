@@ -44,6 +44,13 @@ typedef char * (*adapter_get_alternate_serial_fn)(struct libusb_device_handle *d
 int jtag_libusb_open(const uint16_t vids[], const uint16_t pids[],
 		struct libusb_device_handle **out,
 		adapter_get_alternate_serial_fn adapter_get_alternate_serial);
+/**
+ * List the USB bus locations ("bus-port[.port]...") of all devices with
+ * the given vendor and product ID, in the format used by
+ * "adapter usb location".  The caller frees each string and the array.
+ */
+int jtag_libusb_get_locations(uint16_t vid, uint16_t pid,
+		char ***locations, unsigned int *count);
 void jtag_libusb_close(struct libusb_device_handle *dev);
 int jtag_libusb_control_transfer(struct libusb_device_handle *dev,
 		uint8_t request_type, uint8_t request, uint16_t value,
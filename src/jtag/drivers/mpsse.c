@@ -85,6 +85,31 @@ char *ftd2xx_channel_names[] = {
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+/* Context needed by the callbacks */
+struct transfer_result {
+	struct mpsse_ctx *ctx;
+	bool done;
+	unsigned transferred;
+	uint8_t *buffer; // write data or read destination
+	unsigned count; // bytes to write or read
+};
+
+/* One command buffer with its pending TDO data, as handed to libusb */
+struct mpsse_batch {
+	uint8_t *write_buffer;
+	unsigned write_count;
+	uint8_t *read_buffer;
+	unsigned read_count;
+	uint8_t *read_chunk;
+	struct bit_copy_queue read_queue;
+	struct libusb_transfer *write_transfer;
+	struct libusb_transfer *read_transfer;
+	struct transfer_result write_result;
+	struct transfer_result read_result;
+	int status; // libusb error from submission
+	bool busy;
+};
+
 struct mpsse_ctx {
 	enum mpsse_backend_type backend;
 
@@ -114,8 +139,13 @@ struct mpsse_ctx {
 	unsigned read_chunk_size;
 	struct bit_copy_queue read_queue;
 	int retval;
+	bool pipelined; // overlap building the next batch with the transfer of the previous one
+	struct mpsse_batch batch; // in flight while the next batch is built
 };
 
+static void mpsse_batch_cancel(struct mpsse_ctx *ctx, struct mpsse_batch *batch);
+static int mpsse_flush_pipelined(struct mpsse_ctx *ctx);
+
 /* Returns true if the string descriptor indexed by str_index in device matches string */
 static bool string_descriptor_equal(struct libusb_device_handle *device, uint8_t str_index,
 	const char *string)
@@ -509,6 +539,7 @@ struct mpsse_ctx *mpsse_open(const uint16_t *vid, const uint16_t *pid, const cha
 		return 0;
 
 	bit_copy_queue_init(&ctx->read_queue);
+	bit_copy_queue_init(&ctx->batch.read_queue);
 	ctx->read_chunk_size = 16384;
 	ctx->read_size = 16384;
 	ctx->write_size = 16384;
@@ -521,7 +552,13 @@ struct mpsse_ctx *mpsse_open(const uint16_t *vid, const uint16_t *pid, const cha
 	 * Syscall param ioctl(USBDEVFS_SUBMITURB).buffer points to uninitialised byte(s) */
 	ctx->write_buffer = calloc(1, ctx->write_size);
 
-	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer)
+	/* spare set of buffers, swapped in while a batch is in flight */
+	ctx->batch.read_chunk = malloc(ctx->read_chunk_size);
+	ctx->batch.read_buffer = malloc(ctx->read_size);
+	ctx->batch.write_buffer = calloc(1, ctx->write_size);
+
+	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer
+			|| !ctx->batch.read_chunk || !ctx->batch.read_buffer || !ctx->batch.write_buffer)
 		goto error;
 
 	ctx->interface = channel;
@@ -611,6 +648,7 @@ void mpsse_close(struct mpsse_ctx *ctx)
 {
 	BACKEND_DIVERGENCE_START
 	BACKEND_DIVERGENCE_LIBUSB
+	mpsse_batch_cancel(ctx, &ctx->batch);
 	if (ctx->usb_dev)
 		libusb_close(ctx->usb_dev);
 	if (ctx->usb_ctx)
@@ -627,6 +665,9 @@ void mpsse_close(struct mpsse_ctx *ctx)
 	free(ctx->write_buffer);
 	free(ctx->read_buffer);
 	free(ctx->read_chunk);
+	free(ctx->batch.write_buffer);
+	free(ctx->batch.read_buffer);
+	free(ctx->batch.read_chunk);
 	free(ctx);
 }
 
@@ -635,6 +676,15 @@ bool mpsse_is_high_speed(struct mpsse_ctx *ctx)
 	return ctx->type != TYPE_FT2232C;
 }
 
+void mpsse_set_pipelined(struct mpsse_ctx *ctx, bool enable)
+{
+	if (enable && ctx->backend != MPSSE_BACKEND_TYPE_LIBUSB) {
+		LOG_WARNING("pipelined flush is only supported with the libusb backend");
+		enable = false;
+	}
+	ctx->pipelined = enable;
+}
+
 void mpsse_purge(struct mpsse_ctx *ctx)
 {
 	int err;
@@ -647,6 +697,8 @@ void mpsse_purge(struct mpsse_ctx *ctx)
 	// purge RX & TX buffer
 	BACKEND_DIVERGENCE_START
 	BACKEND_DIVERGENCE_LIBUSB
+	mpsse_batch_cancel(ctx, &ctx->batch);
+
 	err = libusb_control_transfer(ctx->usb_dev, FTDI_DEVICE_OUT_REQTYPE, SIO_RESET_REQUEST,
 			SIO_RESET_PURGE_RX, ctx->index, NULL, 0, ctx->usb_write_timeout);
 	if (err < 0) {
@@ -746,7 +798,7 @@ void mpsse_clock_data(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_of
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) + (length < 8) < (out || (!out && !in) ? 4 : 3)
 				|| (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_flush_pipelined(ctx);
 
 		if (length < 8) {
 			/* Transfer remaining bits in bit mode */
@@ -820,7 +872,7 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	while (length > 0) {
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) < 3 || (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = mpsse_flush_pipelined(ctx);
 
 		/* Byte transfer */
 		unsigned this_bits = length;
@@ -863,7 +915,7 @@ void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t d
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, 0x80);
 	buffer_write_byte(ctx, data);
@@ -880,7 +932,7 @@ void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, 0x82);
 	buffer_write_byte(ctx, data);
@@ -897,7 +949,7 @@ void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, 0x81);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -913,7 +965,7 @@ void mpsse_read_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, 0x83);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -928,7 +980,7 @@ static void single_byte_boolean_helper(struct mpsse_ctx *ctx, bool var, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, var ? val_if_true : val_if_false);
 }
@@ -949,7 +1001,7 @@ void mpsse_set_divisor(struct mpsse_ctx *ctx, uint16_t divisor)
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = mpsse_flush_pipelined(ctx);
 
 	buffer_write_byte(ctx, 0x86);
 	buffer_write_byte(ctx, divisor & 0xff);
@@ -1011,13 +1063,6 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned transferred;
-};
-
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
 	struct transfer_result *res = transfer->user_data;
@@ -1035,21 +1080,25 @@ static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 		unsigned this_size = packet_size - 2;
 		if (this_size > chunk_remains - 2)
 			this_size = chunk_remains - 2;
-		if (this_size > ctx->read_count - res->transferred)
-			this_size = ctx->read_count - res->transferred;
-		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
+		if (this_size > res->count - res->transferred)
+			this_size = res->count - res->transferred;
+		memcpy(res->buffer + res->transferred,
+			transfer->buffer + packet_size * i + 2,
 			this_size);
 		res->transferred += this_size;
 		chunk_remains -= this_size + 2;
-		if (res->transferred == ctx->read_count) {
+		if (res->transferred == res->count) {
 			res->done = true;
 			break;
 		}
 	}
 
 	LOG_DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
-		ctx->read_count);
+		res->count);
+
+	/* don't resubmit a transfer that was cancelled or lost its device */
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED || transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
+		res->done = true;
 
 	if (!res->done)
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
@@ -1059,24 +1108,222 @@ static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 {
 	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
 
 	res->transferred += transfer->actual_length;
 
-	LOG_DEBUG_IO("transferred %d of %d", res->transferred, ctx->write_count);
+	LOG_DEBUG_IO("transferred %d of %d", res->transferred, res->count);
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
-	if (res->transferred == ctx->write_count)
+	if (res->transferred == res->count
+			|| transfer->status == LIBUSB_TRANSFER_CANCELLED
+			|| transfer->status == LIBUSB_TRANSFER_NO_DEVICE)
 		res->done = true;
 	else {
-		transfer->length = ctx->write_count - res->transferred;
-		transfer->buffer = ctx->write_buffer + res->transferred;
+		transfer->length = res->count - res->transferred;
+		transfer->buffer = res->buffer + res->transferred;
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
 			res->done = true;
 	}
 }
 
+/* Submit the write and, if there is data to read back, the read transfer of
+ * a batch. Submission errors are reported by mpsse_batch_wait(). */
+static void mpsse_batch_submit(struct mpsse_ctx *ctx, struct mpsse_batch *batch)
+{
+	batch->write_result = (struct transfer_result) {
+		.ctx = ctx,
+		.buffer = batch->write_buffer,
+		.count = batch->write_count,
+	};
+	/* delay read transaction to ensure the FTDI chip can support us with data
+	   immediately after processing the MPSSE commands in the write transaction */
+	batch->read_result = (struct transfer_result) {
+		.ctx = ctx,
+		.done = batch->read_count == 0,
+		.buffer = batch->read_buffer,
+		.count = batch->read_count,
+	};
+	batch->read_transfer = NULL;
+	batch->busy = true;
+
+	batch->write_transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(batch->write_transfer, ctx->usb_dev, ctx->out_ep, batch->write_buffer,
+		batch->write_count, write_cb, &batch->write_result, ctx->usb_write_timeout);
+	batch->status = libusb_submit_transfer(batch->write_transfer);
+	if (batch->status != LIBUSB_SUCCESS) {
+		batch->write_result.done = true;
+		batch->read_result.done = true;
+		return;
+	}
+
+	if (batch->read_count) {
+		batch->read_transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(batch->read_transfer, ctx->usb_dev, ctx->in_ep, batch->read_chunk,
+			ctx->read_chunk_size, read_cb, &batch->read_result,
+			ctx->usb_read_timeout);
+		batch->status = libusb_submit_transfer(batch->read_transfer);
+		if (batch->status != LIBUSB_SUCCESS) {
+			batch->read_result.done = true;
+			libusb_cancel_transfer(batch->write_transfer);
+		}
+	}
+}
+
+static void mpsse_batch_release(struct mpsse_batch *batch)
+{
+	libusb_free_transfer(batch->write_transfer);
+	if (batch->read_transfer)
+		libusb_free_transfer(batch->read_transfer);
+	batch->write_transfer = NULL;
+	batch->read_transfer = NULL;
+	batch->busy = false;
+}
+
+/* Wait for a submitted batch to complete and deliver its read data through
+ * the bit_copy queue */
+static int mpsse_batch_wait(struct mpsse_ctx *ctx, struct mpsse_batch *batch)
+{
+	struct transfer_result *write_result = &batch->write_result;
+	struct transfer_result *read_result = &batch->read_result;
+	int retval = LIBUSB_SUCCESS;
+
+	/* Polling loop, more or less taken from libftdi */
+	int64_t start = timeval_ms();
+	int64_t warn_after = 2000;
+	while (!write_result->done || !read_result->done) {
+		struct timeval timeout_usb;
+
+		timeout_usb.tv_sec = 1;
+		timeout_usb.tv_usec = 0;
+
+		retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
+		keep_alive();
+		if (retval == LIBUSB_ERROR_NO_DEVICE || retval == LIBUSB_ERROR_INTERRUPTED)
+			break;
+
+		if (retval != LIBUSB_SUCCESS) {
+			libusb_cancel_transfer(batch->write_transfer);
+			if (batch->read_transfer)
+				libusb_cancel_transfer(batch->read_transfer);
+			while (!write_result->done || !read_result->done) {
+				retval = libusb_handle_events_timeout_completed(ctx->usb_ctx,
+								&timeout_usb, NULL);
+				if (retval != LIBUSB_SUCCESS)
+					break;
+			}
+		}
+
+		int64_t now = timeval_ms();
+		if (now - start > warn_after) {
+			LOG_WARNING("Haven't made progress in mpsse_flush() for %" PRId64
+					"ms.", now - start);
+			warn_after *= 2;
+		}
+	}
+
+	if (batch->status != LIBUSB_SUCCESS)
+		retval = batch->status;
+
+	if (retval != LIBUSB_SUCCESS) {
+		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
+		retval = ERROR_FAIL;
+	} else if (write_result->transferred < batch->write_count) {
+		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
+			write_result->transferred,
+			batch->write_count);
+		retval = ERROR_FAIL;
+	} else if (read_result->transferred < batch->read_count) {
+		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
+			read_result->transferred,
+			batch->read_count);
+		retval = ERROR_FAIL;
+	} else {
+		retval = ERROR_OK;
+	}
+
+	if (retval == ERROR_OK && batch->read_count)
+		bit_copy_execute(&batch->read_queue);
+	else
+		bit_copy_discard(&batch->read_queue);
+
+	mpsse_batch_release(batch);
+
+	return retval;
+}
+
+/* Abandon a batch still in flight, e.g. when purging after an error */
+static void mpsse_batch_cancel(struct mpsse_ctx *ctx, struct mpsse_batch *batch)
+{
+	if (!batch->busy)
+		return;
+
+	struct timeval timeout_usb = { .tv_sec = 1, .tv_usec = 0 };
+
+	if (!batch->write_result.done)
+		libusb_cancel_transfer(batch->write_transfer);
+	if (batch->read_transfer && !batch->read_result.done)
+		libusb_cancel_transfer(batch->read_transfer);
+	while (!batch->write_result.done || !batch->read_result.done) {
+		if (libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL) != LIBUSB_SUCCESS)
+			break;
+	}
+
+	bit_copy_discard(&batch->read_queue);
+	mpsse_batch_release(batch);
+}
+
+/* Called when the command buffer fills up in the middle of a queue. In
+ * pipelined mode the full buffer is handed to libusb and queueing continues
+ * in the spare buffers, so building batch N+1 overlaps the USB round trip
+ * of batch N. At most one batch is in flight; mpsse_flush() waits for it
+ * before sending the last one, so read data is still only guaranteed to be
+ * available after mpsse_flush(). */
+static int mpsse_flush_pipelined(struct mpsse_ctx *ctx)
+{
+	struct mpsse_batch *batch = &ctx->batch;
+	int retval;
+
+	if (!ctx->pipelined || ctx->write_count == 0)
+		return mpsse_flush(ctx);
+
+	if (batch->busy) {
+		retval = mpsse_batch_wait(ctx, batch);
+		if (retval != ERROR_OK) {
+			mpsse_purge(ctx);
+			return retval;
+		}
+	}
+
+	LOG_DEBUG_IO("write %d%s, read %d, pipelined", ctx->write_count, ctx->read_count ? "+1" : "",
+			ctx->read_count);
+
+	if (ctx->read_count)
+		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
+
+	/* swap the filled buffers with the idle spare ones */
+	uint8_t *write_buffer = batch->write_buffer;
+	uint8_t *read_buffer = batch->read_buffer;
+	uint8_t *read_chunk = batch->read_chunk;
+
+	batch->write_buffer = ctx->write_buffer;
+	batch->write_count = ctx->write_count;
+	batch->read_buffer = ctx->read_buffer;
+	batch->read_count = ctx->read_count;
+	batch->read_chunk = ctx->read_chunk;
+	list_splice_init(&ctx->read_queue.list, &batch->read_queue.list);
+
+	ctx->write_buffer = write_buffer;
+	ctx->read_buffer = read_buffer;
+	ctx->read_chunk = read_chunk;
+	ctx->write_count = 0;
+	ctx->read_count = 0;
+
+	mpsse_batch_submit(ctx, batch);
+
+	return ERROR_OK;
+}
+
 int mpsse_flush(struct mpsse_ctx *ctx)
 {
 	int retval = ctx->retval;
@@ -1088,6 +1335,15 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 		return retval;
 	}
 
+	/* complete the batch still in flight from a pipelined flush first */
+	if (ctx->batch.busy) {
+		retval = mpsse_batch_wait(ctx, &ctx->batch);
+		if (retval != ERROR_OK) {
+			mpsse_purge(ctx);
+			return retval;
+		}
+	}
+
 	LOG_DEBUG_IO("write %d%s, read %d", ctx->write_count, ctx->read_count ? "+1" : "",
 			ctx->read_count);
 	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
@@ -1169,102 +1425,29 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 	}
 #endif // BUILD_BACKEND_FTD2XX
 	BACKEND_DIVERGENCE_LIBUSB
-	// the original libusb data transfer
-	struct libusb_transfer *read_transfer = 0;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
-	if (ctx->read_count) {
+	// the original libusb data transfer, run synchronously on the current buffers
+	if (ctx->read_count)
 		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
-		/* delay read transaction to ensure the FTDI chip can support us with data
-		   immediately after processing the MPSSE commands in the write transaction */
-	}
-
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
-	if (retval != LIBUSB_SUCCESS)
-		goto error_check;
-
-	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
-			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
-		if (retval != LIBUSB_SUCCESS)
-			goto error_check;
-	}
-
-	/* Polling loop, more or less taken from libftdi */
-	int64_t start = timeval_ms();
-	int64_t warn_after = 2000;
-	while (!write_result.done || !read_result.done) {
-		struct timeval timeout_usb;
 
-		timeout_usb.tv_sec = 1;
-		timeout_usb.tv_usec = 0;
-
-		retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
-		keep_alive();
-		if (retval == LIBUSB_ERROR_NO_DEVICE || retval == LIBUSB_ERROR_INTERRUPTED)
-			break;
-
-		if (retval != LIBUSB_SUCCESS) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
-			while (!write_result.done || !read_result.done) {
-				retval = libusb_handle_events_timeout_completed(ctx->usb_ctx,
-								&timeout_usb, NULL);
-				if (retval != LIBUSB_SUCCESS)
-					break;
-			}
-		}
+	struct mpsse_batch batch = {
+		.write_buffer = ctx->write_buffer,
+		.write_count = ctx->write_count,
+		.read_buffer = ctx->read_buffer,
+		.read_count = ctx->read_count,
+		.read_chunk = ctx->read_chunk,
+	};
+	bit_copy_queue_init(&batch.read_queue);
+	list_splice_init(&ctx->read_queue.list, &batch.read_queue.list);
 
-		int64_t now = timeval_ms();
-		if (now - start > warn_after) {
-			LOG_WARNING("Haven't made progress in mpsse_flush() for %" PRId64
-					"ms.", now - start);
-			warn_after *= 2;
-		}
-	}
+	mpsse_batch_submit(ctx, &batch);
+	retval = mpsse_batch_wait(ctx, &batch);
 
-error_check:
-	if (retval != LIBUSB_SUCCESS) {
-		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
-		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
-		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
-			ctx->write_count);
-		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
-		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
-			ctx->read_count);
-		retval = ERROR_FAIL;
-	} else if (ctx->read_count) {
+	if (retval == ERROR_OK) {
 		ctx->write_count = 0;
 		ctx->read_count = 0;
-		bit_copy_execute(&ctx->read_queue);
-		retval = ERROR_OK;
 	} else {
-		ctx->write_count = 0;
-		bit_copy_discard(&ctx->read_queue);
-		retval = ERROR_OK;
-	}
-
-	if (retval != ERROR_OK)
-		mpsse_purge(ctx);
-
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
-
-	if (retval != ERROR_OK)
 		mpsse_purge(ctx);
+	}
 
 	BACKEND_DIVERGENCE_END
 
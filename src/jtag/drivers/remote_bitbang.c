@@ -407,6 +407,7 @@ static int remote_bitbang_execute_queue(void)
 }
 
 static struct jtag_interface remote_bitbang_interface = {
+	.supported = DEBUG_CAP_BULK_SCAN,
 	.execute_queue = &remote_bitbang_execute_queue,
 };
 
@@ -0,0 +1,449 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/**
+ * @file
+ * JTAG adapter driver that plays back a trace recorded with
+ * "jtag record".  Like the dummy driver it needs no hardware; instead of
+ * a fixed pattern, scans that capture data are answered with the data
+ * captured by the matching scan of the trace.  Every executed queue is
+ * charged against a simple adapter model (round trip latency per flush,
+ * TCK rate and link bandwidth), so the cost of a session can be compared
+ * offline before and after a change to the JTAG queue.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <jtag/interface.h>
+#include <jtag/commands.h>
+#include <jtag/trace.h>
+
+/* bytes an MPSSE-like adapter spends on the opcode of each command */
+#define REPLAY_CMD_OVERHEAD 3
+
+/* how many trace records to skip looking for the scan that matches */
+#define REPLAY_LOOKAHEAD 256
+
+struct replay_stats {
+	uint64_t flushes;
+	uint64_t commands;
+	uint64_t cycles;
+	uint64_t bytes;
+	uint64_t sleep_us;
+	unsigned int mismatches;
+};
+
+static struct jtag_trace replay_trace;
+static struct replay_stats replay_live;
+static tap_state_t replay_state = TAP_RESET;
+
+/* the adapter model */
+static unsigned int replay_latency_us = 125;
+static unsigned int replay_bandwidth_kbps;
+static int replay_khz = 1000;
+static bool replay_realtime;
+
+static unsigned int replay_path_len(tap_state_t from, tap_state_t to)
+{
+	if (from == to || !tap_is_state_stable(to))
+		return 0;
+	if (to == TAP_RESET)
+		return 5;
+	/* unknown state: TLR first */
+	if (!tap_is_state_stable(from))
+		return 5 + tap_get_tms_path_len(TAP_RESET, to);
+	return tap_get_tms_path_len(from, to);
+}
+
+/** Charge one command against the adapter model. */
+static void replay_account(struct replay_stats *stats, tap_state_t *state,
+	const struct jtag_trace_record *rec, bool captured)
+{
+	tap_state_t shift = rec->ir_scan ? TAP_IRSHIFT : TAP_DRSHIFT;
+
+	if (rec->type != JTAG_TRACE_FLUSH)
+		stats->commands++;
+
+	switch (rec->type) {
+		case JTAG_TRACE_FLUSH:
+			stats->flushes++;
+			return;
+		case JTAG_TRACE_SCAN:
+			stats->cycles += replay_path_len(*state, shift);
+			/* fall through */
+		case JTAG_TRACE_TDI:
+			stats->cycles += rec->count + replay_path_len(shift, rec->end_state);
+			stats->bytes += DIV_ROUND_UP(rec->count, 8);
+			if (captured)
+				stats->bytes += DIV_ROUND_UP(rec->count, 8);
+			*state = rec->end_state;
+			break;
+		case JTAG_TRACE_TLR_RESET:
+			stats->cycles += 5;
+			*state = TAP_RESET;
+			break;
+		case JTAG_TRACE_RUNTEST:
+			stats->cycles += replay_path_len(*state, TAP_IDLE) + rec->count
+				+ replay_path_len(TAP_IDLE, rec->end_state);
+			*state = rec->end_state;
+			break;
+		case JTAG_TRACE_RESET:
+			if (rec->trst == 1)
+				*state = TAP_RESET;
+			break;
+		case JTAG_TRACE_PATHMOVE:
+			stats->cycles += rec->count;
+			*state = rec->end_state;
+			break;
+		case JTAG_TRACE_SLEEP:
+			stats->sleep_us += rec->count;
+			return;
+		case JTAG_TRACE_STABLECLOCKS:
+			stats->cycles += rec->count;
+			break;
+		case JTAG_TRACE_TMS:
+			stats->cycles += rec->count;
+			*state = TAP_INVALID;
+			break;
+	}
+	stats->bytes += REPLAY_CMD_OVERHEAD;
+}
+
+static uint64_t replay_model_us(const struct replay_stats *stats)
+{
+	uint64_t us = stats->flushes * replay_latency_us + stats->sleep_us;
+
+	if (replay_khz > 0)
+		us += stats->cycles * 1000 / replay_khz;
+	if (replay_bandwidth_kbps > 0)
+		us += stats->bytes * 8 * 1000 / replay_bandwidth_kbps;
+	return us;
+}
+
+/** Describe a queued command the way it would appear in a trace. */
+static bool replay_command_record(const struct jtag_command *cmd,
+	struct jtag_trace_record *rec, bool *captured)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->end_state = TAP_INVALID;
+	*captured = false;
+
+	switch (cmd->type) {
+		case JTAG_SCAN:
+		case JTAG_TDI:
+			rec->type = cmd->type == JTAG_SCAN ? JTAG_TRACE_SCAN : JTAG_TRACE_TDI;
+			rec->ir_scan = cmd->cmd.scan->ir_scan;
+			rec->end_state = cmd->cmd.scan->end_state;
+			rec->count = jtag_scan_size(cmd->cmd.scan);
+			for (int i = 0; i < cmd->cmd.scan->num_fields; i++) {
+				if (cmd->cmd.scan->fields[i].in_value)
+					*captured = true;
+			}
+			break;
+		case JTAG_TLR_RESET:
+			rec->type = JTAG_TRACE_TLR_RESET;
+			rec->end_state = cmd->cmd.statemove->end_state;
+			break;
+		case JTAG_RUNTEST:
+			rec->type = JTAG_TRACE_RUNTEST;
+			rec->end_state = cmd->cmd.runtest->end_state;
+			rec->count = cmd->cmd.runtest->num_cycles;
+			break;
+		case JTAG_RESET:
+			rec->type = JTAG_TRACE_RESET;
+			rec->trst = cmd->cmd.reset->trst;
+			rec->srst = cmd->cmd.reset->srst;
+			break;
+		case JTAG_PATHMOVE:
+			rec->type = JTAG_TRACE_PATHMOVE;
+			rec->count = cmd->cmd.pathmove->num_states;
+			rec->end_state = cmd->cmd.pathmove->path[rec->count - 1];
+			break;
+		case JTAG_SLEEP:
+			rec->type = JTAG_TRACE_SLEEP;
+			rec->count = cmd->cmd.sleep->us;
+			break;
+		case JTAG_STABLECLOCKS:
+			rec->type = JTAG_TRACE_STABLECLOCKS;
+			rec->count = cmd->cmd.stableclocks->num_cycles;
+			break;
+		case JTAG_TMS:
+			rec->type = JTAG_TRACE_TMS;
+			rec->count = cmd->cmd.tms->num_bits;
+			break;
+		default:
+			LOG_ERROR("BUG: unknown JTAG command type encountered: %d", cmd->type);
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Fill the capture fields of @a scan from the next scan of the trace with
+ * the same shape.  Scans the live queue no longer issues (e.g. because the
+ * queue optimizer dropped them) are skipped.  Without a match TDO reads
+ * as all ones, like a floating line.
+ */
+static void replay_capture(const struct scan_command *scan, const struct jtag_trace_record *live)
+{
+	struct jtag_trace_record rec;
+	size_t pos = replay_trace.pos;
+
+	for (int i = 0; replay_trace.data && i < REPLAY_LOOKAHEAD; i++) {
+		if (!jtag_trace_next(&replay_trace, &rec))
+			break;
+		if (rec.type == live->type && rec.ir_scan == live->ir_scan
+				&& rec.count == live->count && rec.in) {
+			jtag_read_buffer(rec.in, scan);
+			return;
+		}
+	}
+
+	replay_trace.pos = pos;
+	replay_live.mismatches++;
+	LOG_DEBUG("no recorded %s scan of %" PRIu32 " bits at trace offset %zu",
+		live->ir_scan ? "IR" : "DR", live->count, pos);
+
+	uint8_t *ones = malloc(DIV_ROUND_UP(live->count, 8) + 1);
+	if (!ones) {
+		LOG_ERROR("Out of memory");
+		return;
+	}
+	buf_set_ones(ones, live->count);
+	jtag_read_buffer(ones, scan);
+	free(ones);
+}
+
+static int replay_execute_queue(void)
+{
+	struct jtag_trace_record rec;
+	bool captured;
+	uint64_t start_us = replay_model_us(&replay_live);
+
+	for (struct jtag_command *cmd = jtag_command_queue; cmd; cmd = cmd->next) {
+		if (!replay_command_record(cmd, &rec, &captured))
+			continue;
+
+		replay_account(&replay_live, &replay_state, &rec, captured);
+		if (captured)
+			replay_capture(cmd->cmd.scan, &rec);
+		if (tap_is_state_stable(replay_state))
+			tap_set_state(replay_state);
+	}
+	replay_live.flushes++;
+
+	if (replay_realtime)
+		jtag_sleep(replay_model_us(&replay_live) - start_us);
+
+	return ERROR_OK;
+}
+
+static void replay_print_stats(struct command_invocation *cmd, const struct replay_stats *stats)
+{
+	command_print(cmd, "%" PRIu64 " flushes, %" PRIu64 " commands, %" PRIu64
+		" TCK cycles, %" PRIu64 " bytes, %" PRIu64 " us sleeping",
+		stats->flushes, stats->commands, stats->cycles, stats->bytes, stats->sleep_us);
+	command_print(cmd, "modelled time %" PRIu64 " us", replay_model_us(stats));
+}
+
+COMMAND_HANDLER(replay_handle_trace_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	jtag_trace_free(&replay_trace);
+	int retval = jtag_trace_load(CMD_ARGV[0], &replay_trace);
+	if (retval != ERROR_OK)
+		command_print(CMD, "can't load JTAG trace %s", CMD_ARGV[0]);
+	return retval;
+}
+
+COMMAND_HANDLER(replay_handle_latency_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], replay_latency_us);
+	command_print(CMD, "replay latency: %u us per flush", replay_latency_us);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(replay_handle_bandwidth_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], replay_bandwidth_kbps);
+	if (replay_bandwidth_kbps)
+		command_print(CMD, "replay bandwidth: %u kbit/s", replay_bandwidth_kbps);
+	else
+		command_print(CMD, "replay bandwidth: unlimited");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(replay_handle_realtime_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], replay_realtime);
+	command_print(CMD, "replay realtime: %s", replay_realtime ? "on" : "off");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(replay_handle_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(&replay_live, 0, sizeof(replay_live));
+		return ERROR_OK;
+	}
+
+	replay_print_stats(CMD, &replay_live);
+	command_print(CMD, "%u scans not found in the trace", replay_live.mismatches);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(replay_handle_bench_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct jtag_trace trace;
+	int retval = jtag_trace_load(CMD_ARGV[0], &trace);
+	if (retval != ERROR_OK) {
+		command_print(CMD, "can't load JTAG trace %s", CMD_ARGV[0]);
+		return retval;
+	}
+
+	struct replay_stats stats = { 0 };
+	struct jtag_trace_record rec;
+	tap_state_t state = TAP_RESET;
+
+	while (jtag_trace_next(&trace, &rec))
+		replay_account(&stats, &state, &rec, rec.in);
+
+	jtag_trace_free(&trace);
+	replay_print_stats(CMD, &stats);
+	return ERROR_OK;
+}
+
+static const struct command_registration replay_subcommand_handlers[] = {
+	{
+		.name = "trace",
+		.handler = replay_handle_trace_command,
+		.mode = COMMAND_ANY,
+		.help = "Load the trace whose captured data answers the scans.",
+		.usage = "filename",
+	},
+	{
+		.name = "latency",
+		.handler = replay_handle_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "Modelled round trip time of one queue flush.",
+		.usage = "[microseconds]",
+	},
+	{
+		.name = "bandwidth",
+		.handler = replay_handle_bandwidth_command,
+		.mode = COMMAND_ANY,
+		.help = "Modelled host to adapter link bandwidth, 0 for unlimited.",
+		.usage = "[kbit/s]",
+	},
+	{
+		.name = "realtime",
+		.handler = replay_handle_realtime_command,
+		.mode = COMMAND_ANY,
+		.help = "Sleep for the modelled time of each flush.",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "stats",
+		.handler = replay_handle_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "Show or reset the modelled cost of the queues executed so far.",
+		.usage = "['reset']",
+	},
+	{
+		.name = "bench",
+		.handler = replay_handle_bench_command,
+		.mode = COMMAND_ANY,
+		.help = "Show the modelled cost of a recorded trace.",
+		.usage = "filename",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration replay_command_handlers[] = {
+	{
+		.name = "replay",
+		.mode = COMMAND_ANY,
+		.help = "JTAG trace replay driver commands",
+		.chain = replay_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static int replay_reset(int trst, int srst)
+{
+	if (trst || (srst && (jtag_get_reset_config() & RESET_SRST_PULLS_TRST)))
+		replay_state = TAP_RESET;
+	return ERROR_OK;
+}
+
+static int replay_khz_to_speed(int khz, int *jtag_speed)
+{
+	*jtag_speed = khz;
+	return ERROR_OK;
+}
+
+static int replay_speed_div(int speed, int *khz)
+{
+	*khz = speed;
+	return ERROR_OK;
+}
+
+static int replay_speed(int speed)
+{
+	replay_khz = speed;
+	return ERROR_OK;
+}
+
+static int replay_init(void)
+{
+	if (!replay_trace.data)
+		LOG_WARNING("no trace loaded, all scans will capture ones");
+	return ERROR_OK;
+}
+
+static int replay_quit(void)
+{
+	jtag_trace_free(&replay_trace);
+	return ERROR_OK;
+}
+
+static struct jtag_interface replay_interface = {
+	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_TDI_SEQ,
+	.execute_queue = &replay_execute_queue,
+};
+
+struct adapter_driver replay_adapter_driver = {
+	.name = "replay",
+	.transports = jtag_only,
+	.commands = replay_command_handlers,
+
+	.init = &replay_init,
+	.quit = &replay_quit,
+	.reset = &replay_reset,
+	.speed = &replay_speed,
+	.khz = &replay_khz_to_speed,
+	.speed_div = &replay_speed_div,
+
+	.jtag_ops = &replay_interface,
+};
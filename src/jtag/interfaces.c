@@ -47,6 +47,7 @@ extern struct adapter_driver parport_adapter_driver;
 #endif
 #if BUILD_DUMMY == 1
 extern struct adapter_driver dummy_adapter_driver;
+extern struct adapter_driver replay_adapter_driver;
 #endif
 extern struct adapter_driver jtag_tcp_adapter_driver;
 #if BUILD_FTDI == 1
@@ -162,6 +163,7 @@ struct adapter_driver *adapter_drivers[] = {
 #endif
 #if BUILD_DUMMY == 1
 		&dummy_adapter_driver,
+		&replay_adapter_driver,
 #endif
 		&jtag_tcp_adapter_driver,
 #if BUILD_FTDI == 1
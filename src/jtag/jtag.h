@@ -142,6 +142,15 @@ struct jtag_tap {
 	uint8_t *cur_instr;
 	/** Bypass register selected */
 	int bypass;
+	/** cur_instr and bypass are known to match the hardware */
+	bool cur_instr_valid;
+
+	/** Drop queued IR scans that would not change the instruction */
+	bool optimize;
+	/** Number of IR scans dropped by the optimizer */
+	unsigned int ir_scans_saved;
+	/** Number of scan bits those IR scans would have shifted */
+	uint64_t ir_bits_saved;
 
 	struct jtag_tap_event_action *event_action;
 
@@ -499,6 +508,43 @@ int jtag_add_tms_seq(unsigned nbits, const uint8_t *seq, enum tap_state t);
 int jtag_add_tdi_seq(unsigned nbits, const uint8_t *out_bits, uint8_t *in_bits,
 		tap_state_t endstate);
 
+/**
+ * One scan of a vector queued with jtag_add_bulk_scan().  The scan
+ * covers the whole chain, like jtag_add_plain_dr_scan(), so any bypass
+ * bits for other TAPs must already be packed into the vector.
+ */
+struct jtag_bulk_scan {
+	/** Number of bits, taken from the vector right after the previous scan. */
+	unsigned num_bits;
+	/** Shift through the instruction register instead of a data register. */
+	bool ir_scan;
+	/** Store the TDO of this scan in the capture vector. */
+	bool capture;
+	/** Stable state to enter after the scan. */
+	tap_state_t end_state;
+};
+
+/**
+ * Queue many plain scans with a single call.  The TDI bits of all the
+ * scans are packed back to back in @a out_bits, scan @a i starting
+ * right after the last bit of scan @a i - 1.  TDO of the scans marked
+ * @c capture is stored at the same bit positions of @a in_bits, which
+ * must stay valid until the queue has been executed; other bits of
+ * @a in_bits are left alone.
+ *
+ * Adapters that advertise DEBUG_CAP_BULK_SCAN get the whole vector as
+ * one command and can stream it; for the others it is split into plain
+ * scans here.  The TDI vector is copied, so the caller may reuse it.
+ *
+ * @param num_scans Number of entries in @a scans.
+ * @param scans Length, register, capture flag and end state of each scan.
+ * @param out_bits Packed TDI bits.
+ * @param in_bits Packed TDO bits, or NULL when no scan is captured.
+ * @returns ERROR_OK on success, or an error code on failure.
+ */
+int jtag_add_bulk_scan(unsigned num_scans, const struct jtag_bulk_scan *scans,
+		const uint8_t *out_bits, uint8_t *in_bits);
+
 /**
  * Function jtag_add_clocks
  * first checks that the state in which the clocks are to be issued is
@@ -534,6 +580,9 @@ void jtag_execute_queue_noclear(void);
 /** @returns the number of times the scan queue has been flushed */
 int jtag_get_flush_queue_count(void);
 
+/** Number of idle/reset commands the queue optimizer dropped or merged. */
+unsigned int jtag_get_optimize_cmds_saved(void);
+
 /** Report Tcl event to all TAPs */
 void jtag_notify_event(enum jtag_event);
 
@@ -71,6 +71,9 @@ int interface_add_tms_seq(unsigned num_bits,
 int interface_add_tdi_seq(unsigned num_bits,
 		const uint8_t *inbits, uint8_t *outbits, enum tap_state state);
 
+int interface_add_bulk_scan(unsigned num_scans, const struct jtag_bulk_scan *scans,
+		unsigned num_bits, const uint8_t *out_bits, uint8_t *in_bits);
+
 /**
  * This drives the actual srst and trst pins. srst will always be 0
  * if jtag_reset_config & RESET_SRST_PULLS_TRST != 0 and ditto for
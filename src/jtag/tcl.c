@@ -37,6 +37,7 @@
 #include "interface.h"
 #include "interfaces.h"
 #include "tcl.h"
+#include "trace.h"
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -738,6 +739,9 @@ static bool jtag_tap_enable(struct jtag_tap *t)
 	if (!t->enabled)
 		return false;
 
+	/* whatever IR it had before, it joined the chain unseen */
+	t->cur_instr_valid = false;
+
 	/* FIXME add JTAG sanity checks, w/o TLR
 	 *  - scan chain length grew by one (this)
 	 *  - IDs and IR lengths are as expected
@@ -753,6 +757,8 @@ static bool jtag_tap_disable(struct jtag_tap *t)
 	if (t->enabled)
 		return false;
 
+	t->cur_instr_valid = false;
+
 	/* FIXME add JTAG sanity checks, w/o TLR
 	 *  - scan chain length shrank by one (this)
 	 *  - IDs and IR lengths are as expected
@@ -859,7 +865,82 @@ COMMAND_HANDLER(handle_jtag_init_command)
 	return jtag_init(CMD_CTX);
 }
 
+static void jtag_print_optimize(struct command_invocation *cmd, struct jtag_tap *tap)
+{
+	command_print(cmd, "%s: optimize %s, %u IR scans (%" PRIu64 " bytes) saved",
+		tap->dotted_name, tap->optimize ? "on" : "off",
+		tap->ir_scans_saved, DIV_ROUND_UP(tap->ir_bits_saved, 8));
+}
+
+COMMAND_HANDLER(handle_jtag_optimize_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 0) {
+		for (struct jtag_tap *tap = jtag_all_taps(); tap; tap = tap->next_tap)
+			jtag_print_optimize(CMD, tap);
+		command_print(CMD, "chain: %u idle/reset commands merged",
+			jtag_get_optimize_cmds_saved());
+		return ERROR_OK;
+	}
+
+	struct jtag_tap *tap = jtag_tap_by_string(CMD_ARGV[0]);
+	if (!tap) {
+		command_print(CMD, "Tap: %s unknown", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[1], tap->optimize);
+
+	jtag_print_optimize(CMD, tap);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_record_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "off") == 0) {
+			jtag_trace_stop();
+		} else {
+			int retval = jtag_trace_start(CMD_ARGV[0]);
+			if (retval != ERROR_OK) {
+				command_print(CMD, "can't record to %s", CMD_ARGV[0]);
+				return retval;
+			}
+		}
+	}
+
+	const char *filename = jtag_trace_recording();
+	if (filename)
+		command_print(CMD, "recording JTAG queue to %s", filename);
+	else
+		command_print(CMD, "JTAG queue recording is off");
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_subcommand_handlers[] = {
+	{
+		.name = "record",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_record_command,
+		.help = "Record every flushed JTAG queue, with the captured "
+			"data, to a binary trace file for the replay driver.",
+		.usage = "[filename|'off']",
+	},
+	{
+		.name = "optimize",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_optimize_command,
+		.help = "Display or set whether redundant IR scans and idle "
+			"cycles are dropped from the JTAG queue for a TAP, "
+			"and how much was saved.",
+		.usage = "[tap_name ['on'|'off']]",
+	},
 	{
 		.name = "init",
 		.mode = COMMAND_ANY,
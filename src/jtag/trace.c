@@ -0,0 +1,392 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/**
+ * @file
+ * Recorder and reader for binary traces of the flushed JTAG command
+ * queue, see trace.h for the file format.  A trace captured against a
+ * real board can be played back by the "replay" adapter driver to
+ * benchmark queue changes without hardware.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/fileio.h>
+#include "jtag.h"
+#include "commands.h"
+#include "trace.h"
+
+static struct fileio *trace_file;
+static char *trace_filename;
+
+const char *jtag_trace_recording(void)
+{
+	return trace_filename;
+}
+
+int jtag_trace_start(const char *filename)
+{
+	jtag_trace_stop();
+
+	int retval = fileio_open(&trace_file, filename, FILEIO_WRITE, FILEIO_BINARY);
+	if (retval != ERROR_OK) {
+		trace_file = NULL;
+		return retval;
+	}
+
+	size_t written;
+	retval = fileio_write(trace_file, strlen(JTAG_TRACE_MAGIC), JTAG_TRACE_MAGIC, &written);
+	if (retval != ERROR_OK) {
+		fileio_close(trace_file);
+		trace_file = NULL;
+		return retval;
+	}
+
+	trace_filename = strdup(filename);
+	LOG_INFO("recording JTAG queue to %s", filename);
+	return ERROR_OK;
+}
+
+void jtag_trace_stop(void)
+{
+	if (!trace_file)
+		return;
+
+	fileio_close(trace_file);
+	trace_file = NULL;
+	LOG_INFO("JTAG queue recording to %s stopped", trace_filename);
+	free(trace_filename);
+	trace_filename = NULL;
+}
+
+static uint8_t trace_state(tap_state_t state)
+{
+	return state == TAP_INVALID ? 0xff : (uint8_t)state;
+}
+
+static int trace_write(const void *data, size_t size)
+{
+	size_t written;
+	int retval = fileio_write(trace_file, size, data, &written);
+	if (retval == ERROR_OK && written != size)
+		retval = ERROR_FILEIO_OPERATION_FAILED;
+	return retval;
+}
+
+static int trace_write_u32(uint8_t type, uint32_t value)
+{
+	uint8_t rec[5];
+
+	rec[0] = type;
+	h_u32_to_le(rec + 1, value);
+	return trace_write(rec, sizeof(rec));
+}
+
+static int trace_write_scan(uint8_t type, const struct scan_command *scan)
+{
+	uint8_t rec[7];
+	uint8_t *out;
+	uint8_t *in = NULL;
+	int num_bits = jtag_build_buffer(scan, &out);
+	size_t num_bytes = DIV_ROUND_UP(num_bits, 8);
+
+	for (int i = 0, bit = 0; i < scan->num_fields; bit += scan->fields[i++].num_bits) {
+		const struct scan_field *field = scan->fields + i;
+
+		if (!field->in_value)
+			continue;
+		if (!in) {
+			in = calloc(1, num_bytes ? num_bytes : 1);
+			if (!in) {
+				free(out);
+				return ERROR_FAIL;
+			}
+		}
+		buf_set_buf(field->in_value, 0, in, bit, field->num_bits);
+	}
+
+	rec[0] = type;
+	rec[1] = (scan->ir_scan ? TRACE_FLAG_IR_SCAN : 0) | (in ? TRACE_FLAG_CAPTURED : 0);
+	rec[2] = trace_state(scan->end_state);
+	h_u32_to_le(rec + 3, num_bits);
+
+	int retval = trace_write(rec, sizeof(rec));
+	if (retval == ERROR_OK)
+		retval = trace_write(out, num_bytes);
+	if (retval == ERROR_OK && in)
+		retval = trace_write(in, num_bytes);
+
+	free(out);
+	free(in);
+	return retval;
+}
+
+/* Bulk vectors are recorded as the plain scans they stand for, so the
+ * replay driver sees the same records whether or not the recording
+ * adapter took the vector whole. */
+static int trace_write_bulk_scan(const struct bulk_scan_command *bulk)
+{
+	int retval = ERROR_OK;
+	unsigned offset = 0;
+
+	for (unsigned i = 0; retval == ERROR_OK && i < bulk->num_scans; offset += bulk->scans[i++].num_bits) {
+		const struct jtag_bulk_scan *bulk_scan = &bulk->scans[i];
+		size_t num_bytes = DIV_ROUND_UP(bulk_scan->num_bits, 8);
+		struct scan_field field = {
+			.num_bits = bulk_scan->num_bits,
+		};
+		struct scan_command scan = {
+			.ir_scan = bulk_scan->ir_scan,
+			.num_fields = 1,
+			.fields = &field,
+			.end_state = bulk_scan->end_state,
+		};
+		uint8_t *out = malloc(num_bytes);
+		uint8_t *in = bulk_scan->capture ? malloc(num_bytes) : NULL;
+
+		if (!out || (bulk_scan->capture && !in)) {
+			free(out);
+			free(in);
+			return ERROR_FAIL;
+		}
+
+		field.out_value = buf_set_buf(bulk->out, offset, out, 0, bulk_scan->num_bits);
+		if (in)
+			field.in_value = buf_set_buf(bulk->in, offset, in, 0, bulk_scan->num_bits);
+
+		retval = trace_write_scan(JTAG_TRACE_SCAN, &scan);
+		free(out);
+		free(in);
+	}
+
+	return retval;
+}
+
+static int trace_write_command(const struct jtag_command *cmd)
+{
+	uint8_t rec[4];
+	int retval;
+
+	switch (cmd->type) {
+		case JTAG_SCAN:
+			return trace_write_scan(JTAG_TRACE_SCAN, cmd->cmd.scan);
+		case JTAG_TDI:
+			return trace_write_scan(JTAG_TRACE_TDI, cmd->cmd.scan);
+		case JTAG_BULK_SCAN:
+			return trace_write_bulk_scan(cmd->cmd.bulk);
+		case JTAG_TLR_RESET:
+			rec[0] = JTAG_TRACE_TLR_RESET;
+			rec[1] = trace_state(cmd->cmd.statemove->end_state);
+			return trace_write(rec, 2);
+		case JTAG_RUNTEST:
+			rec[0] = JTAG_TRACE_RUNTEST;
+			rec[1] = trace_state(cmd->cmd.runtest->end_state);
+			retval = trace_write(rec, 2);
+			if (retval != ERROR_OK)
+				return retval;
+			h_u32_to_le(rec, cmd->cmd.runtest->num_cycles);
+			return trace_write(rec, 4);
+		case JTAG_RESET:
+			rec[0] = JTAG_TRACE_RESET;
+			rec[1] = cmd->cmd.reset->trst + 1;
+			rec[2] = cmd->cmd.reset->srst + 1;
+			return trace_write(rec, 3);
+		case JTAG_PATHMOVE:
+			retval = trace_write_u32(JTAG_TRACE_PATHMOVE, cmd->cmd.pathmove->num_states);
+			for (int i = 0; retval == ERROR_OK && i < cmd->cmd.pathmove->num_states; i++) {
+				rec[0] = trace_state(cmd->cmd.pathmove->path[i]);
+				retval = trace_write(rec, 1);
+			}
+			return retval;
+		case JTAG_SLEEP:
+			return trace_write_u32(JTAG_TRACE_SLEEP, cmd->cmd.sleep->us);
+		case JTAG_STABLECLOCKS:
+			return trace_write_u32(JTAG_TRACE_STABLECLOCKS, cmd->cmd.stableclocks->num_cycles);
+		case JTAG_TMS:
+			retval = trace_write_u32(JTAG_TRACE_TMS, cmd->cmd.tms->num_bits);
+			if (retval != ERROR_OK)
+				return retval;
+			return trace_write(cmd->cmd.tms->bits, DIV_ROUND_UP(cmd->cmd.tms->num_bits, 8));
+		default:
+			LOG_WARNING("JTAG command %d not recorded", cmd->type);
+			return ERROR_OK;
+	}
+}
+
+/**
+ * Append an executed queue to the trace.  Called after the adapter ran
+ * the queue, so the captured scan data is available.
+ */
+void jtag_trace_record_queue(const struct jtag_command *queue, int result)
+{
+	if (!trace_file)
+		return;
+
+	int retval = ERROR_OK;
+	for (const struct jtag_command *cmd = queue; retval == ERROR_OK && cmd; cmd = cmd->next)
+		retval = trace_write_command(cmd);
+
+	if (retval == ERROR_OK)
+		retval = trace_write_u32(JTAG_TRACE_FLUSH, (uint32_t)result);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("failed to write JTAG trace %s", trace_filename);
+		jtag_trace_stop();
+	}
+}
+
+int jtag_trace_load(const char *filename, struct jtag_trace *trace)
+{
+	struct fileio *fileio;
+	size_t size, size_read;
+
+	memset(trace, 0, sizeof(*trace));
+
+	int retval = fileio_open(&fileio, filename, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_size(fileio, &size);
+	if (retval == ERROR_OK && size < strlen(JTAG_TRACE_MAGIC)) {
+		LOG_ERROR("%s is too short to be a JTAG trace", filename);
+		retval = ERROR_FAIL;
+	}
+
+	if (retval == ERROR_OK) {
+		trace->data = malloc(size);
+		if (!trace->data) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		retval = fileio_read(fileio, size, trace->data, &size_read);
+		if (retval == ERROR_OK && size_read != size)
+			retval = ERROR_FILEIO_OPERATION_FAILED;
+	}
+	fileio_close(fileio);
+
+	if (retval == ERROR_OK && memcmp(trace->data, JTAG_TRACE_MAGIC, strlen(JTAG_TRACE_MAGIC))) {
+		LOG_ERROR("%s is not a JTAG trace", filename);
+		retval = ERROR_FAIL;
+	}
+
+	if (retval != ERROR_OK) {
+		jtag_trace_free(trace);
+		return retval;
+	}
+
+	trace->size = size;
+	trace->pos = strlen(JTAG_TRACE_MAGIC);
+	return ERROR_OK;
+}
+
+void jtag_trace_free(struct jtag_trace *trace)
+{
+	free(trace->data);
+	memset(trace, 0, sizeof(*trace));
+}
+
+/** Return a pointer to the next @a size bytes of the trace, or NULL. */
+static const uint8_t *trace_take(struct jtag_trace *trace, size_t size)
+{
+	if (trace->size - trace->pos < size)
+		return NULL;
+
+	const uint8_t *p = trace->data + trace->pos;
+	trace->pos += size;
+	return p;
+}
+
+static tap_state_t trace_tap_state(uint8_t value)
+{
+	return value == 0xff ? TAP_INVALID : (tap_state_t)value;
+}
+
+/**
+ * Decode the next record of @a trace.
+ * @returns false at the end of the trace or if the trace is truncated.
+ */
+bool jtag_trace_next(struct jtag_trace *trace, struct jtag_trace_record *rec)
+{
+	const uint8_t *p;
+
+	if (trace->pos == trace->size)
+		return false;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->end_state = TAP_INVALID;
+	rec->type = trace->data[trace->pos++];
+
+	switch (rec->type) {
+		case JTAG_TRACE_SCAN:
+		case JTAG_TRACE_TDI:
+			p = trace_take(trace, 6);
+			if (!p)
+				break;
+			rec->ir_scan = p[0] & TRACE_FLAG_IR_SCAN;
+			rec->end_state = trace_tap_state(p[1]);
+			rec->count = le_to_h_u32(p + 2);
+			rec->out = trace_take(trace, DIV_ROUND_UP(rec->count, 8));
+			if (!rec->out)
+				break;
+			if (p[0] & TRACE_FLAG_CAPTURED) {
+				rec->in = trace_take(trace, DIV_ROUND_UP(rec->count, 8));
+				if (!rec->in)
+					break;
+			}
+			return true;
+		case JTAG_TRACE_TLR_RESET:
+			p = trace_take(trace, 1);
+			if (!p)
+				break;
+			rec->end_state = trace_tap_state(p[0]);
+			return true;
+		case JTAG_TRACE_RUNTEST:
+			p = trace_take(trace, 5);
+			if (!p)
+				break;
+			rec->end_state = trace_tap_state(p[0]);
+			rec->count = le_to_h_u32(p + 1);
+			return true;
+		case JTAG_TRACE_RESET:
+			p = trace_take(trace, 2);
+			if (!p)
+				break;
+			rec->trst = (int)p[0] - 1;
+			rec->srst = (int)p[1] - 1;
+			return true;
+		case JTAG_TRACE_PATHMOVE:
+		case JTAG_TRACE_TMS:
+			p = trace_take(trace, 4);
+			if (!p)
+				break;
+			rec->count = le_to_h_u32(p);
+			rec->out = trace_take(trace, rec->type == JTAG_TRACE_TMS
+					? DIV_ROUND_UP(rec->count, 8) : rec->count);
+			if (!rec->out)
+				break;
+			if (rec->type == JTAG_TRACE_PATHMOVE && rec->count)
+				rec->end_state = trace_tap_state(rec->out[rec->count - 1]);
+			return true;
+		case JTAG_TRACE_FLUSH:
+		case JTAG_TRACE_SLEEP:
+		case JTAG_TRACE_STABLECLOCKS:
+			p = trace_take(trace, 4);
+			if (!p)
+				break;
+			rec->count = le_to_h_u32(p);
+			return true;
+		default:
+			LOG_ERROR("unknown JTAG trace record %d at offset %zu",
+				rec->type, trace->pos - 1);
+			trace->pos = trace->size;
+			return false;
+	}
+
+	LOG_ERROR("JTAG trace truncated at offset %zu", trace->pos);
+	trace->pos = trace->size;
+	return false;
+}
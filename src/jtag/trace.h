@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/**
+ * @file
+ * Binary traces of the flushed JTAG command queue.
+ *
+ * A trace starts with an eight byte magic and is followed by one record
+ * per queued command, in queue order.  Every flush is closed by a
+ * JTAG_TRACE_FLUSH record carrying the result of the flush.  All words
+ * are little endian.
+ *
+ *   SCAN, TDI:          type, flags, end_state, u32 num_bits,
+ *                       out bits, [captured bits if TRACE_FLAG_CAPTURED]
+ *   TLR_RESET:          type, end_state
+ *   RUNTEST:            type, end_state, u32 num_cycles
+ *   RESET:              type, trst + 1, srst + 1
+ *   PATHMOVE:           type, u32 num_states, one byte per state
+ *   SLEEP:              type, u32 us
+ *   STABLECLOCKS:       type, u32 num_cycles
+ *   TMS:                type, u32 num_bits, bits
+ *   FLUSH:              type, u32 result
+ */
+
+#ifndef OPENOCD_JTAG_TRACE_H
+#define OPENOCD_JTAG_TRACE_H
+
+#include <jtag/jtag.h>
+
+struct jtag_command;
+
+#define JTAG_TRACE_MAGIC "OCDJTRC1"
+
+#define TRACE_FLAG_IR_SCAN  0x01
+#define TRACE_FLAG_CAPTURED 0x02
+
+enum jtag_trace_type {
+	JTAG_TRACE_FLUSH        = 0,
+	JTAG_TRACE_SCAN         = 1,
+	JTAG_TRACE_TLR_RESET    = 2,
+	JTAG_TRACE_RUNTEST      = 3,
+	JTAG_TRACE_RESET        = 4,
+	JTAG_TRACE_PATHMOVE     = 6,
+	JTAG_TRACE_SLEEP        = 7,
+	JTAG_TRACE_STABLECLOCKS = 8,
+	JTAG_TRACE_TMS          = 9,
+	JTAG_TRACE_TDI          = 10,
+};
+
+/** One decoded trace record; the data pointers point into the trace. */
+struct jtag_trace_record {
+	enum jtag_trace_type type;
+	bool ir_scan;
+	tap_state_t end_state;
+	/** Bits for scans and TMS, cycles for RUNTEST and STABLECLOCKS,
+	 * states for PATHMOVE, microseconds for SLEEP, result for FLUSH. */
+	uint32_t count;
+	int trst;
+	int srst;
+	/** Scan out bits, TMS bits or PATHMOVE states */
+	const uint8_t *out;
+	/** Captured scan bits, NULL if the scan captured nothing */
+	const uint8_t *in;
+};
+
+/** A trace loaded into memory for reading. */
+struct jtag_trace {
+	uint8_t *data;
+	size_t size;
+	size_t pos;
+};
+
+int jtag_trace_start(const char *filename);
+void jtag_trace_stop(void);
+const char *jtag_trace_recording(void);
+void jtag_trace_record_queue(const struct jtag_command *queue, int result);
+
+int jtag_trace_load(const char *filename, struct jtag_trace *trace);
+void jtag_trace_free(struct jtag_trace *trace);
+bool jtag_trace_next(struct jtag_trace *trace, struct jtag_trace_record *rec);
+
+#endif /* OPENOCD_JTAG_TRACE_H */
@@ -50,6 +50,14 @@
 #include <strings.h>
 #endif
 
+#if !IS_WIN32
+#include <sys/wait.h>
+#endif
+
+#ifdef HAVE_LIBUSB1
+#include <jtag/drivers/libusb_helper.h>
+#endif
+
 #ifdef PKGBLDDATE
 #define OPENOCD_VERSION	\
 	"Open On-Chip Debugger " VERSION RELSTR " (" PKGBLDDATE ")"
@@ -118,6 +126,8 @@ COMMAND_HANDLER(handle_noinit_command)
 	return ERROR_OK;
 }
 
+static int supervise_child_apply(struct command_context *cmd_ctx);
+
 /* OpenOCD can't really handle failure of this command. Patches welcome! :-) */
 COMMAND_HANDLER(handle_init_command)
 {
@@ -132,6 +142,11 @@ COMMAND_HANDLER(handle_init_command)
 
 	initialized = 1;
 
+	/* the configuration may run "init" itself */
+	retval = supervise_child_apply(CMD_CTX);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = command_run_line(CMD_CTX, "target init");
 	if (retval != ERROR_OK)
 		return ERROR_FAIL;
@@ -346,6 +361,188 @@ static struct command_context *setup_command_handler(Jim_Interp *interp)
 	return cmd_ctx;
 }
 
+/* Distance between the service ports of two supervised instances, large
+ * enough for the consecutive gdb ports of a multi-core chip. */
+#define SUPERVISE_PORT_STRIDE	100
+
+/* Adapter and index of this supervised instance, until its settings are
+ * applied. */
+static char *supervise_location;
+static unsigned int supervise_index;
+
+/* Turn the --supervise argument into a list of USB locations: either the
+ * explicit comma separated list, or every device matching <vid>:<pid>. */
+static int supervise_get_locations(const char *spec,
+		char ***locations, unsigned int *count)
+{
+	unsigned int vid, pid;
+	char dummy;
+
+	*locations = NULL;
+	*count = 0;
+
+	if (sscanf(spec, "%x:%x%c", &vid, &pid, &dummy) == 2) {
+#ifdef HAVE_LIBUSB1
+		return jtag_libusb_get_locations(vid, pid, locations, count);
+#else
+		LOG_ERROR("enumerating adapters requires libusb-1.x support");
+		return ERROR_NOT_IMPLEMENTED;
+#endif
+	}
+
+	char *list = strdup(spec);
+	if (!list)
+		return ERROR_FAIL;
+
+	char **out = NULL;
+	unsigned int n = 0;
+	for (char *loc = strtok(list, ","); loc; loc = strtok(NULL, ",")) {
+		char **tmp = realloc(out, (n + 1) * sizeof(*out));
+		if (!tmp)
+			break;
+		out = tmp;
+		out[n] = strdup(loc);
+		if (out[n])
+			n++;
+	}
+	free(list);
+
+	*locations = out;
+	*count = n;
+	return ERROR_OK;
+}
+
+/* Prepare a supervised instance before its configuration runs. The
+ * Anlogic target configs pick up the adapter through the USB_LOCATION
+ * variable. */
+static int supervise_child_setup(struct command_context *cmd_ctx,
+		const char *location, unsigned int index)
+{
+	supervise_location = strdup(location);
+	if (!supervise_location) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	supervise_index = index;
+
+	return command_run_linef(cmd_ctx, "set USB_LOCATION {%s}", location);
+}
+
+/* Bind a supervised instance to its adapter and give it its own service
+ * ports and log file. Runs after the configuration, so these win over any
+ * setting in it, but before "init" and the servers start. */
+static int supervise_child_apply(struct command_context *cmd_ctx)
+{
+	if (!supervise_location)
+		return ERROR_OK;
+
+	unsigned int offset = supervise_index * SUPERVISE_PORT_STRIDE;
+	int retval;
+
+	retval = command_run_linef(cmd_ctx, "log_output {openocd-%s.log}", supervise_location);
+	if (retval == ERROR_OK)
+		retval = command_run_linef(cmd_ctx, "adapter usb location {%s}", supervise_location);
+	if (retval == ERROR_OK)
+		retval = command_run_linef(cmd_ctx, "gdb_port %u", 3333 + offset);
+	if (retval == ERROR_OK)
+		retval = command_run_linef(cmd_ctx, "tcl_port %u", 6666 + offset);
+	if (retval == ERROR_OK)
+		retval = command_run_linef(cmd_ctx, "telnet_port %u", 4444 + offset);
+
+	free(supervise_location);
+	supervise_location = NULL;
+	return retval;
+}
+
+/**
+ * Supervisor mode for board farms: run one isolated OpenOCD instance per
+ * adapter, all with the same command line, and wait for all of them.
+ * Every instance is a forked copy of this process, so the whole JTAG,
+ * target and server state stays private to its adapter. That includes the
+ * image cache: each instance parses the image itself, only the file pages
+ * are shared through the host page cache.
+ *
+ * @param is_child set when this returns in a supervised instance, which
+ * must then carry on with the normal startup.
+ * @returns in the supervisor, ERROR_OK only if every instance succeeded.
+ */
+static int openocd_supervise(struct command_context *cmd_ctx,
+		const char *spec, bool *is_child)
+{
+	*is_child = false;
+
+#if IS_WIN32
+	LOG_ERROR("--supervise is not supported on this host");
+	return ERROR_NOT_IMPLEMENTED;
+#else
+	char **locations;
+	unsigned int count;
+	int retval = supervise_get_locations(spec, &locations, &count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (count == 0) {
+		LOG_ERROR("no adapter matches '%s'", spec);
+		free(locations);
+		return ERROR_FAIL;
+	}
+
+	pid_t *pids = calloc(count, sizeof(*pids));
+	if (!pids) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	/* flush before forking, or buffered output is emitted by every child */
+	fflush(stdout);
+	fflush(stderr);
+
+	for (unsigned int i = 0; i < count; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			LOG_ERROR("cannot start instance for adapter %s", locations[i]);
+			retval = ERROR_FAIL;
+			break;
+		}
+		if (pid == 0) {
+			*is_child = true;
+			retval = supervise_child_setup(cmd_ctx, locations[i], i);
+			goto done;
+		}
+		LOG_INFO("adapter %s: pid %d, gdb port %u, log openocd-%s.log",
+				locations[i], (int)pid, 3333 + i * SUPERVISE_PORT_STRIDE,
+				locations[i]);
+		pids[i] = pid;
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		int status;
+
+		if (pids[i] <= 0)
+			continue;
+		if (waitpid(pids[i], &status, 0) < 0) {
+			LOG_ERROR("adapter %s: lost track of instance", locations[i]);
+			retval = ERROR_FAIL;
+			continue;
+		}
+		if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+			LOG_INFO("adapter %s: done", locations[i]);
+		} else {
+			LOG_ERROR("adapter %s: failed (status 0x%x)", locations[i], status);
+			retval = ERROR_FAIL;
+		}
+	}
+
+done:
+	free(pids);
+	for (unsigned int i = 0; i < count; i++)
+		free(locations[i]);
+	free(locations);
+	return retval;
+#endif
+}
+
 /** OpenOCD runtime meat that can become single-thread in future. It parse
  * commandline, reads configuration, sets up the target and starts server loop.
  * Commandline arguments are passed into this function from openocd_main().
@@ -357,6 +554,13 @@ static int openocd_thread(int argc, char *argv[], struct command_context *cmd_ct
 	if (parse_cmdline_args(cmd_ctx, argc, argv) != ERROR_OK)
 		return ERROR_FAIL;
 
+	if (get_supervise_spec()) {
+		bool is_child;
+		ret = openocd_supervise(cmd_ctx, get_supervise_spec(), &is_child);
+		if (!is_child || ret != ERROR_OK)
+			return ret == ERROR_OK ? ERROR_OK : ERROR_FAIL;
+	}
+
 	if (server_preinit() != ERROR_OK)
 		return ERROR_FAIL;
 
@@ -369,6 +573,9 @@ static int openocd_thread(int argc, char *argv[], struct command_context *cmd_ct
 		return ERROR_FAIL;
 	}
 
+	if (supervise_child_apply(cmd_ctx) != ERROR_OK)
+		return ERROR_FAIL;
+
 	ret = server_init(cmd_ctx);
 	if (ret != ERROR_OK)
 		return ERROR_FAIL;
@@ -443,6 +650,8 @@ int openocd_main(int argc, char *argv[])
 
 	rtt_exit();
 	free_config();
+	free_supervise_spec();
+	free(supervise_location);
 
 	log_exit();
 
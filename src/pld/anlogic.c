@@ -0,0 +1,430 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+ * Configuration of Anlogic FPGAs, and of the PL of the DR1 SoCs, over JTAG.
+ *
+ * The bitstream goes through CFG_IN as one continuous DR stream.  The file
+ * is read in chunks and each chunk is queued as a plain DR scan that ends
+ * in DRPAUSE, so the next one carries on shifting without passing
+ * Update-DR; only one chunk is ever held in memory.  The bypass bits of
+ * the other TAPs on the chain are shifted once, before the first and after
+ * the last chunk, as a single DR scan would: CFG_IN takes every bit shifted
+ * through it, so padding each chunk would corrupt the stream.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "anlogic.h"
+#include "pld.h"
+#include <helper/log.h>
+#include <helper/system.h>
+
+#include <sys/stat.h>
+
+#define ANLOGIC_REFRESH		0x01
+#define ANLOGIC_IDCODE		0x06
+#define ANLOGIC_JTAG_PROGRAM	0x30
+#define ANLOGIC_CFG_IN		0x3b
+#define ANLOGIC_JTAG_START	0x3d
+#define ANLOGIC_BYPASS		0xff
+
+/* bytes per DR scan, the queue is run after each of them */
+#define ANLOGIC_CHUNK_SIZE	(1024 * 1024)
+#define ANLOGIC_STARTUP_CLOCKS	100
+
+struct anlogic_bit_reader {
+	FILE *input_file;
+	/* .bit files are records with a 16-bit length, .bin files are raw */
+	bool records;
+	uint32_t record_left;
+};
+
+static uint8_t anlogic_flip[256];
+
+static int anlogic_set_instr(struct jtag_tap *tap, uint32_t new_instr, uint8_t *capture)
+{
+	if (!tap)
+		return ERROR_FAIL;
+
+	if (capture || buf_get_u32(tap->cur_instr, 0, tap->ir_length) != new_instr) {
+		struct scan_field field;
+
+		field.num_bits = tap->ir_length;
+		void *t = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+		if (!t)
+			return ERROR_FAIL;
+		field.out_value = t;
+		buf_set_u32(t, 0, field.num_bits, new_instr);
+		field.in_value = capture;
+
+		/* the capture value is a status here, not a fixed pattern */
+		if (capture)
+			jtag_add_ir_scan_noverify(tap, &field, TAP_IDLE);
+		else
+			jtag_add_ir_scan(tap, &field, TAP_IDLE);
+
+		free(t);
+	}
+
+	return ERROR_OK;
+}
+
+static int anlogic_read_idcode(struct jtag_tap *tap, uint32_t *idcode)
+{
+	struct scan_field field;
+	uint8_t buf[4];
+
+	int retval = anlogic_set_instr(tap, ANLOGIC_IDCODE, NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	field.num_bits = 32;
+	field.out_value = NULL;
+	field.in_value = buf;
+	jtag_add_dr_scan(tap, 1, &field, TAP_IDLE);
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	*idcode = le_to_h_u32(buf);
+	return ERROR_OK;
+}
+
+static int anlogic_read_stat(struct pld_device *pld_device, uint32_t *status)
+{
+	struct anlogic_pld_device *anlogic_info = pld_device->driver_priv;
+	uint8_t buf[4] = { 0 };
+
+	int retval = anlogic_set_instr(anlogic_info->tap, ANLOGIC_BYPASS, buf);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	*status = buf_get_u32(buf, 0, anlogic_info->tap->ir_length);
+	LOG_DEBUG("status: 0x%2.2" PRIx32, *status);
+
+	return ERROR_OK;
+}
+
+static int anlogic_open(struct anlogic_bit_reader *reader, const char *filename)
+{
+	struct stat input_stat;
+	const char *ext = strrchr(filename, '.');
+	int c;
+
+	if (stat(filename, &input_stat) == -1) {
+		LOG_ERROR("couldn't stat() %s: %s", filename, strerror(errno));
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	if (S_ISDIR(input_stat.st_mode)) {
+		LOG_ERROR("%s is a directory", filename);
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	reader->input_file = fopen(filename, "rb");
+	if (!reader->input_file) {
+		LOG_ERROR("couldn't open %s: %s", filename, strerror(errno));
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	reader->records = ext && !strcasecmp(ext, ".bit");
+	reader->record_left = 0;
+	if (!reader->records)
+		return ERROR_OK;
+
+	/* skip the "# key: value" text header */
+	while ((c = fgetc(reader->input_file)) != EOF) {
+		if (c == '#') {
+			while ((c = fgetc(reader->input_file)) != EOF && c != '\n')
+				;
+		} else if (c != '\r' && c != '\n') {
+			ungetc(c, reader->input_file);
+			break;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* Read up to @a size bytes of configuration data, returns 0 at the end */
+static int anlogic_read(struct anlogic_bit_reader *reader, uint8_t *buffer, size_t size)
+{
+	size_t count = 0;
+
+	while (count < size) {
+		size_t n = size - count;
+
+		if (reader->records) {
+			if (!reader->record_left) {
+				uint8_t len[2];
+				size_t r = fread(len, 1, 2, reader->input_file);
+
+				if (r == 0 && feof(reader->input_file))
+					break;
+				if (r != 2) {
+					LOG_ERROR("truncated bitstream record");
+					return ERROR_PLD_FILE_LOAD_FAILED;
+				}
+				/* length is in bits */
+				reader->record_left = be_to_h_u16(len) >> 3;
+				continue;
+			}
+			n = MIN(n, reader->record_left);
+		}
+
+		size_t r = fread(buffer + count, 1, n, reader->input_file);
+		if (r != n && ferror(reader->input_file)) {
+			LOG_ERROR("error reading bitstream: %s", strerror(errno));
+			return ERROR_PLD_FILE_LOAD_FAILED;
+		}
+		if (reader->records) {
+			if (r != n) {
+				LOG_ERROR("truncated bitstream record");
+				return ERROR_PLD_FILE_LOAD_FAILED;
+			}
+			reader->record_left -= r;
+		}
+		count += r;
+		if (r != n)
+			break;
+	}
+
+	/* configuration data is shifted MSB first */
+	for (size_t i = 0; i < count; i++)
+		buffer[i] = anlogic_flip[buffer[i]];
+
+	return count;
+}
+
+/* Shift the bypass bits of the TAPs before (leading) or after tap on the
+ * chain, all other TAPs being in BYPASS. */
+static int anlogic_add_bypass_bits(struct jtag_tap *tap, bool leading)
+{
+	unsigned int num_bits = 0;
+	bool before = true;
+
+	for (struct jtag_tap *t = jtag_tap_next_enabled(NULL); t; t = jtag_tap_next_enabled(t)) {
+		if (t == tap)
+			before = false;
+		else if (before == leading)
+			num_bits++;
+	}
+	if (!num_bits)
+		return ERROR_OK;
+
+	uint8_t *zeros = calloc(DIV_ROUND_UP(num_bits, 8), 1);
+	if (!zeros) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	jtag_add_plain_dr_scan(num_bits, zeros, NULL, TAP_DRPAUSE);
+	free(zeros);
+	return ERROR_OK;
+}
+
+static int anlogic_load(struct pld_device *pld_device, const char *filename)
+{
+	struct anlogic_pld_device *anlogic_info = pld_device->driver_priv;
+	struct jtag_tap *tap = anlogic_info->tap;
+	struct anlogic_bit_reader reader;
+	uint32_t idcode, idcode_after, status;
+	size_t total = 0;
+	uint8_t *buffer;
+	int retval, n;
+
+	retval = anlogic_open(&reader, filename);
+	if (retval != ERROR_OK)
+		return retval;
+
+	buffer = malloc(ANLOGIC_CHUNK_SIZE);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		fclose(reader.input_file);
+		return ERROR_FAIL;
+	}
+
+	jtag_add_tlr();
+	retval = anlogic_read_idcode(tap, &idcode);
+	if (retval != ERROR_OK)
+		goto out;
+
+	/* clear the current configuration */
+	retval = anlogic_set_instr(tap, ANLOGIC_REFRESH, NULL);
+	if (retval != ERROR_OK)
+		goto out;
+	jtag_add_runtest(15, TAP_IDLE);
+	retval = anlogic_set_instr(tap, ANLOGIC_JTAG_PROGRAM, NULL);
+	if (retval != ERROR_OK)
+		goto out;
+	jtag_add_runtest(15, TAP_IDLE);
+	jtag_add_sleep(1000);
+
+	retval = anlogic_set_instr(tap, ANLOGIC_CFG_IN, NULL);
+	if (retval != ERROR_OK)
+		goto out;
+	retval = anlogic_add_bypass_bits(tap, true);
+	if (retval != ERROR_OK)
+		goto out;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	while ((n = anlogic_read(&reader, buffer, ANLOGIC_CHUNK_SIZE)) > 0) {
+		jtag_add_plain_dr_scan(n * 8, buffer, NULL, TAP_DRPAUSE);
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+		total += n;
+		LOG_DEBUG("%zu bytes of configuration data sent", total);
+	}
+	if (n < 0) {
+		retval = n;
+		goto out;
+	}
+	if (!total) {
+		LOG_ERROR("no configuration data in %s", filename);
+		retval = ERROR_PLD_FILE_LOAD_FAILED;
+		goto out;
+	}
+	retval = anlogic_add_bypass_bits(tap, false);
+	if (retval != ERROR_OK)
+		goto out;
+
+	retval = anlogic_set_instr(tap, ANLOGIC_JTAG_START, NULL);
+	if (retval != ERROR_OK)
+		goto out;
+	jtag_add_runtest(ANLOGIC_STARTUP_CLOCKS, TAP_IDLE);
+
+	retval = anlogic_read_stat(pld_device, &status);
+	if (retval != ERROR_OK)
+		goto out;
+
+	retval = anlogic_read_idcode(tap, &idcode_after);
+	if (retval != ERROR_OK)
+		goto out;
+	retval = anlogic_set_instr(tap, ANLOGIC_BYPASS, NULL);
+	if (retval != ERROR_OK)
+		goto out;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	if (idcode_after != idcode) {
+		LOG_ERROR("IDCODE changed from 0x%8.8" PRIx32 " to 0x%8.8" PRIx32
+			" during configuration, the scan chain is broken", idcode, idcode_after);
+		retval = ERROR_PLD_FILE_LOAD_FAILED;
+		goto out;
+	}
+
+	if ((status & anlogic_info->done_mask) != anlogic_info->done_value) {
+		LOG_ERROR("configuration failed, status 0x%2.2" PRIx32 " (want 0x%2.2" PRIx32
+			" under mask 0x%2.2" PRIx32 ")",
+			status, anlogic_info->done_value, anlogic_info->done_mask);
+		retval = ERROR_PLD_FILE_LOAD_FAILED;
+		goto out;
+	}
+
+	LOG_INFO("%zu bytes of configuration data sent, status 0x%2.2" PRIx32, total, status);
+
+out:
+	free(buffer);
+	fclose(reader.input_file);
+	return retval;
+}
+
+COMMAND_HANDLER(anlogic_handle_read_stat_command)
+{
+	struct pld_device *device;
+	uint32_t status;
+
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned dev_id;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], dev_id);
+	device = get_pld_device_by_num(dev_id);
+	if (!device || strcmp(device->driver->name, "anlogic")) {
+		command_print(CMD, "pld device '#%s' is not an anlogic device", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	int retval = anlogic_read_stat(device, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	command_print(CMD, "anlogic status: 0x%2.2" PRIx32, status);
+
+	return ERROR_OK;
+}
+
+PLD_DEVICE_COMMAND_HANDLER(anlogic_pld_device_command)
+{
+	struct jtag_tap *tap;
+	struct anlogic_pld_device *anlogic_info;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	tap = jtag_tap_by_string(CMD_ARGV[1]);
+	if (!tap) {
+		command_print(CMD, "Tap: %s does not exist", CMD_ARGV[1]);
+		return ERROR_FAIL;
+	}
+
+	anlogic_info = calloc(1, sizeof(struct anlogic_pld_device));
+	if (!anlogic_info) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	anlogic_info->tap = tap;
+
+	if (CMD_ARGC >= 3) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], anlogic_info->done_mask);
+		anlogic_info->done_value = anlogic_info->done_mask;
+	}
+	if (CMD_ARGC >= 4)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], anlogic_info->done_value);
+
+	for (unsigned int i = 0; i < 256; i++)
+		anlogic_flip[i] = flip_u32(i, 8);
+
+	pld->driver_priv = anlogic_info;
+
+	return ERROR_OK;
+}
+
+static const struct command_registration anlogic_exec_command_handlers[] = {
+	{
+		.name = "read_stat",
+		.mode = COMMAND_EXEC,
+		.handler = anlogic_handle_read_stat_command,
+		.help = "read the configuration status from Capture-IR",
+		.usage = "pld_num",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration anlogic_command_handler[] = {
+	{
+		.name = "anlogic",
+		.mode = COMMAND_ANY,
+		.help = "Anlogic FPGA specific commands",
+		.usage = "",
+		.chain = anlogic_exec_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+struct pld_driver anlogic_pld = {
+	.name = "anlogic",
+	.commands = anlogic_command_handler,
+	.pld_device_command = &anlogic_pld_device_command,
+	.load = &anlogic_load,
+};
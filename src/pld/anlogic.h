@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_PLD_ANLOGIC_H
+#define OPENOCD_PLD_ANLOGIC_H
+
+#include <jtag/jtag.h>
+
+struct anlogic_pld_device {
+	struct jtag_tap *tap;
+	/* Capture-IR bits that must match done_value once configured */
+	uint32_t done_mask;
+	uint32_t done_value;
+};
+
+#endif /* OPENOCD_PLD_ANLOGIC_H */
@@ -28,9 +28,11 @@
 
 /* pld drivers
  */
+extern struct pld_driver anlogic_pld;
 extern struct pld_driver virtex2_pld;
 
 static struct pld_driver *pld_drivers[] = {
+	&anlogic_pld,
 	&virtex2_pld,
 	NULL,
 };
@@ -45,6 +45,8 @@ struct freertos_thread_entry {
 	struct list_head list;
 	threadid_t threadid;
 	target_addr_t tcb;
+	/* Task name as read during the last list walk. */
+	char *name;
 };
 
 struct FreeRTOS {
@@ -55,6 +57,14 @@ struct FreeRTOS {
 	 * work well with thread id's that are greater than 32 bits.
 	 */
 	struct list_head thread_entry_list;
+	/* Threads found by the last list walk, in walk order.  The walk is
+	 * skipped while uxTaskNumber and uxCurrentNumberOfTasks are unchanged,
+	 * as no task can have been created or deleted. */
+	struct freertos_thread_entry **walk;
+	unsigned int walk_count;
+	bool walk_valid;
+	uint64_t walk_task_number;
+	uint64_t walk_thread_count;
 	/* sizeof(UBaseType_t) */
 	unsigned ubasetype_size;
 	/* sizeof(void *) */
@@ -71,6 +81,7 @@ struct FreeRTOS {
 	unsigned list_next_size;
 	unsigned thread_stack_offset;
 	unsigned thread_stack_size;
+	unsigned thread_state_item_offset;
 	unsigned thread_name_offset;
 };
 
@@ -239,6 +250,7 @@ enum freertos_symbol_values {
 	FREERTOS_VAL_X_SUSPENDED_TASK_LIST = 8,
 	FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS = 9,
 	FREERTOS_VAL_UX_TOP_USED_PRIORITY = 10,
+	FREERTOS_VAL_UX_TASK_NUMBER = 11,
 };
 
 struct symbols {
@@ -258,6 +270,7 @@ static const struct symbols freertos_symbol_list[] = {
 	{ "xSuspendedTaskList", true }, /* Only if INCLUDE_vTaskSuspend */
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
+	{ "uxTaskNumber", true }, /* Bumped on every task creation */
 	{ NULL, false }
 };
 
@@ -408,6 +421,7 @@ static void freertos_compute_offsets(struct rtos *rtos)
 		freertos, task_control_block_info, ARRAY_SIZE(task_control_block_info));
 	freertos->thread_stack_offset = task_control_block_info[0].offset;
 	freertos->thread_stack_size = task_control_block_info[0].size;
+	freertos->thread_state_item_offset = task_control_block_info[1].offset;
 	freertos->thread_name_offset = task_control_block_info[5].offset;
 }
 
@@ -433,6 +447,115 @@ struct freertos_thread_entry *thread_entry_list_find_by_id(
 	return NULL;
 }
 
+static void freertos_fill_thread_detail(struct rtos *rtos, struct thread_detail *detail,
+		const struct freertos_thread_entry *entry, target_addr_t current_tcb)
+{
+	detail->threadid = entry->threadid;
+	detail->exists = true;
+	detail->thread_name_str = strdup(entry->name ? entry->name : "No Name");
+	detail->extra_info_str = NULL;
+
+	if (entry->tcb == current_tcb) {
+		rtos->current_thread = entry->threadid;
+		detail->extra_info_str = strdup("State: Running");
+	}
+}
+
+/* Rebuild the thread list from the last walk, without touching the target.
+ * Returns false if the current task isn't part of that walk. */
+static bool freertos_reuse_walk(struct rtos *rtos, target_addr_t current_tcb)
+{
+	struct FreeRTOS *freertos = (struct FreeRTOS *) rtos->rtos_specific_params;
+	unsigned int i;
+
+	for (i = 0; i < freertos->walk_count; i++) {
+		if (freertos->walk[i]->tcb == current_tcb)
+			break;
+	}
+	if (i == freertos->walk_count)
+		return false;
+
+	rtos_free_threadlist(rtos);
+	rtos->thread_details = calloc(freertos->walk_count, sizeof(struct thread_detail));
+	if (!rtos->thread_details)
+		return false;
+
+	for (i = 0; i < freertos->walk_count; i++)
+		freertos_fill_thread_detail(rtos, &rtos->thread_details[i],
+				freertos->walk[i], current_tcb);
+	rtos->thread_count = freertos->walk_count;
+	return true;
+}
+
+/* Read the list item at list_elem_ptr, returning the TCB that owns it, the
+ * next list item and the task name (FREERTOS_THREAD_NAME_STR_SIZE bytes). */
+static int freertos_read_task(struct rtos *rtos, target_addr_t list_elem_ptr,
+		target_addr_t *tcb, target_addr_t *next, char *name)
+{
+	struct FreeRTOS *freertos = (struct FreeRTOS *) rtos->rtos_specific_params;
+	uint64_t value;
+	int retval;
+
+	/* Tasks are linked through xStateListItem everywhere except in
+	 * xPendingReadyList, so guess that the item lives in the TCB at that
+	 * offset and fetch the TCB up to the end of the name in one read. */
+	if (list_elem_ptr >= freertos->thread_state_item_offset) {
+		target_addr_t guess = list_elem_ptr - freertos->thread_state_item_offset;
+		unsigned int size = freertos->thread_name_offset + FREERTOS_THREAD_NAME_STR_SIZE;
+		uint8_t *buf = malloc(size);
+
+		if (buf && target_read_buffer(rtos->target, guess, size, buf) == ERROR_OK) {
+			const uint8_t *item = buf + freertos->thread_state_item_offset;
+			*tcb = buf_get_u64(item + freertos->list_elem_content_offset, 0,
+					freertos->list_elem_content_size * 8);
+			*next = buf_get_u64(item + freertos->list_elem_next_offset, 0,
+					freertos->list_elem_next_size * 8);
+			if (*tcb == guess) {
+				memcpy(name, buf + freertos->thread_name_offset, FREERTOS_THREAD_NAME_STR_SIZE);
+				free(buf);
+				return ERROR_OK;
+			}
+			free(buf);
+			retval = target_read_buffer(rtos->target, *tcb + freertos->thread_name_offset,
+					FREERTOS_THREAD_NAME_STR_SIZE, (uint8_t *)name);
+			if (retval != ERROR_OK)
+				LOG_ERROR("Error reading thread name in FreeRTOS thread list");
+			return retval;
+		}
+		free(buf);
+	}
+
+	retval = freertos_read_struct_value(rtos->target,
+										list_elem_ptr,
+										freertos->list_elem_content_offset,
+										freertos->list_elem_content_size,
+										&value);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
+		return retval;
+	}
+	*tcb = value;
+
+	retval = target_read_buffer(rtos->target, *tcb + freertos->thread_name_offset,
+			FREERTOS_THREAD_NAME_STR_SIZE, (uint8_t *)name);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading thread name in FreeRTOS thread list");
+		return retval;
+	}
+
+	retval = freertos_read_struct_value(rtos->target,
+										list_elem_ptr,
+										freertos->list_elem_next_offset,
+										freertos->list_elem_next_size,
+										&value);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
+		return retval;
+	}
+	*next = value;
+	return ERROR_OK;
+}
+
 static int freertos_update_threads(struct rtos *rtos)
 {
 	int retval;
@@ -470,9 +593,6 @@ static int freertos_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* wipe out previous thread details if any */
-	rtos_free_threadlist(rtos);
-
 	/* read the current thread */
 	target_addr_t pxCurrentTCB;
 	retval = freertos_read_struct_value(rtos->target,
@@ -488,6 +608,33 @@ static int freertos_update_threads(struct rtos *rtos)
 										rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
 										pxCurrentTCB);
 
+	/* uxTaskNumber is bumped whenever a task is created, and deleting a task
+	 * lowers uxCurrentNumberOfTasks, so if neither moved the set of TCBs is
+	 * the one found by the last walk. */
+	uint64_t task_number = 0;
+	bool have_task_number = false;
+	if (rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address != 0) {
+		retval = freertos_read_struct_value(rtos->target,
+											rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address,
+											0,
+											freertos->ubasetype_size,
+											&task_number);
+		have_task_number = retval == ERROR_OK;
+	}
+
+	if (have_task_number && pxCurrentTCB != 0 && freertos->walk_valid &&
+			task_number == freertos->walk_task_number &&
+			thread_list_size == freertos->walk_thread_count &&
+			freertos_reuse_walk(rtos, pxCurrentTCB)) {
+		LOG_DEBUG("FreeRTOS: uxTaskNumber %" PRIu64 " unchanged, reusing %u cached threads",
+				  task_number, freertos->walk_count);
+		return ERROR_OK;
+	}
+
+	/* wipe out previous thread details if any */
+	rtos_free_threadlist(rtos);
+	freertos->walk_valid = false;
+
 	if ((thread_list_size == 0) || (pxCurrentTCB == 0)) {
 		/* Either : No RTOS threads - there is always at least the current execution though */
 		/* OR     : No current thread - all threads suspended - show the current execution
@@ -521,6 +668,15 @@ static int freertos_update_threads(struct rtos *rtos)
 		}
 	}
 
+	struct freertos_thread_entry **walk = realloc(freertos->walk,
+			sizeof(*walk) * thread_list_size);
+	if (!walk) {
+		LOG_ERROR("Error allocating memory for %" PRIu64 " threads", thread_list_size);
+		return ERROR_FAIL;
+	}
+	freertos->walk = walk;
+	freertos->walk_count = 0;
+
 	/* Find out how many lists are needed to be read from pxReadyTasksLists, */
 	uint64_t top_used_priority = 0;
 	if (rtos->symbols[FREERTOS_VAL_UX_TOP_USED_PRIORITY].address == 0) {
@@ -556,8 +712,12 @@ static int freertos_update_threads(struct rtos *rtos)
 
 	symbol_address_t *list_of_lists =
 		malloc(sizeof(symbol_address_t) * (config_max_priorities + 5));
-	if (!list_of_lists) {
+	uint8_t *list_headers =
+		calloc(config_max_priorities + 5, freertos->list_width);
+	if (!list_of_lists || !list_headers) {
 		LOG_ERROR("Error allocating memory for %u priorities", config_max_priorities);
+		free(list_of_lists);
+		free(list_headers);
 		return ERROR_FAIL;
 	}
 
@@ -572,96 +732,77 @@ static int freertos_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
 
+	/* pxReadyTasksLists is an array, so all the ready list headers come in
+	 * one read; the other lists are separate variables. */
+	retval = ERROR_OK;
+	if (list_of_lists[0] != 0)
+		retval = target_read_buffer(rtos->target, list_of_lists[0],
+				config_max_priorities * freertos->list_width, list_headers);
+	for (unsigned int i = config_max_priorities; i < num_lists && retval == ERROR_OK; i++) {
+		if (list_of_lists[i] == 0)
+			continue;
+		retval = target_read_buffer(rtos->target, list_of_lists[i], freertos->list_width,
+				list_headers + i * freertos->list_width);
+	}
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread lists");
+		goto done;
+	}
+
 	rtos->current_thread = 0;
 	for (unsigned int i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
-		/* Read the number of threads in this list */
-		uint64_t list_thread_count = 0;
-		retval = freertos_read_struct_value(rtos->target,
-											list_of_lists[i],
-											freertos->list_uxNumberOfItems_offset,
-											freertos->list_uxNumberOfItems_size,
-											&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		const uint8_t *header = list_headers + i * freertos->list_width;
+		uint64_t list_thread_count = buf_get_u64(header + freertos->list_uxNumberOfItems_offset,
+				0, freertos->list_uxNumberOfItems_size * 8);
 		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu64,
 										i, list_of_lists[i], list_thread_count);
 
 		if (list_thread_count == 0)
 			continue;
 
-		/* Read the location of first list item */
+		/* Location of first list item */
 		target_addr_t prev_list_elem_ptr = -1;
-		target_addr_t list_elem_ptr = 0;
-		retval = freertos_read_struct_value(rtos->target,
-											list_of_lists[i],
-											freertos->list_next_offset,
-											freertos->list_next_size,
-											&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		target_addr_t list_elem_ptr = buf_get_u64(header + freertos->list_next_offset,
+				0, freertos->list_next_size * 8);
 		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx64,
 				  i, list_of_lists[i] + freertos->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			rtos->thread_details[tasks_found].threadid = 0;
 			target_addr_t tcb;
-			retval = freertos_read_struct_value(rtos->target,
-												list_elem_ptr,
-												freertos->list_elem_content_offset,
-												freertos->list_elem_content_size,
-												&tcb);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			target_addr_t next_list_elem_ptr;
+			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
+
+			retval = freertos_read_task(rtos, list_elem_ptr, &tcb, &next_list_elem_ptr, tmp_str);
+			if (retval != ERROR_OK)
+				goto done;
 
-			const struct freertos_thread_entry *value =
+			struct freertos_thread_entry *value =
 				thread_entry_list_find_by_tcb(&freertos->thread_entry_list, tcb);
 
 			if (!value) {
-				struct freertos_thread_entry *new_value = calloc(1, sizeof(struct freertos_thread_entry));
-				new_value->tcb = tcb;
+				value = calloc(1, sizeof(struct freertos_thread_entry));
+				if (!value) {
+					LOG_ERROR("Error allocating memory for FreeRTOS thread");
+					retval = ERROR_FAIL;
+					goto done;
+				}
+				value->tcb = tcb;
 				/* threadid can't be 0. */
-				new_value->threadid = ++freertos->last_threadid;
+				value->threadid = ++freertos->last_threadid;
 
-				list_add_tail(&new_value->list, &freertos->thread_entry_list);
-				value = new_value;
+				list_add_tail(&value->list, &freertos->thread_entry_list);
 			}
 
-			rtos->thread_details[tasks_found].threadid = value->threadid;
-
 			LOG_DEBUG("FreeRTOS: Thread %" PRId64 " has TCB 0x%" TARGET_PRIxADDR
 					  "; read from 0x%" PRIx64,
 					  value->threadid, value->tcb,
 					  list_elem_ptr + freertos->list_elem_content_offset);
 
-			/* get thread name */
-
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					value->tcb + freertos->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
 			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
 			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
 										value->tcb + freertos->thread_name_offset,
@@ -670,36 +811,18 @@ static int freertos_update_threads(struct rtos *rtos)
 			if (tmp_str[0] == '\x00')
 				strcpy(tmp_str, "No Name");
 
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-			rtos->thread_details[tasks_found].exists = true;
-
-			if (value->tcb == pxCurrentTCB) {
-				char running_str[] = "State: Running";
-				rtos->current_thread = value->threadid;
-				rtos->thread_details[tasks_found].extra_info_str = malloc(
-						sizeof(running_str));
-				strcpy(rtos->thread_details[tasks_found].extra_info_str,
-					running_str);
-			} else
-				rtos->thread_details[tasks_found].extra_info_str = NULL;
+			free(value->name);
+			value->name = strdup(tmp_str);
+			freertos->walk[freertos->walk_count++] = value;
+
+			freertos_fill_thread_detail(rtos, &rtos->thread_details[tasks_found],
+					value, pxCurrentTCB);
 
 			tasks_found++;
 			list_thread_count--;
 
 			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = freertos_read_struct_value(rtos->target,
-												prev_list_elem_ptr,
-												freertos->list_elem_next_offset,
-												freertos->list_elem_next_size,
-												&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			list_elem_ptr = next_list_elem_ptr;
 			LOG_DEBUG("FreeRTOS: Read next thread location at " TARGET_ADDR_FMT
 					  ", value " TARGET_ADDR_FMT,
 					  prev_list_elem_ptr + freertos->list_elem_next_offset,
@@ -707,9 +830,16 @@ static int freertos_update_threads(struct rtos *rtos)
 		}
 	}
 
+	freertos->walk_valid = have_task_number && pxCurrentTCB != 0 &&
+		tasks_found == thread_list_size;
+	freertos->walk_task_number = task_number;
+	freertos->walk_thread_count = thread_list_size;
+
+done:
 	free(list_of_lists);
+	free(list_headers);
 	rtos->thread_count = tasks_found;
-	return 0;
+	return retval;
 }
 
 static int freertos_get_stacking_info(struct rtos *rtos, threadid_t thread_id,
@@ -36,7 +36,7 @@
 #define LINUX_USER_KERNEL_BORDER 0xc0000000
 #include "linux_header.h"
 #define PHYS
-#define MAX_THREADS 200
+#define MAX_THREADS 32768
 /*  specific task  */
 struct linux_os {
 	const char *name;
@@ -49,6 +49,10 @@ struct linux_os {
 	int threads_needs_update;
 	struct current_thread *current_threads;
 	struct threads *thread_list;
+	/*  total_forks and nr_threads seen by the last complete task walk */
+	int threads_generation_valid;
+	uint32_t total_forks;
+	uint32_t nr_threads;
 	/*  virt2phys parameter */
 	uint32_t phys_mask;
 	uint32_t phys_base;
@@ -75,6 +79,7 @@ struct threads {
 	int status;		/* dead = 1 alive = 2 current = 3 alive and current */
 	/*  value that should not change during the live of a thread ? */
 	uint32_t thread_info_addr;	/*  contain latest thread_info_addr computed */
+	uint32_t next_base_addr;	/*  next task in the task list, read by fill_task */
 	/*  retrieve from thread_info */
 	struct cpu_context *context;
 	struct threads *next;
@@ -239,8 +244,12 @@ static bool linux_os_detect(struct target *target)
 static int linux_os_smp_init(struct target *target);
 static int linux_os_clean(struct target *target);
 #define INIT_TASK 0
+#define TOTAL_FORKS 1
+#define NR_THREADS 2
 static const char * const linux_symbol_list[] = {
 	"init_task",
+	"total_forks",		/*  optional: generation check for the task list */
+	"nr_threads",		/*  optional: generation check for the task list */
 	NULL
 };
 
@@ -250,8 +259,10 @@ static int linux_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list
 	*symbol_list = (struct symbol_table_elem *)
 		calloc(ARRAY_SIZE(linux_symbol_list), sizeof(struct symbol_table_elem));
 
-	for (i = 0; i < ARRAY_SIZE(linux_symbol_list); i++)
+	for (i = 0; i < ARRAY_SIZE(linux_symbol_list); i++) {
 		(*symbol_list)[i].symbol_name = linux_symbol_list[i];
+		(*symbol_list)[i].optional = i != INIT_TASK;
+	}
 
 	return 0;
 }
@@ -291,58 +302,81 @@ int fill_task_pid(struct target *target, struct threads *t)
 }
 #endif
 
+/*  task_struct fields read by fill_task() */
+static const struct {
+	uint32_t offset;
+	uint32_t size;
+} task_fields[] = {
+	{ 0, 4 },		/*  state */
+	{ QAT, 4 },		/*  stack, i.e. thread_info */
+	{ ONCPU, 4 },
+	{ NEXT, 4 },
+	{ MEM, 4 },
+	{ PID, 4 },
+	{ COMM, 16 },
+};
+
+/*  fields closer than this are fetched with one read, gap included */
+#define TASK_FIELDS_MAX_GAP 64
+
+/*  read everything needed about a task, including its name and the next
+ *  task in the list, with one read per window of task_fields */
 static int fill_task(struct target *target, struct threads *t)
 {
-	int retval;
-	uint32_t pid_addr = t->base_addr + PID;
-	uint32_t mem_addr = t->base_addr + MEM;
-	uint32_t on_cpu = t->base_addr + ONCPU;
-	uint8_t *buffer = calloc(1, 4);
-	retval = fill_buffer(target, t->base_addr, buffer);
+	int retval = ERROR_OK;
+	uint32_t window_size = 0;
+	unsigned int i;
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->state = val;
-	} else
-		LOG_ERROR("fill_task: unable to read memory");
+	for (i = 0; i < ARRAY_SIZE(task_fields); i++)
+		window_size = MAX(window_size, task_fields[i].offset + task_fields[i].size);
 
-	retval = fill_buffer(target, pid_addr, buffer);
+	uint8_t *window = calloc(1, window_size);
+	if (!window)
+		return ERROR_FAIL;
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->pid = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
+	i = 0;
+	while ((i < ARRAY_SIZE(task_fields)) && (retval == ERROR_OK)) {
+		uint32_t start = task_fields[i].offset;
+		uint32_t end = start + task_fields[i].size;
 
-	retval = fill_buffer(target, on_cpu, buffer);
+		for (i++; i < ARRAY_SIZE(task_fields); i++) {
+			if (task_fields[i].offset > end + TASK_FIELDS_MAX_GAP)
+				break;
+			start = MIN(start, task_fields[i].offset);
+			end = MAX(end, task_fields[i].offset + task_fields[i].size);
+		}
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
-		t->oncpu = val;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
+		retval = linux_read_memory(target, t->base_addr + start, 4,
+				(end - start) / 4, window + start);
+	}
 
-	retval = fill_buffer(target, mem_addr, buffer);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("fill task: unable to read memory");
+		free(window);
+		return retval;
+	}
 
-	if (retval == ERROR_OK) {
-		uint32_t val = get_buffer(target, buffer);
+	t->state = get_buffer(target, window);
+	t->thread_info_addr = get_buffer(target, window + QAT);
+	t->oncpu = get_buffer(target, window + ONCPU);
+	t->next_base_addr = get_buffer(target, window + NEXT) - NEXT;
+	t->pid = get_buffer(target, window + PID);
+	memcpy(t->name, window + COMM, 16);
+	t->name[16] = 0;
 
-		if (val != 0) {
-			uint32_t asid_addr = val + MM_CTX;
-			retval = fill_buffer(target, asid_addr, buffer);
+	uint32_t mm = get_buffer(target, window + MEM);
+	free(window);
 
-			if (retval == ERROR_OK) {
-				val = get_buffer(target, buffer);
-				t->asid = val;
-			} else
-				LOG_ERROR
-					("fill task: unable to read memory -- ASID");
-		} else
-			t->asid = 0;
-	} else
-		LOG_ERROR("fill task: unable to read memory");
+	t->asid = 0;
+	if (mm != 0) {
+		uint8_t buffer[4];
+		retval = fill_buffer(target, mm + MM_CTX, buffer);
 
-	free(buffer);
+		if (retval == ERROR_OK)
+			t->asid = get_buffer(target, buffer);
+		else
+			LOG_ERROR("fill task: unable to read memory -- ASID");
+	}
 
 	return retval;
 }
@@ -456,11 +490,9 @@ static int get_current(struct target *target, int create)
 					t = calloc(1, sizeof(struct threads));
 					t->base_addr = ct->TS;
 					fill_task(target, t);
-					get_name(target, t);
 					t->oncpu = cpu;
 					insert_into_threadlist(target, t);
 					t->status = 3;
-					t->thread_info_addr = 0xdeadbeef;
 					ct->threadid = t->threadid;
 					linux_os->thread_count++;
 #ifdef PID_CHECK
@@ -483,8 +515,9 @@ static struct cpu_context *cpu_context_read(struct target *target, uint32_t base
 	uint32_t *thread_info_addr_old)
 {
 	struct cpu_context *context = calloc(1, sizeof(struct cpu_context));
-	uint32_t preempt_count_addr = 0;
-	uint32_t registers[10];
+	/*  preempt_count and cpu_context come from one read of thread_info */
+	uint8_t info[MAX(PREEMPT + 4, CPU_CONT + 40) - MIN(PREEMPT, CPU_CONT)];
+	const uint8_t *registers = info + CPU_CONT - MIN(PREEMPT, CPU_CONT);
 	uint8_t *buffer = calloc(1, 4);
 	uint32_t stack = base_addr + QAT;
 	uint32_t thread_info_addr = 0;
@@ -514,11 +547,12 @@ retry:
 	} else
 		thread_info_addr = *thread_info_addr_old;
 
-	preempt_count_addr = thread_info_addr + PREEMPT;
-	retval = fill_buffer(target, preempt_count_addr, buffer);
+	retval = linux_read_memory(target, thread_info_addr + MIN(PREEMPT, CPU_CONT),
+			4, sizeof(info) / 4, info);
 
 	if (retval == ERROR_OK)
-		context->preempt_count = get_buffer(target, buffer);
+		context->preempt_count =
+			get_buffer(target, info + PREEMPT - MIN(PREEMPT, CPU_CONT));
 	else {
 		if (*thread_info_addr_old != 0xdeadbeef) {
 			LOG_ERROR
@@ -532,40 +566,21 @@ retry:
 			goto retry;
 		}
 
-		LOG_ERROR("cpu_context: unable to read memory");
-	}
-
-	thread_info_addr += CPU_CONT;
-
-	retval = linux_read_memory(target, thread_info_addr, 4, 10,
-			(uint8_t *) registers);
-
-	if (retval != ERROR_OK) {
 		free(buffer);
 		LOG_ERROR("cpu_context: unable to read memory\n");
 		return context;
 	}
 
-	context->R4 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[0]);
-	context->R5 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[1]);
-	context->R6 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[2]);
-	context->R7 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[3]);
-	context->R8 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[4]);
-	context->R9 =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[5]);
-	context->IP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[6]);
-	context->FP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[7]);
-	context->SP =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[8]);
-	context->PC =
-		target_buffer_get_u32(target, (const uint8_t *)&registers[9]);
+	context->R4 = get_buffer(target, registers + 0);
+	context->R5 = get_buffer(target, registers + 4);
+	context->R6 = get_buffer(target, registers + 8);
+	context->R7 = get_buffer(target, registers + 12);
+	context->R8 = get_buffer(target, registers + 16);
+	context->R9 = get_buffer(target, registers + 20);
+	context->IP = get_buffer(target, registers + 24);
+	context->FP = get_buffer(target, registers + 28);
+	context->SP = get_buffer(target, registers + 32);
+	context->PC = get_buffer(target, registers + 36);
 
 	if (*thread_info_addr_old == 0xdeadbeef)
 		*thread_info_addr_old = thread_info_addr_update;
@@ -679,6 +694,41 @@ static int current_base_addr(struct linux_os *linux_os, uint32_t base_addr)
 	return 0;
 }
 
+static int linux_read_threads_generation(struct target *target,
+	uint32_t *total_forks, uint32_t *nr_threads)
+{
+	struct symbol_table_elem *symbols = target->rtos->symbols;
+	uint8_t buffer[4];
+	int retval;
+
+	if ((!symbols) || (symbols[TOTAL_FORKS].address == 0) ||
+			(symbols[NR_THREADS].address == 0))
+		return ERROR_FAIL;
+
+	retval = fill_buffer(target, symbols[TOTAL_FORKS].address, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+	*total_forks = get_buffer(target, buffer);
+
+	retval = fill_buffer(target, symbols[NR_THREADS].address, buffer);
+	if (retval != ERROR_OK)
+		return retval;
+	*nr_threads = get_buffer(target, buffer);
+
+	return ERROR_OK;
+}
+
+/*  record the task list generation after a complete walk */
+static void linux_save_threads_generation(struct target *target)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+
+	linux_os->threads_generation_valid =
+		linux_read_threads_generation(target, &linux_os->total_forks,
+			&linux_os->nr_threads) == ERROR_OK;
+}
+
 static int linux_get_tasks(struct target *target, int context)
 {
 	int loop = 0;
@@ -704,8 +754,7 @@ static int linux_get_tasks(struct target *target, int context)
 	while (((t->base_addr != linux_os->init_task_addr) &&
 		(t->base_addr != 0)) || (loop == 0)) {
 		loop++;
-		fill_task(target, t);
-		retval = get_name(target, t);
+		retval = fill_task(target, t);
 
 		if (loop > MAX_THREADS) {
 			free(t);
@@ -735,16 +784,15 @@ static int linux_get_tasks(struct target *target, int context)
 				liste_add_task(linux_os->thread_list, t, &last);
 			/* no interest to fill the context if it is a current thread. */
 			linux_os->thread_count++;
-			t->thread_info_addr = 0xdeadbeef;
 
 			if (context)
 				t->context =
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
-			base_addr = next_task(target, t);
+			base_addr = t->next_base_addr;
 		} else {
 			/*LOG_INFO("thread %s is a current thread already created",t->name); */
-			base_addr = next_task(target, t);
+			base_addr = t->next_base_addr;
 			free(t);
 		}
 
@@ -755,6 +803,7 @@ static int linux_get_tasks(struct target *target, int context)
 	linux_os->threads_lookup = 1;
 	linux_os->threads_needs_update = 0;
 	linux_os->preupdtate_threadid_count = linux_os->threadid_count - 1;
+	linux_save_threads_generation(target);
 	/*  check that all current threads have been identified  */
 
 	LOG_INFO("complete time %" PRId64 ", thread mean %" PRId64 "\n",
@@ -797,6 +846,7 @@ static int linux_os_clean(struct target *target)
 	os_linux->nr_cpus = 0;
 	os_linux->threads_lookup = 0;
 	os_linux->threads_needs_update = 0;
+	os_linux->threads_generation_valid = 0;
 	os_linux->threadid_count = 1;
 	return ERROR_OK;
 }
@@ -870,9 +920,7 @@ error_handling:
 				if (fill_task(target, t) != ERROR_OK)
 					goto error_handling;
 
-				get_name(target, t);
 				insert_into_threadlist(target, t);
-				t->thread_info_addr = 0xdeadbeef;
 			}
 
 			t->status = 3;
@@ -912,13 +960,65 @@ error_handling:
 #endif
 }
 
+/*  no task was forked and none exited since the last walk: keep the thread
+ *  list and only find out which threads are running now. The saved
+ *  contexts of the other threads are read again when asked for, as in a
+ *  full walk */
+static int linux_task_update_cached(struct target *target, int context)
+{
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	struct threads *thread_list = linux_os->thread_list;
+	linux_os->thread_count = 0;
+
+	while (thread_list) {
+		if (thread_list->status) {
+			thread_list->status = 1;
+			linux_os->thread_count++;
+		}
+
+		/*  saved contexts may be stale, don't show them */
+		free(thread_list->context);
+		thread_list->context = NULL;
+
+		thread_list = thread_list->next;
+	}
+
+	get_current(target, 0);
+	linux_identify_current_threads(target);
+
+	/*  current threads (status 3) have their context in the cpu */
+	if (context) {
+		for (thread_list = linux_os->thread_list; thread_list;
+				thread_list = thread_list->next) {
+			if (thread_list->status == 1)
+				thread_list->context =
+					cpu_context_read(target,
+						thread_list->base_addr,
+						&thread_list->thread_info_addr);
+		}
+	}
+
+	linux_os->threads_needs_update = 0;
+	return ERROR_OK;
+}
+
 static int linux_task_update(struct target *target, int context)
 {
 	struct linux_os *linux_os = (struct linux_os *)
 		target->rtos->rtos_specific_params;
 	struct threads *thread_list = linux_os->thread_list;
+	uint32_t total_forks, nr_threads;
 	int retval;
 	int loop = 0;
+
+	if (linux_os->threads_generation_valid &&
+			(linux_read_threads_generation(target, &total_forks,
+				&nr_threads) == ERROR_OK) &&
+			(total_forks == linux_os->total_forks) &&
+			(nr_threads == linux_os->nr_threads))
+		return linux_task_update_cached(target, context);
+
 	linux_os->thread_count = 0;
 
 	/*thread_list = thread_list->next; skip init_task*/
@@ -1005,16 +1105,14 @@ static int linux_task_update(struct target *target, int context)
 		if (found == 0) {
 			uint32_t base_addr;
 			fill_task(target, t);
-			get_name(target, t);
 			retval = insert_into_threadlist(target, t);
-			t->thread_info_addr = 0xdeadbeef;
 
 			if (context)
 				t->context =
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
 
-			base_addr = next_task(target, t);
+			base_addr = t->next_base_addr;
 			t = calloc(1, sizeof(struct threads));
 			t->base_addr = base_addr;
 			linux_os->thread_count++;
@@ -1026,6 +1124,7 @@ static int linux_task_update(struct target *target, int context)
 		(timeval_ms() - start), (timeval_ms() - start) / loop);
 	free(t);
 	linux_os->threads_needs_update = 0;
+	linux_save_threads_generation(target);
 	return ERROR_OK;
 }
 
@@ -1049,7 +1148,7 @@ static int linux_gdb_thread_packet(struct target *target,
 	if (retval != ERROR_OK)
 		return ERROR_TARGET_FAILURE;
 
-	char *out_str = calloc(MAX_THREADS * 17 + 10, 1);
+	char *out_str = calloc((linux_os->threadid_count + 1) * 17 + 10, 1);
 	char *tmp_str = out_str;
 	tmp_str += sprintf(tmp_str, "m");
 	struct threads *temp = linux_os->thread_list;
@@ -1086,7 +1185,7 @@ static int linux_gdb_thread_update(struct target *target,
 
 	if (found == 1) {
 		/*LOG_INFO("INTO GDB THREAD UPDATE FOUNDING START TASK");*/
-		char *out_strr = calloc(MAX_THREADS * 17 + 10, 1);
+		char *out_strr = calloc((linux_os->threadid_count + 1) * 17 + 10, 1);
 		char *tmp_strr = out_strr;
 		tmp_strr += sprintf(tmp_strr, "m");
 		/*LOG_INFO("CHAR MALLOC & M DONE");*/
@@ -53,7 +53,14 @@ static struct {
 	struct rtt_sink_list **sink_list;
 	size_t sink_list_length;
 
+	/** Timer period in milliseconds, the shortest polling interval. */
 	unsigned int polling_interval;
+	/** Longest polling interval in milliseconds when idle. */
+	unsigned int max_polling_interval;
+	/** Timer periods between two polls. */
+	unsigned int poll_ticks;
+	/** Timer periods left until the next poll. */
+	unsigned int ticks_left;
 } rtt;
 
 int rtt_init(void)
@@ -68,7 +75,10 @@ int rtt_init(void)
 	rtt.sink_list[0] = NULL;
 	rtt.started = false;
 
-	rtt.polling_interval = 100;
+	rtt.polling_interval = 10;
+	rtt.max_polling_interval = 100;
+	rtt.poll_ticks = 1;
+	rtt.ticks_left = 1;
 
 	return ERROR_OK;
 }
@@ -83,9 +93,14 @@ int rtt_exit(void)
 static int read_channel_callback(void *user_data)
 {
 	int ret;
+	size_t length;
+	unsigned int max_ticks;
+
+	if (--rtt.ticks_left)
+		return ERROR_OK;
 
 	ret = rtt.source.read(rtt.target, &rtt.ctrl, rtt.sink_list,
-		rtt.sink_list_length, NULL);
+		rtt.sink_list_length, &length, NULL);
 
 	if (ret != ERROR_OK) {
 		target_unregister_timer_callback(&read_channel_callback, NULL);
@@ -93,6 +108,16 @@ static int read_channel_callback(void *user_data)
 		return ret;
 	}
 
+	/* Poll faster while data flows and back off while idle. */
+	max_ticks = rtt.max_polling_interval / rtt.polling_interval;
+
+	if (length)
+		rtt.poll_ticks = MAX(rtt.poll_ticks / 2, 1);
+	else
+		rtt.poll_ticks = MIN(rtt.poll_ticks * 2, max_ticks);
+
+	rtt.ticks_left = rtt.poll_ticks;
+
 	return ERROR_OK;
 }
 
@@ -166,6 +191,8 @@ int rtt_start(void)
 	if (ret != ERROR_OK)
 		return ret;
 
+	rtt.poll_ticks = 1;
+	rtt.ticks_left = 1;
 	target_register_timer_callback(&read_channel_callback,
 		rtt.polling_interval, 1, NULL);
 	rtt.started = true;
@@ -282,16 +309,37 @@ int rtt_get_polling_interval(unsigned int *interval)
 
 int rtt_set_polling_interval(unsigned int interval)
 {
-	if (!interval)
+	return rtt_set_polling_range(interval, interval);
+}
+
+int rtt_get_polling_range(unsigned int *min, unsigned int *max,
+		unsigned int *current)
+{
+	if (!min || !max || !current)
+		return ERROR_FAIL;
+
+	*min = rtt.polling_interval;
+	*max = rtt.max_polling_interval;
+	*current = rtt.polling_interval * rtt.poll_ticks;
+
+	return ERROR_OK;
+}
+
+int rtt_set_polling_range(unsigned int min, unsigned int max)
+{
+	if (!min || max < min)
 		return ERROR_FAIL;
 
-	if (rtt.polling_interval != interval) {
+	if (rtt.started && rtt.polling_interval != min) {
 		target_unregister_timer_callback(&read_channel_callback, NULL);
-		target_register_timer_callback(&read_channel_callback, interval, 1,
+		target_register_timer_callback(&read_channel_callback, min, 1,
 			NULL);
 	}
 
-	rtt.polling_interval = interval;
+	rtt.polling_interval = min;
+	rtt.max_polling_interval = max;
+	rtt.poll_ticks = 1;
+	rtt.ticks_left = 1;
 
 	return ERROR_OK;
 }
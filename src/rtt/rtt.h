@@ -121,7 +121,7 @@ typedef int (*rtt_source_start)(struct target *target,
 typedef int (*rtt_source_stop)(struct target *target, void *user_data);
 typedef int (*rtt_source_read)(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data);
+		size_t num_channels, size_t *bytes_read, void *user_data);
 typedef int (*rtt_source_write)(struct target *target,
 		struct rtt_control *ctrl, unsigned int channel,
 		const uint8_t *buffer, size_t *length, void *user_data);
@@ -205,6 +205,32 @@ int rtt_get_polling_interval(unsigned int *interval);
  */
 int rtt_set_polling_interval(unsigned int interval);
 
+/**
+ * Get the adaptive polling interval range.
+ *
+ * @param[out] min Shortest polling interval in milliseconds.
+ * @param[out] max Longest polling interval in milliseconds.
+ * @param[out] current Current polling interval in milliseconds.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_get_polling_range(unsigned int *min, unsigned int *max,
+		unsigned int *current);
+
+/**
+ * Set the adaptive polling interval range.
+ *
+ * Polling starts at the shortest interval, doubles after each poll without
+ * data up to the longest interval and halves after each poll with data.
+ * A range with equal bounds polls at a fixed interval.
+ *
+ * @param[in] min Shortest polling interval in milliseconds.
+ * @param[in] max Longest polling interval in milliseconds.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_polling_range(unsigned int min, unsigned int max);
+
 /**
  * Get whether RTT is started.
  *
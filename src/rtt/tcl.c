@@ -80,22 +80,31 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 {
 	if (CMD_ARGC == 0) {
 		int ret;
-		unsigned int interval;
+		unsigned int min, max, current;
 
-		ret = rtt_get_polling_interval(&interval);
+		ret = rtt_get_polling_range(&min, &max, &current);
 
 		if (ret != ERROR_OK) {
 			command_print(CMD, "Failed to get polling interval");
 			return ret;
 		}
 
-		command_print(CMD, "%u ms", interval);
-	} else if (CMD_ARGC == 1) {
+		if (min == max)
+			command_print(CMD, "%u ms", min);
+		else
+			command_print(CMD, "%u - %u ms (currently %u ms)", min, max,
+				current);
+	} else if (CMD_ARGC <= 2) {
 		int ret;
-		unsigned int interval;
+		unsigned int min, max;
 
-		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], interval);
-		ret = rtt_set_polling_interval(interval);
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], min);
+		max = min;
+
+		if (CMD_ARGC == 2)
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], max);
+
+		ret = rtt_set_polling_range(min, max);
 
 		if (ret != ERROR_OK) {
 			command_print(CMD, "Failed to set polling interval");
@@ -283,8 +292,9 @@ static const struct command_registration rtt_subcommand_handlers[] = {
 		.name = "polling_interval",
 		.handler = handle_rtt_polling_interval_command,
 		.mode = COMMAND_EXEC,
-		.help = "show or set polling interval in ms",
-		.usage = "[interval]"
+		.help = "show or set polling interval in ms, or the range of an "
+			"adaptive polling interval",
+		.usage = "[interval | min_interval max_interval]"
 	},
 	{
 		.name = "channels",
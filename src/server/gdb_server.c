@@ -74,6 +74,22 @@ struct target_desc_format {
 	uint32_t tdesc_length;
 };
 
+enum {
+	GDB_PREFETCH_STACK,
+	GDB_PREFETCH_CODE,
+	GDB_PREFETCH_WINDOWS
+};
+
+struct gdb_prefetch_window {
+	target_addr_t address;
+	uint32_t size;		/* 0 if the window holds nothing */
+	uint8_t *data;
+	/* the window is valid while the memory_generation of the target
+	 * it was read from stays the same */
+	struct target *target;
+	unsigned int generation;
+};
+
 /* private connection data for GDB */
 struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
@@ -107,6 +123,9 @@ struct gdb_connection {
 	char *thread_list;
 	/* flag to mask the output from gdb_log_callback() */
 	enum gdb_output_flag output_flag;
+	/* stack and code memory read right after the last stop, served to 'm'
+	 * packets until target memory may have changed */
+	struct gdb_prefetch_window prefetch[GDB_PREFETCH_WINDOWS];
 };
 
 #if 0
@@ -147,6 +166,12 @@ static int gdb_report_data_abort;
  * default. */
 static int gdb_report_register_access_error;
 
+/* bytes read from the stack pointer upwards and around the program counter
+ * when the target stops, see gdb_prefetch_fill(). Disabled by default, the
+ * windows may run past the end of memory, e.g. with the SP at the top of
+ * RAM after reset. */
+static uint32_t gdb_prefetch_size[GDB_PREFETCH_WINDOWS];
+
 /* set if we are sending target descriptions to gdb
  * via qXfer:features:read packet */
 /* enabled by default */
@@ -789,16 +814,154 @@ static int gdb_output(struct command_context *context, const char *line)
 	return ERROR_OK;
 }
 
+static void gdb_str_to_target(struct target *target,
+		char *tstr, struct reg *reg);
+
+static void gdb_prefetch_invalidate(struct gdb_connection *gdb_connection)
+{
+	for (int i = 0; i < GDB_PREFETCH_WINDOWS; i++)
+		gdb_connection->prefetch[i].size = 0;
+}
+
+static void gdb_prefetch_free(struct gdb_connection *gdb_connection)
+{
+	for (int i = 0; i < GDB_PREFETCH_WINDOWS; i++) {
+		free(gdb_connection->prefetch[i].data);
+		gdb_connection->prefetch[i].data = NULL;
+		gdb_connection->prefetch[i].size = 0;
+	}
+}
+
+/* Find the gdb register number of the first existing register with one of
+ * the given names, -1 if there is none */
+static int gdb_find_reg(struct reg **reg_list, int reg_list_size,
+		const char * const *names)
+{
+	for (; *names; names++) {
+		for (int i = 0; i < reg_list_size; i++) {
+			struct reg *reg = reg_list[i];
+			if (reg && reg->exist && !reg->hidden && reg->size <= 64 &&
+					!strcmp(reg->name, *names))
+				return i;
+		}
+	}
+	return -1;
+}
+
+/* Append the SP, PC and FP as "nn:value;" pairs to a stop reply, so that GDB
+ * does not need to fetch them with 'g' or 'p' packets. The SP and PC values
+ * are stored in base[] and flagged in the returned mask, one bit per
+ * prefetch window. */
+static unsigned int gdb_expedite_registers(struct target *target, char *buf, size_t size,
+		uint64_t base[GDB_PREFETCH_WINDOWS])
+{
+	static const char * const sp_names[] = { "sp", NULL };
+	static const char * const pc_names[] = { "pc", NULL };
+	static const char * const fp_names[] = { "fp", "x29", NULL };
+	/* indexed like the prefetch windows, then the frame pointer */
+	const char * const *names[] = { sp_names, pc_names, fp_names };
+	unsigned int found = 0;
+	struct reg **reg_list;
+	int reg_list_size;
+	size_t len = 0;
+
+	if (target_get_gdb_reg_list_noread(target, &reg_list, &reg_list_size,
+			REG_CLASS_ALL) != ERROR_OK)
+		return 0;
+
+	for (int i = 0; i < (int)ARRAY_SIZE(names); i++) {
+		int reg_num = gdb_find_reg(reg_list, reg_list_size, names[i]);
+		if (reg_num < 0)
+			continue;
+
+		struct reg *reg = reg_list[reg_num];
+		if (!reg->valid && reg->type->get(reg) != ERROR_OK)
+			continue;
+
+		/* "nn:" + value + ";" + the null gdb_str_to_target() writes */
+		if (len + DIV_ROUND_UP(reg->size, 8) * 2 + 12 > size)
+			break;
+		len += sprintf(buf + len, "%x:", reg_num);
+		gdb_str_to_target(target, buf + len, reg);
+		len += DIV_ROUND_UP(reg->size, 8) * 2;
+		buf[len++] = ';';
+		buf[len] = '\0';
+
+		if (i < GDB_PREFETCH_WINDOWS) {
+			base[i] = buf_get_u64(reg->value, 0, reg->size);
+			found |= 1 << i;
+		}
+	}
+
+	free(reg_list);
+	return found;
+}
+
+/* Read the memory GDB asks for right after nearly every stop: the top of the
+ * stack for unwinding and the instructions around the PC. Unreadable
+ * windows are simply left empty. */
+static void gdb_prefetch_fill(struct target *target,
+		struct gdb_connection *gdb_connection, const uint64_t base[GDB_PREFETCH_WINDOWS],
+		unsigned int found)
+{
+	const target_addr_t start[GDB_PREFETCH_WINDOWS] = {
+		[GDB_PREFETCH_STACK] = base[GDB_PREFETCH_STACK] & ~(target_addr_t)3,
+		[GDB_PREFETCH_CODE] = (base[GDB_PREFETCH_CODE] -
+				gdb_prefetch_size[GDB_PREFETCH_CODE] / 2) & ~(target_addr_t)3,
+	};
+
+	for (int i = 0; i < GDB_PREFETCH_WINDOWS; i++) {
+		struct gdb_prefetch_window *window = &gdb_connection->prefetch[i];
+		uint32_t size = gdb_prefetch_size[i];
+
+		window->size = 0;
+		if (!size || !(found & (1 << i)))
+			continue;
+		/* the size may have been changed by gdb_prefetch meanwhile */
+		uint8_t *data = realloc(window->data, size);
+		if (!data)
+			continue;
+		window->data = data;
+		if (target_read_buffer(target, start[i], size, window->data) != ERROR_OK)
+			continue;
+		window->address = start[i];
+		window->size = size;
+		window->target = target;
+		window->generation = target->memory_generation;
+	}
+}
+
+/* Serve a memory read from the prefetched windows if one holds all of it. */
+static bool gdb_prefetch_read(struct gdb_connection *gdb_connection, struct target *target,
+		target_addr_t address, uint32_t len, uint8_t *buffer)
+{
+	for (int i = 0; i < GDB_PREFETCH_WINDOWS; i++) {
+		struct gdb_prefetch_window *window = &gdb_connection->prefetch[i];
+		if (window->target != target || window->generation != target->memory_generation)
+			continue;
+		if (address >= window->address && len <= window->size &&
+				address - window->address <= window->size - len) {
+			memcpy(buffer, window->data + (address - window->address), len);
+			return true;
+		}
+	}
+	return false;
+}
+
 static void gdb_signal_reply(struct target *target, struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = connection->priv;
-	char sig_reply[65];
+	char sig_reply[200];
 	char stop_reason[32];
 	char current_thread[25];
+	char expedited[128];
 	int sig_reply_len;
 	int signal_var;
+	uint64_t prefetch_base[GDB_PREFETCH_WINDOWS];
+	unsigned int prefetch = 0;
 
 	rtos_update_threads(target);
+	gdb_prefetch_invalidate(gdb_connection);
 
 	if (target->debug_reason == DBG_REASON_EXIT) {
 		sig_reply_len = snprintf(sig_reply, sizeof(sig_reply), "W00");
@@ -850,14 +1013,24 @@ static void gdb_signal_reply(struct target *target, struct connection *connectio
 			snprintf(current_thread, sizeof(current_thread), "thread:%" PRIx64 ";",
 					rtos->current_thread);
 
-		sig_reply_len = snprintf(sig_reply, sizeof(sig_reply), "T%2.2x%s%s",
-				signal_var, stop_reason, current_thread);
+		/* with an RTOS the registers belong to a thread, not the target */
+		expedited[0] = '\0';
+		if (!rtos)
+			prefetch = gdb_expedite_registers(target, expedited, sizeof(expedited), prefetch_base);
+
+		sig_reply_len = snprintf(sig_reply, sizeof(sig_reply), "T%2.2x%s%s%s",
+				signal_var, stop_reason, current_thread, expedited);
 
 		gdb_connection->ctrl_c = false;
 	}
 
 	gdb_put_packet(connection, sig_reply, sig_reply_len);
 	gdb_connection->frontend_state = TARGET_HALTED;
+
+	/* GDB is busy with the stop reply meanwhile, so this costs no extra
+	 * round trip; its first memory reads are then answered right away */
+	if (prefetch)
+		gdb_prefetch_fill(target, gdb_connection, prefetch_base, prefetch);
 }
 
 static void gdb_fileio_reply(struct target *target, struct connection *connection)
@@ -1024,6 +1197,7 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
 	gdb_connection->output_flag = GDB_OUTPUT_NO;
+	memset(gdb_connection->prefetch, 0, sizeof(gdb_connection->prefetch));
 
 	/* send ACK to GDB for debug request */
 	gdb_write(connection, "+", 1);
@@ -1141,6 +1315,7 @@ static int gdb_connection_closed(struct connection *connection)
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	gdb_prefetch_free(gdb_connection);
 	free(connection->priv);
 	connection->priv = NULL;
 
@@ -1537,7 +1712,9 @@ static int gdb_read_memory_packet(struct connection *connection,
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
 	retval = ERROR_NOT_IMPLEMENTED;
-	if (target->rtos)
+	if (gdb_prefetch_read(connection->priv, target, addr, len, buffer))
+		retval = ERROR_OK;
+	else if (target->rtos)
 		retval = rtos_read_buffer(target, addr, len, buffer);
 	if (retval == ERROR_NOT_IMPLEMENTED)
 		retval = target_read_buffer(target, addr, len, buffer);
@@ -3961,6 +4138,28 @@ COMMAND_HANDLER(handle_gdb_report_register_access_error)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_prefetch_command)
+{
+	if (CMD_ARGC == 2) {
+		uint32_t size[GDB_PREFETCH_WINDOWS];
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], size[GDB_PREFETCH_STACK]);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size[GDB_PREFETCH_CODE]);
+		for (int i = 0; i < GDB_PREFETCH_WINDOWS; i++) {
+			if (size[i] > 4096) {
+				command_print(CMD, "prefetch window can't be larger than 4096 bytes");
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			}
+			gdb_prefetch_size[i] = size[i];
+		}
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD, "gdb prefetch: %" PRIu32 " stack bytes, %" PRIu32 " code bytes",
+			gdb_prefetch_size[GDB_PREFETCH_STACK], gdb_prefetch_size[GDB_PREFETCH_CODE]);
+	return ERROR_OK;
+}
+
 /* gdb_breakpoint_override */
 COMMAND_HANDLER(handle_gdb_breakpoint_override_command)
 {
@@ -4089,6 +4288,14 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable reporting register access errors",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_prefetch",
+		.handler = handle_gdb_prefetch_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set how much stack and code memory is read "
+			"when the target stops.",
+		.usage = "[stack_bytes code_bytes]"
+	},
 	{
 		.name = "gdb_breakpoint_override",
 		.handler = handle_gdb_breakpoint_override_command,
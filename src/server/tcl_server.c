@@ -28,6 +28,48 @@
 #define TCL_LINE_INITIAL		(4*1024)
 #define TCL_LINE_MAX			(4*1024*1024)
 
+/* Binary framed protocol, enabled per connection with the "tcl_binary" command.
+ *
+ * Request:  u8 magic, u8 op, u16 reserved, u32 id, u32 length, payload
+ * Reply:    u8 magic, u8 op, u16 reserved, u32 id, i32 status, u32 length, payload
+ *
+ * All fields are little endian; status is an OpenOCD error code. */
+#define TCL_BIN_MAGIC			0xb7
+#define TCL_BIN_HEADER_SIZE		12
+#define TCL_BIN_REPLY_HEADER_SIZE	16
+#define TCL_BIN_PAYLOAD_MAX		TCL_LINE_MAX
+/* minimum free space offered to each socket read */
+#define TCL_BIN_READ_CHUNK		(64*1024)
+/* largest target access built from adjacent requests */
+#define TCL_BIN_MERGE_MAX		(1024*1024)
+/* payload of a memory access request: u64 address, u32 size, u32 count */
+#define TCL_BIN_ACCESS_SIZE		16
+
+enum tcl_bin_op {
+	TCL_BIN_OP_EVAL = 1,	/* payload: Tcl command; reply: result string */
+	TCL_BIN_OP_READ = 2,	/* payload: access; reply: raw target bytes */
+	TCL_BIN_OP_WRITE = 3,	/* payload: access + raw bytes; reply: empty */
+	TCL_BIN_OP_NOTIFY = 0x80,	/* unsolicited notification or trace, id 0 */
+};
+
+struct tcl_bin_request {
+	uint8_t op;
+	uint32_t id;
+	uint32_t length;
+	const uint8_t *payload;
+	/* decoded memory access, when valid */
+	bool valid;
+	target_addr_t address;
+	uint32_t size;
+	uint32_t count;
+};
+
+struct tcl_bin_output {
+	uint8_t *buf;
+	size_t len;
+	size_t size;
+};
+
 struct tcl_connection {
 	int tc_linedrop;
 	int tc_lineoffset;
@@ -37,6 +79,10 @@ struct tcl_connection {
 	enum target_state tc_laststate;
 	bool tc_notify;
 	bool tc_trace;
+	bool tc_binary;
+	uint8_t *tc_bin;
+	size_t tc_bin_len;
+	size_t tc_bin_size;
 };
 
 static char *tcl_port;
@@ -46,6 +92,7 @@ static int tcl_new_connection(struct connection *connection);
 static int tcl_input(struct connection *connection);
 static int tcl_output(struct connection *connection, const void *buf, ssize_t len);
 static int tcl_closed(struct connection *connection);
+static int tcl_output_message(struct connection *connection, const char *buf, size_t len);
 
 static int tcl_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
@@ -58,14 +105,14 @@ static int tcl_target_callback_event_handler(struct target *target,
 
 	if (tclc->tc_notify) {
 		snprintf(buf, sizeof(buf), "type target_event event %s\r\n\x1a", target_event_name(event));
-		tcl_output(connection, buf, strlen(buf));
+		tcl_output_message(connection, buf, strlen(buf));
 	}
 
 	if (tclc->tc_laststate != target->state) {
 		tclc->tc_laststate = target->state;
 		if (tclc->tc_notify) {
 			snprintf(buf, sizeof(buf), "type target_state state %s\r\n\x1a", target_state_name(target));
-			tcl_output(connection, buf, strlen(buf));
+			tcl_output_message(connection, buf, strlen(buf));
 		}
 	}
 
@@ -83,7 +130,7 @@ static int tcl_target_callback_reset_handler(struct target *target,
 
 	if (tclc->tc_notify) {
 		snprintf(buf, sizeof(buf), "type target_reset mode %s\r\n\x1a", target_reset_mode_name(reset_mode));
-		tcl_output(connection, buf, strlen(buf));
+		tcl_output_message(connection, buf, strlen(buf));
 	}
 
 	return ERROR_OK;
@@ -107,7 +154,7 @@ static int tcl_target_callback_trace_handler(struct target *target,
 		buf = malloc(max_len);
 		hexify(hex, data, len, hex_len);
 		snprintf(buf, max_len, "%s%s%s", header, hex, trailer);
-		tcl_output(connection, buf, strlen(buf));
+		tcl_output_message(connection, buf, strlen(buf));
 		free(hex);
 		free(buf);
 	}
@@ -139,6 +186,310 @@ int tcl_output(struct connection *connection, const void *data, ssize_t len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+/* reserve a reply in out and return its payload area, NULL when out of memory */
+static uint8_t *tcl_bin_reply(struct tcl_bin_output *out, uint8_t op, uint32_t id,
+		int status, size_t length)
+{
+	size_t needed = out->len + TCL_BIN_REPLY_HEADER_SIZE + length;
+
+	if (needed > out->size) {
+		size_t size = MAX(needed, 2 * out->size);
+		uint8_t *buf = realloc(out->buf, size);
+		if (!buf) {
+			LOG_ERROR("Out of memory");
+			return NULL;
+		}
+		out->buf = buf;
+		out->size = size;
+	}
+
+	uint8_t *header = out->buf + out->len;
+	header[0] = TCL_BIN_MAGIC;
+	header[1] = op;
+	h_u16_to_le(header + 2, 0);
+	h_u32_to_le(header + 4, id);
+	h_u32_to_le(header + 8, status);
+	h_u32_to_le(header + 12, length);
+	out->len = needed;
+	return header + TCL_BIN_REPLY_HEADER_SIZE;
+}
+
+static void tcl_bin_reply_status(struct tcl_bin_output *out,
+		const struct tcl_bin_request *req, int status)
+{
+	tcl_bin_reply(out, req->op, req->id, status, 0);
+}
+
+/* notifications and trace data keep their text form, minus the 0x1a */
+static int tcl_output_message(struct connection *connection, const char *buf, size_t len)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (!tclc->tc_binary)
+		return tcl_output(connection, buf, len);
+
+	if (len && buf[len - 1] == '\x1a')
+		len--;
+
+	struct tcl_bin_output out = { NULL, 0, 0 };
+	uint8_t *payload = tcl_bin_reply(&out, TCL_BIN_OP_NOTIFY, 0, ERROR_OK, len);
+	if (!payload)
+		return ERROR_FAIL;
+	memcpy(payload, buf, len);
+	int retval = tcl_output(connection, out.buf, out.len);
+	free(out.buf);
+	return retval;
+}
+
+static void tcl_bin_eval(struct connection *connection, struct tcl_bin_output *out,
+		const struct tcl_bin_request *req)
+{
+	Jim_Interp *interp = (Jim_Interp *)connection->cmd_ctx->interp;
+	char *line = malloc(req->length + 1);
+
+	if (!line) {
+		tcl_bin_reply_status(out, req, ERROR_FAIL);
+		return;
+	}
+	memcpy(line, req->payload, req->length);
+	line[req->length] = '\0';
+
+	int retval = command_run_line(connection->cmd_ctx, line);
+	free(line);
+
+	int reslen;
+	const char *result = Jim_GetString(Jim_GetResult(interp), &reslen);
+	uint8_t *payload = tcl_bin_reply(out, req->op, req->id, retval, reslen);
+	if (payload)
+		memcpy(payload, result, reslen);
+}
+
+static void tcl_bin_decode_access(struct tcl_bin_request *req)
+{
+	req->valid = false;
+	if (req->length < TCL_BIN_ACCESS_SIZE)
+		return;
+
+	req->address = le_to_h_u64(req->payload);
+	req->size = le_to_h_u32(req->payload + 8);
+	req->count = le_to_h_u32(req->payload + 12);
+
+	if (req->size != 1 && req->size != 2 && req->size != 4 && req->size != 8)
+		return;
+	if (req->count > TCL_BIN_PAYLOAD_MAX / req->size)
+		return;
+	if (req->op == TCL_BIN_OP_READ && req->length != TCL_BIN_ACCESS_SIZE)
+		return;
+	if (req->op == TCL_BIN_OP_WRITE &&
+			req->length != TCL_BIN_ACCESS_SIZE + req->size * req->count)
+		return;
+	req->valid = true;
+}
+
+/* adjacent accesses of the same kind and size can be done in one go */
+static bool tcl_bin_mergeable(const struct tcl_bin_request *prev,
+		const struct tcl_bin_request *next)
+{
+	return next->valid && next->op == prev->op && next->size == prev->size &&
+		next->address == prev->address + (target_addr_t)prev->size * prev->count;
+}
+
+static int tcl_bin_access_one(struct target *target, const struct tcl_bin_request *req,
+		uint8_t *buf)
+{
+	if (req->op == TCL_BIN_OP_READ)
+		return target_read_memory(target, req->address, req->size, req->count, buf);
+	return target_write_memory(target, req->address, req->size, req->count,
+			req->payload + TCL_BIN_ACCESS_SIZE);
+}
+
+/* perform n mergeable memory requests with a single target access */
+static void tcl_bin_access(struct connection *connection, struct tcl_bin_output *out,
+		const struct tcl_bin_request *reqs, unsigned int n, size_t total)
+{
+	struct target *target = get_current_target_or_null(connection->cmd_ctx);
+	bool read = reqs[0].op == TCL_BIN_OP_READ;
+	int retval = ERROR_FAIL;
+	uint8_t *buf = NULL;
+	unsigned int i;
+
+	if (!target) {
+		for (i = 0; i < n; i++)
+			tcl_bin_reply_status(out, &reqs[i], ERROR_FAIL);
+		return;
+	}
+
+	if (n == 1 && !read) {
+		retval = tcl_bin_access_one(target, &reqs[0], NULL);
+		tcl_bin_reply_status(out, &reqs[0], retval);
+		return;
+	}
+
+	buf = malloc(MAX(total, 1));
+	if (buf) {
+		size_t offset = 0;
+		if (!read) {
+			for (i = 0; i < n; i++) {
+				size_t len = (size_t)reqs[i].size * reqs[i].count;
+				memcpy(buf + offset, reqs[i].payload + TCL_BIN_ACCESS_SIZE, len);
+				offset += len;
+			}
+			retval = target_write_memory(target, reqs[0].address, reqs[0].size,
+					total / reqs[0].size, buf);
+		} else {
+			retval = target_read_memory(target, reqs[0].address, reqs[0].size,
+					total / reqs[0].size, buf);
+		}
+	}
+
+	size_t offset = 0;
+	for (i = 0; i < n; i++) {
+		const struct tcl_bin_request *req = &reqs[i];
+		size_t len = (size_t)req->size * req->count;
+		int status = retval;
+
+		/* on failure, find out which of the requests is to blame */
+		if (status != ERROR_OK && buf && n > 1)
+			status = tcl_bin_access_one(target, req, buf + offset);
+
+		if (read && status == ERROR_OK) {
+			uint8_t *payload = tcl_bin_reply(out, req->op, req->id, status, len);
+			if (payload)
+				memcpy(payload, buf + offset, len);
+		} else {
+			tcl_bin_reply_status(out, req, status);
+		}
+		offset += len;
+	}
+
+	free(buf);
+}
+
+/* Handle every complete request in the input buffer and send all replies
+ * with one write.  Runs of adjacent reads or writes become one target access. */
+static int tcl_bin_dispatch(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+	struct tcl_bin_request *reqs = NULL;
+	unsigned int n = 0, reqs_size = 0;
+	size_t pos = 0;
+	int retval = ERROR_OK;
+
+	while (tclc->tc_bin_len - pos >= TCL_BIN_HEADER_SIZE) {
+		const uint8_t *header = tclc->tc_bin + pos;
+		uint32_t length = le_to_h_u32(header + 8);
+
+		if (header[0] != TCL_BIN_MAGIC || length > TCL_BIN_PAYLOAD_MAX) {
+			LOG_ERROR("tcl: malformed binary request, closing connection");
+			free(reqs);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		if (tclc->tc_bin_len - pos - TCL_BIN_HEADER_SIZE < length)
+			break;
+
+		if (n == reqs_size) {
+			unsigned int size = reqs_size ? 2 * reqs_size : 64;
+			struct tcl_bin_request *new_reqs = realloc(reqs, size * sizeof(*reqs));
+			if (!new_reqs) {
+				LOG_ERROR("Out of memory");
+				free(reqs);
+				return ERROR_SERVER_REMOTE_CLOSED;
+			}
+			reqs = new_reqs;
+			reqs_size = size;
+		}
+
+		struct tcl_bin_request *req = &reqs[n++];
+		req->op = header[1];
+		req->id = le_to_h_u32(header + 4);
+		req->length = length;
+		req->payload = header + TCL_BIN_HEADER_SIZE;
+		if (req->op == TCL_BIN_OP_READ || req->op == TCL_BIN_OP_WRITE)
+			tcl_bin_decode_access(req);
+		else
+			req->valid = false;
+
+		pos += TCL_BIN_HEADER_SIZE + length;
+	}
+
+	struct tcl_bin_output out = { NULL, 0, 0 };
+	unsigned int i = 0;
+	while (i < n) {
+		struct tcl_bin_request *req = &reqs[i];
+
+		if (req->op == TCL_BIN_OP_EVAL) {
+			tcl_bin_eval(connection, &out, req);
+			i++;
+		} else if (req->op == TCL_BIN_OP_READ || req->op == TCL_BIN_OP_WRITE) {
+			if (!req->valid) {
+				tcl_bin_reply_status(&out, req, ERROR_COMMAND_ARGUMENT_INVALID);
+				i++;
+				continue;
+			}
+
+			unsigned int j = i + 1;
+			size_t total = (size_t)req->size * req->count;
+			while (j < n && tcl_bin_mergeable(&reqs[j - 1], &reqs[j]) &&
+					total + (size_t)reqs[j].size * reqs[j].count <= TCL_BIN_MERGE_MAX) {
+				total += (size_t)reqs[j].size * reqs[j].count;
+				j++;
+			}
+			tcl_bin_access(connection, &out, req, j - i, total);
+			i = j;
+		} else {
+			tcl_bin_reply_status(&out, req, ERROR_NOT_IMPLEMENTED);
+			i++;
+		}
+	}
+	free(reqs);
+
+	if (out.len)
+		retval = tcl_output(connection, out.buf, out.len);
+	free(out.buf);
+
+	/* keep a trailing partial request for the next read */
+	memmove(tclc->tc_bin, tclc->tc_bin + pos, tclc->tc_bin_len - pos);
+	tclc->tc_bin_len -= pos;
+
+	return retval;
+}
+
+/* make room for at least len more bytes of binary input */
+static int tcl_bin_reserve(struct tcl_connection *tclc, size_t len)
+{
+	if (tclc->tc_bin_size - tclc->tc_bin_len >= len)
+		return ERROR_OK;
+
+	size_t size = MAX(tclc->tc_bin_len + len, 2 * tclc->tc_bin_size);
+	uint8_t *buf = realloc(tclc->tc_bin, size);
+	if (!buf) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	tclc->tc_bin = buf;
+	tclc->tc_bin_size = size;
+	return ERROR_OK;
+}
+
+static int tcl_bin_input(struct connection *connection)
+{
+	struct tcl_connection *tclc = connection->priv;
+
+	if (tcl_bin_reserve(tclc, TCL_BIN_READ_CHUNK) != ERROR_OK)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	ssize_t rlen = connection_read(connection, tclc->tc_bin + tclc->tc_bin_len,
+			tclc->tc_bin_size - tclc->tc_bin_len);
+	if (rlen <= 0) {
+		if (rlen < 0)
+			LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+	tclc->tc_bin_len += rlen;
+
+	return tcl_bin_dispatch(connection);
+}
+
 /* connections */
 static int tcl_new_connection(struct connection *connection)
 {
@@ -184,6 +535,13 @@ static int tcl_input(struct connection *connection)
 	char *tc_line_new;
 	int tc_line_size_new;
 
+	tclc = connection->priv;
+	if (!tclc)
+		return ERROR_CONNECTION_REJECTED;
+
+	if (tclc->tc_binary)
+		return tcl_bin_input(connection);
+
 	rlen = connection_read(connection, &in, sizeof(in));
 	if (rlen <= 0) {
 		if (rlen < 0)
@@ -191,10 +549,6 @@ static int tcl_input(struct connection *connection)
 		return ERROR_SERVER_REMOTE_CLOSED;
 	}
 
-	tclc = connection->priv;
-	if (!tclc)
-		return ERROR_CONNECTION_REJECTED;
-
 	/* push as much data into the line as possible */
 	for (i = 0; i < rlen; i++) {
 		/* buffer the data */
@@ -252,6 +606,16 @@ static int tcl_input(struct connection *connection)
 
 		tclc->tc_lineoffset = 0;
 		tclc->tc_linedrop = 0;
+
+		/* "tcl_binary" switches the rest of the stream to binary frames */
+		if (tclc->tc_binary) {
+			size_t rest = rlen - i - 1;
+			if (tcl_bin_reserve(tclc, rest) != ERROR_OK)
+				return ERROR_SERVER_REMOTE_CLOSED;
+			memcpy(tclc->tc_bin + tclc->tc_bin_len, &in[i + 1], rest);
+			tclc->tc_bin_len += rest;
+			return tcl_bin_dispatch(connection);
+		}
 	}
 
 	return ERROR_OK;
@@ -265,6 +629,7 @@ static int tcl_closed(struct connection *connection)
 	/* cleanup connection context */
 	if (tclc) {
 		free(tclc->tc_line);
+		free(tclc->tc_bin);
 		free(tclc);
 		connection->priv = NULL;
 	}
@@ -334,6 +699,27 @@ COMMAND_HANDLER(handle_tcl_trace_command)
 	}
 }
 
+COMMAND_HANDLER(handle_tcl_binary_command)
+{
+	struct connection *connection = NULL;
+	struct tcl_connection *tclc = NULL;
+
+	if (CMD_CTX->output_handler_priv)
+		connection = CMD_CTX->output_handler_priv;
+
+	if (connection && !strcmp(connection->service->name, "tcl")) {
+		if (CMD_ARGC)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		/* takes effect once the reply to this command has been sent */
+		tclc = connection->priv;
+		tclc->tc_binary = true;
+		return ERROR_OK;
+	} else {
+		LOG_ERROR("%s: can only be called from the tcl server", CMD_NAME);
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+}
+
 static const struct command_registration tcl_command_handlers[] = {
 	{
 		.name = "tcl_port",
@@ -358,6 +744,13 @@ static const struct command_registration tcl_command_handlers[] = {
 		.help = "Target trace output",
 		.usage = "[on|off]",
 	},
+	{
+		.name = "tcl_binary",
+		.handler = handle_tcl_binary_command,
+		.mode = COMMAND_EXEC,
+		.help = "Switch the current connection to the binary framed protocol",
+		.usage = "",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -211,11 +211,23 @@ struct svf_check_tdo_para {
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
 
+/* SIR and SDR scans that follow each other in the buffers without a gap,
+ * i.e. all but the last one a whole number of bytes long, are queued
+ * together as one bulk scan vector. Every scan also has a check para,
+ * so there are never more than SVF_CHECK_TDO_PARA_SIZE of them. */
+static struct jtag_bulk_scan *svf_bulk_scans;
+static unsigned int svf_bulk_num_scans;
+static int svf_bulk_offset;	/* buffer offset of the first scan */
+static int svf_bulk_bits;	/* total length of the scans */
+static bool svf_bulk_capture;	/* some scan captures TDO */
+
 static int svf_read_command_from_file(FILE *fd);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
+static int svf_cache_open(const char *name, FILE **cache);
+static int svf_cache_play(struct command_context *cmd_ctx, FILE *cache, int *command_num);
 
 static FILE *svf_fd;
 static char *svf_read_line;
@@ -231,6 +243,7 @@ static int svf_buffer_index, svf_buffer_size;
 static int svf_quiet;
 static int svf_nil;
 static int svf_ignore_error;
+static int svf_use_cache;
 
 /* Targeting particular tap */
 static int svf_tap_is_specified;
@@ -351,11 +364,32 @@ int svf_add_statemove(tap_state_t state_to)
 	return ERROR_FAIL;
 }
 
+static void svf_log_command(const char *text)
+{
+	if (svf_quiet) {
+		if (svf_progress_enabled) {
+			svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
+			if (svf_last_printed_percentage != svf_percentage) {
+				LOG_USER_N("\r%d%%    ", svf_percentage);
+				svf_last_printed_percentage = svf_percentage;
+			}
+		}
+	} else {
+		if (svf_progress_enabled) {
+			svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
+			LOG_USER_N("%3d%%  %s", svf_percentage, text);
+		} else
+			LOG_USER_N("%s", text);
+	}
+}
+
 COMMAND_HANDLER(handle_svf_command)
 {
 #define SVF_MIN_NUM_OF_OPTIONS 1
-#define SVF_MAX_NUM_OF_OPTIONS 5
+#define SVF_MAX_NUM_OF_OPTIONS 6
 	int command_num = 0;
+	const char *svf_file_name = NULL;
+	FILE *cache_fd;
 	int ret = ERROR_OK;
 	int64_t time_measure_ms;
 	int time_measure_s, time_measure_m;
@@ -374,6 +408,7 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_nil = 0;
 	svf_progress_enabled = 0;
 	svf_ignore_error = 0;
+	svf_use_cache = 0;
 	for (unsigned int i = 0; i < CMD_ARGC; i++) {
 		if (strcmp(CMD_ARGV[i], "-tap") == 0) {
 			tap = jtag_tap_by_string(CMD_ARGV[i+1]);
@@ -393,6 +428,8 @@ COMMAND_HANDLER(handle_svf_command)
 		else if ((strcmp(CMD_ARGV[i],
 				  "ignore_error") == 0) || (strcmp(CMD_ARGV[i], "-ignore_error") == 0))
 			svf_ignore_error = 1;
+		else if ((strcmp(CMD_ARGV[i], "cache") == 0) || (strcmp(CMD_ARGV[i], "-cache") == 0))
+			svf_use_cache = 1;
 		else {
 			svf_fd = fopen(CMD_ARGV[i], "r");
 			if (!svf_fd) {
@@ -400,8 +437,10 @@ COMMAND_HANDLER(handle_svf_command)
 				command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
 				/* no need to free anything now */
 				return ERROR_COMMAND_SYNTAX_ERROR;
-			} else
+			} else {
 				LOG_USER("svf processing file: \"%s\"", CMD_ARGV[i]);
+				svf_file_name = CMD_ARGV[i];
+			}
 		}
 	}
 
@@ -417,7 +456,9 @@ COMMAND_HANDLER(handle_svf_command)
 
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
-	if (!svf_check_tdo_para) {
+	svf_bulk_num_scans = 0;
+	svf_bulk_scans = malloc(sizeof(struct jtag_bulk_scan) * SVF_CHECK_TDO_PARA_SIZE);
+	if (!svf_check_tdo_para || !svf_bulk_scans) {
 		LOG_ERROR("not enough memory");
 		ret = ERROR_FAIL;
 		goto free_all;
@@ -484,43 +525,39 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
-		/* Count total lines in file. */
-		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
-			svf_total_lines++;
-		}
-		rewind(svf_fd);
+	cache_fd = NULL;
+	if (svf_use_cache) {
+		ret = svf_cache_open(svf_file_name, &cache_fd);
+		if (ret != ERROR_OK)
+			goto free_all;
 	}
-	while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
-		/* Log Output */
-		if (svf_quiet) {
-			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				if (svf_last_printed_percentage != svf_percentage) {
-					LOG_USER_N("\r%d%%    ", svf_percentage);
-					svf_last_printed_percentage = svf_percentage;
-				}
+
+	if (cache_fd) {
+		ret = svf_cache_play(CMD_CTX, cache_fd, &command_num);
+		fclose(cache_fd);
+	} else {
+		if (svf_progress_enabled) {
+			/* Count total lines in file. */
+			while (!feof(svf_fd)) {
+				svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
+				svf_total_lines++;
 			}
-		} else {
-			if (svf_progress_enabled) {
-				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
-			} else
-				LOG_USER_N("%s", svf_read_line);
+			rewind(svf_fd);
 		}
-		/* Run Command */
-		if (svf_run_command(CMD_CTX, svf_command_buffer) != ERROR_OK) {
-			LOG_ERROR("fail to run command at line %d", svf_line_number);
-			ret = ERROR_FAIL;
-			break;
+		while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
+			/* Log Output */
+			svf_log_command(svf_read_line);
+			/* Run Command */
+			if (svf_run_command(CMD_CTX, svf_command_buffer) != ERROR_OK) {
+				LOG_ERROR("fail to run command at line %d", svf_line_number);
+				ret = ERROR_FAIL;
+				break;
+			}
+			command_num++;
 		}
-		command_num++;
 	}
 
-	if ((!svf_nil) && (jtag_execute_queue() != ERROR_OK))
-		ret = ERROR_FAIL;
-	else if (svf_check_tdo() != ERROR_OK)
+	if (svf_execute_tap() != ERROR_OK)
 		ret = ERROR_FAIL;
 
 	/* print time */
@@ -550,6 +587,10 @@ free_all:
 	svf_check_tdo_para = NULL;
 	svf_check_tdo_para_index = 0;
 
+	free(svf_bulk_scans);
+	svf_bulk_scans = NULL;
+	svf_bulk_num_scans = 0;
+
 	free(svf_tdi_buffer);
 	svf_tdi_buffer = NULL;
 
@@ -891,8 +932,58 @@ static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len)
 	return ERROR_OK;
 }
 
+/* Queue the scans collected so far. Needed before any other JTAG command
+ * is queued, so that the order is kept. */
+static int svf_bulk_flush(void)
+{
+	if (!svf_bulk_num_scans)
+		return ERROR_OK;
+
+	uint8_t *vector = &svf_tdi_buffer[svf_bulk_offset];
+	int retval = jtag_add_bulk_scan(svf_bulk_num_scans, svf_bulk_scans,
+			vector, svf_bulk_capture ? vector : NULL);
+	svf_bulk_num_scans = 0;
+
+	return retval;
+}
+
+/* Add the scan just assembled at @a buffer_offset to the bulk vector. TDO
+ * is captured in place, over the TDI bits, as with single scans. */
+static int svf_bulk_add(int buffer_offset, int num_bits, bool ir_scan,
+		bool capture, tap_state_t end_state)
+{
+	/* a scan after a gap in the buffer starts a new vector */
+	if (svf_bulk_num_scans && (svf_bulk_bits % 8 ||
+			buffer_offset != svf_bulk_offset + svf_bulk_bits / 8)) {
+		if (svf_bulk_flush() != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	if (!svf_bulk_num_scans) {
+		svf_bulk_offset = buffer_offset;
+		svf_bulk_bits = 0;
+		svf_bulk_capture = false;
+	}
+
+	struct jtag_bulk_scan *scan = &svf_bulk_scans[svf_bulk_num_scans++];
+	scan->num_bits = num_bits;
+	scan->ir_scan = ir_scan;
+	scan->capture = capture;
+	scan->end_state = end_state;
+	svf_bulk_bits += num_bits;
+	svf_bulk_capture |= capture;
+
+	if (svf_bulk_num_scans == SVF_CHECK_TDO_PARA_SIZE)
+		return svf_bulk_flush();
+
+	return ERROR_OK;
+}
+
 static int svf_execute_tap(void)
 {
+	if ((!svf_nil) && (svf_bulk_flush() != ERROR_OK))
+		return ERROR_FAIL;
+
 	if ((!svf_nil) && (jtag_execute_queue() != ERROR_OK))
 		return ERROR_FAIL;
 	else if (svf_check_tdo() != ERROR_OK)
@@ -903,6 +994,257 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
+/*
+ * Second half of the XXR commands, shared with the cache player: apply the
+ * SVF defaults for an absent MASK or TDO, then queue the scan for SIR and
+ * SDR.  @a old_len is the previous length of this kind of scan.
+ */
+static int svf_xxr_scan(int command, struct svf_xxr_para *xxr_para_tmp, int old_len)
+{
+	int i;
+
+	/* If a command changes the length of the last scan of the same type and the
+	 * MASK parameter is absent, */
+	/* the mask pattern used is all cares */
+	if (!(xxr_para_tmp->data_mask & XXR_MASK) && (old_len != xxr_para_tmp->len)) {
+		/* MASK not defined and length changed */
+		if (ERROR_OK !=
+		svf_adjust_array_length(&xxr_para_tmp->mask, old_len,
+			xxr_para_tmp->len)) {
+			LOG_ERROR("fail to adjust length of array");
+			return ERROR_FAIL;
+		}
+		buf_set_ones(xxr_para_tmp->mask, xxr_para_tmp->len);
+	}
+	/* If TDO is absent, no comparison is needed, set the mask to 0 */
+	if (!(xxr_para_tmp->data_mask & XXR_TDO)) {
+		if (!xxr_para_tmp->tdo) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&xxr_para_tmp->tdo, old_len,
+				xxr_para_tmp->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		if (!xxr_para_tmp->mask) {
+			if (ERROR_OK !=
+			svf_adjust_array_length(&xxr_para_tmp->mask, old_len,
+				xxr_para_tmp->len)) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+		}
+		memset(xxr_para_tmp->mask, 0, (xxr_para_tmp->len + 7) >> 3);
+	}
+	/* do scan if necessary */
+	if (command == SDR) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hdr_para.len + svf_para.sdr_para.len +
+				svf_para.tdr_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			/* reallocate buffer */
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble dr data */
+		i = 0;
+		buf_set_buf(svf_para.hdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hdr_para.len);
+		i += svf_para.hdr_para.len;
+		buf_set_buf(svf_para.sdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sdr_para.len);
+		i += svf_para.sdr_para.len;
+		buf_set_buf(svf_para.tdr_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tdr_para.len);
+		i += svf_para.tdr_para.len;
+
+		/* add check data */
+		if (svf_para.sdr_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hdr_para.len);
+			i += svf_para.hdr_para.len;
+			buf_set_buf(svf_para.sdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sdr_para.len);
+			i += svf_para.sdr_para.len;
+			buf_set_buf(svf_para.tdr_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tdr_para.len);
+			i += svf_para.tdr_para.len;
+
+			svf_add_check_para(1, svf_buffer_index, i);
+		} else
+			svf_add_check_para(0, svf_buffer_index, i);
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			if (svf_bulk_add(svf_buffer_index, i, false,
+					xxr_para_tmp->data_mask & XXR_TDO,
+					svf_para.dr_end_state) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+
+		svf_buffer_index += (i + 7) >> 3;
+	} else if (command == SIR) {
+		/* check buffer size first, reallocate if necessary */
+		i = svf_para.hir_para.len + svf_para.sir_para.len +
+				svf_para.tir_para.len;
+		if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
+			if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
+				LOG_ERROR("not enough memory");
+				return ERROR_FAIL;
+			}
+		}
+
+		/* assemble ir data */
+		i = 0;
+		buf_set_buf(svf_para.hir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.hir_para.len);
+		i += svf_para.hir_para.len;
+		buf_set_buf(svf_para.sir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.sir_para.len);
+		i += svf_para.sir_para.len;
+		buf_set_buf(svf_para.tir_para.tdi,
+				0,
+				&svf_tdi_buffer[svf_buffer_index],
+				i,
+				svf_para.tir_para.len);
+		i += svf_para.tir_para.len;
+
+		/* add check data */
+		if (svf_para.sir_para.data_mask & XXR_TDO) {
+			/* assemble dr mask data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.mask,
+					0,
+					&svf_mask_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+
+			/* assemble dr check data */
+			i = 0;
+			buf_set_buf(svf_para.hir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.hir_para.len);
+			i += svf_para.hir_para.len;
+			buf_set_buf(svf_para.sir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.sir_para.len);
+			i += svf_para.sir_para.len;
+			buf_set_buf(svf_para.tir_para.tdo,
+					0,
+					&svf_tdo_buffer[svf_buffer_index],
+					i,
+					svf_para.tir_para.len);
+			i += svf_para.tir_para.len;
+
+			svf_add_check_para(1, svf_buffer_index, i);
+		} else
+			svf_add_check_para(0, svf_buffer_index, i);
+		if (!svf_nil) {
+			/* NOTE:  doesn't use SVF-specified state paths */
+			if (svf_bulk_add(svf_buffer_index, i, true,
+					xxr_para_tmp->data_mask & XXR_TDO,
+					svf_para.ir_end_state) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+
+		svf_buffer_index += (i + 7) >> 3;
+	}
+
+	return ERROR_OK;
+}
+
+/* Run the queue once enough has been batched, or after every command when debugging */
+static int svf_commit(int command, int num_of_argu)
+{
+	if (debug_level >= LOG_LVL_DEBUG) {
+		/* for convenient debugging, execute tap if possible */
+		if ((svf_buffer_index > 0) &&
+				(((command != STATE) && (command != RUNTEST)) ||
+						((command == STATE) && (num_of_argu == 2)))) {
+			if (svf_execute_tap() != ERROR_OK)
+				return ERROR_FAIL;
+
+			/* output debug info */
+			if ((command == SIR) || (command == SDR))
+				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
+		}
+	} else {
+		/* for fast executing, execute tap if necessary */
+		/* half of the buffer is for the next command */
+		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) ||
+				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) &&
+				(((command != STATE) && (command != RUNTEST)) ||
+						((command == STATE) && (num_of_argu == 2))))
+			return svf_execute_tap();
+	}
+
+	return ERROR_OK;
+}
+
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
 	char *argus[256], command;
@@ -917,7 +1259,6 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	/* for XXR */
 	struct svf_xxr_para *xxr_para_tmp;
 	uint8_t **pbuffer_tmp;
-	struct scan_field field;
 	/* for STATE */
 	tap_state_t *path = NULL, state;
 	/* flag padding commands skipped due to -tap command */
@@ -932,6 +1273,12 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 
 	command = svf_find_string_in_array(argus[0],
 			(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
+
+	/* other commands may queue JTAG operations of their own */
+	if (command != SIR && command != SDR && !svf_nil &&
+			svf_bulk_flush() != ERROR_OK)
+		return ERROR_FAIL;
+
 	switch (command) {
 		case ENDDR:
 		case ENDIR:
@@ -1076,222 +1423,8 @@ xxr_common:
 				}
 				SVF_BUF_LOG(DEBUG, *pbuffer_tmp, xxr_para_tmp->len, argus[i]);
 			}
-			/* If a command changes the length of the last scan of the same type and the
-			 * MASK parameter is absent, */
-			/* the mask pattern used is all cares */
-			if (!(xxr_para_tmp->data_mask & XXR_MASK) && (i_tmp != xxr_para_tmp->len)) {
-				/* MASK not defined and length changed */
-				if (ERROR_OK !=
-				svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-					xxr_para_tmp->len)) {
-					LOG_ERROR("fail to adjust length of array");
-					return ERROR_FAIL;
-				}
-				buf_set_ones(xxr_para_tmp->mask, xxr_para_tmp->len);
-			}
-			/* If TDO is absent, no comparison is needed, set the mask to 0 */
-			if (!(xxr_para_tmp->data_mask & XXR_TDO)) {
-				if (!xxr_para_tmp->tdo) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->tdo, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				if (!xxr_para_tmp->mask) {
-					if (ERROR_OK !=
-					svf_adjust_array_length(&xxr_para_tmp->mask, i_tmp,
-						xxr_para_tmp->len)) {
-						LOG_ERROR("fail to adjust length of array");
-						return ERROR_FAIL;
-					}
-				}
-				memset(xxr_para_tmp->mask, 0, (xxr_para_tmp->len + 7) >> 3);
-			}
-			/* do scan if necessary */
-			if (command == SDR) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hdr_para.len + svf_para.sdr_para.len +
-						svf_para.tdr_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					/* reallocate buffer */
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble dr data */
-				i = 0;
-				buf_set_buf(svf_para.hdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hdr_para.len);
-				i += svf_para.hdr_para.len;
-				buf_set_buf(svf_para.sdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sdr_para.len);
-				i += svf_para.sdr_para.len;
-				buf_set_buf(svf_para.tdr_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tdr_para.len);
-				i += svf_para.tdr_para.len;
-
-				/* add check data */
-				if (svf_para.sdr_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hdr_para.len);
-					i += svf_para.hdr_para.len;
-					buf_set_buf(svf_para.sdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sdr_para.len);
-					i += svf_para.sdr_para.len;
-					buf_set_buf(svf_para.tdr_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tdr_para.len);
-					i += svf_para.tdr_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_dr_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.dr_end_state);
-				}
-
-				svf_buffer_index += (i + 7) >> 3;
-			} else if (command == SIR) {
-				/* check buffer size first, reallocate if necessary */
-				i = svf_para.hir_para.len + svf_para.sir_para.len +
-						svf_para.tir_para.len;
-				if ((svf_buffer_size - svf_buffer_index) < ((i + 7) >> 3)) {
-					if (svf_realloc_buffers(svf_buffer_index + ((i + 7) >> 3)) != ERROR_OK) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
-
-				/* assemble ir data */
-				i = 0;
-				buf_set_buf(svf_para.hir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.hir_para.len);
-				i += svf_para.hir_para.len;
-				buf_set_buf(svf_para.sir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.sir_para.len);
-				i += svf_para.sir_para.len;
-				buf_set_buf(svf_para.tir_para.tdi,
-						0,
-						&svf_tdi_buffer[svf_buffer_index],
-						i,
-						svf_para.tir_para.len);
-				i += svf_para.tir_para.len;
-
-				/* add check data */
-				if (svf_para.sir_para.data_mask & XXR_TDO) {
-					/* assemble dr mask data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.mask,
-							0,
-							&svf_mask_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-
-					/* assemble dr check data */
-					i = 0;
-					buf_set_buf(svf_para.hir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.hir_para.len);
-					i += svf_para.hir_para.len;
-					buf_set_buf(svf_para.sir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.sir_para.len);
-					i += svf_para.sir_para.len;
-					buf_set_buf(svf_para.tir_para.tdo,
-							0,
-							&svf_tdo_buffer[svf_buffer_index],
-							i,
-							svf_para.tir_para.len);
-					i += svf_para.tir_para.len;
-
-					svf_add_check_para(1, svf_buffer_index, i);
-				} else
-					svf_add_check_para(0, svf_buffer_index, i);
-				field.num_bits = i;
-				field.out_value = &svf_tdi_buffer[svf_buffer_index];
-				field.in_value = (xxr_para_tmp->data_mask & XXR_TDO) ? &svf_tdi_buffer[svf_buffer_index] : NULL;
-				if (!svf_nil) {
-					/* NOTE:  doesn't use SVF-specified state paths */
-					jtag_add_plain_ir_scan(field.num_bits,
-							field.out_value,
-							field.in_value,
-							svf_para.ir_end_state);
-				}
-
-				svf_buffer_index += (i + 7) >> 3;
-			}
+			if (svf_xxr_scan(command, xxr_para_tmp, i_tmp) != ERROR_OK)
+				return ERROR_FAIL;
 			break;
 		case PIO:
 		case PIOMAP:
@@ -1525,38 +1658,438 @@ xxr_common:
 			LOG_USER("(Above Padding command skipped, as per -tap argument)");
 	}
 
-	if (debug_level >= LOG_LVL_DEBUG) {
-		/* for convenient debugging, execute tap if possible */
-		if ((svf_buffer_index > 0) &&
-				(((command != STATE) && (command != RUNTEST)) ||
-						((command == STATE) && (num_of_argu == 2)))) {
-			if (svf_execute_tap() != ERROR_OK)
-				return ERROR_FAIL;
+	return svf_commit(command, num_of_argu);
+}
 
-			/* output debug info */
-			if ((command == SIR) || (command == SDR))
-				SVF_BUF_LOG(DEBUG, svf_tdi_buffer, svf_check_tdo_para[0].bit_len, "TDO read");
+/*
+ * Compiled SVF cache.  For big SVF files, e.g. PL bitstreams, nearly all of
+ * the time goes into reading the text and converting the long SDR hex
+ * strings.  With the "cache" option the file is compiled once into a
+ * stream of binary records.  The stream is saved as "<file>.cache" next
+ * to it, together with the size and a hash of the source, and later runs
+ * replay it directly.  Scans are stored as binary data.  All other
+ * commands are rare and are kept as their normalized text for
+ * svf_run_command().
+ */
+#define SVF_CACHE_MAGIC		"OCDSVFC1"
+/* magic, source size, source hash, number of lines, reserved */
+#define SVF_CACHE_HDR_SIZE	32
+/* type, command, data mask, reserved, line number, length */
+#define SVF_CACHE_REC_SIZE	12
+
+enum svf_cache_record {
+	SVF_REC_END,
+	SVF_REC_TEXT,
+	SVF_REC_XXR,
+};
+
+static const int svf_xxr_fields[] = { XXR_TDI, XXR_TDO, XXR_MASK, XXR_SMASK };
+
+static int svf_hash_file(FILE *fd, uint64_t *size, uint64_t *hash, long *lines)
+{
+	uint8_t *buf = malloc(64 * 1024);
+	uint64_t h = 0xcbf29ce484222325ULL;	/* FNV-1a */
+	size_t n;
+
+	if (!buf) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	*size = 0;
+	*lines = 0;
+	while ((n = fread(buf, 1, 64 * 1024, fd)) > 0) {
+		for (size_t i = 0; i < n; i++) {
+			h = (h ^ buf[i]) * 0x100000001b3ULL;
+			if (buf[i] == '\n')
+				(*lines)++;
+		}
+		*size += n;
+	}
+	free(buf);
+
+	if (ferror(fd)) {
+		LOG_ERROR("error reading SVF file");
+		return ERROR_FAIL;
+	}
+	rewind(fd);
+	*hash = h;
+
+	return ERROR_OK;
+}
+
+static int svf_cache_write(FILE *out, enum svf_cache_record type, int command, int data_mask,
+		uint32_t len, const void *data, size_t data_len)
+{
+	uint8_t rec[SVF_CACHE_REC_SIZE] = { type, command, data_mask, 0 };
+
+	h_u32_to_le(rec + 4, svf_line_number);
+	h_u32_to_le(rec + 8, len);
+	if (fwrite(rec, 1, sizeof(rec), out) != sizeof(rec) ||
+			(data_len && fwrite(data, 1, data_len, out) != data_len)) {
+		LOG_ERROR("error writing SVF cache");
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/* Parse one XXR command the way svf_run_command() does, into a binary record */
+static int svf_cache_compile_xxr(FILE *out, int command, uint8_t **bufs, int *buf_bits)
+{
+	char *argus[256];
+	int num_of_argu = 0, len, data_mask = 0, i, k;
+
+	if (svf_parse_cmd_string(svf_command_buffer, strlen(svf_command_buffer),
+			argus, &num_of_argu) != ERROR_OK)
+		return ERROR_FAIL;
+	if ((num_of_argu > 10) || (num_of_argu % 2)) {
+		LOG_ERROR("invalid parameter of %s", argus[0]);
+		return ERROR_FAIL;
+	}
+	len = atoi(argus[1]);
+
+	for (i = 2; i < num_of_argu; i += 2) {
+		if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
+		(argus[i + 1][strlen(argus[i + 1]) - 1] != ')')) {
+			LOG_ERROR("data section error");
+			return ERROR_FAIL;
+		}
+		argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
+		if (!strcmp(argus[i], "TDI"))
+			k = 0;
+		else if (!strcmp(argus[i], "TDO"))
+			k = 1;
+		else if (!strcmp(argus[i], "MASK"))
+			k = 2;
+		else if (!strcmp(argus[i], "SMASK"))
+			k = 3;
+		else {
+			LOG_ERROR("unknown parameter: %s", argus[i]);
+			return ERROR_FAIL;
+		}
+		if (svf_copy_hexstring_to_binary(&argus[i + 1][1], &bufs[k], buf_bits[k], len) != ERROR_OK) {
+			LOG_ERROR("fail to parse hex value");
+			return ERROR_FAIL;
+		}
+		buf_bits[k] = MAX(buf_bits[k], len);
+		data_mask |= svf_xxr_fields[k];
+	}
+
+	if (svf_cache_write(out, SVF_REC_XXR, command, data_mask, len, NULL, 0) != ERROR_OK)
+		return ERROR_FAIL;
+	for (k = 0; k < 4; k++) {
+		size_t n = DIV_ROUND_UP(len, 8);
+
+		if ((data_mask & svf_xxr_fields[k]) && fwrite(bufs[k], 1, n, out) != n) {
+			LOG_ERROR("error writing SVF cache");
+			return ERROR_FAIL;
 		}
-	} else {
-		/* for fast executing, execute tap if necessary */
-		/* half of the buffer is for the next command */
-		if (((svf_buffer_index >= SVF_MAX_BUFFER_SIZE_TO_COMMIT) ||
-				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) &&
-				(((command != STATE) && (command != RUNTEST)) ||
-						((command == STATE) && (num_of_argu == 2))))
-			return svf_execute_tap();
 	}
 
 	return ERROR_OK;
 }
 
+static int svf_cache_compile(FILE *out)
+{
+	uint8_t *bufs[4] = { NULL };
+	int buf_bits[4] = { 0 };
+	int retval = ERROR_OK;
+
+	while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
+		char *cmd = svf_command_buffer + strspn(svf_command_buffer, " \t");
+		size_t name_len = strcspn(cmd, " \t");
+		int command;
+
+		for (command = 0; command < (int)ARRAY_SIZE(svf_command_name); command++)
+			if (strlen(svf_command_name[command]) == name_len &&
+					!strncmp(cmd, svf_command_name[command], name_len))
+				break;
+
+		switch (command) {
+			case HDR:
+			case HIR:
+			case SDR:
+			case SIR:
+			case TDR:
+			case TIR:
+				retval = svf_cache_compile_xxr(out, command, bufs, buf_bits);
+				break;
+			default:
+				retval = svf_cache_write(out, SVF_REC_TEXT, 0, 0, strlen(cmd), cmd, strlen(cmd));
+				break;
+		}
+		if (retval != ERROR_OK) {
+			LOG_ERROR("fail to compile command at line %d", svf_line_number);
+			break;
+		}
+	}
+
+	if (retval == ERROR_OK)
+		retval = svf_cache_write(out, SVF_REC_END, 0, 0, 0, NULL, 0);
+
+	for (int k = 0; k < 4; k++)
+		free(bufs[k]);
+	return retval;
+}
+
+/*
+ * Open the cache of the SVF file @a name, compiling it first when it is
+ * missing or stale.  Leaves *cache NULL, and the source rewound, when no
+ * cache can be written or read back; the file is then played from its
+ * text, which also reports any error the compiler ran into.
+ */
+static int svf_cache_open(const char *name, FILE **cache)
+{
+	uint8_t hdr[SVF_CACHE_HDR_SIZE], want[SVF_CACHE_HDR_SIZE] = { 0 };
+	uint64_t size, hash;
+	long lines;
+	char *path, *tmp_path;
+	FILE *fd;
+	int retval;
+
+	*cache = NULL;
+
+	retval = svf_hash_file(svf_fd, &size, &hash, &lines);
+	if (retval != ERROR_OK)
+		return retval;
+
+	memcpy(want, SVF_CACHE_MAGIC, 8);
+	h_u64_to_le(want + 8, size);
+	h_u64_to_le(want + 16, hash);
+	h_u32_to_le(want + 24, lines);
+
+	path = alloc_printf("%s.cache", name);
+	tmp_path = alloc_printf("%s.cache.tmp", name);
+	if (!path || !tmp_path) {
+		LOG_ERROR("not enough memory");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	fd = fopen(path, "rb");
+	if (fd) {
+		if (fread(hdr, 1, sizeof(hdr), fd) == sizeof(hdr) && !memcmp(hdr, want, sizeof(hdr))) {
+			LOG_INFO("svf: using compiled cache \"%s\"", path);
+			goto done;
+		}
+		fclose(fd);
+	}
+
+	fd = fopen(tmp_path, "wb");
+	if (!fd) {
+		LOG_WARNING("svf: cannot create \"%s\" (%s), not caching", tmp_path, strerror(errno));
+		goto out;
+	}
+
+	LOG_INFO("svf: compiling \"%s\"", name);
+	/* the header is written last so an interrupted compile never matches */
+	retval = ERROR_OK;
+	if (fwrite(hdr, 1, sizeof(hdr), fd) != sizeof(hdr))
+		retval = ERROR_FAIL;
+	if (retval == ERROR_OK)
+		retval = svf_cache_compile(fd);
+	if (retval == ERROR_OK && (fseek(fd, 0, SEEK_SET) || fwrite(want, 1, sizeof(want), fd) != sizeof(want)))
+		retval = ERROR_FAIL;
+	if (fclose(fd) && retval == ERROR_OK)
+		retval = ERROR_FAIL;
+	svf_line_number = 0;
+
+	if (retval != ERROR_OK) {
+		LOG_WARNING("svf: cannot write \"%s\", not caching", tmp_path);
+		remove(tmp_path);
+		rewind(svf_fd);
+		retval = ERROR_OK;
+		goto out;
+	}
+	if (rename(tmp_path, path)) {
+		LOG_WARNING("svf: cannot rename \"%s\" (%s), not caching", tmp_path, strerror(errno));
+		remove(tmp_path);
+		rewind(svf_fd);
+		goto out;
+	}
+
+	fd = fopen(path, "rb");
+	if (!fd || fseek(fd, SVF_CACHE_HDR_SIZE, SEEK_SET)) {
+		LOG_WARNING("svf: cannot open \"%s\", not caching", path);
+		if (fd)
+			fclose(fd);
+		rewind(svf_fd);
+		goto out;
+	}
+
+done:
+	svf_total_lines = lines + 1;
+	*cache = fd;
+out:
+	free(path);
+	free(tmp_path);
+	return retval;
+}
+
+/* Replay of one binary XXR record, the counterpart of the xxr_common path */
+static int svf_run_xxr_record(int command, int len, int data_mask, const uint8_t *data)
+{
+	struct svf_xxr_para *xxr_para_tmp;
+	uint8_t **pbuffer_tmp[4];
+	int old_len;
+
+	switch (command) {
+		case HDR:
+			xxr_para_tmp = &svf_para.hdr_para;
+			break;
+		case HIR:
+			xxr_para_tmp = &svf_para.hir_para;
+			break;
+		case TDR:
+			xxr_para_tmp = &svf_para.tdr_para;
+			break;
+		case TIR:
+			xxr_para_tmp = &svf_para.tir_para;
+			break;
+		case SDR:
+			xxr_para_tmp = &svf_para.sdr_para;
+			break;
+		case SIR:
+			xxr_para_tmp = &svf_para.sir_para;
+			break;
+		default:
+			LOG_ERROR("corrupt SVF cache");
+			return ERROR_FAIL;
+	}
+
+	if (svf_tap_is_specified && command != SDR && command != SIR) {
+		if (!svf_quiet)
+			LOG_USER("(Above Padding command skipped, as per -tap argument)");
+		return ERROR_OK;
+	}
+
+	old_len = xxr_para_tmp->len;
+	xxr_para_tmp->len = len;
+	if (old_len < len)
+		svf_free_xxd_para(xxr_para_tmp);
+
+	pbuffer_tmp[0] = &xxr_para_tmp->tdi;
+	pbuffer_tmp[1] = &xxr_para_tmp->tdo;
+	pbuffer_tmp[2] = &xxr_para_tmp->mask;
+	pbuffer_tmp[3] = &xxr_para_tmp->smask;
+	xxr_para_tmp->data_mask = data_mask;
+	for (int k = 0; k < 4; k++) {
+		if (!(data_mask & svf_xxr_fields[k]))
+			continue;
+		if (svf_adjust_array_length(pbuffer_tmp[k], old_len, len) != ERROR_OK)
+			return ERROR_FAIL;
+		memcpy(*pbuffer_tmp[k], data, DIV_ROUND_UP(len, 8));
+		data += DIV_ROUND_UP(len, 8);
+	}
+
+	if (svf_xxr_scan(command, xxr_para_tmp, old_len) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return svf_commit(command, 0);
+}
+
+static int svf_cache_play(struct command_context *cmd_ctx, FILE *cache, int *command_num)
+{
+	uint8_t rec[SVF_CACHE_REC_SIZE];
+	uint8_t *data = NULL;
+	size_t data_size = 0;
+	char line[32];
+	int retval = ERROR_OK;
+
+	/* bytes left in the cache file, every record length is checked
+	 * against it before anything is allocated for it */
+	long start = ftell(cache);
+	if (start < 0 || fseek(cache, 0, SEEK_END) != 0) {
+		LOG_ERROR("cannot seek SVF cache");
+		return ERROR_FAIL;
+	}
+	long end = ftell(cache);
+	if (end < start || fseek(cache, start, SEEK_SET) != 0) {
+		LOG_ERROR("cannot seek SVF cache");
+		return ERROR_FAIL;
+	}
+	uint64_t remaining = end - start;
+
+	setvbuf(cache, NULL, _IOFBF, 1024 * 1024);
+
+	while (retval == ERROR_OK) {
+		if (fread(rec, 1, sizeof(rec), cache) != sizeof(rec)) {
+			LOG_ERROR("SVF cache is truncated");
+			retval = ERROR_FAIL;
+			break;
+		}
+		remaining -= sizeof(rec);
+		if (rec[0] == SVF_REC_END)
+			break;
+
+		svf_line_number = le_to_h_u32(rec + 4);
+		uint32_t len = le_to_h_u32(rec + 8);
+		uint64_t n = len;
+		if (rec[0] == SVF_REC_XXR) {
+			int fields = 0;
+			for (int k = 0; k < 4; k++)
+				if (rec[2] & svf_xxr_fields[k])
+					fields++;
+			n = fields * DIV_ROUND_UP((uint64_t)len, 8);
+		}
+		if (n > remaining) {
+			LOG_ERROR("corrupt SVF cache, record at line %d is larger than the file",
+					svf_line_number);
+			retval = ERROR_FAIL;
+			break;
+		}
+		remaining -= n;
+
+		/* room for the ";\n" of the log line */
+		if (n + 3 > data_size) {
+			uint8_t *ptr = realloc(data, n + 3);
+			if (!ptr) {
+				LOG_ERROR("not enough memory");
+				retval = ERROR_FAIL;
+				break;
+			}
+			data = ptr;
+			data_size = n + 3;
+		}
+		if (fread(data, 1, n, cache) != n) {
+			LOG_ERROR("SVF cache is truncated");
+			retval = ERROR_FAIL;
+			break;
+		}
+
+		if (rec[0] == SVF_REC_TEXT) {
+			memcpy(data + n, ";\n", 3);
+			svf_log_command((char *)data);
+			data[n] = '\0';
+			retval = svf_run_command(cmd_ctx, (char *)data);
+		} else if (rec[0] == SVF_REC_XXR) {
+			snprintf(line, sizeof(line), "%s %" PRIu32 ";\n",
+					rec[1] < ARRAY_SIZE(svf_command_name) ? svf_command_name[rec[1]] : "?", len);
+			svf_log_command(line);
+			retval = svf_run_xxr_record(rec[1], len, rec[2], data);
+		} else {
+			LOG_ERROR("corrupt SVF cache");
+			retval = ERROR_FAIL;
+		}
+
+		if (retval != ERROR_OK)
+			LOG_ERROR("fail to run command at line %d", svf_line_number);
+		else
+			(*command_num)++;
+	}
+
+	free(data);
+	return retval;
+}
+
 static const struct command_registration svf_command_handlers[] = {
 	{
 		.name = "svf",
 		.handler = handle_svf_command,
 		.mode = COMMAND_EXEC,
 		.help = "Runs a SVF file.",
-		.usage = "[-tap device.tap] <file> [quiet] [nil] [progress] [ignore_error]",
+		.usage = "[-tap device.tap] <file> [quiet] [nil] [progress] [ignore_error] [cache]",
 	},
 	COMMAND_REGISTRATION_DONE
 };
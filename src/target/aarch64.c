@@ -2472,6 +2472,173 @@ static int aarch64_read_cpu_memory(struct target *target,
 	return ERROR_OK;
 }
 
+/*
+ * Bulk transfers through a system MEM-AP (usually the AXI-AP) on the same
+ * DAP.  Such an AP accesses memory behind the core caches, so every range
+ * it touches is cleaned and invalidated by VA first (DC CIVAC) and, after
+ * a write, invalidated in the I-cache (IC IVAU).  Only the transferred
+ * lines are maintained, never the whole cache.
+ */
+
+/* transfers below this size stay on the DCC, they are cheaper there */
+#define AARCH64_SYSAP_MIN_BYTES 256
+/* smallest translation granule; a VA chunk of this size maps to one PA */
+#define AARCH64_SYSAP_CHUNK 4096
+
+static struct adiv5_ap *aarch64_get_sys_ap(struct target *target)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct adiv5_dap *dap = aarch64->armv8_common.arm.dap;
+	struct adiv5_ap *ap;
+	int retval;
+
+	if (aarch64->sys_ap)
+		return aarch64->sys_ap;
+
+	if (aarch64->sysap_num < 0) {
+		retval = dap_find_ap(dap, AP_TYPE_AXI_AP, &ap);
+		if (retval != ERROR_OK) {
+			LOG_WARNING("%s: no AXI-AP found, using the CPU for memory access",
+				target_name(target));
+			aarch64->memaccess_mode = AARCH64_MEMACCESS_CPU;
+			return NULL;
+		}
+	} else {
+		ap = dap_ap(dap, aarch64->sysap_num);
+	}
+
+	retval = mem_ap_init(ap);
+	if (retval != ERROR_OK) {
+		LOG_WARNING("%s: cannot initialize MEM-AP #%d, using the CPU for memory access",
+			target_name(target), ap->ap_num);
+		aarch64->memaccess_mode = AARCH64_MEMACCESS_CPU;
+		return NULL;
+	}
+
+	LOG_DEBUG("%s: system MEM-AP #%d", target_name(target), ap->ap_num);
+	aarch64->sys_ap = ap;
+	return ap;
+}
+
+static bool aarch64_use_sys_ap(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+
+	if (aarch64->memaccess_mode != AARCH64_MEMACCESS_SYSAP)
+		return false;
+	if (target->state != TARGET_HALTED)
+		return false;
+	if ((uint64_t)size * count < AARCH64_SYSAP_MIN_BYTES || address % size)
+		return false;
+
+	return aarch64_get_sys_ap(target);
+}
+
+/*
+ * Transfer through the system MEM-AP.  With @a translate set, @a address is
+ * a virtual address and is translated one page at a time; otherwise it is
+ * used both as VA for cache maintenance and as PA for the bus access.
+ */
+static int aarch64_sys_ap_access(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint8_t *rbuf, const uint8_t *wbuf, bool translate)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	struct armv8_cache_common *cache = &armv8->armv8_mmu.armv8_cache;
+	target_addr_t va = address;
+	uint32_t remaining = size * count;
+	int retval;
+
+	while (remaining) {
+		uint32_t len = AARCH64_SYSAP_CHUNK - (va & (AARCH64_SYSAP_CHUNK - 1));
+		target_addr_t pa = va;
+
+		if (len > remaining)
+			len = remaining;
+
+		if (translate) {
+			retval = armv8_mmu_translate_va_pa(target, va, &pa, 0);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		/* write back dirty lines so the AP and the caches agree */
+		if (cache->d_u_cache_enabled) {
+			retval = armv8_cache_d_inner_flush_virt(armv8, va, len);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		if (wbuf) {
+			retval = mem_ap_write_buf(aarch64->sys_ap, wbuf, size, len / size, pa);
+			if (retval != ERROR_OK)
+				return retval;
+			if (cache->i_cache_enabled) {
+				retval = armv8_cache_i_inner_inval_virt(armv8, va, len);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			wbuf += len;
+		} else {
+			retval = mem_ap_read_buf(aarch64->sys_ap, rbuf, size, len / size, pa);
+			if (retval != ERROR_OK)
+				return retval;
+			rbuf += len;
+		}
+
+		va += len;
+		remaining -= len;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Remember a range written through the CPU so that flush_cache() only has
+ * to maintain the lines that were actually touched.
+ */
+static void aarch64_record_write(struct target *target, target_addr_t va, size_t size)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_cache_common *cache = &aarch64->armv8_common.armv8_mmu.armv8_cache;
+	size_t total = size, cache_size = 0;
+	int cl;
+
+	if (aarch64->wr_ranges_overflow)
+		return;
+
+	for (unsigned int i = 0; i < aarch64->wr_range_count; i++) {
+		struct aarch64_wr_range *r = &aarch64->wr_ranges[i];
+
+		if (va == r->va + r->size) {
+			r->size += size;
+			size = 0;
+		}
+		total += r->size;
+	}
+
+	/* beyond the outermost cache size a full clean by set/way is cheaper */
+	for (cl = 0; cl < cache->loc; cl++)
+		cache_size = MAX(cache_size, (size_t)cache->arch[cl].d_u_size.cachesize * 1024);
+	if (total > cache_size)
+		goto overflow;
+
+	if (!size)
+		return;
+	if (aarch64->wr_range_count == AARCH64_MAX_WR_RANGES)
+		goto overflow;
+
+	aarch64->wr_ranges[aarch64->wr_range_count].va = va;
+	aarch64->wr_ranges[aarch64->wr_range_count].size = size;
+	aarch64->wr_range_count++;
+	return;
+
+overflow:
+	aarch64->wr_ranges_overflow = true;
+	aarch64->wr_range_count = 0;
+}
+
 static int aarch64_read_phys_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, uint8_t *buffer)
@@ -2483,6 +2650,9 @@ static int aarch64_read_phys_memory(struct target *target,
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
 			return retval;
+		if (aarch64_use_sys_ap(target, address, size, count))
+			return aarch64_sys_ap_access(target, address, size, count,
+					buffer, NULL, false);
 		retval = aarch64_read_cpu_memory(target, address, size, count, buffer);
 	}
 	return retval;
@@ -2505,6 +2675,9 @@ static int aarch64_read_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
+	if (aarch64_use_sys_ap(target, address, size, count))
+		return aarch64_sys_ap_access(target, address, size, count,
+				buffer, NULL, mmu_enabled);
 	return aarch64_read_cpu_memory(target, address, size, count, buffer);
 }
 
@@ -2519,7 +2692,14 @@ static int aarch64_write_phys_memory(struct target *target,
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
 			return retval;
-		return aarch64_write_cpu_memory(target, address, size, count, buffer);
+		if (aarch64_use_sys_ap(target, address, size, count))
+			return aarch64_sys_ap_access(target, address, size, count,
+					NULL, buffer, false);
+		retval = aarch64_write_cpu_memory(target, address, size, count, buffer);
+		/* no VA is known for a physical write, flush_cache() must clean it all */
+		if (retval == ERROR_OK)
+			target_to_aarch64(target)->wr_ranges_overflow = true;
+		return retval;
 	}
 
 	return retval;
@@ -2542,22 +2722,44 @@ static int aarch64_write_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
-	return aarch64_write_cpu_memory(target, address, size, count, buffer);
+	if (aarch64_use_sys_ap(target, address, size, count))
+		return aarch64_sys_ap_access(target, address, size, count,
+				NULL, buffer, mmu_enabled);
+	retval = aarch64_write_cpu_memory(target, address, size, count, buffer);
+	if (retval == ERROR_OK)
+		aarch64_record_write(target, address, size * count);
+	return retval;
 }
 
 static int aarch64_flush_cache(struct target *target)
 {
-	struct armv8_common *armv8 = target_to_armv8(target);
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	struct armv8_cache_common *cache = &armv8->armv8_mmu.armv8_cache;
 	int mmu_enabled = 0;
 	int retval;
 	retval = aarch64_mmu(target, &mmu_enabled);
 
-	if (mmu_enabled) {
+	if (mmu_enabled && !aarch64->wr_ranges_overflow) {
+		/* maintain only the lines written since the last flush */
+		LOG_DEBUG("flush %u written range(s) after write", aarch64->wr_range_count);
+		for (unsigned int i = 0; i < aarch64->wr_range_count && retval == ERROR_OK; i++) {
+			struct aarch64_wr_range *r = &aarch64->wr_ranges[i];
+
+			if (cache->d_u_cache_enabled)
+				retval = armv8_cache_d_inner_flush_virt(armv8, r->va, r->size);
+			if (retval == ERROR_OK && cache->i_cache_enabled)
+				retval = armv8_cache_i_inner_inval_virt(armv8, r->va, r->size);
+		}
+	} else if (mmu_enabled) {
 		/* flush data cache armv8 function to be called */
 		LOG_DEBUG("flush d-cache after write");
-		if (armv8->armv8_mmu.armv8_cache.flush_all_data_cache)
-			armv8->armv8_mmu.armv8_cache.flush_all_data_cache(target);
+		if (cache->flush_all_data_cache)
+			cache->flush_all_data_cache(target);
 	}
+
+	aarch64->wr_range_count = 0;
+	aarch64->wr_ranges_overflow = false;
 	return retval;
 }
 
@@ -2737,6 +2939,8 @@ static int aarch64_examine_first(struct target *target)
 	target->state = TARGET_UNKNOWN;
 	target->debug_reason = DBG_REASON_NOTHALTED;
 	aarch64->isrmasking_mode = AARCH64_ISRMASK_ON;
+	/* looked up again on first use */
+	aarch64->sys_ap = NULL;
 	target_set_examined(target);
 	return ERROR_OK;
 }
@@ -2776,6 +2980,9 @@ static int aarch64_init_arch_info(struct target *target,
 	/* Setup struct aarch64_common */
 	aarch64->common_magic = AARCH64_COMMON_MAGIC;
 	armv8->arm.dap = dap;
+	aarch64->memaccess_mode = AARCH64_MEMACCESS_CPU;
+	aarch64->sysap_num = -1;
+	aarch64->pcsr_space = AARCH64_PCSR_ANY;
 
 	/* register arch-specific functions */
 	armv8->examine_debug_reason = NULL;
@@ -2843,6 +3050,165 @@ static int aarch64_virt2phys(struct target *target, target_addr_t virt,
 	return armv8_mmu_translate_va_pa(target, virt, phys, 1);
 }
 
+/* samples queued per core before each dap_run() */
+#define AARCH64_PCSR_BURST	64
+
+struct aarch64_pcsr_core {
+	struct target *target;
+	uint32_t lo[AARCH64_PCSR_BURST];
+	uint32_t cid[AARCH64_PCSR_BURST];
+	uint32_t hi[AARCH64_PCSR_BURST];
+	uint32_t accepted;
+	uint32_t dropped;
+};
+
+static bool aarch64_pcsr_supported(struct target *target)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	uint32_t devid;
+
+	if (!target_was_examined(target) || !armv8->debug_ap)
+		return false;
+
+	if (mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_EDDEVID, &devid) != ERROR_OK)
+		return false;
+
+	/* EDDEVID.PCSample: 2 = EDPCSR and EDCIDSR, 3 = EDVIDSR too */
+	return (devid & 0xf) >= 2;
+}
+
+/* Sample EDPCSR of every running core of the SMP group through the DAP,
+ * without halting anything.  Reads of EDPCSR[31:0] latch EDCIDSR and
+ * EDPCSR[63:32], which share its 16-byte bank, so each sample costs one
+ * to three AP reads and no TAR updates.  The gmon output only keeps 32
+ * bits of PC; samples can be restricted to kernel or user addresses and
+ * to one CONTEXTIDR with "aarch64 pcsr_filter".
+ */
+static int aarch64_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+	struct armv8_common *armv8 = &aarch64->armv8_common;
+	struct adiv5_dap *dap = armv8->arm.dap;
+	bool need_hi = aarch64->pcsr_space != AARCH64_PCSR_ANY;
+	bool need_cid = aarch64->pcsr_cid_filter;
+	struct aarch64_pcsr_core *cores;
+	struct target_list *head;
+	unsigned int num_cores = 0;
+	struct timeval timeout, now;
+	uint32_t sample_count = 0;
+	int retval = ERROR_OK;
+
+	if (!aarch64_pcsr_supported(target)) {
+		LOG_TARGET_INFO(target, "EDPCSR sampling not supported on this processor.");
+		return target_profiling_default(target, samples, max_num_samples, num_samples, seconds);
+	}
+
+	if (target->smp) {
+		foreach_smp_target(head, target->smp_targets)
+			num_cores++;
+	} else {
+		num_cores = 1;
+	}
+
+	cores = calloc(num_cores, sizeof(*cores));
+	if (!cores) {
+		LOG_ERROR("No memory for PC samples");
+		return ERROR_FAIL;
+	}
+
+	num_cores = 0;
+	if (target->smp) {
+		foreach_smp_target(head, target->smp_targets) {
+			struct target *curr = head->target;
+
+			if (curr != target && (target_to_armv8(curr)->arm.dap != dap
+					|| !aarch64_pcsr_supported(curr))) {
+				LOG_TARGET_WARNING(curr, "not sampled");
+				continue;
+			}
+			cores[num_cores++].target = curr;
+		}
+	} else {
+		cores[num_cores++].target = target;
+	}
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+	if (retval != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Error while resuming target");
+		free(cores);
+		return retval;
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	LOG_TARGET_INFO(target, "Starting AArch64 profiling. Sampling EDPCSR of %u core%s as fast as we can...",
+			num_cores, num_cores == 1 ? "" : "s");
+
+	while (sample_count < max_num_samples) {
+		for (unsigned int c = 0; c < num_cores && retval == ERROR_OK; c++) {
+			struct armv8_common *curr = target_to_armv8(cores[c].target);
+			target_addr_t base = curr->debug_base;
+
+			for (unsigned int k = 0; k < AARCH64_PCSR_BURST && retval == ERROR_OK; k++) {
+				retval = mem_ap_read_u32(curr->debug_ap, base + CPUV8_DBG_EDPCSR_LO,
+						&cores[c].lo[k]);
+				if (retval == ERROR_OK && need_cid)
+					retval = mem_ap_read_u32(curr->debug_ap, base + CPUV8_DBG_EDCIDSR,
+							&cores[c].cid[k]);
+				if (retval == ERROR_OK && need_hi)
+					retval = mem_ap_read_u32(curr->debug_ap, base + CPUV8_DBG_EDPCSR_HI,
+							&cores[c].hi[k]);
+			}
+		}
+		if (retval == ERROR_OK)
+			retval = dap_run(dap);
+		if (retval != ERROR_OK) {
+			LOG_TARGET_ERROR(target, "Error while reading EDPCSR");
+			break;
+		}
+
+		for (unsigned int k = 0; k < AARCH64_PCSR_BURST; k++) {
+			for (unsigned int c = 0; c < num_cores && sample_count < max_num_samples; c++) {
+				struct aarch64_pcsr_core *core = &cores[c];
+				bool kernel = core->hi[k] & 0x80000000;
+
+				/* all ones: in Debug state, or sampling is prohibited */
+				if (core->lo[k] == 0xffffffff
+						|| (need_cid && core->cid[k] != aarch64->pcsr_cid)
+						|| (aarch64->pcsr_space == AARCH64_PCSR_KERNEL && !kernel)
+						|| (aarch64->pcsr_space == AARCH64_PCSR_USER && kernel)) {
+					core->dropped++;
+					continue;
+				}
+
+				samples[sample_count++] = core->lo[k];
+				core->accepted++;
+			}
+		}
+
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&now, &timeout) > 0)
+			break;
+	}
+
+	if (retval == ERROR_OK) {
+		LOG_TARGET_INFO(target, "Profiling completed. %" PRIu32 " samples.", sample_count);
+		for (unsigned int c = 0; c < num_cores; c++)
+			LOG_TARGET_INFO(cores[c].target, "%" PRIu32 " samples kept, %" PRIu32 " dropped",
+					cores[c].accepted, cores[c].dropped);
+	}
+
+	free(cores);
+	*num_samples = sample_count;
+	return retval;
+}
+
 /*
  * private target configuration items
  */
@@ -3277,6 +3643,87 @@ COMMAND_HANDLER(aarch64_mask_interrupts_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(aarch64_memaccess_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+
+	static const struct jim_nvp nvp_memaccess_modes[] = {
+		{ .name = "cpu", .value = AARCH64_MEMACCESS_CPU },
+		{ .name = "sysap", .value = AARCH64_MEMACCESS_SYSAP },
+		{ .name = NULL, .value = -1 },
+	};
+	const struct jim_nvp *n;
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC > 0) {
+		n = jim_nvp_name2value_simple(nvp_memaccess_modes, CMD_ARGV[0]);
+		if (!n->name) {
+			LOG_ERROR("Unknown parameter: %s - should be cpu or sysap", CMD_ARGV[0]);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+		if (CMD_ARGC > 1) {
+			if (n->value != AARCH64_MEMACCESS_SYSAP)
+				return ERROR_COMMAND_SYNTAX_ERROR;
+			uint8_t ap_num;
+			COMMAND_PARSE_NUMBER(u8, CMD_ARGV[1], ap_num);
+			aarch64->sysap_num = ap_num;
+		} else if (n->value == AARCH64_MEMACCESS_SYSAP) {
+			aarch64->sysap_num = -1;
+		}
+
+		aarch64->memaccess_mode = n->value;
+		aarch64->sys_ap = NULL;
+	}
+
+	n = jim_nvp_value2name_simple(nvp_memaccess_modes, aarch64->memaccess_mode);
+	if (aarch64->memaccess_mode == AARCH64_MEMACCESS_SYSAP && aarch64->sysap_num >= 0)
+		command_print(CMD, "aarch64 memory access %s %d", n->name, aarch64->sysap_num);
+	else
+		command_print(CMD, "aarch64 memory access %s", n->name);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(aarch64_pcsr_filter_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct aarch64_common *aarch64 = target_to_aarch64(target);
+
+	static const struct jim_nvp nvp_pcsr_spaces[] = {
+		{ .name = "any", .value = AARCH64_PCSR_ANY },
+		{ .name = "kernel", .value = AARCH64_PCSR_KERNEL },
+		{ .name = "user", .value = AARCH64_PCSR_USER },
+		{ .name = NULL, .value = -1 },
+	};
+	const struct jim_nvp *n;
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC > 0) {
+		n = jim_nvp_name2value_simple(nvp_pcsr_spaces, CMD_ARGV[0]);
+		if (!n->name) {
+			LOG_ERROR("Unknown parameter: %s - should be any, kernel or user", CMD_ARGV[0]);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+		aarch64->pcsr_space = n->value;
+		aarch64->pcsr_cid_filter = CMD_ARGC > 1;
+		if (CMD_ARGC > 1)
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], aarch64->pcsr_cid);
+	}
+
+	n = jim_nvp_value2name_simple(nvp_pcsr_spaces, aarch64->pcsr_space);
+	if (aarch64->pcsr_cid_filter)
+		command_print(CMD, "aarch64 pcsr filter %s 0x%08" PRIx32, n->name, aarch64->pcsr_cid);
+	else
+		command_print(CMD, "aarch64 pcsr filter %s", n->name);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(aarch64_ap_rw_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -3545,6 +3992,20 @@ static const struct command_registration aarch64_exec_command_handlers[] = {
 		.help = "mask aarch64 interrupts during single-step",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "memaccess",
+		.handler = aarch64_memaccess_command,
+		.mode = COMMAND_ANY,
+		.help = "select how bulk memory transfers reach the target memory",
+		.usage = "['cpu'|'sysap' [ap_num]]",
+	},
+	{
+		.name = "pcsr_filter",
+		.handler = aarch64_pcsr_filter_command,
+		.mode = COMMAND_ANY,
+		.help = "select which EDPCSR samples the profile command keeps",
+		.usage = "[('any'|'kernel'|'user') [context_id]]",
+	},
 	{
 		.name = "mcr",
 		.mode = COMMAND_EXEC,
@@ -3656,4 +4117,5 @@ struct target_type aarch64_target = {
 	.write_phys_memory = aarch64_write_phys_memory,
 	.mmu = aarch64_mmu,
 	.virt2phys = aarch64_virt2phys,
+	.profiling = aarch64_profiling,
 };
@@ -41,6 +41,26 @@ enum aarch64_isrmasking_mode {
 	AARCH64_ISRMASK_ON,
 };
 
+enum aarch64_memaccess_mode {
+	AARCH64_MEMACCESS_CPU,
+	AARCH64_MEMACCESS_SYSAP,
+};
+
+/* virtual address ranges written since the last cache flush */
+#define AARCH64_MAX_WR_RANGES 32
+
+/* which EDPCSR samples "profile" keeps */
+enum aarch64_pcsr_space {
+	AARCH64_PCSR_ANY,
+	AARCH64_PCSR_KERNEL,
+	AARCH64_PCSR_USER,
+};
+
+struct aarch64_wr_range {
+	target_addr_t va;
+	size_t size;
+};
+
 struct aarch64_brp {
 	int used;
 	int type;
@@ -70,6 +90,20 @@ struct aarch64_common {
 	struct armv8_common armv8_common;
 
 	enum aarch64_isrmasking_mode isrmasking_mode;
+
+	/* Bulk memory access through a system MEM-AP */
+	enum aarch64_memaccess_mode memaccess_mode;
+	int sysap_num;
+	struct adiv5_ap *sys_ap;
+
+	struct aarch64_wr_range wr_ranges[AARCH64_MAX_WR_RANGES];
+	unsigned int wr_range_count;
+	bool wr_ranges_overflow;
+
+	/* PC sampling filter */
+	enum aarch64_pcsr_space pcsr_space;
+	bool pcsr_cid_filter;
+	uint32_t pcsr_cid;
 };
 
 static inline struct aarch64_common *
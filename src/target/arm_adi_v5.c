@@ -198,6 +198,70 @@ static void mem_ap_update_tar_cache(struct adiv5_ap *ap)
 		ap->tar_value += inc;
 }
 
+/* probing stops here, TAR rewrites every 64 KiB cost nothing measurable */
+#define TAR_AUTOINCR_BLOCK_MAX (1 << 16)
+
+/*
+ * Find out whether TAR autoincrement carries across @a boundary, an odd
+ * multiple of the current block size.  Reads at boundary - size and at
+ * boundary; if TAR wraps the second read hits boundary - block instead.
+ * The caller makes sure that both places are readable.
+ */
+static void mem_ap_probe_tar_carry(struct adiv5_ap *ap, uint32_t csw_size,
+		uint32_t size, target_addr_t boundary)
+{
+	uint32_t data[2];
+	target_addr_t tar;
+
+	int retval = mem_ap_setup_csw(ap, csw_size | CSW_ADDRINC_SINGLE);
+	if (retval == ERROR_OK)
+		retval = mem_ap_setup_tar(ap, boundary - size);
+	if (retval == ERROR_OK)
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, &data[0]);
+	if (retval == ERROR_OK)
+		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, &data[1]);
+	ap->tar_valid = false;
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_tar(ap, &tar);
+
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("MEM_AP TAR autoincrement probe failed, keeping %" PRIu32 " bytes",
+				ap->tar_autoincr_block);
+		ap->tar_autoincr_probe = false;
+		return;
+	}
+
+	if (tar != boundary + size) {
+		LOG_DEBUG("MEM_AP TAR autoincrement block: %" PRIu32 " bytes", ap->tar_autoincr_block);
+		ap->tar_autoincr_probe = false;
+		return;
+	}
+
+	ap->tar_autoincr_block <<= 1;
+	if (ap->tar_autoincr_block >= TAR_AUTOINCR_BLOCK_MAX)
+		ap->tar_autoincr_probe = false;
+	LOG_DEBUG("MEM_AP TAR autoincrement block: at least %" PRIu32 " bytes", ap->tar_autoincr_block);
+}
+
+/*
+ * Probe the TAR autoincrement block inside a read of [address, address +
+ * nbytes).  The boundary is chosen with a whole block of the range in
+ * front of it, so a wrapping TAR only re-reads memory the caller asked for.
+ */
+static void mem_ap_probe_tar_autoincr(struct adiv5_ap *ap, uint32_t csw_size,
+		uint32_t size, target_addr_t address, size_t nbytes)
+{
+	target_addr_t block = ap->tar_autoincr_block;
+	target_addr_t boundary = (address + 2 * block - 1) & ~(block - 1);
+
+	if (!(boundary & block))
+		boundary += block;
+	if (boundary + size > address + nbytes)
+		return;
+
+	mem_ap_probe_tar_carry(ap, csw_size, size, boundary);
+}
+
 /**
  * Queue transactions setting up transfer parameters for the
  * currently selected MEM-AP.
@@ -514,6 +578,9 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	if (ap->unaligned_access_bad && (adr % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	if (addrinc && ap->tar_autoincr_probe && !dap->ti_be_32_quirks)
+		mem_ap_probe_tar_autoincr(ap, csw_size, size, adr, nbytes);
+
 	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
 	 * over-allocation if packed transfers are going to be used, but determining the real need at
 	 * this point would be messy. */
@@ -837,6 +904,21 @@ int mem_ap_init(struct adiv5_ap *ap)
 	 * operations are supported on other processors. */
 	ap->unaligned_access_bad = dap->ti_be_32_quirks;
 
+	/* A ROM table spans 4 KiB of side effect free registers, enough to
+	 * check the 1 KiB and 2 KiB boundaries.  Larger blocks are probed
+	 * later on by the reads themselves. */
+	if (ap->tar_autoincr_probe && !dap->ti_be_32_quirks) {
+		target_addr_t dbgbase;
+		uint32_t apid;
+
+		retval = dap_get_debugbase(ap, &dbgbase, &apid);
+		if (retval == ERROR_OK && dbgbase != 0xFFFFFFFF && (dbgbase & 0x3) == 0x3) {
+			dbgbase &= ~(target_addr_t)0xFFF;
+			while (ap->tar_autoincr_probe && ap->tar_autoincr_block < 0x1000)
+				mem_ap_probe_tar_carry(ap, CSW_32BIT, 4, dbgbase + ap->tar_autoincr_block);
+		}
+	}
+
 	LOG_DEBUG("MEM_AP CFG: large data %d, long address %d, big-endian %d",
 			!!(cfg & MEM_AP_REG_CFG_LD), !!(cfg & MEM_AP_REG_CFG_LA), !!(cfg & MEM_AP_REG_CFG_BE));
 
@@ -1837,6 +1919,38 @@ COMMAND_HANDLER(dap_memaccess_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(dap_tar_autoincr_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	struct adiv5_ap *ap = dap_ap(dap, dap->apsel);
+	uint32_t block;
+
+	switch (CMD_ARGC) {
+	case 0:
+		break;
+	case 1:
+		if (!strcmp(CMD_ARGV[0], "probe")) {
+			ap->tar_autoincr_probe = true;
+			break;
+		}
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], block);
+		if (block < (1 << 10) || (block & (block - 1))) {
+			command_print(CMD, "block size must be a power of 2, at least 1024");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		ap->tar_autoincr_block = block;
+		ap->tar_autoincr_probe = false;
+		break;
+	default:
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD, "TAR autoincrement block %" PRIu32 " bytes%s",
+			ap->tar_autoincr_block, ap->tar_autoincr_probe ? " (probing)" : "");
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(dap_apsel_command)
 {
 	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
@@ -2117,6 +2231,14 @@ const struct command_registration dap_instance_commands[] = {
 			"bus access [0-255]",
 		.usage = "[cycles]",
 	},
+	{
+		.name = "tar_autoincr",
+		.handler = dap_tar_autoincr_command,
+		.mode = COMMAND_ANY,
+		.help = "set/get the TAR autoincrement block of the current AP, "
+			"or let it be probed",
+		.usage = "['probe'|bytes]",
+	},
 	{
 		.name = "ti_be_32_quirks",
 		.handler = dap_ti_be_32_quirks_command,
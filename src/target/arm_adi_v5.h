@@ -248,6 +248,9 @@ struct adiv5_ap {
 	/* Size of TAR autoincrement block, ARM ADI Specification requires at least 10 bits */
 	uint32_t tar_autoincr_block;
 
+	/* true while the real TAR autoincrement block is still being probed */
+	bool tar_autoincr_probe;
+
 	/* true if packed transfers are supported by the MEM-AP */
 	bool packed_transfers;
 
@@ -255,6 +255,12 @@ static inline bool is_armv8(struct armv8_common *armv8)
 #define CPUV8_DBG_LOCKACCESS 0xFB0
 #define CPUV8_DBG_LOCKSTATUS 0xFB4
 
+#define CPUV8_DBG_EDPCSR_LO	0x0A0
+#define CPUV8_DBG_EDCIDSR	0x0A4
+#define CPUV8_DBG_EDVIDSR	0x0A8
+#define CPUV8_DBG_EDPCSR_HI	0x0AC
+#define CPUV8_DBG_EDDEVID	0xFC8
+
 #define CPUV8_DBG_EDESR		0x20
 #define CPUV8_DBG_EDECR		0x24
 #define CPUV8_DBG_EDWAR0	0x30
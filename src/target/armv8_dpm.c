@@ -730,6 +730,61 @@ static int dpmv8_write_reg(struct arm_dpm *dpm, struct reg *r, unsigned regnum)
 	return retval;
 }
 
+/*
+ * Snapshot X0..X30 with a single DAP transaction.  Each register costs an
+ * ITR write and two DTR reads that are only queued; DSCR is checked once
+ * at the end instead of polling ITE/TXfull around every instruction.
+ * Only valid in AArch64 state.  If the core reports an ITR overrun or a
+ * DTR underrun, nothing is cached and the caller falls back to the
+ * per-register path.
+ */
+static int dpmv8_read_gp_regs_batched(struct arm_dpm *dpm)
+{
+	struct armv8_common *armv8 = dpm->arm->arch_info;
+	struct arm *arm = dpm->arm;
+	uint32_t lvalue[ARMV8_R30 + 1], hvalue[ARMV8_R30 + 1];
+	uint32_t dscr;
+	int retval = ERROR_OK;
+
+	for (unsigned int i = ARMV8_R0; i <= ARMV8_R30 && retval == ERROR_OK; i++) {
+		retval = mem_ap_write_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_ITR,
+				ARMV8_MSR_GP(SYSTEM_DBG_DBGDTR_EL0, i));
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRTX, &lvalue[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRRX, &hvalue[i]);
+	}
+	if (retval == ERROR_OK)
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	dpm->dscr = dscr;
+	if (dscr & (DSCR_ERR | DSCR_TXU | DSCR_SYS_ERROR_PEND)) {
+		LOG_DEBUG("batched register read failed, dscr = 0x%08" PRIx32, dscr);
+		mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = ARMV8_R0; i <= ARMV8_R30; i++) {
+		struct reg *r = armv8_reg_current(arm, i);
+		if (r->valid)
+			continue;
+		buf_set_u64(r->value, 0, 64, (uint64_t)hvalue[i] << 32 | lvalue[i]);
+		r->valid = true;
+		r->dirty = false;
+	}
+
+	return ERROR_OK;
+}
+
 /**
  * Read basic registers of the current context:  R0 to R15, and CPSR;
  * sets the core mode (such as USR or IRQ) and state (such as ARM or Thumb).
@@ -752,6 +807,14 @@ int armv8_dpm_read_current_registers(struct arm_dpm *dpm)
 
 	cache = arm->core_cache;
 
+	/* grab all general purpose registers at once when possible; anything
+	 * left invalid is picked up one by one below */
+	if (armv8_dpm_get_core_state(dpm) == ARM_STATE_AARCH64) {
+		retval = dpmv8_read_gp_regs_batched(dpm);
+		if (retval != ERROR_OK)
+			LOG_DEBUG("falling back to single register reads");
+	}
+
 	/* read R0 first (it's used for scratch), then CPSR */
 	r = cache->reg_list + ARMV8_R0;
 	if (!r->valid) {
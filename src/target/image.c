@@ -35,6 +35,8 @@
 #include "image.h"
 #include "target.h"
 #include <helper/log.h>
+#include <helper/configuration.h>
+#include <sys/stat.h>
 
 /* convert ELF header field to host endianness */
 #define field16(elf, field) \
@@ -49,6 +51,38 @@
 	((elf->endianness == ELFDATA2LSB) ? \
 	le_to_h_u64((uint8_t *)&field) : be_to_h_u64((uint8_t *)&field))
 
+/* parsed images kept around for reuse, most recently used first */
+#define IMAGE_CACHE_MAX_ENTRIES		4
+
+struct image_cache_section {
+	target_addr_t base_address;
+	uint32_t size;
+	uint64_t flags;
+	const uint8_t *data;	/* section contents, in the file mapping or buffer */
+	bool crc_valid;
+	uint32_t crc;
+};
+
+struct image_cache_entry {
+	char *path;				/* canonical file name */
+	enum image_type type;
+	time_t mtime;
+	long mtime_nsec;
+	uint64_t ino;
+	uint64_t size;
+	struct fileio *fileio;	/* kept open for sections mapped from the file */
+	uint8_t *buffer;		/* decoded ihex/s19 data */
+	unsigned int num_sections;
+	struct image_cache_section *sections;	/* not relocated */
+	bool start_address_set;
+	uint32_t start_address;
+	unsigned int refcount;	/* open images using this entry */
+	bool stale;				/* file changed, free on last release */
+	struct image_cache_entry *next;
+};
+
+static struct image_cache_entry *image_cache;
+
 static int autodetect_image_type(struct image *image, const char *url)
 {
 	int retval;
@@ -771,8 +805,14 @@ static int image_sparse_read_raw_section(struct image_sparse *sparse,
 {
 	int retval;
 	size_t really_read;
+	const uint8_t *data;
 
 	*read_size = MIN(size, chk->size - offset);
+	if (fileio_map(sparse->fileio, chk->input_offset + offset, *read_size, &data) == ERROR_OK) {
+		memcpy(buffer, data, *read_size);
+		return ERROR_OK;
+	}
+
 	retval = fileio_seek(sparse->fileio, chk->input_offset + offset);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("cannot find sparse chunk content, seek failed");
@@ -797,7 +837,7 @@ static int image_sparse_read_fill_section(struct image_sparse *sparse,
 	size_t fill_size, really_read;
 	int retval;
 	uint32_t fill_value;
-	uint8_t *fill_buffer;
+	uint8_t fill_bytes[4];
 
 	fill_size = chk->chunk_header->chunk_sz * sparse->header->blk_sz;
 	retval = fileio_seek(sparse->fileio, chk->input_offset);
@@ -812,16 +852,14 @@ static int image_sparse_read_fill_section(struct image_sparse *sparse,
 		return retval;
 	}
 
-	fill_buffer = malloc(fill_size);
-	for (size_t i = 0; i < fill_size; i += 4) {
-		fill_buffer[i] = fill_value;
-		fill_buffer[i+1] = fill_value >> 8;
-		fill_buffer[i+2] = fill_value >> 16;
-		fill_buffer[i+3] = fill_value >> 24;
-	}
-	*read_size = MIN(size, fill_size);
-	memcpy(buffer, (fill_buffer + offset), *read_size);
-	free(fill_buffer);
+	/* replicate the fill word straight into the caller's buffer */
+	fill_bytes[0] = fill_value;
+	fill_bytes[1] = fill_value >> 8;
+	fill_bytes[2] = fill_value >> 16;
+	fill_bytes[3] = fill_value >> 24;
+	*read_size = MIN(size, fill_size - offset);
+	for (size_t i = 0; i < *read_size; i++)
+		buffer[i] = fill_bytes[(offset + i) & 3];
 	return ERROR_OK;
 }
 
@@ -1172,13 +1210,262 @@ static int image_sparse_read_headers(struct image *image)
 	return image_sparse_read_chunk_headers(image);
 }
 
-int image_open(struct image *image, const char *url, const char *type_string)
+static bool image_cache_type_supported(enum image_type type)
 {
-	int retval = ERROR_OK;
+	return type == IMAGE_BINARY || type == IMAGE_IHEX || type == IMAGE_ELF
+		|| type == IMAGE_SRECORD || type == IMAGE_SPARSE;
+}
 
-	retval = identify_image_type(image, type_string, url);
-	if (retval != ERROR_OK)
-		return retval;
+static void image_cache_free_entry(struct image_cache_entry *entry)
+{
+	if (entry->fileio)
+		fileio_close(entry->fileio);
+	free(entry->sections);
+	free(entry->buffer);
+	free(entry->path);
+	free(entry);
+}
+
+/* drop unreferenced entries beyond IMAGE_CACHE_MAX_ENTRIES, least recently used first */
+static void image_cache_trim(void)
+{
+	struct image_cache_entry **prev = &image_cache;
+	unsigned int count = 0;
+
+	while (*prev) {
+		struct image_cache_entry *entry = *prev;
+
+		if (++count > IMAGE_CACHE_MAX_ENTRIES && !entry->refcount) {
+			*prev = entry->next;
+			image_cache_free_entry(entry);
+			continue;
+		}
+		prev = &entry->next;
+	}
+}
+
+/* nanoseconds of the modification time, so that rebuilds within the same
+ * second are noticed */
+static long image_cache_mtime_nsec(const struct stat *st)
+{
+#if defined(__APPLE__)
+	return st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+	return 0;
+#else
+	return st->st_mtim.tv_nsec;
+#endif
+}
+
+/* canonical name of a file, so that different paths to it share an entry */
+static char *image_cache_canonical_path(const char *path)
+{
+#ifdef _WIN32
+	return _fullpath(NULL, path, 0);
+#else
+	return realpath(path, NULL);
+#endif
+}
+
+static struct image_cache_entry *image_cache_lookup(const char *path,
+	enum image_type type, const struct stat *st)
+{
+	struct image_cache_entry **prev = &image_cache;
+
+	for (struct image_cache_entry *entry = image_cache; entry; entry = entry->next) {
+		if (entry->type != type || strcmp(entry->path, path) != 0) {
+			prev = &entry->next;
+			continue;
+		}
+
+		*prev = entry->next;
+		if (entry->mtime == st->st_mtime && entry->mtime_nsec == image_cache_mtime_nsec(st)
+				&& entry->ino == (uint64_t)st->st_ino && entry->size == (uint64_t)st->st_size) {
+			/* move to the front, most recently used */
+			entry->next = image_cache;
+			image_cache = entry;
+			return entry;
+		}
+
+		LOG_DEBUG("image %s changed on disk, dropping cached copy", path);
+		entry->next = NULL;
+		entry->stale = true;
+		if (!entry->refcount)
+			image_cache_free_entry(entry);
+		return NULL;
+	}
+
+	return NULL;
+}
+
+static int image_cache_attach(struct image *image, struct image_cache_entry *entry)
+{
+	struct imagesection *sections = NULL;
+
+	if (entry->num_sections) {
+		sections = malloc(entry->num_sections * sizeof(struct imagesection));
+		if (!sections) {
+			LOG_ERROR("insufficient memory to perform operation");
+			return ERROR_FAIL;
+		}
+	}
+
+	for (unsigned int i = 0; i < entry->num_sections; i++) {
+		sections[i].base_address = entry->sections[i].base_address;
+		sections[i].size = entry->sections[i].size;
+		sections[i].flags = entry->sections[i].flags;
+		sections[i].private = NULL;
+	}
+
+	image->type = entry->type;
+	image->type_private = NULL;
+	image->num_sections = entry->num_sections;
+	image->sections = sections;
+	if (entry->start_address_set) {
+		image->start_address_set = true;
+		image->start_address = entry->start_address;
+	}
+
+	entry->refcount++;
+	image->cache = entry;
+
+	return ERROR_OK;
+}
+
+static void image_cache_release(struct image_cache_entry *entry)
+{
+	assert(entry->refcount);
+
+	entry->refcount--;
+	if (entry->stale) {
+		if (!entry->refcount)
+			image_cache_free_entry(entry);
+	} else {
+		image_cache_trim();
+	}
+}
+
+/* offset of a section's data in the image file, if it is stored there verbatim */
+static bool image_section_file_offset(struct image *image, unsigned int section,
+	uint64_t *offset)
+{
+	if (image->type == IMAGE_BINARY) {
+		*offset = 0;
+		return true;
+	} else if (image->type == IMAGE_ELF) {
+		struct image_elf *elf = image->type_private;
+
+		if (elf->is_64_bit) {
+			Elf64_Phdr *segment = image->sections[section].private;
+			*offset = field64(elf, segment->p_offset);
+		} else {
+			Elf32_Phdr *segment = image->sections[section].private;
+			*offset = field32(elf, segment->p_offset);
+		}
+		return true;
+	} else if (image->type == IMAGE_SPARSE) {
+		Sparse_Chk *chk = image->sections[section].private;
+
+		if (chk->chunk_header->chunk_type != CHUNK_TYPE_RAW)
+			return false;
+		*offset = chk->input_offset;
+		return true;
+	}
+
+	return false;
+}
+
+/* Turn a freshly parsed image into a cache entry. Section data is taken
+ * from the file mapping where it is stored verbatim in a mapped file, ihex
+ * and s19 keep their decoded buffer. Images with any other section, e.g.
+ * sparse FILL chunks or any file when mapping is not available, are not
+ * cached: their sections stay lazy instead of being copied to the heap.
+ * On any failure the image is left untouched and simply stays uncached. */
+static void image_cache_populate(struct image *image, const char *path,
+	const struct stat *st)
+{
+	struct image_cache_entry *entry;
+	struct image parsed;
+	bool mapped = false;
+
+	entry = calloc(1, sizeof(struct image_cache_entry));
+	if (!entry)
+		return;
+
+	entry->path = strdup(path);
+	entry->type = image->type;
+	entry->mtime = st->st_mtime;
+	entry->mtime_nsec = image_cache_mtime_nsec(st);
+	entry->ino = st->st_ino;
+	entry->size = st->st_size;
+	entry->num_sections = image->num_sections;
+	entry->start_address_set = image->start_address_set;
+	entry->start_address = image->start_address;
+	if (image->num_sections)
+		entry->sections = calloc(image->num_sections, sizeof(struct image_cache_section));
+	if (!entry->path || (image->num_sections && !entry->sections)) {
+		image_cache_free_entry(entry);
+		return;
+	}
+
+	if (image->type != IMAGE_IHEX && image->type != IMAGE_SRECORD
+			&& fileio_open(&entry->fileio, path, FILEIO_READ, FILEIO_BINARY) != ERROR_OK)
+		entry->fileio = NULL;
+
+	for (unsigned int i = 0; i < image->num_sections; i++) {
+		struct image_cache_section *section = &entry->sections[i];
+		uint64_t offset;
+
+		section->base_address = image->sections[i].base_address;
+		section->size = image->sections[i].size;
+		section->flags = image->sections[i].flags;
+
+		if (entry->fileio && image_section_file_offset(image, i, &offset)
+				&& fileio_map(entry->fileio, offset, section->size, &section->data) == ERROR_OK) {
+			mapped = true;
+			continue;
+		}
+
+		if (image->type == IMAGE_IHEX || image->type == IMAGE_SRECORD) {
+			section->data = image->sections[i].private;
+		} else if (section->size) {
+			image_cache_free_entry(entry);
+			return;
+		}
+	}
+
+	/* only empty sections, nothing to keep the file open for */
+	if (entry->fileio && !mapped) {
+		fileio_close(entry->fileio);
+		entry->fileio = NULL;
+	}
+
+	parsed = *image;
+	if (image_cache_attach(image, entry) != ERROR_OK) {
+		image_cache_free_entry(entry);
+		return;
+	}
+
+	/* the decoded ihex/s19 data now belongs to the cache */
+	if (parsed.type == IMAGE_IHEX) {
+		struct image_ihex *image_ihex = parsed.type_private;
+		entry->buffer = image_ihex->buffer;
+		image_ihex->buffer = NULL;
+	} else if (parsed.type == IMAGE_SRECORD) {
+		struct image_mot *image_mot = parsed.type_private;
+		entry->buffer = image_mot->buffer;
+		image_mot->buffer = NULL;
+	}
+	image_close(&parsed);
+
+	entry->next = image_cache;
+	image_cache = entry;
+	image_cache_trim();
+}
+
+static int image_open_sections(struct image *image, const char *url)
+{
+	int retval = ERROR_OK;
 
 	if (image->type == IMAGE_BINARY) {
 		struct image_binary *image_binary;
@@ -1286,6 +1573,48 @@ int image_open(struct image *image, const char *url, const char *type_string)
 		image->type_private = NULL;
 	}
 
+	return retval;
+}
+
+int image_open(struct image *image, const char *url, const char *type_string)
+{
+	struct image_cache_entry *entry = NULL;
+	char *path = NULL;
+	struct stat st;
+	int retval = ERROR_OK;
+
+	image->cache = NULL;
+
+	retval = identify_image_type(image, type_string, url);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (image_cache_type_supported(image->type)) {
+		char *found = find_file(url);
+		if (found) {
+			path = image_cache_canonical_path(found);
+			free(found);
+		}
+		if (path && (stat(path, &st) != 0 || !S_ISREG(st.st_mode))) {
+			free(path);
+			path = NULL;
+		}
+		if (path)
+			entry = image_cache_lookup(path, image->type, &st);
+	}
+
+	if (entry) {
+		LOG_DEBUG("using cached image %s", path);
+		retval = image_cache_attach(image, entry);
+	} else {
+		retval = image_open_sections(image, url);
+		if (retval == ERROR_OK && path)
+			image_cache_populate(image, path, &st);
+	}
+	free(path);
+	if (retval != ERROR_OK)
+		return retval;
+
 	image->size = 0;
 	for (unsigned int section = 0; section < image->num_sections; section++) {
 		image->size = image->size + image->sections[section].size;
@@ -1321,6 +1650,13 @@ int image_read_section(struct image *image,
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
+	if (image->cache) {
+		memcpy(buffer, image->cache->sections[section].data + offset, size);
+		*size_read = size;
+
+		return ERROR_OK;
+	}
+
 	if (image->type == IMAGE_BINARY) {
 		struct image_binary *image_binary = image->type_private;
 
@@ -1399,6 +1735,64 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/**
+ * Get a pointer to section data without copying it, when the image keeps
+ * it in memory or in a memory-mapped file. Returns
+ * ERROR_IMAGE_TEMPORARILY_UNAVAILABLE otherwise, in which case the caller
+ * uses image_read_section(). The data is valid until image_close().
+ */
+int image_section_data(struct image *image, int section, target_addr_t offset,
+	uint32_t size, const uint8_t **data)
+{
+	uint64_t file_offset;
+
+	if (offset + size > image->sections[section].size)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (image->cache) {
+		*data = image->cache->sections[section].data + offset;
+		return ERROR_OK;
+	}
+
+	if (image->type == IMAGE_IHEX || image->type == IMAGE_SRECORD
+			|| image->type == IMAGE_BUILDER) {
+		*data = (const uint8_t *)image->sections[section].private + offset;
+		return ERROR_OK;
+	}
+
+	if (image_section_file_offset(image, section, &file_offset)) {
+		struct fileio *fileio;
+
+		if (image->type == IMAGE_BINARY)
+			fileio = ((struct image_binary *)image->type_private)->fileio;
+		else if (image->type == IMAGE_ELF)
+			fileio = ((struct image_elf *)image->type_private)->fileio;
+		else
+			fileio = ((struct image_sparse *)image->type_private)->fileio;
+
+		if (fileio_map(fileio, file_offset + offset, size, data) == ERROR_OK)
+			return ERROR_OK;
+	}
+
+	return ERROR_IMAGE_TEMPORARILY_UNAVAILABLE;
+}
+
+/**
+ * Check if a section is one repeated 32-bit pattern, i.e. a sparse FILL
+ * chunk. Such a section has no data to point at, but any piece of it that
+ * starts at a multiple of 4 is the same as its start: callers expand up to
+ * IMAGE_FILL_PIECE_SIZE bytes once with image_read_section() and write
+ * that piece repeatedly instead of expanding the whole section.
+ */
+bool image_section_is_fill(struct image *image, int section)
+{
+	if (image->cache || image->type != IMAGE_SPARSE)
+		return false;
+
+	Sparse_Chk *chk = image->sections[section].private;
+	return chk->chunk_header->chunk_type == CHUNK_TYPE_FILL;
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, uint64_t flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1438,7 +1832,10 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size, ui
 
 void image_close(struct image *image)
 {
-	if (image->type == IMAGE_BINARY) {
+	if (image->cache) {
+		image_cache_release(image->cache);
+		image->cache = NULL;
+	} else if (image->type == IMAGE_BINARY) {
 		struct image_binary *image_binary = image->type_private;
 
 		fileio_close(image_binary->fileio);
@@ -1484,6 +1881,11 @@ void image_close(struct image *image)
 
 		fileio_close(image_sparse->fileio);
 
+		if (image_sparse->chunks) {
+			for (uint32_t i = 0; i < image_sparse->header->total_chunks; i++)
+				free(image_sparse->chunks[i].chunk_header);
+		}
+
 		free(image_sparse->header);
 		image_sparse->header = NULL;
 
@@ -1504,6 +1906,40 @@ void image_close(struct image *image)
 	image->sections = NULL;
 }
 
+int image_section_checksum(struct image *image, unsigned int section, uint32_t *checksum)
+{
+	uint32_t size = image->sections[section].size;
+	uint8_t *buffer;
+	size_t size_read;
+	int retval;
+
+	if (image->cache) {
+		struct image_cache_section *cached = &image->cache->sections[section];
+
+		if (!cached->crc_valid) {
+			retval = image_calculate_checksum(cached->data, cached->size, &cached->crc);
+			if (retval != ERROR_OK)
+				return retval;
+			cached->crc_valid = true;
+		}
+		*checksum = cached->crc;
+		return ERROR_OK;
+	}
+
+	buffer = malloc(size);
+	if (!buffer) {
+		LOG_ERROR("error allocating buffer for section (%" PRIu32 " bytes)", size);
+		return ERROR_FAIL;
+	}
+
+	retval = image_read_section(image, section, 0x0, size, buffer, &size_read);
+	if (retval == ERROR_OK)
+		retval = image_calculate_checksum(buffer, size_read, checksum);
+
+	free(buffer);
+	return retval;
+}
+
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
 {
 	uint32_t crc = 0xffffffff;
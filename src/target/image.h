@@ -57,6 +57,8 @@ struct imagesection {
 	void *private;		/* private data */
 };
 
+struct image_cache_entry;
+
 struct image {
 	enum image_type type;		/* image type (plain, ihex, ...) */
 	void *type_private;		/* type private data */
@@ -67,6 +69,7 @@ struct image {
 	long long base_address;		/* base address, if one is set */
 	bool start_address_set;	/* whether the image has a start address (entry point) associated */
 	uint32_t start_address;		/* start address, if one is set */
+	struct image_cache_entry *cache;	/* shared parsed file, if cached */
 };
 
 struct image_binary {
@@ -110,9 +113,16 @@ struct image_sparse {
 	Sparse_Chk *chunks;
 };
 
+/* Largest piece of a fill section expanded at once, a multiple of the
+ * 4 byte fill pattern and of common flash block sizes. */
+#define IMAGE_FILL_PIECE_SIZE	(1024 * 1024)
+
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+int image_section_data(struct image *image, int section, target_addr_t offset,
+		uint32_t size, const uint8_t **data);
+bool image_section_is_fill(struct image *image, int section);
 void image_close(struct image *image);
 
 int image_add_section(struct image *image, target_addr_t base, uint32_t size,
@@ -120,6 +130,8 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size,
 
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
+int image_section_checksum(struct image *image, unsigned int section,
+		uint32_t *checksum);
 
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
@@ -188,6 +188,10 @@ typedef struct {
 	 * reads/writes respectively. */
 	unsigned int bus_master_write_delay, bus_master_read_delay;
 
+	/* Number of DMI scans per system bus batch. Adapted at run time between
+	 * RISCV_SBA_BATCH_MIN and RISCV_SBA_BATCH_MAX. */
+	unsigned int bus_master_batch_size;
+
 	/* This value is increased every time we tried to execute two commands
 	 * consecutively, and the second one failed because the previous hadn't
 	 * completed yet.  It's used to add extra run-test/idle cycles after
@@ -2146,6 +2150,9 @@ static int sba_supports_access(struct target *target, unsigned int size_bytes)
 	}
 }
 
+/* Upper bound of DMI operations queued in one memory sampling batch. */
+#define SAMPLE_BATCH_SCANS	512
+
 static int sample_memory_bus_v1(struct target *target,
 								struct riscv_sample_buf *buf,
 								const riscv_sample_config_t *config,
@@ -2171,73 +2178,129 @@ static int sample_memory_bus_v1(struct target *target,
 	uint32_t sbaddress1 = 0;
 	bool sbaddress1_valid = false;
 
-	/* How often to read each value in a batch. */
-	const unsigned int repeat = 5;
-
+	/*
+	 * Group enabled buckets of the same size at consecutive addresses, so
+	 * each group is read with one address write and auto-increment.
+	 */
+	struct {
+		unsigned int first;
+		unsigned int count;
+	} runs[ARRAY_SIZE(config->bucket)];
+	unsigned int run_count = 0;
 	unsigned int enabled_count = 0;
+	unsigned int round_scans = 0;
+	unsigned int round_bytes = 0;
 	for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
-		if (config->bucket[i].enabled)
-			enabled_count++;
+		if (!config->bucket[i].enabled)
+			continue;
+		if (!sba_supports_access(target, config->bucket[i].size_bytes)) {
+			LOG_ERROR("Hardware does not support SBA access for %d-byte memory sampling.",
+					config->bucket[i].size_bytes);
+			return ERROR_NOT_IMPLEMENTED;
+		}
+		if (run_count) {
+			unsigned int prev = runs[run_count - 1].first + runs[run_count - 1].count - 1;
+			if (prev == i - 1 &&
+					config->bucket[prev].size_bytes == config->bucket[i].size_bytes &&
+					config->bucket[prev].address + config->bucket[prev].size_bytes ==
+						config->bucket[i].address) {
+				runs[run_count - 1].count++;
+				round_scans += config->bucket[i].size_bytes > 4 ? 2 : 1;
+				/* sbcs write stopping read-on-data before the last value */
+				if (runs[run_count - 1].count == 2)
+					round_scans++;
+				round_bytes += 1 + config->bucket[i].size_bytes;
+				enabled_count++;
+				continue;
+			}
+		}
+		runs[run_count].first = i;
+		runs[run_count].count = 1;
+		run_count++;
+		/* sbcs, sbaddress1, sbaddress0 and the data reads */
+		round_scans += 3 + (config->bucket[i].size_bytes > 4 ? 2 : 1);
+		round_bytes += 1 + config->bucket[i].size_bytes;
+		enabled_count++;
 	}
 
+	if (!enabled_count)
+		return ERROR_OK;
+
+	/* How often to read each value in a batch. */
+	const unsigned int repeat = MAX(1, SAMPLE_BATCH_SCANS / round_scans);
+
 	while (timeval_ms() < until_ms) {
+		if (buf->used + repeat * round_bytes >= buf->size)
+			riscv_sample_buf_flush(target);
+		if (buf->used + repeat * round_bytes >= buf->size) {
+			riscv_sample_buf_overflow(target);
+			break;
+		}
+
 		/*
 		 * batch_run() adds to the batch, so we can't simply reuse the same
 		 * batch over and over. So we create a new one every time through the
 		 * loop.
 		 */
 		struct riscv_batch *batch = riscv_batch_alloc(
-			target, 1 + enabled_count * 5 * repeat,
+			target, 1 + round_scans * repeat,
 			info->dmi_busy_delay + info->bus_master_read_delay);
 		if (!batch)
 			return ERROR_FAIL;
 
-		unsigned int result_bytes = 0;
 		for (unsigned int n = 0; n < repeat; n++) {
-			for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
-				if (config->bucket[i].enabled) {
-					if (!sba_supports_access(target, config->bucket[i].size_bytes)) {
-						LOG_ERROR("Hardware does not support SBA access for %d-byte memory sampling.",
-								config->bucket[i].size_bytes);
-						return ERROR_NOT_IMPLEMENTED;
-					}
-
-					uint32_t sbcs_write = DM_SBCS_SBREADONADDR;
-					if (enabled_count == 1)
-						sbcs_write |= DM_SBCS_SBREADONDATA;
-					sbcs_write |= sb_sbaccess(config->bucket[i].size_bytes);
-					if (!sbcs_valid || sbcs_write != sbcs) {
-						riscv_batch_add_dmi_write(batch, DM_SBCS, sbcs_write);
-						sbcs = sbcs_write;
-						sbcs_valid = true;
-					}
+			for (unsigned int r = 0; r < run_count; r++) {
+				unsigned int i = runs[r].first;
+				unsigned int count = runs[r].count;
+				target_addr_t address = config->bucket[i].address;
+
+				uint32_t sbcs_write = DM_SBCS_SBREADONADDR;
+				if (enabled_count == 1 || count > 1)
+					sbcs_write |= DM_SBCS_SBREADONDATA;
+				if (count > 1)
+					sbcs_write |= DM_SBCS_SBAUTOINCREMENT;
+				sbcs_write |= sb_sbaccess(config->bucket[i].size_bytes);
+				if (!sbcs_valid || sbcs_write != sbcs) {
+					riscv_batch_add_dmi_write(batch, DM_SBCS, sbcs_write);
+					sbcs = sbcs_write;
+					sbcs_valid = true;
+				}
 
-					if (sbasize > 32 &&
-							(!sbaddress1_valid ||
-							sbaddress1 != config->bucket[i].address >> 32)) {
-						sbaddress1 = config->bucket[i].address >> 32;
-						riscv_batch_add_dmi_write(batch, DM_SBADDRESS1, sbaddress1);
-						sbaddress1_valid = true;
-					}
-					if (!sbaddress0_valid ||
-							sbaddress0 != (config->bucket[i].address & 0xffffffff)) {
-						sbaddress0 = config->bucket[i].address;
-						riscv_batch_add_dmi_write(batch, DM_SBADDRESS0, sbaddress0);
-						sbaddress0_valid = true;
+				if (sbasize > 32 &&
+						(!sbaddress1_valid ||
+						sbaddress1 != address >> 32)) {
+					sbaddress1 = address >> 32;
+					riscv_batch_add_dmi_write(batch, DM_SBADDRESS1, sbaddress1);
+					sbaddress1_valid = true;
+				}
+				if (!sbaddress0_valid ||
+						sbaddress0 != (address & 0xffffffff)) {
+					sbaddress0 = address;
+					riscv_batch_add_dmi_write(batch, DM_SBADDRESS0, sbaddress0);
+					sbaddress0_valid = true;
+				}
+				for (unsigned int k = 0; k < count; k++) {
+					if (count > 1 && k == count - 1) {
+						/* Reading the last value must not start a bus read
+						 * past the group, which may be a peripheral
+						 * register. */
+						sbcs = sbcs_write & ~DM_SBCS_SBREADONDATA;
+						riscv_batch_add_dmi_write(batch, DM_SBCS, sbcs);
 					}
-					if (config->bucket[i].size_bytes > 4)
+					if (config->bucket[i + k].size_bytes > 4)
 						riscv_batch_add_dmi_read(batch, DM_SBDATA1);
 					riscv_batch_add_dmi_read(batch, DM_SBDATA0);
-					result_bytes += 1 + config->bucket[i].size_bytes;
+				}
+				if (count > 1) {
+					/* Auto-increment moved the address past the group. */
+					sbaddress0_valid = false;
+					target_addr_t end = address + count * config->bucket[i].size_bytes;
+					if (end >> 32 != address >> 32)
+						sbaddress1_valid = false;
 				}
 			}
 		}
 
-		if (buf->used + result_bytes >= buf->size) {
-			riscv_batch_free(batch);
-			break;
-		}
-
 		size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
 
 		int result = batch_run(target, batch);
@@ -2251,6 +2314,9 @@ static int sample_memory_bus_v1(struct target *target,
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
 			dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
 			riscv_batch_free(batch);
+			sbcs_valid = false;
+			sbaddress0_valid = false;
+			sbaddress1_valid = false;
 			continue;
 		}
 		if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
@@ -2262,8 +2328,8 @@ static int sample_memory_bus_v1(struct target *target,
 
 		unsigned int read = 0;
 		for (unsigned int n = 0; n < repeat; n++) {
-			for (unsigned int i = 0; i < ARRAY_SIZE(config->bucket); i++) {
-				if (config->bucket[i].enabled) {
+			for (unsigned int r = 0; r < run_count; r++) {
+				for (unsigned int i = runs[r].first; i < runs[r].first + runs[r].count; i++) {
 					assert(i < RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE);
 					uint64_t value = 0;
 					if (config->bucket[i].size_bytes > 4)
@@ -2344,6 +2410,7 @@ static int init_target(struct command_context *cmd_ctx,
 	info->dmi_busy_delay = 0;
 	info->bus_master_read_delay = 0;
 	info->bus_master_write_delay = 0;
+	info->bus_master_batch_size = RISCV_BATCH_ALLOC_SIZE;
 	info->ac_busy_delay = 0;
 
 	/* Assume all these abstract commands are supported until we learn
@@ -2703,8 +2770,31 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+/* Adapt the number of scans per system bus batch: grow while batches go
+ * through cleanly, so that long transfers amortize the adapter round trip
+ * over more words, and back off as soon as the bus or the DMI reports
+ * busy. */
+static void sba_batch_success(struct target *target)
+{
+	RISCV013_INFO(info);
+	if (info->bus_master_batch_size < RISCV_SBA_BATCH_MAX)
+		info->bus_master_batch_size *= 2;
+}
+
+static void sba_batch_busy(struct target *target)
+{
+	RISCV013_INFO(info);
+	if (info->bus_master_batch_size > RISCV_SBA_BATCH_MIN)
+		info->bus_master_batch_size /= 2;
+}
+
 /**
  * Read the requested memory using the system bus interface.
+ *
+ * All words but the last are read with sbreadondata set, in batches whose
+ * last scan reads back sbcs, so a batch costs a single JTAG queue flush.
+ * When a batch hits a busy condition, the words that were read before it
+ * are kept and the transfer restarts at the exact word that failed.
  */
 static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer, uint32_t increment)
@@ -2715,10 +2805,14 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	}
 
 	RISCV013_INFO(info);
-	target_addr_t next_address = address;
-	target_addr_t end_address = address + count * size;
+	static const int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
+	const unsigned int scans_per_word = (size + 3) / 4;
+	assert(size <= 16);
 
-	while (next_address < end_address) {
+	/* Index of the next word that still has to be read. */
+	uint32_t next = 0;
+
+	while (next < count) {
 		uint32_t sbcs_write = set_field(0, DM_SBCS_SBREADONADDR, 1);
 		sbcs_write |= sb_sbaccess(size);
 		if (increment == size)
@@ -2729,7 +2823,7 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 			return ERROR_FAIL;
 
 		/* This address write will trigger the first read. */
-		if (sb_write_address(target, next_address, true) != ERROR_OK)
+		if (sb_write_address(target, address + next * increment, true) != ERROR_OK)
 			return ERROR_FAIL;
 
 		if (info->bus_master_read_delay) {
@@ -2741,60 +2835,109 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		/* First value has been read, and is waiting for us to issue a DMI read
-		 * to get it. */
-
-		static int sbdata[4] = {DM_SBDATA0, DM_SBDATA1, DM_SBDATA2, DM_SBDATA3};
-		assert(size <= 16);
-		target_addr_t next_read = address - 1;
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			for (int j = (size - 1) / 4; j >= 0; j--) {
-				uint32_t value;
-				unsigned attempt = 0;
-				while (1) {
-					if (attempt++ > 100) {
-						LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								  next_read);
-						return ERROR_FAIL;
-					}
-					keep_alive();
-					dmi_status_t status = dmi_scan(target, NULL, &value,
-												   DMI_OP_READ, sbdata[j], 0, false);
-					if (status == DMI_STATUS_BUSY)
-						increase_dmi_busy_delay(target);
-					else if (status == DMI_STATUS_SUCCESS)
+		 * to get it. Every read of sbdata0 starts the next bus read. */
+		uint32_t sbcs_read = 0;
+		bool restart = false;
+		while (next < count - 1) {
+			uint32_t words = MIN(count - 1 - next,
+					info->bus_master_batch_size / scans_per_word);
+			if (words == 0)
+				words = 1;
+
+			struct riscv_batch *batch = riscv_batch_alloc(target,
+					words * scans_per_word + 1,
+					info->dmi_busy_delay + info->bus_master_read_delay);
+			if (!batch)
+				return ERROR_FAIL;
+
+			size_t first_key = 0;
+			for (uint32_t i = 0; i < words; i++)
+				for (int j = scans_per_word - 1; j >= 0; j--) {
+					size_t key = riscv_batch_add_dmi_read(batch, sbdata[j]);
+					if (i == 0 && j == (int)scans_per_word - 1)
+						first_key = key;
+				}
+			size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
+
+			keep_alive();
+			if (batch_run(target, batch) != ERROR_OK) {
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
+
+			/* Copy out every word whose DMI reads all succeeded. */
+			uint32_t good = 0;
+			bool dmi_busy = false;
+			for (uint32_t i = 0; i < words && !dmi_busy; i++) {
+				for (int j = scans_per_word - 1; j >= 0; j--) {
+					size_t key = first_key + i * scans_per_word + (scans_per_word - 1 - j);
+					unsigned int op = riscv_batch_get_dmi_read_op(batch, key);
+					if (op == DMI_STATUS_BUSY) {
+						dmi_busy = true;
 						break;
-					else
+					} else if (op != DMI_STATUS_SUCCESS) {
+						LOG_ERROR("DMI read of sbdata%d failed, status=%d", j, op);
+						riscv_batch_free(batch);
 						return ERROR_FAIL;
+					}
+					uint32_t value = riscv_batch_get_dmi_read_data(batch, key);
+					buf_set_u32(buffer + (next + i) * size + j * 4, 0,
+							8 * MIN(size, 4), value);
+					log_memory_access(address + (next + i) * increment + j * 4,
+							value, MIN(size, 4), true);
 				}
-				if (next_read != address - 1) {
-					buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-					log_memory_access(next_read, value, MIN(size, 4), true);
-				}
-				next_read = address + i * size + j * 4;
+				if (!dmi_busy)
+					good++;
 			}
-		}
+			if (!dmi_busy && riscv_batch_get_dmi_read_op(batch, sbcs_key) == DMI_STATUS_BUSY)
+				dmi_busy = true;
+			if (!dmi_busy)
+				sbcs_read = riscv_batch_get_dmi_read_data(batch, sbcs_key);
+			riscv_batch_free(batch);
 
-		uint32_t sbcs_read = 0;
-		if (count > 1) {
-			uint32_t value;
-			unsigned attempt = 0;
-			while (1) {
-				if (attempt++ > 100) {
-					LOG_ERROR("DMI keeps being busy in while reading memory just past " TARGET_ADDR_FMT,
-								next_read);
+			if (dmi_busy) {
+				/* The DTM ignored everything after the busy response; the bus
+				 * read for word next + good was started but never fetched. */
+				LOG_DEBUG("DMI busy encountered during system bus read.");
+				increase_dmi_busy_delay(target);
+				if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
 					return ERROR_FAIL;
-				}
-				dmi_status_t status = dmi_scan(target, NULL, &value, DMI_OP_NOP, 0, 0, false);
-				if (status == DMI_STATUS_BUSY)
-					increase_dmi_busy_delay(target);
-				else if (status == DMI_STATUS_SUCCESS)
-					break;
-				else
+			}
+
+			if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
+				/* We read while the target was busy. No new bus access was
+				 * started after that, so sbaddress points just past the word
+				 * whose value was lost. */
+				if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
 					return ERROR_FAIL;
+				if (dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR) != ERROR_OK)
+					return ERROR_FAIL;
+				/* Keep only the words known to precede the lost one. */
+				uint32_t batch_good = good;
+				good = 0;
+				if (increment == size) {
+					target_addr_t failed = sb_read_address(target) - size;
+					if (failed >= address + next * size &&
+							failed < address + (next + batch_good) * size)
+						good = (failed - address) / size - next;
+				}
+				info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
 			}
-			buf_set_u32(buffer + next_read - address, 0, 8 * MIN(size, 4), value);
-			log_memory_access(next_read, value, MIN(size, 4), true);
 
+			next += good;
+			if (dmi_busy || get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
+				sba_batch_busy(target);
+				restart = true;
+				break;
+			}
+			if (get_field(sbcs_read, DM_SBCS_SBERROR))
+				break;
+			sba_batch_success(target);
+		}
+		if (restart)
+			continue;
+
+		if (count > 1) {
 			/* "Writes to sbcs while sbbusy is high result in undefined behavior.
 			 * A debugger must not write to sbcs until it reads sbbusy as 0." */
 			if (read_sbcs_nonbusy(target, &sbcs_read) != ERROR_OK)
@@ -2808,7 +2951,7 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		/* Read the last word, after we disabled sbreadondata if necessary. */
 		if (!get_field(sbcs_read, DM_SBCS_SBERROR) &&
 				!get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
-			if (read_memory_bus_word(target, address + (count - 1) * size, size,
+			if (read_memory_bus_word(target, address + (count - 1) * increment, size,
 						buffer + (count - 1) * size) != ERROR_OK)
 				return ERROR_FAIL;
 
@@ -2817,17 +2960,17 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
+			/* We read while the target was busy. Slow down and try again
+			 * with the last word. */
 			if (dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR) != ERROR_OK)
 				return ERROR_FAIL;
-			next_address = sb_read_address(target);
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
 			continue;
 		}
 
 		unsigned error = get_field(sbcs_read, DM_SBCS_SBERROR);
 		if (error == 0) {
-			next_address = end_address;
+			next = count;
 		} else {
 			/* Some error indicating the bus access failed, but not because of
 			 * something we did wrong. */
@@ -3690,7 +3833,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 		struct riscv_batch *batch = riscv_batch_alloc(
 				target,
-				RISCV_BATCH_ALLOC_SIZE,
+				info->bus_master_batch_size,
 				info->dmi_busy_delay + info->bus_master_write_delay);
 		if (!batch)
 			return ERROR_FAIL;
@@ -3698,7 +3841,8 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		for (uint32_t i = (next_address - address) / size; i < count; i++) {
 			const uint8_t *p = buffer + i * size;
 
-			if (riscv_batch_available_scans(batch) < (size + 3) / 4)
+			/* Keep one scan for the sbcs read below. */
+			if (riscv_batch_available_scans(batch) < (size + 3) / 4 + 1)
 				break;
 
 			if (size > 12)
@@ -3733,18 +3877,32 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			next_address += size;
 		}
 
+		/* Read sbcs as part of the same batch, which saves a queue flush
+		 * per batch whenever nothing went wrong. */
+		size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
+
 		/* Execute the batch of writes */
 		result = batch_run(target, batch);
-		riscv_batch_free(batch);
-		if (result != ERROR_OK)
+		if (result != ERROR_OK) {
+			riscv_batch_free(batch);
 			return result;
+		}
 
-		/* Read sbcs value.
-		 * At the same time, detect if DMI busy has occurred during the batch write. */
-		bool dmi_busy_encountered;
-		if (dmi_op(target, &sbcs, &dmi_busy_encountered, DMI_OP_READ,
-				DM_SBCS, 0, false, true) != ERROR_OK)
-			return ERROR_FAIL;
+		/* A busy DMI response anywhere in the batch sticks, so it shows up
+		 * on the sbcs read too. In that case read sbcs again, which also
+		 * detects and clears the busy condition. */
+		bool dmi_busy_encountered = false;
+		if (riscv_batch_get_dmi_read_op(batch, sbcs_key) == DMI_STATUS_SUCCESS) {
+			sbcs = riscv_batch_get_dmi_read_data(batch, sbcs_key);
+		} else {
+			dmi_busy_encountered = true;
+			increase_dmi_busy_delay(target);
+			if (dmi_read(target, &sbcs, DM_SBCS) != ERROR_OK) {
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
+		}
+		riscv_batch_free(batch);
 		if (dmi_busy_encountered)
 			LOG_DEBUG("DMI busy encountered during system bus write.");
 
@@ -3771,6 +3929,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		}
 
 		if (get_field(sbcs, DM_SBCS_SBBUSYERROR) || dmi_busy_encountered) {
+			sba_batch_busy(target);
 			/* Recover from the case when the write commands were issued too fast.
 			 * Determine the address from which to resume writing. */
 			next_address = sb_read_address(target);
@@ -3805,6 +3964,8 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			/* Fail the whole operation */
 			return ERROR_FAIL;
 		}
+
+		sba_batch_success(target);
 	}
 
 	return ERROR_OK;
@@ -4301,8 +4462,89 @@ static int riscv013_on_step(struct target *target)
 	return riscv013_on_step_or_resume(target, true);
 }
 
+/* Read all GPRs into the register cache with a single batch of abstract
+ * commands, instead of one execute_abstract_command() round trip (with its
+ * abstractcs polling) per register. cmderr is only checked once at the end.
+ * On any error nothing is cached, and registers are read on demand as
+ * before. */
+static int read_gprs_batched(struct target *target)
+{
+	RISCV013_INFO(info);
+
+	if (!target->reg_cache)
+		return ERROR_OK;
+
+	unsigned int xlen = riscv_xlen(target);
+	unsigned int last = riscv_supports_extension(target, 'E') ?
+		GDB_REGNO_XPR15 : GDB_REGNO_XPR31;
+
+	if (dm013_select_target(target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	struct riscv_batch *batch = riscv_batch_alloc(target,
+			(last - GDB_REGNO_ZERO) * 3,
+			info->dmi_busy_delay + info->ac_busy_delay);
+	if (!batch)
+		return ERROR_FAIL;
+
+	size_t keys[GDB_REGNO_XPR31 + 1][2];
+	for (unsigned int i = GDB_REGNO_ZERO + 1; i <= last; i++) {
+		uint32_t command = access_register_command(target, i, xlen,
+				AC_ACCESS_REGISTER_TRANSFER);
+		riscv_batch_add_dmi_write(batch, DM_COMMAND, command);
+		keys[i][0] = riscv_batch_add_dmi_read(batch, DM_DATA0);
+		if (xlen > 32)
+			keys[i][1] = riscv_batch_add_dmi_read(batch, DM_DATA1);
+	}
+
+	int result = batch_run(target, batch);
+	if (result != ERROR_OK) {
+		riscv_batch_free(batch);
+		return result;
+	}
+
+	uint32_t abstractcs;
+	bool dmi_busy_encountered;
+	result = dmi_op(target, &abstractcs, &dmi_busy_encountered,
+			DMI_OP_READ, DM_ABSTRACTCS, 0, false, true);
+	if (result == ERROR_OK && get_field(abstractcs, DM_ABSTRACTCS_BUSY))
+		result = wait_for_idle(target, &abstractcs);
+	if (result != ERROR_OK) {
+		riscv_batch_free(batch);
+		return result;
+	}
+
+	info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+	if (info->cmderr != CMDERR_NONE || dmi_busy_encountered) {
+		LOG_TARGET_DEBUG(target, "batched GPR read failed, abstractcs=0x%08x",
+				abstractcs);
+		if (info->cmderr != CMDERR_NONE)
+			riscv013_clear_abstract_error(target);
+		if (info->cmderr == CMDERR_BUSY || dmi_busy_encountered)
+			increase_ac_busy_delay(target);
+		riscv_batch_free(batch);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = GDB_REGNO_ZERO + 1; i <= last; i++) {
+		struct reg *reg = &target->reg_cache->reg_list[i];
+		if (reg->valid)
+			continue;
+		uint64_t value = riscv_batch_get_dmi_read_data(batch, keys[i][0]);
+		if (xlen > 32)
+			value |= (uint64_t)riscv_batch_get_dmi_read_data(batch, keys[i][1]) << 32;
+		buf_set_u64(reg->value, 0, reg->size, value);
+		reg->valid = true;
+	}
+
+	riscv_batch_free(batch);
+	return ERROR_OK;
+}
+
 static int riscv013_on_halt(struct target *target)
 {
+	if (read_gprs_batched(target) != ERROR_OK)
+		LOG_TARGET_DEBUG(target, "falling back to on-demand GPR reads");
 	return ERROR_OK;
 }
 
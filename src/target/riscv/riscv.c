@@ -199,6 +199,14 @@ void riscv_sample_buf_maybe_add_timestamp(struct target *target, bool before)
 	}
 }
 
+void riscv_sample_buf_overflow(struct target *target)
+{
+	RISCV_INFO(r);
+	if (!r->sample_buf.overflows)
+		LOG_TARGET_WARNING(target, "Memory sample buffer is full; dropping samples.");
+	r->sample_buf.overflows++;
+}
+
 static int riscv_resume_go_all_harts(struct target *target);
 
 void select_dmi_via_bscan(struct target *target)
@@ -443,6 +451,9 @@ static void riscv_deinit_target(struct target *target)
 		free(entry);
 	}
 
+	riscv_sample_stream_close(target);
+	free(info->sample_buf.buf);
+
 	free(info->reg_names);
 	free(target->arch_info);
 
@@ -2340,6 +2351,7 @@ int sample_memory(struct target *target)
 	if (!r->sample_buf.buf || !r->sample_config.enabled)
 		return ERROR_OK;
 
+	riscv_sample_buf_flush(target);
 	LOG_DEBUG("buf used/size: %d/%d", r->sample_buf.used, r->sample_buf.size);
 
 	uint64_t start = timeval_ms();
@@ -2355,24 +2367,30 @@ int sample_memory(struct target *target)
 	/* Default slow path. */
 	while (timeval_ms() - start < TARGET_DEFAULT_POLLING_INTERVAL) {
 		for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++) {
-			if (r->sample_config.bucket[i].enabled &&
-					r->sample_buf.used + 1 + r->sample_config.bucket[i].size_bytes < r->sample_buf.size) {
-				assert(i < RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE);
-				r->sample_buf.buf[r->sample_buf.used] = i;
-				result = riscv_read_phys_memory(
-					target, r->sample_config.bucket[i].address,
-					r->sample_config.bucket[i].size_bytes, 1,
-					r->sample_buf.buf + r->sample_buf.used + 1);
-				if (result == ERROR_OK)
-					r->sample_buf.used += 1 + r->sample_config.bucket[i].size_bytes;
-				else
-					goto exit;
+			if (!r->sample_config.bucket[i].enabled)
+				continue;
+			if (r->sample_buf.used + 1 + r->sample_config.bucket[i].size_bytes >= r->sample_buf.size)
+				riscv_sample_buf_flush(target);
+			if (r->sample_buf.used + 1 + r->sample_config.bucket[i].size_bytes >= r->sample_buf.size) {
+				riscv_sample_buf_overflow(target);
+				goto exit;
 			}
+			assert(i < RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE);
+			r->sample_buf.buf[r->sample_buf.used] = i;
+			result = riscv_read_phys_memory(
+				target, r->sample_config.bucket[i].address,
+				r->sample_config.bucket[i].size_bytes, 1,
+				r->sample_buf.buf + r->sample_buf.used + 1);
+			if (result == ERROR_OK)
+				r->sample_buf.used += 1 + r->sample_config.bucket[i].size_bytes;
+			else
+				goto exit;
 		}
 	}
 
 exit:
 	riscv_sample_buf_maybe_add_timestamp(target, false);
+	riscv_sample_buf_flush(target);
 	if (result != ERROR_OK) {
 		LOG_INFO("Turning off memory sampling because it failed.");
 		r->sample_config.enabled = false;
@@ -2548,8 +2566,6 @@ int riscv_openocd_step(struct target *target, int current,
 		LOG_ERROR("unable to step rtos hart");
 	}
 
-	register_cache_invalidate(target->reg_cache);
-
 	if (info->isrmask_mode == RISCV_ISRMASK_STEPONLY)
 		if (riscv_interrupts_restore(target, current_mstatus) != ERROR_OK) {
 			success = false;
@@ -3265,11 +3281,14 @@ COMMAND_HANDLER(handle_memory_sample_command)
 
 	uint32_t bucket;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], bucket);
-	if (bucket > ARRAY_SIZE(r->sample_config.bucket)) {
+	if (bucket >= ARRAY_SIZE(r->sample_config.bucket)) {
 		LOG_ERROR("Max bucket number is %d.", (unsigned) ARRAY_SIZE(r->sample_config.bucket));
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
+	/* Samples taken with the old configuration go out before it changes. */
+	riscv_sample_buf_flush(target);
+
 	if (!strcmp(CMD_ARGV[1], "clear")) {
 		r->sample_config.bucket[bucket].enabled = false;
 	} else {
@@ -3302,6 +3321,43 @@ COMMAND_HANDLER(handle_memory_sample_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_memory_sample_stream_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	uint64_t max_size = 0;
+	unsigned int files = 1;
+
+	if (CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 0)
+		return CALL_COMMAND_HANDLER(riscv_sample_stream_print_status, target);
+
+	if (!strcmp(CMD_ARGV[0], "off")) {
+		if (CMD_ARGC > 1)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		riscv_sample_stream_close(target);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC > 1) {
+		if (CMD_ARGV[0][0] == ':') {
+			LOG_ERROR("File size and count only apply to file output.");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		COMMAND_PARSE_NUMBER(u64, CMD_ARGV[1], max_size);
+	}
+	if (CMD_ARGC > 2) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], files);
+		if (files < 1) {
+			LOG_ERROR("At least one file is needed.");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	return riscv_sample_stream_open(target, CMD_ARGV[0], max_size, files);
+}
+
 COMMAND_HANDLER(handle_dump_sample_buf_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -3425,6 +3481,13 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 		.usage = "bucket address|clear [size=4]",
 		.help = "Causes OpenOCD to frequently read size bytes at the given address."
 	},
+	{
+		.name = "memory_sample_stream",
+		.handler = handle_memory_sample_stream_command,
+		.mode = COMMAND_ANY,
+		.usage = "[off | (filename | ':'port) [max_size [files]]]",
+		.help = "Continuously send memory samples to a TCP port or to rotating files."
+	},
 	{
 		.name = "repeat_read",
 		.handler = handle_repeat_read,
@@ -3818,6 +3881,9 @@ int riscv_step_rtos_hart(struct target *target)
 	r->on_step(target);
 	if (r->step_current_hart(target) != ERROR_OK)
 		return ERROR_FAIL;
+	/* Dirty registers were written back before the step; drop the old
+	 * values so on_halt() can refill the cache for the new state. */
+	register_cache_invalidate(target->reg_cache);
 	r->on_halt(target);
 	if (!riscv_is_halted(target)) {
 		LOG_ERROR("Hart was not halted after single step!");
@@ -31,6 +31,10 @@ struct riscv_program;
 
 #define RISCV_BATCH_ALLOC_SIZE 128
 
+/* Bounds for the adaptive number of scans in a system bus batch. */
+#define RISCV_SBA_BATCH_MIN 32
+#define RISCV_SBA_BATCH_MAX 4096
+
 extern struct target_type riscv011_target;
 extern struct target_type riscv013_target;
 
@@ -76,8 +80,12 @@ struct riscv_sample_buf {
 	uint8_t *buf;
 	unsigned int used;
 	unsigned int size;
+	/* sampling rounds skipped because the buffer was full */
+	uint64_t overflows;
 };
 
+struct riscv_sample_stream;
+
 typedef struct {
 	bool enabled;
 	struct {
@@ -242,6 +250,8 @@ typedef struct {
 
 	riscv_sample_config_t sample_config;
 	struct riscv_sample_buf sample_buf;
+	/* Where sample_buf is drained to, if anywhere. */
+	struct riscv_sample_stream *sample_stream;
 
 	/* Track when we were last asked to do something substantial. */
 	int64_t last_activity;
@@ -402,6 +412,13 @@ int riscv_hit_watchpoint(struct target *target, struct watchpoint **hit_wp_addre
 
 int riscv_init_registers(struct target *target);
 
+int riscv_sample_stream_open(struct target *target, const char *output,
+		uint64_t max_file_size, unsigned int max_files);
+void riscv_sample_stream_close(struct target *target);
+void riscv_sample_buf_flush(struct target *target);
+void riscv_sample_buf_overflow(struct target *target);
+COMMAND_HELPER(riscv_sample_stream_print_status, struct target *target);
+
 void riscv_semihosting_init(struct target *target);
 typedef enum {
 	SEMI_NONE,		/* Not halted for a semihosting call. */
@@ -0,0 +1,314 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/**
+ * @file
+ * Stream the RISC-V memory sample buffer to a TCP client or to a set of
+ * rotating files, so that sampling can run for longer than one buffer.
+ *
+ * The stream carries the sample buffer bytes unchanged: a bucket number
+ * followed by its little endian value, or RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE /
+ * RISCV_SAMPLE_BUF_TIMESTAMP_AFTER followed by a 32-bit millisecond
+ * timestamp.  Whatever the sink does not accept stays in the sample buffer;
+ * once that is full, sampling rounds are dropped and counted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <helper/log.h>
+#include <helper/replacements.h>
+#include <server/server.h>
+#include "target/target.h"
+#include "riscv.h"
+
+#define SAMPLE_STREAM_SERVICE_NAME	"riscv_sample"
+
+struct riscv_sample_stream {
+	/* ":port" for a TCP service, otherwise the base file name */
+	char *output;
+	struct connection *connection;
+
+	FILE *file;
+	uint64_t file_size;
+	uint64_t max_file_size;
+	unsigned int max_files;
+
+	uint64_t bytes_written;
+	uint64_t stalls;
+	unsigned int rotations;
+};
+
+struct riscv_sample_service {
+	struct target *target;
+};
+
+static struct riscv_sample_stream *target_to_stream(struct target *target)
+{
+	RISCV_INFO(r);
+	return r->sample_stream;
+}
+
+static int sample_stream_new_connection(struct connection *connection)
+{
+	struct riscv_sample_service *service = connection->service->priv;
+	struct riscv_sample_stream *stream = target_to_stream(service->target);
+
+	/* A slow client must not stall polling; unsent data stays queued. */
+	socket_nonblock(connection->fd_out);
+	stream->connection = connection;
+	LOG_TARGET_INFO(service->target, "streaming memory samples to new connection");
+	return ERROR_OK;
+}
+
+static int sample_stream_input(struct connection *connection)
+{
+	uint8_t buf[64];
+
+	/* Nothing is expected from the client; just notice when it goes away. */
+	int bytes_read = connection_read(connection, buf, sizeof(buf));
+	if (!bytes_read)
+		return ERROR_SERVER_REMOTE_CLOSED;
+	if (bytes_read < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return ERROR_OK;
+		LOG_ERROR("error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+	return ERROR_OK;
+}
+
+static int sample_stream_connection_closed(struct connection *connection)
+{
+	struct riscv_sample_service *service = connection->service->priv;
+	struct riscv_sample_stream *stream = target_to_stream(service->target);
+
+	if (stream && stream->connection == connection)
+		stream->connection = NULL;
+	return ERROR_OK;
+}
+
+static const struct service_driver sample_stream_service_driver = {
+	.name = SAMPLE_STREAM_SERVICE_NAME,
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = sample_stream_new_connection,
+	.input_handler = sample_stream_input,
+	.connection_closed_handler = sample_stream_connection_closed,
+	.keep_client_alive_handler = NULL,
+};
+
+static int sample_stream_open_file(struct riscv_sample_stream *stream)
+{
+	stream->file = fopen(stream->output, "wb");
+	if (!stream->file) {
+		LOG_ERROR("Can't open %s: %s", stream->output, strerror(errno));
+		return ERROR_FAIL;
+	}
+	stream->file_size = 0;
+	return ERROR_OK;
+}
+
+/* name -> name.1 -> name.2 ... keeping at most max_files files */
+static int sample_stream_rotate(struct riscv_sample_stream *stream)
+{
+	size_t len = strlen(stream->output) + 12;
+	char *from = malloc(len);
+	char *to = malloc(len);
+
+	fclose(stream->file);
+	stream->file = NULL;
+
+	if (!from || !to) {
+		free(from);
+		free(to);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = stream->max_files - 1; i > 0; i--) {
+		if (i == 1)
+			snprintf(from, len, "%s", stream->output);
+		else
+			snprintf(from, len, "%s.%u", stream->output, i - 1);
+		snprintf(to, len, "%s.%u", stream->output, i);
+		if (rename(from, to) != 0 && errno != ENOENT)
+			LOG_WARNING("Can't rename %s to %s: %s", from, to, strerror(errno));
+	}
+	free(from);
+	free(to);
+
+	stream->rotations++;
+	return sample_stream_open_file(stream);
+}
+
+/** Write up to size bytes; returns how many were taken, or -1 on error. */
+static int sample_stream_write(struct riscv_sample_stream *stream,
+		const uint8_t *data, unsigned int size)
+{
+	if (stream->output[0] == ':') {
+		if (!stream->connection)
+			return 0;
+		int written = connection_write(stream->connection, data, size);
+		if (written < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				written = 0;
+			else
+				return -1;
+		}
+		if ((unsigned int)written < size)
+			stream->stalls++;
+		return written;
+	}
+
+	/* The caller passes whole records, so every file starts with one. */
+	if (stream->max_file_size && stream->file_size &&
+			stream->file_size + size > stream->max_file_size) {
+		if (sample_stream_rotate(stream) != ERROR_OK)
+			return -1;
+	}
+
+	if (fwrite(data, 1, size, stream->file) != size) {
+		LOG_ERROR("Error writing to %s: %s", stream->output, strerror(errno));
+		return -1;
+	}
+	fflush(stream->file);
+	stream->file_size += size;
+	return size;
+}
+
+/* Length of the whole records at the start of buf. */
+static unsigned int sample_buf_whole_records(struct target *target,
+		const uint8_t *buf, unsigned int used)
+{
+	RISCV_INFO(r);
+	unsigned int i = 0;
+
+	while (i < used) {
+		uint8_t command = buf[i];
+		unsigned int len;
+		if (command == RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE ||
+				command == RISCV_SAMPLE_BUF_TIMESTAMP_AFTER)
+			len = 5;
+		else if (command < ARRAY_SIZE(r->sample_config.bucket))
+			len = 1 + r->sample_config.bucket[command].size_bytes;
+		else
+			break;
+		if (i + len > used)
+			break;
+		i += len;
+	}
+	return i;
+}
+
+void riscv_sample_buf_flush(struct target *target)
+{
+	RISCV_INFO(r);
+	struct riscv_sample_stream *stream = r->sample_stream;
+
+	if (!stream || !r->sample_buf.used)
+		return;
+
+	unsigned int size = r->sample_buf.used;
+	if (stream->output[0] != ':' && stream->max_file_size)
+		size = sample_buf_whole_records(target, r->sample_buf.buf, size);
+
+	int written = sample_stream_write(stream, r->sample_buf.buf, size);
+	if (written < 0) {
+		LOG_TARGET_ERROR(target, "memory sample stream failed; closing it");
+		riscv_sample_stream_close(target);
+		return;
+	}
+
+	stream->bytes_written += written;
+	memmove(r->sample_buf.buf, r->sample_buf.buf + written, r->sample_buf.used - written);
+	r->sample_buf.used -= written;
+}
+
+int riscv_sample_stream_open(struct target *target, const char *output,
+		uint64_t max_file_size, unsigned int max_files)
+{
+	RISCV_INFO(r);
+
+	riscv_sample_stream_close(target);
+
+	struct riscv_sample_stream *stream = calloc(1, sizeof(*stream));
+	if (!stream) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	stream->output = strdup(output);
+	stream->max_file_size = max_file_size;
+	stream->max_files = max_files ? max_files : 1;
+	if (!stream->output) {
+		free(stream);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval;
+	if (output[0] == ':') {
+		struct riscv_sample_service *service = malloc(sizeof(*service));
+		if (!service) {
+			retval = ERROR_FAIL;
+		} else {
+			service->target = target;
+			retval = add_service(&sample_stream_service_driver, &output[1], 1, service);
+			if (retval != ERROR_OK)
+				free(service);
+		}
+	} else {
+		retval = sample_stream_open_file(stream);
+	}
+
+	if (retval != ERROR_OK) {
+		free(stream->output);
+		free(stream);
+		return retval;
+	}
+
+	r->sample_stream = stream;
+	return ERROR_OK;
+}
+
+void riscv_sample_stream_close(struct target *target)
+{
+	RISCV_INFO(r);
+	struct riscv_sample_stream *stream = r->sample_stream;
+
+	if (!stream)
+		return;
+
+	r->sample_stream = NULL;
+	if (stream->output[0] == ':')
+		remove_service(SAMPLE_STREAM_SERVICE_NAME, &stream->output[1]);
+	else if (stream->file)
+		fclose(stream->file);
+	free(stream->output);
+	free(stream);
+}
+
+COMMAND_HELPER(riscv_sample_stream_print_status, struct target *target)
+{
+	RISCV_INFO(r);
+	struct riscv_sample_stream *stream = r->sample_stream;
+
+	if (!stream) {
+		command_print(CMD, "memory sample stream: off");
+	} else {
+		if (stream->output[0] == ':')
+			command_print(CMD, "memory sample stream: tcp port %s (%s)", &stream->output[1],
+					stream->connection ? "connected" : "no client");
+		else
+			command_print(CMD, "memory sample stream: file %s, %u rotations",
+					stream->output, stream->rotations);
+		command_print(CMD, "bytes streamed: %" PRIu64 ", sink stalls: %" PRIu64,
+				stream->bytes_written, stream->stalls);
+	}
+	command_print(CMD, "bytes queued: %u/%u, sampling rounds dropped: %" PRIu64,
+			r->sample_buf.used, r->sample_buf.size, r->sample_buf.overflows);
+	return ERROR_OK;
+}
@@ -24,9 +24,26 @@
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
 #include <helper/command.h>
+#include <helper/time_support.h>
 #include <rtt/rtt.h>
 
 #include "target.h"
+#include "target_type.h"
+#include "algorithm.h"
+#include "aarch64.h"
+#include "riscv/riscv.h"
+
+static void parse_rtt_channel(const uint8_t *buf, target_addr_t address,
+		struct rtt_channel *channel)
+{
+	channel->address = address;
+	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
+	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
+	channel->size = buf_get_u32(buf + 8, 0, 32);
+	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
+	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
+	channel->flags = buf_get_u32(buf + 20, 0, 32);
+}
 
 static int read_rtt_channel(struct target *target,
 		const struct rtt_control *ctrl, unsigned int channel_index,
@@ -46,13 +63,7 @@ static int read_rtt_channel(struct target *target,
 	if (ret != ERROR_OK)
 		return ret;
 
-	channel->address = address;
-	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
-	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
-	channel->size = buf_get_u32(buf + 8, 0, 32);
-	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
-	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
-	channel->flags = buf_get_u32(buf + 20, 0, 32);
+	parse_rtt_channel(buf, address, channel);
 
 	return ERROR_OK;
 }
@@ -248,56 +259,258 @@ int target_rtt_read_control_block(struct target *target,
 	return ERROR_OK;
 }
 
-int target_rtt_find_control_block(struct target *target,
-		target_addr_t *address, size_t size, const char *id, bool *found,
-		void *user_data)
+/* Bounds of the chunk size used when searching from the host. */
+#define RTT_SEARCH_CHUNK_MIN	1024
+#define RTT_SEARCH_CHUNK_MAX	(64 * 1024)
+/* Grow chunks while a read takes less than this, in milliseconds. */
+#define RTT_SEARCH_CHUNK_TIME	50
+
+/* Range handed to the on-target search at once. */
+#define RTT_SEARCH_SLICE	(16 * 1024 * 1024)
+
+static const uint8_t riscv_rtt_find_code[] = {
+#include "../../contrib/loaders/rtt/riscv_rtt_find.inc"
+};
+
+static const uint8_t aarch64_rtt_find_code[] = {
+#include "../../contrib/loaders/rtt/aarch64_rtt_find.inc"
+};
+
+/* Boyer-Moore-Horspool search. */
+static const uint8_t *find_id(const uint8_t *buf, size_t length,
+		const uint8_t *id, size_t id_length, const size_t *shift)
 {
-	uint8_t buf[1024];
+	size_t i = 0;
 
-	*found = false;
+	while (i + id_length <= length) {
+		uint8_t last = buf[i + id_length - 1];
 
-	size_t j = 0;
-	size_t cb_offset = 0;
+		if (last == id[id_length - 1] &&
+				!memcmp(buf + i, id, id_length - 1))
+			return buf + i;
+
+		i += shift[last];
+	}
+
+	return NULL;
+}
+
+static int find_control_block_on_host(struct target *target,
+		target_addr_t *address, size_t size, const char *id, bool *found)
+{
 	const size_t id_length = strlen(id);
+	size_t shift[256];
+	size_t chunk_size = RTT_SEARCH_CHUNK_MIN;
+	size_t kept = 0;
+	uint8_t *buf;
 
-	LOG_INFO("rtt: Searching for control block '%s'", id);
+	for (size_t i = 0; i < ARRAY_SIZE(shift); i++)
+		shift[i] = id_length;
+
+	for (size_t i = 0; i < id_length - 1; i++)
+		shift[(uint8_t)id[i]] = id_length - 1 - i;
 
-	for (target_addr_t addr = 0; addr < size; addr = addr + sizeof(buf)) {
+	/* Room for the largest chunk plus the tail of the previous one. */
+	buf = malloc(RTT_SEARCH_CHUNK_MAX + id_length);
+
+	if (!buf) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (size_t offset = 0; offset < size; ) {
 		int ret;
+		const uint8_t *match;
+		const size_t read_length = MIN(chunk_size, size - offset);
+		int64_t start = timeval_ms();
 
-		const size_t buf_size = MIN(sizeof(buf), size - addr);
-		ret = target_read_buffer(target, *address + addr, buf_size, buf);
+		ret = target_read_buffer(target, *address + offset, read_length,
+			buf + kept);
 
-		if (ret != ERROR_OK)
+		if (ret != ERROR_OK) {
+			free(buf);
 			return ret;
+		}
+
+		match = find_id(buf, kept + read_length, (const uint8_t *)id,
+			id_length, shift);
+
+		if (match) {
+			*address = *address + offset - kept + (match - buf);
+			*found = true;
+			free(buf);
+			return ERROR_OK;
+		}
 
-		size_t start = 0;
-		size_t i = 0;
+		/* Keep a tail so that a match across two chunks is found. */
+		size_t tail = MIN(id_length - 1, kept + read_length);
+		memmove(buf, buf + kept + read_length - tail, tail);
+		kept = tail;
+		offset += read_length;
 
-		while (i < buf_size) {
-			if (buf[i] != id[j]) {
-				start++;
-				cb_offset++;
-				i = start;
-				j = 0;
+		if (timeval_ms() - start < RTT_SEARCH_CHUNK_TIME)
+			chunk_size = MIN(2 * chunk_size, RTT_SEARCH_CHUNK_MAX);
 
-				continue;
-			}
+		keep_alive();
+	}
+
+	free(buf);
+
+	return ERROR_OK;
+}
+
+/*
+ * Search on the target with a small loader, if the target is halted and has
+ * a working area.  Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE when the
+ * search has to be done from the host instead.
+ */
+static int find_control_block_on_target(struct target *target,
+		target_addr_t *address, size_t size, const char *id, bool *found)
+{
+	static char * const riscv_regs[] = {
+		"a0", "a1", "a2", "a3", "a4", "a5", "t0", "t1", "t2"
+	};
+	static char * const aarch64_regs[] = {
+		"x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8"
+	};
+	struct riscv_algorithm riscv_info;
+	struct aarch64_algorithm aarch64_info;
+	struct reg_param reg_params[ARRAY_SIZE(riscv_regs)];
+	char * const *reg_names;
+	const uint8_t *code;
+	size_t code_size;
+	unsigned int xlen;
+	void *arch_info;
+	struct working_area *area;
+	const size_t id_length = strlen(id);
+	int ret;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* With address translation on, a fault in the loader would be
+	 * taken by the OS exception handlers. */
+	int mmu_enabled;
+	if (target->type->mmu(target, &mmu_enabled) != ERROR_OK || mmu_enabled)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (!strcmp(target_type_name(target), "riscv")) {
+		code = riscv_rtt_find_code;
+		code_size = sizeof(riscv_rtt_find_code);
+		reg_names = riscv_regs;
+		xlen = riscv_xlen(target);
+		memset(&riscv_info, 0, sizeof(riscv_info));
+		arch_info = &riscv_info;
+	} else if (!strcmp(target_type_name(target), "aarch64")) {
+		code = aarch64_rtt_find_code;
+		code_size = sizeof(aarch64_rtt_find_code);
+		reg_names = aarch64_regs;
+		xlen = 64;
+		aarch64_info.common_magic = AARCH64_COMMON_MAGIC;
+		arch_info = &aarch64_info;
+	} else {
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if (target_alloc_working_area(target, code_size + id_length,
+			&area) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	const target_addr_t id_address = area->address + code_size;
+
+	ret = target_write_buffer(target, area->address, code_size, code);
+
+	if (ret == ERROR_OK)
+		ret = target_write_buffer(target, id_address, id_length,
+			(const uint8_t *)id);
+
+	if (ret != ERROR_OK) {
+		target_free_working_area(target, area);
+		return ret;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(reg_params); i++)
+		init_reg_param(&reg_params[i], reg_names[i], xlen,
+			i == 0 ? PARAM_IN_OUT : PARAM_OUT);
+
+	size_t offset = 0;
 
-			i++;
-			j++;
+	while (offset < size) {
+		const size_t length = MIN(RTT_SEARCH_SLICE, size - offset);
+		const target_addr_t start = *address + offset;
+
+		buf_set_u64(reg_params[0].value, 0, xlen, start);
+		buf_set_u64(reg_params[1].value, 0, xlen, length);
+		buf_set_u64(reg_params[2].value, 0, xlen, id_address);
+		buf_set_u64(reg_params[3].value, 0, xlen, id_length);
+
+		ret = target_run_algorithm(target, 0, NULL, ARRAY_SIZE(reg_params),
+			reg_params, area->address, 0, 1000 + length / 8192, arch_info);
+
+		if (ret != ERROR_OK)
+			break;
 
-			if (j == id_length) {
-				*address = *address + cb_offset;
-				*found = true;
-				return ERROR_OK;
+		uint64_t result = buf_get_u64(reg_params[0].value, 0, xlen);
+
+		if (result < length) {
+			/* Skip the copy of the ID the search itself uses. */
+			if (start + result == id_address) {
+				offset += result + 1;
+				continue;
 			}
+
+			*address = start + result;
+			*found = true;
+			break;
 		}
+
+		if (offset + length >= size)
+			break;
+
+		/* Overlap the slices so that a match across two is found. */
+		offset += length - MIN(length, id_length - 1);
+		keep_alive();
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	/* Don't leave a copy of the ID behind for a later search to find. */
+	uint8_t *zeros = calloc(1, id_length);
+	if (!zeros || target_write_buffer(target, id_address, id_length,
+			zeros) != ERROR_OK)
+		LOG_WARNING("rtt: Failed to clear the search ID at " TARGET_ADDR_FMT,
+			id_address);
+	free(zeros);
+
+	target_free_working_area(target, area);
+
+	if (ret != ERROR_OK) {
+		LOG_WARNING("rtt: Search on the target failed, searching from the host");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
 	return ERROR_OK;
 }
 
+int target_rtt_find_control_block(struct target *target,
+		target_addr_t *address, size_t size, const char *id, bool *found,
+		void *user_data)
+{
+	int ret;
+
+	*found = false;
+
+	LOG_INFO("rtt: Searching for control block '%s'", id);
+
+	ret = find_control_block_on_target(target, address, size, id, found);
+
+	if (ret != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		return ret;
+
+	return find_control_block_on_host(target, address, size, id, found);
+}
+
 int target_rtt_read_channel_info(struct target *target,
 		const struct rtt_control *ctrl, unsigned int channel_index,
 		enum rtt_channel_type type, struct rtt_channel_info *info,
@@ -381,26 +594,53 @@ static int read_from_channel(struct target *target,
 
 int target_rtt_read_callback(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data)
+		size_t num_channels, size_t *bytes_read, void *user_data)
 {
+	int ret;
+	uint8_t *descriptors;
+	size_t num_descriptors = 0;
+
+	*bytes_read = 0;
 	num_channels = MIN(num_channels, ctrl->num_up_channels);
 
 	for (size_t i = 0; i < num_channels; i++) {
-		int ret;
+		if (sinks[i])
+			num_descriptors = i + 1;
+	}
+
+	if (!num_descriptors)
+		return ERROR_OK;
+
+	/*
+	 * The up-channel descriptors follow the control block header, so fetch
+	 * all of them up to the last one with a sink in a single read.
+	 */
+	descriptors = malloc(num_descriptors * RTT_CHANNEL_SIZE);
+
+	if (!descriptors) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
+
+	ret = target_read_buffer(target, ctrl->address + RTT_CB_SIZE,
+		num_descriptors * RTT_CHANNEL_SIZE, descriptors);
+
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to read up-channel descriptions");
+		free(descriptors);
+		return ret;
+	}
+
+	for (size_t i = 0; i < num_descriptors; i++) {
 		struct rtt_channel channel;
-		uint8_t buffer[1024];
+		uint8_t *buffer;
 		size_t length;
 
 		if (!sinks[i])
 			continue;
 
-		ret = read_rtt_channel(target, ctrl, i, RTT_CHANNEL_TYPE_UP,
-			&channel);
-
-		if (ret != ERROR_OK) {
-			LOG_ERROR("rtt: Failed to read up-channel %zu description", i);
-			return ret;
-		}
+		parse_rtt_channel(descriptors + i * RTT_CHANNEL_SIZE,
+			ctrl->address + RTT_CB_SIZE + i * RTT_CHANNEL_SIZE, &channel);
 
 		if (!channel_is_active(&channel)) {
 			LOG_WARNING("rtt: Up-channel %zu is not active", i);
@@ -412,17 +652,44 @@ int target_rtt_read_callback(struct target *target,
 			continue;
 		}
 
-		length = sizeof(buffer);
+		if (channel.read_pos >= channel.size ||
+				channel.write_pos >= channel.size) {
+			LOG_WARNING("rtt: Up-channel %zu has invalid positions", i);
+			continue;
+		}
+
+		/* Drain everything available, in at most two reads. */
+		length = (channel.write_pos + channel.size - channel.read_pos)
+			% channel.size;
+
+		if (!length)
+			continue;
+
+		buffer = malloc(length);
+
+		if (!buffer) {
+			LOG_ERROR("rtt: Out of memory");
+			free(descriptors);
+			return ERROR_FAIL;
+		}
+
 		ret = read_from_channel(target, &channel, buffer, &length);
 
 		if (ret != ERROR_OK) {
 			LOG_ERROR("rtt: Failed to read from up-channel %zu", i);
+			free(buffer);
+			free(descriptors);
 			return ret;
 		}
 
 		for (struct rtt_sink_list *sink = sinks[i]; sink; sink = sink->next)
 			sink->read(i, buffer, length, sink->user_data);
+
+		*bytes_read += length;
+		free(buffer);
 	}
 
+	free(descriptors);
+
 	return ERROR_OK;
 }
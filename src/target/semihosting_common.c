@@ -159,6 +159,13 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->result = -1;
 	semihosting->sys_errno = -1;
 	semihosting->cmdline = NULL;
+	semihosting->ring_address = 0;
+	semihosting->ring_size = 0;
+	semihosting->ring_working_area = NULL;
+	semihosting->ring_in_working_area = false;
+	semihosting->ring_bytes = 0;
+	semihosting->ring_records = 0;
+	semihosting->ring_drains = 0;
 
 	/* If possible, update it in setup(). */
 	semihosting->setup_time = clock();
@@ -309,6 +316,189 @@ static inline int semihosting_getchar(struct semihosting *semihosting, int fd)
 	return getchar();
 }
 
+/*
+ * Shared-memory write ring.
+ *
+ * The ring starts with four 32-bit words in target byte order: magic, size
+ * of the data area, head (offset the target writes next) and tail (offset
+ * OpenOCD reads next), followed by the data area. Each record is a 32-bit
+ * file handle, a 32-bit length and the data padded to a multiple of 4 bytes;
+ * records wrap around the end of the data area. The target advances head
+ * only after a whole record is in place, keeps at least 4 bytes free, and
+ * falls back to a plain SYS_WRITE trap when a record doesn't fit. The ring
+ * is drained on every semihosting trap before the operation is performed,
+ * which keeps ring data and trapped writes in order.
+ */
+#define SEMIHOSTING_RING_MAGIC		0x53485247	/* "SHRG" */
+#define SEMIHOSTING_RING_HEADER_SIZE	16
+#define SEMIHOSTING_RING_MIN_SIZE	64
+#define SEMIHOSTING_RING_NAME		":semihosting-ring"
+
+/**
+ * Clear the ring magic in target memory, so the target stops queueing into
+ * the ring and probes for a new one. Done before the ring memory may be
+ * handed out again.
+ */
+static void semihosting_ring_invalidate(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+
+	/* a released working area may already be reused */
+	if (!semihosting->ring_address ||
+			(semihosting->ring_in_working_area && !semihosting->ring_working_area))
+		return;
+
+	if (target_write_u32(target, semihosting->ring_address, 0) != ERROR_OK)
+		LOG_WARNING("semihosting ring at " TARGET_ADDR_FMT
+			" could not be invalidated, the target may keep writing to it",
+			semihosting->ring_address);
+}
+
+/**
+ * Called before all working areas are freed (reset, resume on some
+ * targets, work area reconfiguration): a ring placed in one of them is
+ * invalidated while its memory is still ours.
+ */
+void semihosting_ring_invalidate_working_area(struct target *target)
+{
+	if (target->semihosting && target->semihosting->ring_working_area)
+		semihosting_ring_invalidate(target);
+}
+
+static void semihosting_ring_release(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+
+	semihosting_ring_invalidate(target);
+
+	if (semihosting->ring_working_area)
+		target_free_working_area(target, semihosting->ring_working_area);
+	semihosting->ring_working_area = NULL;
+	semihosting->ring_in_working_area = false;
+	semihosting->ring_address = 0;
+	semihosting->ring_size = 0;
+}
+
+static void semihosting_ring_write(struct semihosting *semihosting, int fd,
+	uint8_t *buf, uint32_t size)
+{
+	while (size > 0) {
+		ssize_t written = semihosting_write(semihosting, fd, buf, size);
+		if (written <= 0) {
+			LOG_WARNING("semihosting ring: write to handle %d failed, %" PRIu32
+				" bytes lost", fd, size);
+			return;
+		}
+		buf += written;
+		size -= written;
+	}
+}
+
+/**
+ * Write out the records queued in the shared-memory ring, merging
+ * consecutive records for the same handle into one host write.
+ */
+static int semihosting_ring_drain(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+	uint8_t header[SEMIHOSTING_RING_HEADER_SIZE];
+
+	if (!semihosting->ring_address || semihosting->is_fileio)
+		return ERROR_OK;
+
+	if (semihosting->ring_in_working_area && !semihosting->ring_working_area) {
+		LOG_WARNING("semihosting ring working area was released, ring disabled");
+		semihosting_ring_release(target);
+		return ERROR_OK;
+	}
+
+	int retval = target_read_memory(target, semihosting->ring_address, 4,
+			SEMIHOSTING_RING_HEADER_SIZE / 4, header);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t magic = target_buffer_get_u32(target, header);
+	uint32_t size = target_buffer_get_u32(target, header + 4);
+	uint32_t head = target_buffer_get_u32(target, header + 8);
+	uint32_t tail = target_buffer_get_u32(target, header + 12);
+
+	if (magic != SEMIHOSTING_RING_MAGIC || size != semihosting->ring_size ||
+			head >= size || tail >= size || (head & 3) || (tail & 3)) {
+		LOG_ERROR("semihosting ring at " TARGET_ADDR_FMT " is corrupted, ring disabled",
+			semihosting->ring_address);
+		semihosting_ring_release(target);
+		return ERROR_OK;
+	}
+
+	if (head == tail)
+		return ERROR_OK;
+
+	target_addr_t data_address = semihosting->ring_address + SEMIHOSTING_RING_HEADER_SIZE;
+	uint32_t used = head > tail ? head - tail : size - tail + head;
+	uint32_t first = MIN(used, size - tail);
+	uint8_t *data = malloc(used);
+	if (!data) {
+		LOG_ERROR("out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* One read, or two when the queued records wrap around. */
+	retval = target_read_memory(target, data_address + tail, 4, first / 4, data);
+	if (retval == ERROR_OK && used > first)
+		retval = target_read_memory(target, data_address, 4, (used - first) / 4,
+				data + first);
+	if (retval != ERROR_OK) {
+		free(data);
+		return retval;
+	}
+
+	/* Redirection is decided per operation; this is all SYS_WRITE data. */
+	int op = semihosting->op;
+	semihosting->op = SEMIHOSTING_SYS_WRITE;
+
+	uint32_t pos = 0;
+	uint32_t run_start = 0;
+	uint32_t run_size = 0;
+	int run_fd = -1;
+	while (pos + 8 <= used) {
+		int fd = target_buffer_get_u32(target, data + pos);
+		uint32_t len = target_buffer_get_u32(target, data + pos + 4);
+		uint32_t padded = (len + 3) & ~3u;
+
+		if (len > used - pos - 8 || padded > used - pos - 8) {
+			LOG_ERROR("semihosting ring: truncated record at offset %" PRIu32,
+				(tail + pos) % size);
+			break;
+		}
+
+		if (run_size && fd != run_fd) {
+			semihosting_ring_write(semihosting, run_fd, data + run_start, run_size);
+			run_size = 0;
+		}
+		if (!run_size) {
+			run_fd = fd;
+			run_start = pos;
+		}
+		memmove(data + run_start + run_size, data + pos + 8, len);
+		run_size += len;
+
+		semihosting->ring_bytes += len;
+		semihosting->ring_records++;
+		pos += 8 + padded;
+	}
+	if (run_size)
+		semihosting_ring_write(semihosting, run_fd, data + run_start, run_size);
+
+	semihosting->op = op;
+	semihosting->ring_drains++;
+	free(data);
+
+	LOG_DEBUG("semihosting ring: drained %" PRIu32 " bytes", used);
+
+	/* Hand the space back to the target. */
+	return target_write_u32(target, semihosting->ring_address + 12, head);
+}
+
 /**
  * User operation parameter string storage buffer. Contains valid data when the
  * TARGET_EVENT_SEMIHOSTING_USER_CMD_xxxxx event callbacks are running.
@@ -347,6 +537,11 @@ int semihosting_common(struct target *target)
 	LOG_DEBUG("op=0x%x, param=0x%" PRIx64, semihosting->op,
 		semihosting->param);
 
+	/* Whatever the target queued in the ring comes before this operation. */
+	retval = semihosting_ring_drain(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	switch (semihosting->op) {
 
 		case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
@@ -883,7 +1078,17 @@ int semihosting_common(struct target *target)
 					fn[len] = 0;
 					/* TODO: implement the :semihosting-features special file.
 					 * */
-					if (semihosting->is_fileio) {
+					if (strcmp((char *)fn, SEMIHOSTING_RING_NAME) == 0) {
+						/* Not a file: returns the address of the ring. */
+						if (semihosting->ring_address && !semihosting->is_fileio) {
+							semihosting->result = semihosting->ring_address;
+							semihosting->sys_errno = 0;
+						} else {
+							semihosting->result = -1;
+							semihosting->sys_errno = ENOENT;
+						}
+						LOG_DEBUG("open('%s')=0x%" PRIx64, fn, semihosting->result);
+					} else if (semihosting->is_fileio) {
 						if (strcmp((char *)fn, ":semihosting-features") == 0) {
 							semihosting->result = -1;
 							semihosting->sys_errno = EINVAL;
@@ -2001,6 +2206,97 @@ COMMAND_HANDLER(handle_common_semihosting_resumable_exit_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_common_semihosting_ring_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (!target) {
+		LOG_ERROR("No target selected");
+		return ERROR_FAIL;
+	}
+
+	struct semihosting *semihosting = target->semihosting;
+	if (!semihosting) {
+		command_print(CMD, "semihosting not supported for current target");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* Don't leave queued data behind when the ring changes. */
+	if (semihosting->ring_address && target->state == TARGET_HALTED) {
+		int retval = semihosting_ring_drain(target);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "off") == 0) {
+		semihosting_ring_release(target);
+	} else if (CMD_ARGC > 0) {
+		target_addr_t address = 0;
+		uint32_t size;
+
+		if (semihosting->is_fileio) {
+			command_print(CMD, "the semihosting ring can't be used with semihosting_fileio");
+			return ERROR_FAIL;
+		}
+
+		if (CMD_ARGC == 2)
+			COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[CMD_ARGC - 1], size);
+		if (size < SEMIHOSTING_RING_MIN_SIZE || (size & 3)) {
+			command_print(CMD, "ring size must be a multiple of 4 and at least %d bytes",
+				SEMIHOSTING_RING_MIN_SIZE);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		semihosting_ring_release(target);
+
+		if (CMD_ARGC == 1) {
+			int retval = target_alloc_working_area(target,
+					SEMIHOSTING_RING_HEADER_SIZE + size,
+					&semihosting->ring_working_area);
+			if (retval != ERROR_OK) {
+				command_print(CMD, "no working area available for a %" PRIu32
+					" byte semihosting ring", size);
+				return retval;
+			}
+			semihosting->ring_in_working_area = true;
+			address = semihosting->ring_working_area->address;
+		}
+
+		uint8_t header[SEMIHOSTING_RING_HEADER_SIZE];
+		target_buffer_set_u32(target, header, SEMIHOSTING_RING_MAGIC);
+		target_buffer_set_u32(target, header + 4, size);
+		target_buffer_set_u32(target, header + 8, 0);
+		target_buffer_set_u32(target, header + 12, 0);
+		int retval = target_write_memory(target, address, 4,
+				SEMIHOSTING_RING_HEADER_SIZE / 4, header);
+		if (retval != ERROR_OK) {
+			semihosting_ring_release(target);
+			return retval;
+		}
+
+		semihosting->ring_address = address;
+		semihosting->ring_size = size;
+		semihosting->ring_bytes = 0;
+		semihosting->ring_records = 0;
+		semihosting->ring_drains = 0;
+	}
+
+	if (semihosting->ring_address)
+		command_print(CMD, "semihosting ring at " TARGET_ADDR_FMT ", %" PRIu32
+			" bytes; %" PRIu64 " bytes in %" PRIu64 " records drained in %" PRIu64 " passes",
+			semihosting->ring_address, semihosting->ring_size,
+			semihosting->ring_bytes, semihosting->ring_records,
+			semihosting->ring_drains);
+	else
+		command_print(CMD, "semihosting ring is disabled");
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_common_semihosting_read_user_param_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -2061,6 +2357,13 @@ const struct command_registration semihosting_common_handlers[] = {
 		.usage = "['enable'|'disable']",
 		.help = "activate support for semihosting resumable exit",
 	},
+	{
+		.name = "semihosting_ring",
+		.handler = handle_common_semihosting_ring_command,
+		.mode = COMMAND_EXEC,
+		.usage = "['off' | [address] size]",
+		.help = "set up a shared-memory ring for semihosting writes",
+	},
 	{
 		.name = "semihosting_read_user_param",
 		.handler = handle_common_semihosting_read_user_param_command,
@@ -26,6 +26,7 @@
 #include <stdbool.h>
 #include <time.h>
 #include "helper/replacements.h"
+#include "helper/types.h"
 #include <server/server.h>
 
 /*
@@ -104,6 +105,7 @@ enum semihosting_redirect_config {
 };
 
 struct target;
+struct working_area;
 
 /*
  * A pointer to this structure was added to the target structure.
@@ -176,6 +178,25 @@ struct semihosting {
 	/** The current time when 'execution starts' */
 	clock_t setup_time;
 
+	/**
+	 * Shared-memory ring the target queues SYS_WRITE data into without
+	 * trapping; 0 when not in use. The target finds it by opening the
+	 * special path ":semihosting-ring".
+	 */
+	target_addr_t ring_address;
+
+	/** Size of the ring data area, in bytes. */
+	uint32_t ring_size;
+
+	/** Working area holding the ring, if OpenOCD allocated it. */
+	struct working_area *ring_working_area;
+	bool ring_in_working_area;
+
+	/** Ring statistics. */
+	uint64_t ring_bytes;
+	uint64_t ring_records;
+	uint64_t ring_drains;
+
 	int (*setup)(struct target *target, int enable);
 	int (*post_result)(struct target *target);
 };
@@ -183,5 +204,6 @@ struct semihosting {
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
 int semihosting_common(struct target *target);
+void semihosting_ring_invalidate_working_area(struct target *target);
 
 #endif	/* OPENOCD_TARGET_SEMIHOSTING_COMMON_H */
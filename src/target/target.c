@@ -57,6 +57,7 @@
 #include "transport/transport.h"
 #include "arm_cti.h"
 #include "smp.h"
+#include "semihosting_common.h"
 
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
@@ -583,6 +584,9 @@ int target_poll(struct target *target)
 	}
 
 	retval = target->type->poll(target);
+	/* some targets resume on their own, e.g. after handling semihosting */
+	if (target->state != TARGET_HALTED)
+		target_mem_cache_invalidate(target);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -663,6 +667,7 @@ int target_resume(struct target *target, int current, target_addr_t address,
 	}
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
+	target_mem_cache_invalidate(target);
 
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
@@ -700,8 +705,10 @@ static int target_process_reset(struct command_invocation *cmd, enum target_rese
 	}
 
 	struct target *target;
-	for (target = all_targets; target; target = target->next)
+	for (target = all_targets; target; target = target->next) {
+		target_mem_cache_invalidate(target);
 		target_call_reset_callbacks(target, reset_mode);
+	}
 
 	/* disable polling during reset to make reset event scripts
 	 * more predictable, i.e. dr/irscan & pathmove in events will
@@ -892,6 +899,7 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate(target);
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -937,6 +945,7 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate(target);
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -1532,6 +1541,265 @@ int target_run_async_algorithm(struct target *trans_target, struct target *exec_
 	return retval;
 }
 
+/*
+ * Memory read cache for the halted state.
+ *
+ * While a target is halted GDB, the RTOS support and memory display
+ * commands read the same memory over and over. With the cache enabled,
+ * such reads are rounded to whole pages, the pages are kept and later
+ * reads are served from them without accessing the target.
+ *
+ * Anything that may change memory drops the whole cache: resume, step,
+ * reset, algorithm runs and halts. Writes that fall completely within
+ * cached pages are written through; any other write might have side
+ * effects (peripheral or flash controller registers) and drops the cache
+ * as well. Ranges holding memory mapped registers are excluded from
+ * caching with "$target_name mem_cache exclude"; a read is not cached when
+ * any of its pages touches such a range.
+ *
+ * Writes also drop the caches of the other targets in an SMP group, which
+ * share the memory. Other targets on the same bus, e.g. a mem_ap target
+ * next to the cores, are not tracked.
+ */
+
+#define TARGET_MEM_CACHE_PAGE_SIZE	256
+#define TARGET_MEM_CACHE_PAGES		64
+
+struct target_mem_cache_page {
+	target_addr_t address;
+	uint64_t last_use;		/* 0 if the page holds nothing */
+	uint8_t data[TARGET_MEM_CACHE_PAGE_SIZE];
+};
+
+struct target_mem_cache_range {
+	target_addr_t address;
+	target_addr_t size;
+};
+
+struct target_mem_cache {
+	bool enabled;
+	/* set while pages are read, to keep the reads below out of the cache */
+	bool filling;
+	uint64_t use_count;
+	struct target_mem_cache_page pages[TARGET_MEM_CACHE_PAGES];
+
+	unsigned int num_excluded;
+	struct target_mem_cache_range *excluded;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t uncached;
+	uint64_t invalidations;
+};
+
+static target_addr_t target_mem_cache_page_of(target_addr_t address)
+{
+	return address & ~(target_addr_t)(TARGET_MEM_CACHE_PAGE_SIZE - 1);
+}
+
+static struct target_mem_cache_page *target_mem_cache_find(struct target_mem_cache *cache,
+		target_addr_t address)
+{
+	for (unsigned int i = 0; i < TARGET_MEM_CACHE_PAGES; i++) {
+		struct target_mem_cache_page *page = &cache->pages[i];
+		if (page->last_use && page->address == address)
+			return page;
+	}
+	return NULL;
+}
+
+/* The least recently used page, or an empty one. */
+static struct target_mem_cache_page *target_mem_cache_victim(struct target_mem_cache *cache)
+{
+	struct target_mem_cache_page *victim = &cache->pages[0];
+
+	for (unsigned int i = 1; i < TARGET_MEM_CACHE_PAGES; i++) {
+		if (cache->pages[i].last_use < victim->last_use)
+			victim = &cache->pages[i];
+	}
+	return victim;
+}
+
+static bool target_mem_cache_is_empty(struct target_mem_cache *cache)
+{
+	for (unsigned int i = 0; i < TARGET_MEM_CACHE_PAGES; i++) {
+		if (cache->pages[i].last_use)
+			return false;
+	}
+	return true;
+}
+
+/* True if every page of [first, last] is cached. */
+static bool target_mem_cache_holds(struct target_mem_cache *cache,
+		target_addr_t first, target_addr_t last)
+{
+	for (target_addr_t page = first; ; page += TARGET_MEM_CACHE_PAGE_SIZE) {
+		if (!target_mem_cache_find(cache, page))
+			return false;
+		if (page == last)
+			return true;
+	}
+}
+
+static bool target_mem_cache_excluded(struct target_mem_cache *cache,
+		target_addr_t first, target_addr_t last)
+{
+	for (unsigned int i = 0; i < cache->num_excluded; i++) {
+		struct target_mem_cache_range *range = &cache->excluded[i];
+		if (first <= range->address + (range->size - 1) && range->address <= last)
+			return true;
+	}
+	return false;
+}
+
+void target_mem_cache_invalidate(struct target *target)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	target->memory_generation++;
+
+	if (!cache || target_mem_cache_is_empty(cache))
+		return;
+
+	for (unsigned int i = 0; i < TARGET_MEM_CACHE_PAGES; i++)
+		cache->pages[i].last_use = 0;
+	cache->invalidations++;
+}
+
+/* Copy the part of [address, address + count) held by page to buffer. */
+static void target_mem_cache_copy_out(struct target_mem_cache_page *page,
+		target_addr_t address, uint32_t count, uint8_t *buffer)
+{
+	target_addr_t start = MAX(address, page->address);
+	target_addr_t end = MIN(address + (count - 1), page->address + (TARGET_MEM_CACHE_PAGE_SIZE - 1));
+
+	memcpy(buffer + (start - address), page->data + (start - page->address), end - start + 1);
+}
+
+/**
+ * Serve a read from the cache, reading and keeping the pages it covers
+ * first if needed.
+ *
+ * @returns ERROR_OK with @a buffer filled, or ERROR_NOT_IMPLEMENTED if the
+ * read has to go to the target as usual.
+ */
+static int target_mem_cache_read(struct target *target,
+		target_addr_t address, uint32_t count, uint8_t *buffer)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (!cache || !cache->enabled || cache->filling || !count ||
+			target->state != TARGET_HALTED || target->running_alg)
+		return ERROR_NOT_IMPLEMENTED;
+
+	target_addr_t first = target_mem_cache_page_of(address);
+	target_addr_t last = target_mem_cache_page_of(address + (count - 1));
+	if (last < first)
+		return ERROR_NOT_IMPLEMENTED;
+
+	/* large reads would only push out everything else */
+	uint64_t num_pages = (last - first) / TARGET_MEM_CACHE_PAGE_SIZE + 1;
+	/* the fill reads whole pages, so they must all be free of registers */
+	if (num_pages > TARGET_MEM_CACHE_PAGES / 2 ||
+			target_mem_cache_excluded(cache, first, last + (TARGET_MEM_CACHE_PAGE_SIZE - 1))) {
+		cache->uncached++;
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	if (target_mem_cache_holds(cache, first, last)) {
+		cache->hits++;
+	} else {
+		/* one read for the whole span is cheaper than one per missing page */
+		uint32_t span = num_pages * TARGET_MEM_CACHE_PAGE_SIZE;
+		uint8_t *data = malloc(span);
+		if (!data)
+			return ERROR_NOT_IMPLEMENTED;
+
+		cache->filling = true;
+		int retval = target->type->read_buffer(target, first, span, data);
+		cache->filling = false;
+		if (retval != ERROR_OK) {
+			/* maybe just the rounding reached unreadable memory */
+			free(data);
+			cache->uncached++;
+			return ERROR_NOT_IMPLEMENTED;
+		}
+
+		for (uint64_t i = 0; i < num_pages; i++) {
+			target_addr_t page_address = first + i * TARGET_MEM_CACHE_PAGE_SIZE;
+			struct target_mem_cache_page *page = target_mem_cache_find(cache, page_address);
+			if (!page)
+				page = target_mem_cache_victim(cache);
+			page->address = page_address;
+			page->last_use = ++cache->use_count;
+			memcpy(page->data, data + i * TARGET_MEM_CACHE_PAGE_SIZE, TARGET_MEM_CACHE_PAGE_SIZE);
+		}
+		free(data);
+		cache->misses++;
+	}
+
+	for (target_addr_t page_address = first; ; page_address += TARGET_MEM_CACHE_PAGE_SIZE) {
+		struct target_mem_cache_page *page = target_mem_cache_find(cache, page_address);
+		page->last_use = ++cache->use_count;
+		target_mem_cache_copy_out(page, address, count, buffer);
+		if (page_address == last)
+			break;
+	}
+
+	return ERROR_OK;
+}
+
+/* The other targets of an SMP group see the memory written through target. */
+static void target_mem_cache_invalidate_smp(struct target *target)
+{
+	struct target_list *head;
+
+	if (!target->smp)
+		return;
+	foreach_smp_target(head, target->smp_targets) {
+		if (head->target != target)
+			target_mem_cache_invalidate(head->target);
+	}
+}
+
+/* Keep the cache coherent with a write of count bytes at address. */
+static void target_mem_cache_write(struct target *target,
+		target_addr_t address, uint32_t count, const uint8_t *buffer, int retval)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	target->memory_generation++;
+	target_mem_cache_invalidate_smp(target);
+
+	if (!cache || !count || target_mem_cache_is_empty(cache))
+		return;
+
+	target_addr_t first = target_mem_cache_page_of(address);
+	target_addr_t last = target_mem_cache_page_of(address + (count - 1));
+	if (retval != ERROR_OK || last < first || !target_mem_cache_holds(cache, first, last)) {
+		target_mem_cache_invalidate(target);
+		return;
+	}
+
+	for (target_addr_t page_address = first; ; page_address += TARGET_MEM_CACHE_PAGE_SIZE) {
+		struct target_mem_cache_page *page = target_mem_cache_find(cache, page_address);
+		target_addr_t start = MAX(address, page_address);
+		target_addr_t end = MIN(address + (count - 1), page_address + (TARGET_MEM_CACHE_PAGE_SIZE - 1));
+		memcpy(page->data + (start - page_address), buffer + (start - address), end - start + 1);
+		if (page_address == last)
+			break;
+	}
+}
+
+static void target_mem_cache_free(struct target *target)
+{
+	if (!target->mem_cache)
+		return;
+	free(target->mem_cache->excluded);
+	free(target->mem_cache);
+	target->mem_cache = NULL;
+}
+
 int target_read_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t count, uint8_t *buffer)
 {
@@ -1545,6 +1813,9 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	if ((uint64_t)size * count <= UINT32_MAX &&
+			target_mem_cache_read(target, address, size * count, buffer) == ERROR_OK)
+		return ERROR_OK;
 	return target->type->read_memory(target, address, size, count, buffer);
 }
 
@@ -1573,7 +1844,16 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
-	return target->type->write_memory(target, address, size, count, buffer);
+	int retval = target->type->write_memory(target, address, size, count, buffer);
+	if (count && size > UINT32_MAX / count) {
+		/* the range written can't be told, drop everything */
+		target->memory_generation++;
+		target_mem_cache_invalidate(target);
+		target_mem_cache_invalidate_smp(target);
+	} else {
+		target_mem_cache_write(target, address, size * count, buffer, retval);
+	}
+	return retval;
 }
 
 int target_write_phys_memory(struct target *target,
@@ -1587,6 +1867,9 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	/* the cache holds virtual addresses, so any of them may be affected */
+	target_mem_cache_invalidate(target);
+	target_mem_cache_invalidate_smp(target);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1713,6 +1996,7 @@ int target_step(struct target *target,
 	int retval;
 
 	target_call_event_callbacks(target, TARGET_EVENT_STEP_START);
+	target_mem_cache_invalidate(target);
 
 	retval = target->type->step(target, current, address, handle_breakpoints);
 	if (retval != ERROR_OK)
@@ -2066,6 +2350,19 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	struct target_event_callback *callback = target_event_callbacks;
 	struct target_event_callback *next_callback;
 
+	switch (event) {
+		case TARGET_EVENT_HALTED:
+		case TARGET_EVENT_RESUMED:
+		case TARGET_EVENT_DEBUG_HALTED:
+		case TARGET_EVENT_DEBUG_RESUMED:
+		case TARGET_EVENT_RESET_ASSERT:
+			/* whatever ran since the cache was filled may have changed memory */
+			target_mem_cache_invalidate(target);
+			break;
+		default:
+			break;
+	}
+
 	if (event == TARGET_EVENT_HALTED) {
 		/* execute early halted first */
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
@@ -2430,6 +2727,9 @@ static void target_free_all_working_areas_restore(struct target *target, int res
 
 	LOG_DEBUG("freeing all working areas");
 
+	/* the semihosting ring may live in one of them */
+	semihosting_ring_invalidate_working_area(target);
+
 	/* Loop through all areas, restoring the allocated ones and marking them as free */
 	while (c) {
 		if (!c->free) {
@@ -2514,6 +2814,7 @@ static void target_destroy(struct target *target)
 	}
 
 	rtos_destroy(target);
+	target_mem_cache_free(target);
 
 	free(target->gdb_port_override);
 	free(target->type);
@@ -2656,7 +2957,9 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
-	return target->type->write_buffer(target, address, size, buffer);
+	int retval = target->type->write_buffer(target, address, size, buffer);
+	target_mem_cache_write(target, address, size, buffer, retval);
+	return retval;
 }
 
 static int target_write_buffer_default(struct target *target,
@@ -2721,6 +3024,8 @@ int target_read_buffer(struct target *target, target_addr_t address, uint32_t si
 		return ERROR_FAIL;
 	}
 
+	if (target_mem_cache_read(target, address, size, buffer) == ERROR_OK)
+		return ERROR_OK;
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
@@ -3880,6 +4185,36 @@ static COMMAND_HELPER(parse_load_image_command, struct image *image,
 	return ERROR_OK;
 }
 
+/* Write @a length bytes of a fill section, starting @a offset bytes into
+ * it, from one expanded piece of the fill pattern. */
+static int target_write_fill_section(struct target *target, struct image *image,
+		int section, uint32_t offset, uint32_t length)
+{
+	uint32_t piece = MIN(image->sections[section].size, IMAGE_FILL_PIECE_SIZE);
+	size_t size_read;
+
+	uint8_t *buffer = malloc(piece);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = image_read_section(image, section, 0x0, piece, buffer, &size_read);
+	while (retval == ERROR_OK && length > 0) {
+		/* start each write in phase with the 4 byte pattern */
+		uint32_t phase = offset & 3;
+		uint32_t count = MIN(length, piece - phase);
+
+		retval = target_write_buffer(target, image->sections[section].base_address + offset,
+				count, buffer + phase);
+		offset += count;
+		length -= count;
+	}
+
+	free(buffer);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_load_image_command)
 {
 	uint8_t *buffer;
@@ -3905,19 +4240,29 @@ COMMAND_HANDLER(handle_load_image_command)
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
+		const uint8_t *data = NULL;
+		bool fill = image_section_is_fill(&image, i);
+
+		/* write straight from the image where it is already in memory,
+		 * fill sections piece by piece */
+		buffer = NULL;
+		buf_cnt = image.sections[i].size;
+		if (!fill && image_section_data(&image, i, 0x0, image.sections[i].size, &data) != ERROR_OK) {
+			buffer = malloc(image.sections[i].size);
+			if (!buffer) {
+				command_print(CMD,
+							  "error allocating buffer for section (%d bytes)",
+							  (int)(image.sections[i].size));
+				retval = ERROR_FAIL;
+				break;
+			}
 
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
+			retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				break;
+			}
+			data = buffer;
 		}
 
 		uint32_t offset = 0;
@@ -3937,8 +4282,11 @@ COMMAND_HANDLER(handle_load_image_command)
 			if (image.sections[i].base_address + buf_cnt > max_address)
 				length -= (image.sections[i].base_address + buf_cnt)-max_address;
 
-			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
+			if (fill)
+				retval = target_write_fill_section(target, &image, i, offset, length);
+			else
+				retval = target_write_buffer(target,
+						image.sections[i].base_address + offset, length, data + offset);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -4081,35 +4429,19 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	int diffs = 0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
-			break;
-		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
-		}
+		buf_cnt = image.sections[i].size;
 
 		if (verify >= IMAGE_VERIFY) {
-			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
-			if (retval != ERROR_OK) {
-				free(buffer);
+			/* checksum of image, known up front for cached images */
+			retval = image_section_checksum(&image, i, &checksum);
+			if (retval != ERROR_OK)
 				break;
-			}
 
 			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
-			if (retval != ERROR_OK) {
-				free(buffer);
+			if (retval != ERROR_OK)
 				break;
-			}
 			if ((checksum != mem_checksum) && (verify == IMAGE_CHECKSUM_ONLY)) {
 				LOG_ERROR("checksum mismatch");
-				free(buffer);
 				retval = ERROR_FAIL;
 				goto done;
 			}
@@ -4120,6 +4452,19 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				if (diffs == 0)
 					LOG_ERROR("checksum mismatch - attempting binary compare");
 
+				buffer = malloc(buf_cnt);
+				if (!buffer) {
+					command_print(CMD,
+							"error allocating buffer for section (%" PRIu32 " bytes)",
+							image.sections[i].size);
+					break;
+				}
+				retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+				if (retval != ERROR_OK) {
+					free(buffer);
+					break;
+				}
+
 				data = malloc(buf_cnt);
 
 				retval = target_read_buffer(target, image.sections[i].base_address, buf_cnt, data);
@@ -4144,6 +4489,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 					}
 				}
 				free(data);
+				free(buffer);
 			}
 		} else {
 			command_print(CMD, "address " TARGET_ADDR_FMT " length 0x%08zx",
@@ -4151,7 +4497,6 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 						  buf_cnt);
 		}
 
-		free(buffer);
 		image_size += buf_cnt;
 	}
 	if (diffs > 0)
@@ -6128,6 +6473,76 @@ static int jim_target_wait_state(Jim_Interp *interp, int argc, Jim_Obj *const *a
 	}
 	return JIM_OK;
 }
+
+COMMAND_HANDLER(handle_target_mem_cache)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 0 && !target->mem_cache) {
+		target->mem_cache = calloc(1, sizeof(*target->mem_cache));
+		if (!target->mem_cache) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (CMD_ARGC == 1 && !strcmp(CMD_ARGV[0], "flush")) {
+		target_mem_cache_invalidate(target);
+	} else if (CMD_ARGC == 2 && !strcmp(CMD_ARGV[0], "exclude") && !strcmp(CMD_ARGV[1], "none")) {
+		free(cache->excluded);
+		cache->excluded = NULL;
+		cache->num_excluded = 0;
+	} else if (CMD_ARGC == 3 && !strcmp(CMD_ARGV[0], "exclude")) {
+		struct target_mem_cache_range range;
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], range.address);
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[2], range.size);
+		if (!range.size || range.address + (range.size - 1) < range.address) {
+			command_print(CMD, "invalid range");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		struct target_mem_cache_range *excluded = realloc(cache->excluded,
+				(cache->num_excluded + 1) * sizeof(*excluded));
+		if (!excluded) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		excluded[cache->num_excluded++] = range;
+		cache->excluded = excluded;
+		/* pages read before may cover the range now excluded */
+		target_mem_cache_invalidate(target);
+	} else if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+		cache->enabled = enable;
+		target_mem_cache_invalidate(target);
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (!cache) {
+		command_print(CMD, "memory cache: disabled");
+		return ERROR_OK;
+	}
+
+	unsigned int used = 0;
+	for (unsigned int i = 0; i < TARGET_MEM_CACHE_PAGES; i++) {
+		if (cache->pages[i].last_use)
+			used++;
+	}
+	command_print(CMD, "memory cache: %s, %u/%u pages of %u bytes in use",
+			cache->enabled ? "enabled" : "disabled",
+			used, TARGET_MEM_CACHE_PAGES, TARGET_MEM_CACHE_PAGE_SIZE);
+	command_print(CMD, "hits: %" PRIu64 ", misses: %" PRIu64 ", uncached: %" PRIu64
+			", invalidations: %" PRIu64,
+			cache->hits, cache->misses, cache->uncached, cache->invalidations);
+	for (unsigned int i = 0; i < cache->num_excluded; i++)
+		command_print(CMD, "excluded: " TARGET_ADDR_FMT "-" TARGET_ADDR_FMT,
+				cache->excluded[i].address,
+				cache->excluded[i].address + (cache->excluded[i].size - 1));
+	return ERROR_OK;
+}
+
 /* List for human, Events defined for this target.
  * scripts/programs should use 'name cget -event NAME'
  */
@@ -6300,6 +6715,15 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
 		.usage = "address width data ['phys']",
 	},
+	{
+		.name = "mem_cache",
+		.handler = handle_target_mem_cache,
+		.mode = COMMAND_ANY,
+		.help = "Display the memory read cache of this target and its "
+			"statistics, enable, disable or flush it, or exclude a "
+			"range of memory mapped registers from it",
+		.usage = "['enable'|'disable'|'flush'|'exclude' ('none'|address size)]",
+	},
 	{
 		.name = "eventlist",
 		.handler = handle_target_event_list,
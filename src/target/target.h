@@ -46,6 +46,7 @@ struct mem_param;
 struct reg_param;
 struct target_list;
 struct gdb_fileio_info;
+struct target_mem_cache;
 
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
@@ -222,6 +223,13 @@ struct target {
 
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* Memory read cache used while the target is halted, NULL until
+	 * configured with the mem_cache command. */
+	struct target_mem_cache *mem_cache;
+	/* Incremented whenever target memory may have changed: on every write,
+	 * resume, step, reset and algorithm run. */
+	unsigned int memory_generation;
 };
 
 struct target_list {
@@ -696,6 +704,13 @@ int target_write_buffer(struct target *target,
 		target_addr_t address, uint32_t size, const uint8_t *buffer);
 int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
+
+/**
+ * Forget all memory held by the memory read cache of @a target and bump
+ * its memory_generation. Used when memory changes behind the back of the
+ * memory access functions, e.g. by a flash driver.
+ */
+void target_mem_cache_invalidate(struct target *target);
 int target_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *crc);
 int target_blank_check_memory(struct target *target,
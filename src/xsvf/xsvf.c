@@ -197,11 +197,399 @@ static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
 	return ERROR_OK;
 }
 
+/* Limits on how much speculative scan data one batch may queue before the
+ * captured TDO is checked.
+ */
+#define XSVF_BATCH_MAX_SCANS	256
+#define XSVF_BATCH_MAX_BYTES	(1024 * 1024)
+
+/* One XSDR-class data scan, kept until its TDO has been checked so it can
+ * be shifted again if it does not match.
+ */
+struct xsvf_scan {
+	const char *op_name;
+	long file_offset;
+	int num_bits;
+	uint8_t *out;			/* TDI */
+	uint8_t *in;			/* captured TDO */
+	uint8_t *expected;		/* NULL when TDO is not checked */
+	uint8_t *mask;			/* NULL compares every bit */
+	int limit;			/* number of attempts allowed */
+	int xruntest;			/* wait after a good scan, 0 for none */
+	tap_state_t end_state;		/* state after a good scan without a wait */
+};
+
+struct xsvf_batch {
+	struct jtag_tap *tap;
+	bool runtest_requires_tck;
+	bool verbose;
+	/* queue consecutive scans and check them together */
+	bool speculate;
+	unsigned int count;
+	size_t bytes;
+	long fail_offset;
+	struct xsvf_scan scans[XSVF_BATCH_MAX_SCANS];
+};
+
+static struct xsvf_batch xsvf_batch;
+
+/* TDI and expected TDO of an XSDRB ... XSDRE run, shifted as one scan */
+struct xsvf_segment {
+	int num_bits;
+	bool check;
+	uint8_t *out;
+	uint8_t *expected;
+	uint8_t *mask;
+};
+
+static uint8_t *xsvf_dup_buffer(const uint8_t *buf, int num_bits)
+{
+	uint8_t *copy;
+
+	if (!buf)
+		return NULL;
+	copy = malloc(DIV_ROUND_UP(num_bits, 8));
+	if (copy)
+		memcpy(copy, buf, DIV_ROUND_UP(num_bits, 8));
+	return copy;
+}
+
+static void xsvf_scan_free(struct xsvf_scan *scan)
+{
+	free(scan->out);
+	free(scan->in);
+	free(scan->expected);
+	free(scan->mask);
+}
+
+static void xsvf_batch_reset(struct xsvf_batch *batch)
+{
+	for (unsigned int i = 0; i < batch->count; i++)
+		xsvf_scan_free(&batch->scans[i]);
+	batch->count = 0;
+	batch->bytes = 0;
+}
+
+static void xsvf_queue_scan(struct xsvf_batch *batch, struct xsvf_scan *scan)
+{
+	struct scan_field field;
+
+	field.num_bits = scan->num_bits;
+	field.out_value = scan->out;
+	field.in_value = scan->in;
+
+	if (!batch->tap)
+		jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value,
+				TAP_DRPAUSE);
+	else
+		jtag_add_dr_scan(batch->tap, 1, &field, TAP_DRPAUSE);
+}
+
+/* See page 19 of XSVF spec regarding opcode "XSDR" */
+static int xsvf_queue_post(struct xsvf_batch *batch, struct xsvf_scan *scan)
+{
+	int result;
+
+	if (scan->xruntest) {
+		result = svf_add_statemove(TAP_IDLE);
+		if (result != ERROR_OK)
+			return result;
+
+		if (batch->runtest_requires_tck)
+			jtag_add_clocks(scan->xruntest);
+		else
+			jtag_add_sleep(scan->xruntest);
+	} else if (scan->end_state != TAP_DRPAUSE) {
+		/* we are already in TAP_DRPAUSE */
+		result = svf_add_statemove(scan->end_state);
+		if (result != ERROR_OK)
+			return result;
+	}
+
+	return ERROR_OK;
+}
+
+static bool xsvf_scan_matches(struct xsvf_scan *scan)
+{
+	bool mismatch;
+
+	if (!scan->expected)
+		return true;
+
+	if (scan->mask)
+		mismatch = buf_cmp_mask(scan->in, scan->expected, scan->mask, scan->num_bits);
+	else
+		mismatch = buf_cmp(scan->in, scan->expected, scan->num_bits);
+
+	if (mismatch) {
+		int bits = MIN(scan->num_bits, DEBUG_JTAG_IOZ);
+		char *captured_str = buf_to_hex_str(scan->in, bits);
+		char *expected_str = buf_to_hex_str(scan->expected, bits);
+
+		LOG_DEBUG("%s captured 0x%s, expected 0x%s", scan->op_name,
+				captured_str, expected_str);
+		free(captured_str);
+		free(expected_str);
+	}
+
+	return !mismatch;
+}
+
+/* Shift one scan record by record until it matches or runs out of
+ * attempts.  'in_pause' tells whether the TAP is still in DRPAUSE right
+ * after the failed attempt, which the XC9500 exception sequence needs.
+ */
+static int xsvf_retry_scan(struct xsvf_batch *batch, struct xsvf_scan *scan,
+		int attempt, bool in_pause)
+{
+	int result;
+
+	for (; attempt < scan->limit; ++attempt) {
+		if (attempt > 0) {
+			/* perform the XC9500 exception handling sequence shown in xapp067.pdf and
+			 * illustrated in pseudo code at end of this file.  We start from state
+			 * DRPAUSE:
+			 * go to Exit2-DR
+			 * go to Shift-DR
+			 * go to Exit1-DR
+			 * go to Update-DR
+			 * go to Run-Test/Idle
+			 *
+			 * This sequence should be harmless for other devices, and it
+			 * will be skipped entirely if xrepeat is set to zero.
+			 */
+
+			static tap_state_t exception_path[] = {
+				TAP_DREXIT2,
+				TAP_DRSHIFT,
+				TAP_DREXIT1,
+				TAP_DRUPDATE,
+				TAP_IDLE,
+			};
+
+			if (in_pause)
+				jtag_add_pathmove(ARRAY_SIZE(exception_path), exception_path);
+
+			if (batch->verbose)
+				LOG_USER("%s mismatch, xsdrsize=%d retry=%d",
+						scan->op_name,
+						scan->num_bits,
+						attempt);
+		}
+
+		xsvf_queue_scan(batch, scan);
+
+		/* LOG_DEBUG("FLUSHING QUEUE"); */
+		result = jtag_execute_queue();
+		if (result != ERROR_OK)
+			return result;
+		in_pause = true;
+
+		if (xsvf_scan_matches(scan))
+			return xsvf_queue_post(batch, scan);
+	}
+
+	LOG_USER("%s mismatch", scan->op_name);
+	return ERROR_XSVF_FAILED;
+}
+
+/* Run the queued scans and check their TDO.  A mismatch while speculating
+ * means the scans behind it were shifted too early: the failing scan gets
+ * its remaining attempts and everything after it is shifted again, one
+ * record at a time.
+ */
+static int xsvf_batch_flush(struct xsvf_batch *batch)
+{
+	int result;
+
+	if (!batch->count)
+		return ERROR_OK;
+
+	result = jtag_execute_queue();
+	if (result != ERROR_OK) {
+		batch->fail_offset = batch->scans[0].file_offset;
+		xsvf_batch_reset(batch);
+		return result;
+	}
+
+	for (unsigned int i = 0; i < batch->count; i++) {
+		struct xsvf_scan *scan = &batch->scans[i];
+
+		if (xsvf_scan_matches(scan)) {
+			if (!batch->speculate) {
+				result = xsvf_queue_post(batch, scan);
+				if (result != ERROR_OK)
+					break;
+			}
+			continue;
+		}
+
+		if (batch->speculate)
+			LOG_DEBUG("%s mismatch at offset %ld, replaying %u queued scans",
+					scan->op_name, scan->file_offset, batch->count - i);
+
+		for (unsigned int j = i; j < batch->count; j++) {
+			result = xsvf_retry_scan(batch, &batch->scans[j], j == i ? 1 : 0,
+					!batch->speculate);
+			if (result != ERROR_OK) {
+				batch->fail_offset = batch->scans[j].file_offset;
+				break;
+			}
+		}
+		break;
+	}
+
+	xsvf_batch_reset(batch);
+	return result;
+}
+
+/* Queue a data scan.  Without speculation it is checked right away. */
+static int xsvf_batch_add(struct xsvf_batch *batch, const char *op_name, long file_offset,
+		int num_bits, const uint8_t *out, const uint8_t *expected, const uint8_t *mask,
+		int limit, int xruntest, tap_state_t end_state)
+{
+	struct xsvf_scan *scan = &batch->scans[batch->count];
+	int result;
+
+	scan->op_name = op_name;
+	scan->file_offset = file_offset;
+	scan->num_bits = num_bits;
+	scan->out = xsvf_dup_buffer(out, num_bits);
+	scan->in = calloc(DIV_ROUND_UP(num_bits, 8), 1);
+	scan->expected = xsvf_dup_buffer(expected, num_bits);
+	scan->mask = xsvf_dup_buffer(mask, num_bits);
+	scan->limit = MAX(limit, 1);
+	scan->xruntest = xruntest;
+	scan->end_state = end_state;
+	if (!scan->out || !scan->in || (expected && !scan->expected) || (mask && !scan->mask)) {
+		LOG_ERROR("XSVF: out of memory");
+		xsvf_scan_free(scan);
+		batch->fail_offset = file_offset;
+		return ERROR_FAIL;
+	}
+	batch->count++;
+	batch->bytes += DIV_ROUND_UP(num_bits, 8);
+
+	xsvf_queue_scan(batch, scan);
+
+	if (batch->speculate) {
+		result = xsvf_queue_post(batch, scan);
+		if (result != ERROR_OK)
+			return result;
+		if (batch->count < XSVF_BATCH_MAX_SCANS && batch->bytes < XSVF_BATCH_MAX_BYTES)
+			return ERROR_OK;
+	}
+
+	return xsvf_batch_flush(batch);
+}
+
+/* Opcodes that only read data scans or the state they depend on, and so
+ * may sit between the scans of one batch.
+ */
+static bool xsvf_batchable(uint8_t opcode)
+{
+	switch (opcode) {
+		case XTDOMASK:
+		case XRUNTEST:
+		case XREPEAT:
+		case XSDRSIZE:
+		case XSDR:
+		case XSDRTDO:
+		case XSETSDRMASKS:
+		case XSDRINC:
+		case XSDRB:
+		case XSDRC:
+		case XSDRE:
+		case XSDRTDOB:
+		case XSDRTDOC:
+		case XSDRTDOE:
+		case XENDIR:
+		case XENDDR:
+		case XCOMMENT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static int xsvf_segment_append(struct xsvf_segment *seg, int num_bits,
+		const uint8_t *out, const uint8_t *expected)
+{
+	int total = seg->num_bits + num_bits;
+	size_t old_bytes = DIV_ROUND_UP(seg->num_bits, 8);
+	size_t new_bytes = DIV_ROUND_UP(total, 8);
+	uint8_t *bufs[3];
+
+	bufs[0] = realloc(seg->out, new_bytes);
+	if (bufs[0])
+		seg->out = bufs[0];
+	bufs[1] = realloc(seg->expected, new_bytes);
+	if (bufs[1])
+		seg->expected = bufs[1];
+	bufs[2] = realloc(seg->mask, new_bytes);
+	if (bufs[2])
+		seg->mask = bufs[2];
+	if (!bufs[0] || !bufs[1] || !bufs[2]) {
+		LOG_ERROR("XSVF: out of memory");
+		return ERROR_FAIL;
+	}
+
+	memset(seg->out + old_bytes, 0, new_bytes - old_bytes);
+	memset(seg->expected + old_bytes, 0, new_bytes - old_bytes);
+	memset(seg->mask + old_bytes, 0, new_bytes - old_bytes);
+
+	buf_set_buf(out, 0, seg->out, seg->num_bits, num_bits);
+	if (expected) {
+		buf_set_buf(expected, 0, seg->expected, seg->num_bits, num_bits);
+		for (int i = 0; i < num_bits; i++)
+			buf_set_u32(seg->mask, seg->num_bits + i, 1, 1);
+		seg->check = true;
+	}
+	seg->num_bits = total;
+
+	return ERROR_OK;
+}
+
+static void xsvf_segment_reset(struct xsvf_segment *seg)
+{
+	free(seg->out);
+	free(seg->expected);
+	free(seg->mask);
+	memset(seg, 0, sizeof(*seg));
+}
+
+/* XSDRINC: add one to the address bits selected by 'addr_mask', then
+ * scatter 'data' into the bits selected by 'data_mask'.
+ */
+static void xsvf_sdr_masking(uint8_t *buf, int num_bits, const uint8_t *addr_mask,
+		const uint8_t *data_mask, const uint8_t *data)
+{
+	bool carry = true;
+	int data_bit = 0;
+
+	for (int i = 0; i < num_bits; i++) {
+		if (carry && buf_get_u32(addr_mask, i, 1)) {
+			uint32_t bit = buf_get_u32(buf, i, 1);
+
+			buf_set_u32(buf, i, 1, bit ^ 1);
+			carry = bit;
+		}
+		if (buf_get_u32(data_mask, i, 1))
+			buf_set_u32(buf, i, 1, buf_get_u32(data, data_bit++, 1));
+	}
+}
+
 COMMAND_HANDLER(handle_xsvf_command)
 {
 	uint8_t *dr_out_buf = NULL;				/* from host to device (TDI) */
 	uint8_t *dr_in_buf = NULL;				/* from device to host (TDO) */
 	uint8_t *dr_in_mask = NULL;
+	uint8_t *sdr_addr_mask = NULL;			/* from XSETSDRMASKS */
+	uint8_t *sdr_data_mask = NULL;
+	uint8_t *sdr_data = NULL;
+	int sdr_masks_size = 0;
+	int sdr_data_bits = 0;
+	struct xsvf_segment seg = { 0 };
 
 	int xsdrsize = 0;
 	int xruntest = 0;					/* number of TCK cycles OR *microseconds */
@@ -246,6 +634,7 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 	/* we mess with CMD_ARGV starting point below, snapshot filename here */
 	const char *filename = CMD_ARGV[1];
+	bool speculate = false;
 
 	if (strcmp(CMD_ARGV[0], "plain") != 0) {
 		tap = jtag_tap_by_string(CMD_ARGV[0]);
@@ -269,8 +658,21 @@ COMMAND_HANDLER(handle_xsvf_command)
 		++CMD_ARGV;
 	}
 
-	if ((CMD_ARGC > 2) && (strcmp(CMD_ARGV[2], "quiet") == 0))
+	if ((CMD_ARGC > 2) && (strcmp(CMD_ARGV[2], "quiet") == 0)) {
 		verbose = 0;
+		--CMD_ARGC;
+		++CMD_ARGV;
+	}
+
+	/* queue runs of data scans and check their TDO after one flush */
+	if ((CMD_ARGC > 2) && (strcmp(CMD_ARGV[2], "batch") == 0))
+		speculate = true;
+
+	xsvf_batch.tap = tap;
+	xsvf_batch.runtest_requires_tck = runtest_requires_tck;
+	xsvf_batch.verbose = verbose;
+	xsvf_batch.speculate = speculate;
+	xsvf_batch.fail_offset = 0;
 
 	LOG_WARNING("XSVF support in OpenOCD is limited. Consider using SVF instead");
 	LOG_USER("xsvf processing file: \"%s\"", filename);
@@ -279,6 +681,23 @@ COMMAND_HANDLER(handle_xsvf_command)
 		/* record the position of this opcode within the file */
 		file_offset = lseek(xsvf_fd, 0, SEEK_CUR) - 1;
 
+		if (seg.num_bits && opcode != XSDRC && opcode != XSDRE
+				&& opcode != XSDRTDOC && opcode != XSDRTDOE && opcode != XCOMMENT) {
+			LOG_ERROR("XSVF: XSDRB run not terminated by XSDRE");
+			do_abort = 1;
+			break;
+		}
+
+		/* anything else needs the queued data scans checked first */
+		if (!xsvf_batchable(opcode)) {
+			result = xsvf_batch_flush(&xsvf_batch);
+			if (result != ERROR_OK) {
+				file_offset = xsvf_batch.fail_offset;
+				tdo_mismatch = 1;
+				break;
+			}
+		}
+
 		/* maybe collect another state for a pathmove();
 		 * or terminate a path.
 		 */
@@ -425,10 +844,6 @@ COMMAND_HANDLER(handle_xsvf_command)
 			case XSDR:		/* these two are identical except for the dr_in_buf */
 			case XSDRTDO:
 			{
-				int limit = xrepeat;
-				int matched = 0;
-				int attempt;
-
 				const char *op_name = (opcode == XSDR ? "XSDR" : "XSDRTDO");
 
 				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK) {
@@ -444,133 +859,138 @@ COMMAND_HANDLER(handle_xsvf_command)
 					}
 				}
 
-				if (limit < 1)
-					limit = 1;
-
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
-				for (attempt = 0; attempt < limit; ++attempt) {
-					struct scan_field field;
+				result = xsvf_batch_add(&xsvf_batch, op_name, file_offset, xsdrsize,
+						dr_out_buf, dr_in_buf, dr_in_mask, xrepeat, xruntest,
+						xendir != TAP_DRPAUSE ? xenddr : TAP_DRPAUSE);
+				if (result != ERROR_OK) {
+					file_offset = xsvf_batch.fail_offset;
+					tdo_mismatch = 1;
+				}
+			}
+			break;
 
-					if (attempt > 0) {
-						/* perform the XC9500 exception handling sequence shown in xapp067.pdf and
-						 * illustrated in pseudo code at end of this file.  We start from state
-						 * DRPAUSE:
-						 * go to Exit2-DR
-						 * go to Shift-DR
-						 * go to Exit1-DR
-						 * go to Update-DR
-						 * go to Run-Test/Idle
-						 *
-						 * This sequence should be harmless for other devices, and it
-						 * will be skipped entirely if xrepeat is set to zero.
-						 */
-
-						static tap_state_t exception_path[] = {
-							TAP_DREXIT2,
-							TAP_DRSHIFT,
-							TAP_DREXIT1,
-							TAP_DRUPDATE,
-							TAP_IDLE,
-						};
-
-						jtag_add_pathmove(ARRAY_SIZE(exception_path), exception_path);
-
-						if (verbose)
-							LOG_USER("%s mismatch, xsdrsize=%d retry=%d",
-									op_name,
-									xsdrsize,
-									attempt);
-					}
+			case XSETSDRMASKS:
+			{
+				int num_bytes = (xsdrsize + 7) / 8;
+
+				free(sdr_addr_mask);
+				free(sdr_data_mask);
+				free(sdr_data);
+				sdr_addr_mask = malloc(num_bytes);
+				sdr_data_mask = malloc(num_bytes);
+				sdr_data = malloc(num_bytes);
+				sdr_masks_size = xsdrsize;
+
+				if (!sdr_addr_mask || !sdr_data_mask || !sdr_data) {
+					LOG_ERROR("Out of memory");
+					free(sdr_addr_mask);
+					free(sdr_data_mask);
+					free(sdr_data);
+					sdr_addr_mask = NULL;
+					sdr_data_mask = NULL;
+					sdr_data = NULL;
+					do_abort = 1;
+					break;
+				}
 
-					field.num_bits = xsdrsize;
-					field.out_value = dr_out_buf;
-					field.in_value = calloc(DIV_ROUND_UP(field.num_bits, 8), 1);
+				if (xsvf_read_buffer(xsdrsize, xsvf_fd, sdr_addr_mask) != ERROR_OK
+						|| xsvf_read_buffer(xsdrsize, xsvf_fd, sdr_data_mask) != ERROR_OK) {
+					do_abort = 1;
+					break;
+				}
 
-					if (!tap)
-						jtag_add_plain_dr_scan(field.num_bits,
-								field.out_value,
-								field.in_value,
-								TAP_DRPAUSE);
-					else
-						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+				sdr_data_bits = 0;
+				for (int i = 0; i < xsdrsize; i++)
+					sdr_data_bits += buf_get_u32(sdr_data_mask, i, 1);
 
-					jtag_check_value_mask(&field, dr_in_buf, dr_in_mask);
+				LOG_DEBUG("XSETSDRMASKS %d data bits", sdr_data_bits);
+			}
+			break;
 
-					free(field.in_value);
+			case XSDRINC:
+			{
+				uint8_t num_times;
 
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
-					if (result == ERROR_OK) {
-						matched = 1;
-						break;
-					}
+				if (!sdr_addr_mask || sdr_masks_size != xsdrsize) {
+					LOG_ERROR("XSDRINC without matching XSETSDRMASKS");
+					unsupported = 1;
+					break;
 				}
 
-				if (!matched) {
-					LOG_USER("%s mismatch", op_name);
-					tdo_mismatch = 1;
+				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK
+						|| read(xsvf_fd, &num_times, 1) != 1) {
+					do_abort = 1;
 					break;
 				}
 
-				/* See page 19 of XSVF spec regarding opcode "XSDR" */
-				if (xruntest) {
-					result = svf_add_statemove(TAP_IDLE);
-					if (result != ERROR_OK)
-						return result;
+				LOG_DEBUG("XSDRINC %d x%d", xsdrsize, num_times);
+
+				/* the start address, then one scan per data item */
+				for (int i = 0; i <= num_times; i++) {
+					if (i > 0) {
+						if (xsvf_read_buffer(sdr_data_bits, xsvf_fd, sdr_data) != ERROR_OK) {
+							do_abort = 1;
+							break;
+						}
+						xsvf_sdr_masking(dr_out_buf, xsdrsize, sdr_addr_mask,
+								sdr_data_mask, sdr_data);
+					}
 
-					if (runtest_requires_tck)
-						jtag_add_clocks(xruntest);
-					else
-						jtag_add_sleep(xruntest);
-				} else if (xendir != TAP_DRPAUSE) {
-					/* we are already in TAP_DRPAUSE */
-					result = svf_add_statemove(xenddr);
-					if (result != ERROR_OK)
-						return result;
+					result = xsvf_batch_add(&xsvf_batch, "XSDRINC", file_offset,
+							xsdrsize, dr_out_buf, dr_in_buf, dr_in_mask, xrepeat,
+							xruntest, xendir != TAP_DRPAUSE ? xenddr : TAP_DRPAUSE);
+					if (result != ERROR_OK) {
+						file_offset = xsvf_batch.fail_offset;
+						tdo_mismatch = 1;
+						break;
+					}
 				}
 			}
 			break;
 
-			case XSETSDRMASKS:
-				LOG_ERROR("unsupported XSETSDRMASKS");
-				unsupported = 1;
-				break;
-
-			case XSDRINC:
-				LOG_ERROR("unsupported XSDRINC");
-				unsupported = 1;
-				break;
-
+			/* XSDRB starts a shift that XSDRC continues and XSDRE ends.
+			 * The run is collected and shifted as one scan at XSDRE.
+			 */
 			case XSDRB:
-				LOG_ERROR("unsupported XSDRB");
-				unsupported = 1;
-				break;
-
 			case XSDRC:
-				LOG_ERROR("unsupported XSDRC");
-				unsupported = 1;
-				break;
-
 			case XSDRE:
-				LOG_ERROR("unsupported XSDRE");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOB:
-				LOG_ERROR("unsupported XSDRTDOB");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOC:
-				LOG_ERROR("unsupported XSDRTDOC");
-				unsupported = 1;
-				break;
-
 			case XSDRTDOE:
-				LOG_ERROR("unsupported XSDRTDOE");
-				unsupported = 1;
-				break;
+			{
+				bool check = opcode >= XSDRTDOB;
+
+				if (xsvf_read_buffer(xsdrsize, xsvf_fd, dr_out_buf) != ERROR_OK
+						|| (check && xsvf_read_buffer(xsdrsize, xsvf_fd,
+								dr_in_buf) != ERROR_OK)) {
+					do_abort = 1;
+					break;
+				}
+
+				LOG_DEBUG("XSDR%s%c %d", check ? "TDO" : "",
+						"BCE"[(opcode - XSDRB) % 3], xsdrsize);
+
+				if (xsvf_segment_append(&seg, xsdrsize, dr_out_buf,
+						check ? dr_in_buf : NULL) != ERROR_OK) {
+					do_abort = 1;
+					break;
+				}
+
+				if (opcode != XSDRE && opcode != XSDRTDOE)
+					break;
+
+				result = xsvf_batch_add(&xsvf_batch, check ? "XSDRTDOE" : "XSDRE",
+						file_offset, seg.num_bits, seg.out,
+						seg.check ? seg.expected : NULL, seg.mask, 1, 0, xenddr);
+				xsvf_segment_reset(&seg);
+				if (result != ERROR_OK) {
+					file_offset = xsvf_batch.fail_offset;
+					tdo_mismatch = 1;
+				}
+			}
+			break;
 
 			case XSTATE:
 			{
@@ -990,20 +1410,37 @@ COMMAND_HANDLER(handle_xsvf_command)
 				unsupported = 1;
 		}
 
-		if (do_abort || unsupported || tdo_mismatch) {
-			LOG_DEBUG("xsvf failed, setting taps to reasonable state");
-
-			/* upon error, return the TAPs to a reasonable state */
-			result = svf_add_statemove(TAP_IDLE);
-			if (result != ERROR_OK)
-				return result;
-			result = jtag_execute_queue();
-			if (result != ERROR_OK)
-				return result;
+		if (do_abort || unsupported || tdo_mismatch)
 			break;
+	}
+
+	/* the file may end without XCOMPLETE */
+	if (!do_abort && !unsupported && !tdo_mismatch) {
+		result = xsvf_batch_flush(&xsvf_batch);
+		if (result != ERROR_OK) {
+			file_offset = xsvf_batch.fail_offset;
+			tdo_mismatch = 1;
 		}
 	}
 
+	xsvf_batch_reset(&xsvf_batch);
+	xsvf_segment_reset(&seg);
+	free(sdr_addr_mask);
+	free(sdr_data_mask);
+	free(sdr_data);
+
+	if (do_abort || unsupported || tdo_mismatch) {
+		LOG_DEBUG("xsvf failed, setting taps to reasonable state");
+
+		/* upon error, return the TAPs to a reasonable state */
+		result = svf_add_statemove(TAP_IDLE);
+		if (result != ERROR_OK)
+			return result;
+		result = jtag_execute_queue();
+		if (result != ERROR_OK)
+			return result;
+	}
+
 	if (tdo_mismatch) {
 		command_print(CMD,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
@@ -1044,8 +1481,10 @@ static const struct command_registration xsvf_command_handlers[] = {
 		.help = "Runs a XSVF file.  If 'virt2' is given, xruntest "
 			"counts are interpreted as TCK cycles rather than "
 			"as microseconds.  Without the 'quiet' option, all "
-			"comments, retries, and mismatches will be reported.",
-		.usage = "(tapname|'plain') filename ['virt2'] ['quiet']",
+			"comments, retries, and mismatches will be reported.  "
+			"With 'batch', runs of data scans are checked after "
+			"one flush and replayed one by one on a mismatch.",
+		.usage = "(tapname|'plain') filename ['virt2'] ['quiet'] ['batch']",
 	},
 	COMMAND_REGISTRATION_DONE
 };